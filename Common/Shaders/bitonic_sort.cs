@@ -0,0 +1,40 @@
+#version 430
+
+// Must match BITONIC_SORT_GROUP_SIZE
+layout (local_size_x = 256) in;
+
+layout (std430, binding = 6) buffer KeyBuffer {
+    float gKeys[];
+};
+
+layout (std430, binding = 7) buffer ValueBuffer {
+    uint gValues[];
+};
+
+uniform uint gBlockSize;
+uniform bool gFlip;
+
+// One invocation per pair of elements. All the comparisons sort in ascending
+// order - the flip step compares an element of the first half of the block
+// with its mirror in the second half so there is no need for descending runs.
+void main()
+{
+    uint t = gl_GlobalInvocationID.x;
+    uint HalfSize = gBlockSize / 2u;
+    uint BlockStart = (t / HalfSize) * gBlockSize;
+    uint r = t % HalfSize;
+
+    uint i = BlockStart + r;
+    uint j = gFlip ? BlockStart + gBlockSize - 1u - r : i + HalfSize;
+
+    float KeyI = gKeys[i];
+    float KeyJ = gKeys[j];
+
+    if (KeyI > KeyJ) {
+        gKeys[i] = KeyJ;
+        gKeys[j] = KeyI;
+        uint Temp = gValues[i];
+        gValues[i] = gValues[j];
+        gValues[j] = Temp;
+    }
+}
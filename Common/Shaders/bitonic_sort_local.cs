@@ -0,0 +1,87 @@
+#version 430
+
+// Must match BITONIC_SORT_BLOCK_SIZE. Every invocation owns two elements.
+const uint BLOCK_SIZE = 1024u;
+
+layout (local_size_x = 512) in;
+
+layout (std430, binding = 6) buffer KeyBuffer {
+    float gKeys[];
+};
+
+layout (std430, binding = 7) buffer ValueBuffer {
+    uint gValues[];
+};
+
+uniform uint gBlockOffset;
+uniform bool gPresort;
+
+shared float sKeys[BLOCK_SIZE];
+shared uint sValues[BLOCK_SIZE];
+
+void CompareAndSwap(uint i, uint j)
+{
+    if (sKeys[i] > sKeys[j]) {
+        float Key = sKeys[i];
+        sKeys[i] = sKeys[j];
+        sKeys[j] = Key;
+        uint Value = sValues[i];
+        sValues[i] = sValues[j];
+        sValues[j] = Value;
+    }
+}
+
+void Flip(uint BlockSize)
+{
+    uint HalfSize = BlockSize / 2u;
+    uint t = gl_LocalInvocationID.x;
+    uint BlockStart = (t / HalfSize) * BlockSize;
+    uint r = t % HalfSize;
+    CompareAndSwap(BlockStart + r, BlockStart + BlockSize - 1u - r);
+}
+
+void Disperse(uint BlockSize)
+{
+    uint HalfSize = BlockSize / 2u;
+    uint t = gl_LocalInvocationID.x;
+    uint i = (t / HalfSize) * BlockSize + t % HalfSize;
+    CompareAndSwap(i, i + HalfSize);
+}
+
+void main()
+{
+    uint Base = gBlockOffset + gl_WorkGroupID.x * BLOCK_SIZE;
+    uint t = gl_LocalInvocationID.x;
+    uint HalfBlock = BLOCK_SIZE / 2u;
+
+    sKeys[t] = gKeys[Base + t];
+    sKeys[t + HalfBlock] = gKeys[Base + t + HalfBlock];
+    sValues[t] = gValues[Base + t];
+    sValues[t + HalfBlock] = gValues[Base + t + HalfBlock];
+    barrier();
+
+    if (gPresort) {
+        // All the stages up to the block size
+        for (uint BlockSize = 2u ; BlockSize <= BLOCK_SIZE ; BlockSize *= 2u) {
+            Flip(BlockSize);
+            barrier();
+
+            for (uint HalfSize = BlockSize / 2u ; HalfSize >= 2u ; HalfSize /= 2u) {
+                Disperse(HalfSize);
+                barrier();
+            }
+        }
+    }
+    else {
+        // The end of a stage whose first steps were done by bitonic_sort.cs
+        for (uint BlockSize = BLOCK_SIZE ; BlockSize >= 2u ; BlockSize /= 2u) {
+            Disperse(BlockSize);
+            barrier();
+        }
+    }
+
+    gKeys[Base + t] = sKeys[t];
+    gKeys[Base + t + HalfBlock] = sKeys[t + HalfBlock];
+    gValues[Base + t] = sValues[t];
+    gValues[Base + t + HalfBlock] = sValues[t + HalfBlock];
+}
@@ -0,0 +1,128 @@
+#version 430
+
+// Must match ogldev_clustered_lighting.h
+const int CLUSTER_GRID_X = 16;
+const int CLUSTER_GRID_Y = 9;
+const int CLUSTER_GRID_Z = 24;
+
+in vec2 TexCoord0;
+in vec3 Normal0;
+in vec3 WorldPos0;
+
+out vec4 FragColor;
+
+struct BaseLight
+{
+    vec3 Color;
+    float AmbientIntensity;
+    float DiffuseIntensity;
+};
+
+struct DirectionalLight
+{
+    BaseLight Base;
+    vec3 Direction;
+};
+
+struct ClusterLight
+{
+    vec4 PositionRange;
+    vec4 ColorDiffuse;
+    vec4 Atten;             // constant, linear, exp, ambient intensity
+    vec4 DirectionCutoff;   // cutoff is -2 for point lights
+};
+
+layout (std430, binding = 0) readonly buffer LightBuffer {
+    ClusterLight gLights[];
+};
+
+layout (std430, binding = 1) readonly buffer ClusterBuffer {
+    uvec2 gClusters[];      // offset and count in gLightIndices
+};
+
+layout (std430, binding = 2) readonly buffer LightIndexBuffer {
+    uint gLightIndices[];
+};
+
+uniform DirectionalLight gDirectionalLight;
+uniform sampler2D gColorMap;
+uniform vec3 gEyeWorldPos;
+uniform float gMatSpecularIntensity;
+uniform float gSpecularPower;
+uniform mat4 gView;
+uniform vec2 gTileScale;        // clusters per pixel
+uniform vec2 gSliceParams;      // log(view z) * x + y is the depth slice
+
+vec4 CalcLightInternal(BaseLight Light, vec3 LightDirection, vec3 Normal)
+{
+    vec4 AmbientColor = vec4(Light.Color * Light.AmbientIntensity, 1.0f);
+    float DiffuseFactor = dot(Normal, -LightDirection);
+
+    vec4 DiffuseColor  = vec4(0, 0, 0, 0);
+    vec4 SpecularColor = vec4(0, 0, 0, 0);
+
+    if (DiffuseFactor > 0) {
+        DiffuseColor = vec4(Light.Color * Light.DiffuseIntensity * DiffuseFactor, 1.0f);
+
+        vec3 VertexToEye = normalize(gEyeWorldPos - WorldPos0);
+        vec3 LightReflect = normalize(reflect(LightDirection, Normal));
+        float SpecularFactor = dot(VertexToEye, LightReflect);
+        if (SpecularFactor > 0) {
+            SpecularFactor = pow(SpecularFactor, gSpecularPower);
+            SpecularColor = vec4(Light.Color * gMatSpecularIntensity * SpecularFactor, 1.0f);
+        }
+    }
+
+    return (AmbientColor + DiffuseColor + SpecularColor);
+}
+
+vec4 CalcDirectionalLight(vec3 Normal)
+{
+    return CalcLightInternal(gDirectionalLight.Base, gDirectionalLight.Direction, Normal);
+}
+
+// Point and spot lights share the same code - a point light is a spot light
+// whose cutoff can never be reached
+vec4 CalcClusterLight(ClusterLight l, vec3 Normal)
+{
+    vec3 LightDirection = WorldPos0 - l.PositionRange.xyz;
+    float Distance = length(LightDirection);
+    LightDirection = normalize(LightDirection);
+
+    float SpotFactor = dot(LightDirection, l.DirectionCutoff.xyz);
+    float Cutoff = l.DirectionCutoff.w;
+
+    if (SpotFactor <= Cutoff) {
+        return vec4(0, 0, 0, 0);
+    }
+
+    BaseLight Base = BaseLight(l.ColorDiffuse.xyz, l.Atten.w, l.ColorDiffuse.w);
+    vec4 Color = CalcLightInternal(Base, LightDirection, Normal);
+    float Attenuation = l.Atten.x + l.Atten.y * Distance + l.Atten.z * Distance * Distance;
+    Color /= Attenuation;
+
+    if (Cutoff > -1.0) {
+        Color *= (1.0 - (1.0 - SpotFactor) * 1.0/(1.0 - Cutoff));
+    }
+
+    return Color;
+}
+
+void main()
+{
+    vec3 Normal = normalize(Normal0);
+    vec4 TotalLight = CalcDirectionalLight(Normal);
+
+    float ViewZ = (gView * vec4(WorldPos0, 1.0)).z;
+    int Slice = clamp(int(log(ViewZ) * gSliceParams.x + gSliceParams.y), 0, CLUSTER_GRID_Z - 1);
+    ivec2 Tile = clamp(ivec2(gl_FragCoord.xy * gTileScale), ivec2(0, 0), ivec2(CLUSTER_GRID_X - 1, CLUSTER_GRID_Y - 1));
+    int Cluster = (Slice * CLUSTER_GRID_Y + Tile.y) * CLUSTER_GRID_X + Tile.x;
+
+    uvec2 LightList = gClusters[Cluster];
+
+    for (uint i = 0 ; i < LightList.y ; i++) {
+        TotalLight += CalcClusterLight(gLights[gLightIndices[LightList.x + i]], Normal);
+    }
+
+    FragColor = texture(gColorMap, TexCoord0.xy) * TotalLight;
+}
@@ -0,0 +1,30 @@
+#version 330
+
+layout (location = 0) in vec3 Position;
+layout (location = 2) in vec3 Normal;
+layout (location = 3) in ivec4 BoneIDs;
+layout (location = 4) in vec4 Weights;
+layout (location = 14) in ivec4 BoneIDs2;  // zero weights unless the mesh has more than 4 bones per vertex
+layout (location = 15) in vec4 Weights2;
+
+out vec3 SkinnedPos;
+out vec3 SkinnedNormal;
+
+const int MAX_BONES = 100;
+
+uniform mat4 gBones[MAX_BONES];
+
+void main()
+{
+    mat4 BoneTransform = gBones[BoneIDs[0]] * Weights[0];
+    BoneTransform     += gBones[BoneIDs[1]] * Weights[1];
+    BoneTransform     += gBones[BoneIDs[2]] * Weights[2];
+    BoneTransform     += gBones[BoneIDs[3]] * Weights[3];
+    BoneTransform     += gBones[BoneIDs2[0]] * Weights2[0];
+    BoneTransform     += gBones[BoneIDs2[1]] * Weights2[1];
+    BoneTransform     += gBones[BoneIDs2[2]] * Weights2[2];
+    BoneTransform     += gBones[BoneIDs2[3]] * Weights2[3];
+
+    SkinnedPos    = (BoneTransform * vec4(Position, 1.0)).xyz;
+    SkinnedNormal = (BoneTransform * vec4(Normal, 0.0)).xyz;
+}
@@ -0,0 +1,47 @@
+#version 330
+
+in vec2 TexCoord;
+
+out vec4 FragColor;
+
+uniform sampler2D gCurrentMap;
+uniform sampler2D gHistoryMap;
+uniform sampler2D gDepthMap;
+uniform mat4 gReprojection;     // current clip space -> previous clip space
+uniform float gBlendFactor;     // weight of the current frame
+
+
+void main()
+{
+    ivec2 Coord = ivec2(gl_FragCoord.xy);
+    ivec2 MaxCoord = textureSize(gCurrentMap, 0) - ivec2(1);
+
+    vec4 Current = texelFetch(gCurrentMap, Coord, 0);
+
+    // The range of the 3x3 neighbourhood. History outside of it belongs to a
+    // surface which is no longer visible at this pixel.
+    vec4 MinColor = Current;
+    vec4 MaxColor = Current;
+
+    for (int y = -1 ; y <= 1 ; y++) {
+        for (int x = -1 ; x <= 1 ; x++) {
+            vec4 c = texelFetch(gCurrentMap, clamp(Coord + ivec2(x, y), ivec2(0), MaxCoord), 0);
+            MinColor = min(MinColor, c);
+            MaxColor = max(MaxColor, c);
+        }
+    }
+
+    float Depth = texture(gDepthMap, TexCoord).x;
+    vec4 ClipPos = vec4(TexCoord * 2.0 - 1.0, Depth * 2.0 - 1.0, 1.0);
+    vec4 PrevClipPos = gReprojection * ClipPos;
+    vec2 PrevTexCoord = PrevClipPos.xy / PrevClipPos.w * 0.5 + 0.5;
+
+    if (any(lessThan(PrevTexCoord, vec2(0.0))) || any(greaterThan(PrevTexCoord, vec2(1.0)))) {
+        FragColor = Current;
+        return;
+    }
+
+    vec4 History = clamp(texture(gHistoryMap, PrevTexCoord), MinColor, MaxColor);
+
+    FragColor = mix(History, Current, gBlendFactor);
+}
@@ -3,14 +3,23 @@
 #include "glut_backend.cpp"
 #include "io_buffer.cpp"
 #include "math_3d.cpp"
+#include "ogldev_anim_clip.cpp"
+#include "ogldev_anim_texture.cpp"
 #include "ogldev_app.cpp"
 #include "ogldev_atb.cpp"
 #include "ogldev_backend.cpp"
 #include "ogldev_basic_lighting.cpp"
 #include "ogldev_basic_mesh.cpp"
+#include "ogldev_bvh.cpp"
+#include "ogldev_clustered_lighting.cpp"
 #include "ogldev_glfw_backend.cpp"
+#include "ogldev_gpu_sort.cpp"
+#include "ogldev_mesh_adjacency.cpp"
+#include "ogldev_shadow_atlas.cpp"
 #include "ogldev_shadow_map_fbo.cpp"
 #include "ogldev_skinned_mesh.cpp"
+#include "ogldev_skinning_stream_out.cpp"
+#include "ogldev_temporal_accumulation.cpp"
 #include "ogldev_texture.cpp"
 #include "ogldev_util.cpp"
 #include "ogldev_vulkan_core.cpp"
@@ -0,0 +1,489 @@
+/*
+
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <math.h>
+#include <algorithm>
+
+#include "ogldev_util.h"
+#include "ogldev_anim_clip.h"
+
+#define MAX_QUANTIZED_VEC3   65535.0f
+#define MAX_QUANTIZED_QUAT   32767.0f
+#define QUAT_COMPONENT_RANGE 0.70710678f   // 1/sqrt(2) - bound of the three smallest components
+
+
+static aiVector3D SampleVectorKeys(const aiVectorKey* pKeys, uint NumKeys, float AnimationTime)
+{
+    if (NumKeys == 1) {
+        return pKeys[0].mValue;
+    }
+
+    float StartTime = (float)pKeys[0].mTime;
+
+    for (uint i = 0 ; i < NumKeys - 1 ; i++) {
+        float t1 = (float)pKeys[i].mTime - StartTime;
+        float t2 = (float)pKeys[i + 1].mTime - StartTime;
+
+        if (AnimationTime < t2) {
+            float Factor = (t2 > t1) ? (AnimationTime - t1) / (t2 - t1) : 0.0f;
+            Factor = std::max(Factor, 0.0f);
+            return pKeys[i].mValue + Factor * (pKeys[i + 1].mValue - pKeys[i].mValue);
+        }
+    }
+
+    return pKeys[NumKeys - 1].mValue;
+}
+
+
+static aiQuaternion SampleQuatKeys(const aiQuatKey* pKeys, uint NumKeys, float AnimationTime)
+{
+    if (NumKeys == 1) {
+        return pKeys[0].mValue;
+    }
+
+    float StartTime = (float)pKeys[0].mTime;
+
+    for (uint i = 0 ; i < NumKeys - 1 ; i++) {
+        float t1 = (float)pKeys[i].mTime - StartTime;
+        float t2 = (float)pKeys[i + 1].mTime - StartTime;
+
+        if (AnimationTime < t2) {
+            float Factor = (t2 > t1) ? (AnimationTime - t1) / (t2 - t1) : 0.0f;
+            Factor = std::max(Factor, 0.0f);
+            aiQuaternion Out;
+            aiQuaternion::Interpolate(Out, pKeys[i].mValue, pKeys[i + 1].mValue, Factor);
+            return Out.Normalize();
+        }
+    }
+
+    return pKeys[NumKeys - 1].mValue;
+}
+
+
+static aiVector3D Lerp(const aiVector3D& Start, const aiVector3D& End, float Factor)
+{
+    return Start + Factor * (End - Start);
+}
+
+
+// Normalized lerp. Cheaper than slerp and accurate enough between the
+// closely spaced keys of a resampled clip.
+static aiQuaternion Nlerp(const aiQuaternion& Start, const aiQuaternion& End, float Factor)
+{
+    float Dot = Start.x * End.x + Start.y * End.y + Start.z * End.z + Start.w * End.w;
+    float Sign = (Dot < 0.0f) ? -1.0f : 1.0f;
+    float InvFactor = 1.0f - Factor;
+
+    aiQuaternion Out(InvFactor * Start.w + Sign * Factor * End.w,
+                     InvFactor * Start.x + Sign * Factor * End.x,
+                     InvFactor * Start.y + Sign * Factor * End.y,
+                     InvFactor * Start.z + Sign * Factor * End.z);
+
+    return Out.Normalize();
+}
+
+
+static float VectorError(const aiVector3D& a, const aiVector3D& b)
+{
+    return std::max(fabsf(a.x - b.x), std::max(fabsf(a.y - b.y), fabsf(a.z - b.z)));
+}
+
+
+// Angle (in radians) of the rotation from a to b. acos of the dot product
+// can't resolve angles below ~0.001 in float so the angle is taken from the
+// vector and scalar parts of the relative rotation conj(a) * b instead.
+static float QuatError(const aiQuaternion& a, const aiQuaternion& b)
+{
+    float w = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+    float x = a.w * b.x - b.w * a.x - (a.y * b.z - a.z * b.y);
+    float y = a.w * b.y - b.w * a.y - (a.z * b.x - a.x * b.z);
+    float z = a.w * b.z - b.w * a.z - (a.x * b.y - a.y * b.x);
+
+    return 2.0f * atan2f(sqrtf(x * x + y * y + z * z), fabsf(w));
+}
+
+
+static ushort QuantizeUnitFloat(float f, float MaxValue)
+{
+    f = std::min(std::max(f, 0.0f), 1.0f);
+    return (ushort)(f * MaxValue + 0.5f);
+}
+
+
+static void EncodeQuat(const aiQuaternion& q, ushort* pData)
+{
+    float c[4] = { q.x, q.y, q.z, q.w };
+
+    uint Largest = 0;
+
+    for (uint i = 1 ; i < 4 ; i++) {
+        if (fabsf(c[i]) > fabsf(c[Largest])) {
+            Largest = i;
+        }
+    }
+
+    // q and -q are the same rotation so we can always make the dropped component positive
+    float Sign = (c[Largest] < 0.0f) ? -1.0f : 1.0f;
+
+    uint64_t Bits = Largest;
+
+    for (uint i = 0 ; i < 4 ; i++) {
+        if (i != Largest) {
+            float n = (c[i] * Sign + QUAT_COMPONENT_RANGE) / (2.0f * QUAT_COMPONENT_RANGE);
+            Bits = (Bits << 15) | QuantizeUnitFloat(n, MAX_QUANTIZED_QUAT);
+        }
+    }
+
+    pData[0] = (ushort)((Bits >> 32) & 0xffff);
+    pData[1] = (ushort)((Bits >> 16) & 0xffff);
+    pData[2] = (ushort)(Bits & 0xffff);
+}
+
+
+static aiQuaternion DecodeQuat(const ushort* pData)
+{
+    uint64_t Bits = ((uint64_t)pData[0] << 32) | ((uint64_t)pData[1] << 16) | (uint64_t)pData[2];
+
+    uint Largest = (uint)((Bits >> 45) & 0x3);
+
+    float c[4];
+    float SumSquares = 0.0f;
+
+    // The components were shifted in from the left so they come out in reverse
+    for (int i = 3 ; i >= 0 ; i--) {
+        if ((uint)i != Largest) {
+            float n = (float)(Bits & 0x7fff) / MAX_QUANTIZED_QUAT;
+            c[i] = n * 2.0f * QUAT_COMPONENT_RANGE - QUAT_COMPONENT_RANGE;
+            SumSquares += c[i] * c[i];
+            Bits >>= 15;
+        }
+    }
+
+    c[Largest] = sqrtf(std::max(1.0f - SumSquares, 0.0f));
+
+    return aiQuaternion(c[3], c[0], c[1], c[2]);
+}
+
+
+CompressedAnimClip::CompressedAnimClip()
+{
+    m_ticksPerSecond = 0.0f;
+    m_duration = 0.0f;
+    m_ticksPerFrame = 0.0f;
+    m_numFrames = 0;
+    m_sourceSize = 0;
+    m_maxPositionError = 0.0f;
+    m_maxRotationError = 0.0f;
+    m_maxScaleError = 0.0f;
+}
+
+
+bool CompressedAnimClip::Init(const aiAnimation* pAnimation, float SampleRate,
+                              float PositionTolerance, float RotationTolerance, float ScaleTolerance)
+{
+    m_tracks.clear();
+    m_trackMapping.clear();
+    m_sourceSize = 0;
+    m_maxPositionError = 0.0f;
+    m_maxRotationError = 0.0f;
+    m_maxScaleError = 0.0f;
+
+    m_ticksPerSecond = (float)(pAnimation->mTicksPerSecond != 0 ? pAnimation->mTicksPerSecond : 25.0f);
+    m_duration = (float)pAnimation->mDuration;
+    m_ticksPerFrame = m_ticksPerSecond / SampleRate;
+    m_numFrames = (uint)ceilf(m_duration / m_ticksPerFrame) + 1;
+
+    // Frame indices are stored in 16 bits
+    if (m_numFrames > 0xffff) {
+        OGLDEV_ERROR("Animation '%s' is too long to compress at %f samples per second\n", pAnimation->mName.data, SampleRate);
+        return false;
+    }
+
+    m_tracks.resize(pAnimation->mNumChannels);
+
+    vector<aiVector3D> Scalings(m_numFrames);
+    vector<aiQuaternion> Rotations(m_numFrames);
+    vector<aiVector3D> Translations(m_numFrames);
+
+    for (uint i = 0 ; i < pAnimation->mNumChannels ; i++) {
+        const aiNodeAnim* pNodeAnim = pAnimation->mChannels[i];
+
+        m_trackMapping[string(pNodeAnim->mNodeName.data)] = i;
+
+        m_sourceSize += pNodeAnim->mNumScalingKeys * sizeof(aiVectorKey) +
+                        pNodeAnim->mNumRotationKeys * sizeof(aiQuatKey) +
+                        pNodeAnim->mNumPositionKeys * sizeof(aiVectorKey);
+
+        for (uint Frame = 0 ; Frame < m_numFrames ; Frame++) {
+            float AnimationTime = std::min(Frame * m_ticksPerFrame, m_duration);
+            Scalings[Frame] = SampleVectorKeys(pNodeAnim->mScalingKeys, pNodeAnim->mNumScalingKeys, AnimationTime);
+            Rotations[Frame] = SampleQuatKeys(pNodeAnim->mRotationKeys, pNodeAnim->mNumRotationKeys, AnimationTime);
+            Translations[Frame] = SampleVectorKeys(pNodeAnim->mPositionKeys, pNodeAnim->mNumPositionKeys, AnimationTime);
+        }
+
+        m_maxScaleError = std::max(m_maxScaleError, CompressVec3(Scalings, ScaleTolerance, m_tracks[i].Scaling));
+        m_maxRotationError = std::max(m_maxRotationError, CompressQuat(Rotations, RotationTolerance, m_tracks[i].Rotation));
+        m_maxPositionError = std::max(m_maxPositionError, CompressVec3(Translations, PositionTolerance, m_tracks[i].Translation));
+    }
+
+    return true;
+}
+
+
+// Greedily extends each segment as long as interpolating its end points
+// reproduces every sample in between within the tolerance
+template<typename T, typename InterpFunc, typename ErrorFunc>
+static void ReduceKeys(const vector<T>& Samples, float Tolerance, InterpFunc Interp, ErrorFunc Error, vector<ushort>& Frames)
+{
+    uint NumSamples = (uint)Samples.size();
+
+    Frames.clear();
+    Frames.push_back(0);
+
+    uint Start = 0;
+
+    while (Start < NumSamples - 1) {
+        uint End = Start + 1;
+
+        while (End + 1 < NumSamples) {
+            uint Candidate = End + 1;
+            bool Predictable = true;
+
+            for (uint k = Start + 1 ; k < Candidate ; k++) {
+                float Factor = (float)(k - Start) / (float)(Candidate - Start);
+
+                if (Error(Interp(Samples[Start], Samples[Candidate], Factor), Samples[k]) > Tolerance) {
+                    Predictable = false;
+                    break;
+                }
+            }
+
+            if (!Predictable) {
+                break;
+            }
+
+            End = Candidate;
+        }
+
+        Frames.push_back((ushort)End);
+        Start = End;
+    }
+
+    // A constant channel only needs a single key
+    if ((Frames.size() == 2) && (Error(Samples[0], Samples[NumSamples - 1]) <= Tolerance)) {
+        Frames.pop_back();
+    }
+}
+
+
+// The keys are chosen on the exact samples but the clip is played from the
+// quantized keys. Every sample is reconstructed from the quantized keys and
+// the worst sample of each segment that is still off by more than the
+// tolerance becomes a key. Returns false if no key was added. The largest
+// error goes into MaxError.
+template<typename T, typename SampleFunc, typename ErrorFunc>
+static bool AddMissingKeys(const vector<T>& Samples, float Tolerance, SampleFunc Sample, ErrorFunc Error,
+                           vector<ushort>& Frames, float& MaxError)
+{
+    uint NumSamples = (uint)Samples.size();
+    vector<ushort> NewFrames;
+
+    MaxError = 0.0f;
+
+    for (uint i = 0 ; i < Frames.size() ; i++) {
+        uint SegmentEnd = (i + 1 < Frames.size()) ? Frames[i + 1] : NumSamples;
+        uint WorstFrame = 0;
+        float WorstError = Tolerance;
+
+        for (uint k = Frames[i] ; k < SegmentEnd ; k++) {
+            float e = Error(Sample((float)k), Samples[k]);
+            MaxError = std::max(MaxError, e);
+
+            // A key can't get any closer than its quantization allows
+            if ((k != Frames[i]) && (e > WorstError)) {
+                WorstError = e;
+                WorstFrame = k;
+            }
+        }
+
+        if (WorstFrame != 0) {
+            NewFrames.push_back((ushort)WorstFrame);
+        }
+    }
+
+    if (NewFrames.empty()) {
+        return false;
+    }
+
+    vector<ushort> Merged(Frames.size() + NewFrames.size());
+    std::merge(Frames.begin(), Frames.end(), NewFrames.begin(), NewFrames.end(), Merged.begin());
+    Frames.swap(Merged);
+
+    return true;
+}
+
+
+float CompressedAnimClip::CompressVec3(const vector<aiVector3D>& Samples, float Tolerance, Vec3Channel& Channel)
+{
+    ReduceKeys(Samples, Tolerance, Lerp, VectorError, Channel.Frames);
+
+    float MaxError = 0.0f;
+
+    do {
+        QuantizeVec3(Samples, Channel);
+    } while (AddMissingKeys(Samples, Tolerance, [&](float Frame) { return SampleVec3(Channel, Frame); },
+                            VectorError, Channel.Frames, MaxError));
+
+    return MaxError;
+}
+
+
+// The range of the quantization is the bounding box of the keys
+void CompressedAnimClip::QuantizeVec3(const vector<aiVector3D>& Samples, Vec3Channel& Channel)
+{
+    aiVector3D Min = Samples[Channel.Frames[0]];
+    aiVector3D Max = Min;
+
+    for (uint i = 1 ; i < Channel.Frames.size() ; i++) {
+        const aiVector3D& v = Samples[Channel.Frames[i]];
+        Min.x = std::min(Min.x, v.x); Max.x = std::max(Max.x, v.x);
+        Min.y = std::min(Min.y, v.y); Max.y = std::max(Max.y, v.y);
+        Min.z = std::min(Min.z, v.z); Max.z = std::max(Max.z, v.z);
+    }
+
+    Channel.Min = Min;
+    Channel.Extent = Max - Min;
+    Channel.Keys.resize(Channel.Frames.size());
+
+    for (uint i = 0 ; i < Channel.Frames.size() ; i++) {
+        const aiVector3D& v = Samples[Channel.Frames[i]];
+        QuantizedVec3& Key = Channel.Keys[i];
+        Key.Data[0] = (Channel.Extent.x > 0.0f) ? QuantizeUnitFloat((v.x - Min.x) / Channel.Extent.x, MAX_QUANTIZED_VEC3) : 0;
+        Key.Data[1] = (Channel.Extent.y > 0.0f) ? QuantizeUnitFloat((v.y - Min.y) / Channel.Extent.y, MAX_QUANTIZED_VEC3) : 0;
+        Key.Data[2] = (Channel.Extent.z > 0.0f) ? QuantizeUnitFloat((v.z - Min.z) / Channel.Extent.z, MAX_QUANTIZED_VEC3) : 0;
+    }
+}
+
+
+float CompressedAnimClip::CompressQuat(const vector<aiQuaternion>& Samples, float Tolerance, QuatChannel& Channel)
+{
+    ReduceKeys(Samples, Tolerance, Nlerp, QuatError, Channel.Frames);
+
+    float MaxError = 0.0f;
+
+    do {
+        Channel.Keys.resize(Channel.Frames.size());
+
+        for (uint i = 0 ; i < Channel.Frames.size() ; i++) {
+            EncodeQuat(Samples[Channel.Frames[i]], Channel.Keys[i].Data);
+        }
+    } while (AddMissingKeys(Samples, Tolerance, [&](float Frame) { return SampleQuat(Channel, Frame); },
+                            QuatError, Channel.Frames, MaxError));
+
+    return MaxError;
+}
+
+
+aiVector3D CompressedAnimClip::DecodeVec3(const Vec3Channel& Channel, uint KeyIndex) const
+{
+    const QuantizedVec3& Key = Channel.Keys[KeyIndex];
+
+    return aiVector3D(Channel.Min.x + Channel.Extent.x * ((float)Key.Data[0] / MAX_QUANTIZED_VEC3),
+                      Channel.Min.y + Channel.Extent.y * ((float)Key.Data[1] / MAX_QUANTIZED_VEC3),
+                      Channel.Min.z + Channel.Extent.z * ((float)Key.Data[2] / MAX_QUANTIZED_VEC3));
+}
+
+
+// Returns the index of the last key at or before the frame
+static uint FindKey(const vector<ushort>& Frames, float Frame)
+{
+    vector<ushort>::const_iterator it = std::upper_bound(Frames.begin(), Frames.end(), Frame);
+
+    if (it == Frames.begin()) {
+        return 0;
+    }
+
+    return (uint)(it - Frames.begin()) - 1;
+}
+
+
+aiVector3D CompressedAnimClip::SampleVec3(const Vec3Channel& Channel, float Frame) const
+{
+    uint Key = FindKey(Channel.Frames, Frame);
+
+    if (Key + 1 >= Channel.Frames.size()) {
+        return DecodeVec3(Channel, Key);
+    }
+
+    float Factor = (Frame - Channel.Frames[Key]) / (float)(Channel.Frames[Key + 1] - Channel.Frames[Key]);
+
+    return Lerp(DecodeVec3(Channel, Key), DecodeVec3(Channel, Key + 1), Factor);
+}
+
+
+aiQuaternion CompressedAnimClip::SampleQuat(const QuatChannel& Channel, float Frame) const
+{
+    uint Key = FindKey(Channel.Frames, Frame);
+
+    if (Key + 1 >= Channel.Frames.size()) {
+        return DecodeQuat(Channel.Keys[Key].Data);
+    }
+
+    float Factor = (Frame - Channel.Frames[Key]) / (float)(Channel.Frames[Key + 1] - Channel.Frames[Key]);
+
+    return Nlerp(DecodeQuat(Channel.Keys[Key].Data), DecodeQuat(Channel.Keys[Key + 1].Data), Factor);
+}
+
+
+int CompressedAnimClip::FindTrack(const string& NodeName) const
+{
+    map<string, uint>::const_iterator it = m_trackMapping.find(NodeName);
+
+    if (it == m_trackMapping.end()) {
+        return -1;
+    }
+
+    return (int)it->second;
+}
+
+
+void CompressedAnimClip::Sample(uint Track, float AnimationTime, aiVector3D& Scaling, aiQuaternion& Rotation, aiVector3D& Translation) const
+{
+    assert(Track < m_tracks.size());
+
+    float Frame = std::min(AnimationTime / m_ticksPerFrame, (float)(m_numFrames - 1));
+
+    Scaling     = SampleVec3(m_tracks[Track].Scaling, Frame);
+    Rotation    = SampleQuat(m_tracks[Track].Rotation, Frame);
+    Translation = SampleVec3(m_tracks[Track].Translation, Frame);
+}
+
+
+uint CompressedAnimClip::GetCompressedSize() const
+{
+    uint Size = (uint)(m_tracks.size() * sizeof(Track));
+
+    for (uint i = 0 ; i < m_tracks.size() ; i++) {
+        const Track& t = m_tracks[i];
+        Size += (uint)(t.Scaling.Frames.size() * (sizeof(ushort) + sizeof(QuantizedVec3)));
+        Size += (uint)(t.Rotation.Frames.size() * (sizeof(ushort) + sizeof(QuantizedQuat)));
+        Size += (uint)(t.Translation.Frames.size() * (sizeof(ushort) + sizeof(QuantizedVec3)));
+    }
+
+    return Size;
+}
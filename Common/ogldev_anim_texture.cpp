@@ -0,0 +1,135 @@
+/*
+
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ogldev_util.h"
+#include "ogldev_anim_texture.h"
+
+#define TEXELS_PER_BONE 3
+
+
+AnimationTexture::AnimationTexture()
+{
+    m_numBones = 0;
+    m_numFrames = 0;
+    m_texture = 0;
+}
+
+
+AnimationTexture::~AnimationTexture()
+{
+    if (m_texture != 0) {
+        glDeleteTextures(1, &m_texture);
+    }
+}
+
+
+bool AnimationTexture::AddClip(SkinnedMesh& Mesh, float FramesPerSecond)
+{
+    if (m_clips.size() == 0) {
+        m_numBones = Mesh.NumBones();
+    }
+    else if (Mesh.NumBones() != m_numBones) {
+        printf("Animation clip has %d bones but the texture was created for %d\n", Mesh.NumBones(), m_numBones);
+        return false;
+    }
+
+    ClipInfo Clip;
+    Clip.FirstFrame = m_numFrames;
+    Clip.NumFrames = (uint)(Mesh.GetAnimationDuration() * FramesPerSecond);
+    Clip.FramesPerSecond = FramesPerSecond;
+
+    if (Clip.NumFrames == 0) {
+        Clip.NumFrames = 1;
+    }
+
+    m_texels.reserve(m_texels.size() + Clip.NumFrames * m_numBones * TEXELS_PER_BONE);
+
+    vector<Matrix4f> Transforms;
+
+    for (uint Frame = 0 ; Frame < Clip.NumFrames ; Frame++) {
+        Mesh.BoneTransform((float)Frame / FramesPerSecond, Transforms);
+
+        for (uint i = 0 ; i < m_numBones ; i++) {
+            const Matrix4f& m = Transforms[i];
+
+            for (uint Row = 0 ; Row < TEXELS_PER_BONE ; Row++) {
+                m_texels.push_back(Vector4f(m.m[Row][0], m.m[Row][1], m.m[Row][2], m.m[Row][3]));
+            }
+        }
+    }
+
+    m_numFrames += Clip.NumFrames;
+    m_clips.push_back(Clip);
+
+    return true;
+}
+
+
+bool AnimationTexture::Finalize()
+{
+    if (m_clips.size() == 0) {
+        printf("No animation clips were added\n");
+        return false;
+    }
+
+    GLint MaxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &MaxSize);
+
+    if ((m_numBones * TEXELS_PER_BONE > (uint)MaxSize) || (m_numFrames > (uint)MaxSize)) {
+        printf("Animation texture %dx%d exceeds the max texture size %d\n", m_numBones * TEXELS_PER_BONE, m_numFrames, MaxSize);
+        return false;
+    }
+
+    if (m_texture == 0) {
+        glGenTextures(1, &m_texture);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, m_numBones * TEXELS_PER_BONE, m_numFrames, 0, GL_RGBA, GL_FLOAT, &m_texels[0]);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    printf("Animation texture: %d clips, %d frames, %d bytes\n", (int)m_clips.size(), m_numFrames,
+           (int)(m_texels.size() * sizeof(Vector4f)));
+
+    // The CPU copy is no longer needed
+    vector<Vector4f>().swap(m_texels);
+
+    return GLCheckError();
+}
+
+
+void AnimationTexture::Bind(GLenum TextureUnit)
+{
+    glActiveTexture(TextureUnit);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+}
+
+
+Vector4f AnimationTexture::GetInstanceParams(uint Clip, float TimeOffset) const
+{
+    assert(Clip < m_clips.size());
+
+    return Vector4f((float)m_clips[Clip].FirstFrame,
+                    (float)m_clips[Clip].NumFrames,
+                    m_clips[Clip].FramesPerSecond,
+                    TimeOffset);
+}
@@ -42,14 +42,21 @@ void BasicMesh::Clear()
         glDeleteVertexArrays(1, &m_VAO);
         m_VAO = 0;
     }
+
+    if (m_depthVAO != 0) {
+        glDeleteVertexArrays(1, &m_depthVAO);
+        m_depthVAO = 0;
+    }
 }
 
 
-bool BasicMesh::LoadMesh(const string& Filename)
+bool BasicMesh::LoadMesh(const string& Filename, bool HalfFloatDepthStream)
 {
     // Release the previously loaded mesh (if it exists)
     Clear();
 
+    m_halfFloatDepthStream = HalfFloatDepthStream;
+
     // Create the VAO
     glGenVertexArrays(1, &m_VAO);
     glBindVertexArray(m_VAO);
@@ -89,12 +96,18 @@ bool BasicMesh::InitFromScene(const aiScene* pScene, const string& Filename)
 
     InitAllMeshes(pScene);
 
+    CalcBoundingSphere();
+
+    InitBVH(Filename);
+
     if (!InitMaterials(pScene, Filename)) {
         return false;
     }
 
     PopulateBuffers();
 
+    PopulateDepthBuffers();
+
     return GLCheckError();
 }
 
@@ -296,6 +309,61 @@ void BasicMesh::LoadColors(const aiMaterial* pMaterial, int index)
 }
 
 
+// Centered on the bounding box. Not the tightest sphere but good enough for culling.
+void BasicMesh::CalcBoundingSphere()
+{
+    if (m_Positions.empty()) {
+        return;
+    }
+
+    Vector3f Min = m_Positions[0];
+    Vector3f Max = m_Positions[0];
+
+    for (unsigned int i = 1 ; i < m_Positions.size() ; i++) {
+        const Vector3f& v = m_Positions[i];
+        Min = Vector3f(MIN(Min.x, v.x), MIN(Min.y, v.y), MIN(Min.z, v.z));
+        Max = Vector3f(MAX(Max.x, v.x), MAX(Max.y, v.y), MAX(Max.z, v.z));
+    }
+
+    m_boundingSphereCenter = (Min + Max) * 0.5f;
+    m_boundingSphereRadius = 0.0f;
+
+    for (unsigned int i = 0 ; i < m_Positions.size() ; i++) {
+        float Distance = (m_Positions[i] - m_boundingSphereCenter).Length();
+        m_boundingSphereRadius = MAX(m_boundingSphereRadius, Distance);
+    }
+}
+
+
+// The tree is cached next to the mesh file. The checksum catches a mesh
+// that was modified after the cache was written.
+void BasicMesh::InitBVH(const string& Filename)
+{
+    vector<unsigned int> Indices(m_Indices.size());
+
+    for (unsigned int i = 0 ; i < m_Meshes.size() ; i++) {
+        for (unsigned int j = 0 ; j < m_Meshes[i].NumIndices ; j++) {
+            unsigned int Index = m_Meshes[i].BaseIndex + j;
+            Indices[Index] = m_Meshes[i].BaseVertex + m_Indices[Index];
+        }
+    }
+
+    string CacheFilename = Filename + ".bvh";
+    unsigned int Checksum = TriangleBVH::CalcChecksum(m_Positions, Indices);
+
+    if (m_bvh.Load(CacheFilename, Checksum)) {
+        return;
+    }
+
+    m_bvh.Build(m_Positions, Indices);
+
+    // The mesh may be in a read only directory - the tree is simply rebuilt next time
+    if (!m_bvh.Save(CacheFilename, Checksum)) {
+        printf("Warning! Cannot write the BVH cache '%s'\n", CacheFilename.c_str());
+    }
+}
+
+
 void BasicMesh::PopulateBuffers()
 {
     glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[POS_VB]);
@@ -318,6 +386,129 @@ void BasicMesh::PopulateBuffers()
 }
 
 
+struct PositionKey
+{
+    float x, y, z;
+
+    bool operator<(const PositionKey& r) const
+    {
+        if (x != r.x) return x < r.x;
+        if (y != r.y) return y < r.y;
+        return z < r.z;
+    }
+};
+
+
+// IEEE 754 binary16 with round to nearest. Values which are too small for
+// a normalized half become zero.
+static unsigned short FloatToHalf(float f)
+{
+    unsigned int Bits;
+    memcpy(&Bits, &f, sizeof(Bits));
+
+    unsigned int Sign = (Bits >> 16) & 0x8000;
+    int Exp = (int)((Bits >> 23) & 0xff) - 127 + 15;
+    unsigned int Mantissa = Bits & 0x7fffff;
+
+    if (Exp <= 0) {
+        return (unsigned short)Sign;
+    }
+
+    if (Exp >= 31) {
+        return (unsigned short)(Sign | 0x7c00);
+    }
+
+    unsigned int Half = Sign | (Exp << 10) | (Mantissa >> 13);
+
+    // Round to nearest. A carry into the exponent is still correct.
+    if (Mantissa & 0x1000) {
+        Half++;
+    }
+
+    return (unsigned short)Half;
+}
+
+
+// The normals and texture coordinates split vertices that share the same
+// position. The depth passes don't need them so the positions are merged
+// and all the submeshes are rebased into one index buffer.
+void BasicMesh::PopulateDepthBuffers()
+{
+    map<PositionKey, unsigned int> PositionMap;
+    vector<unsigned int> Remap(m_Positions.size());
+    vector<Vector3f> Positions;
+
+    for (unsigned int i = 0 ; i < m_Positions.size() ; i++) {
+        PositionKey Key = { m_Positions[i].x, m_Positions[i].y, m_Positions[i].z };
+        map<PositionKey, unsigned int>::iterator it = PositionMap.find(Key);
+
+        if (it == PositionMap.end()) {
+            Remap[i] = (unsigned int)Positions.size();
+            PositionMap[Key] = Remap[i];
+            Positions.push_back(m_Positions[i]);
+        }
+        else {
+            Remap[i] = it->second;
+        }
+    }
+
+    vector<unsigned int> Indices;
+    Indices.reserve(m_Indices.size());
+
+    for (unsigned int i = 0 ; i < m_Meshes.size() ; i++) {
+        for (unsigned int j = 0 ; j < m_Meshes[i].NumIndices ; j++) {
+            unsigned int Index = m_Indices[m_Meshes[i].BaseIndex + j];
+            Indices.push_back(Remap[m_Meshes[i].BaseVertex + Index]);
+        }
+    }
+
+    m_numDepthIndices = (unsigned int)Indices.size();
+
+    // Nothing to draw - RenderDepth checks the index count
+    if (Positions.empty() || Indices.empty()) {
+        m_numDepthIndices = 0;
+        return;
+    }
+
+    glGenVertexArrays(1, &m_depthVAO);
+    glBindVertexArray(m_depthVAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[DEPTH_POS_VB]);
+
+    if (m_halfFloatDepthStream) {
+        // Padded to 8 bytes to keep the vertices aligned
+        vector<unsigned short> HalfPositions(Positions.size() * 4, 0);
+
+        for (unsigned int i = 0 ; i < Positions.size() ; i++) {
+            HalfPositions[i * 4]     = FloatToHalf(Positions[i].x);
+            HalfPositions[i * 4 + 1] = FloatToHalf(Positions[i].y);
+            HalfPositions[i * 4 + 2] = FloatToHalf(Positions[i].z);
+        }
+
+        glBufferData(GL_ARRAY_BUFFER, sizeof(HalfPositions[0]) * HalfPositions.size(), &HalfPositions[0], GL_STATIC_DRAW);
+        glEnableVertexAttribArray(POSITION_LOCATION);
+        glVertexAttribPointer(POSITION_LOCATION, 3, GL_HALF_FLOAT, GL_FALSE, 4 * sizeof(unsigned short), 0);
+    }
+    else {
+        glBufferData(GL_ARRAY_BUFFER, sizeof(Positions[0]) * Positions.size(), &Positions[0], GL_STATIC_DRAW);
+        glEnableVertexAttribArray(POSITION_LOCATION);
+        glVertexAttribPointer(POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    }
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_Buffers[DEPTH_INDEX_BUFFER]);
+
+    if (Positions.size() <= 0x10000) {
+        vector<unsigned short> ShortIndices(Indices.begin(), Indices.end());
+        m_depthIndexType = GL_UNSIGNED_SHORT;
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(ShortIndices[0]) * ShortIndices.size(), &ShortIndices[0], GL_STATIC_DRAW);
+    }
+    else {
+        m_depthIndexType = GL_UNSIGNED_INT;
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(Indices[0]) * Indices.size(), &Indices[0], GL_STATIC_DRAW);
+    }
+}
+
+
 // Introduced in youtube tutorial #18
 void BasicMesh::Render()
 {
@@ -357,6 +548,12 @@ void BasicMesh::Render(unsigned int NumInstances, const Matrix4f* WVPMats, const
     glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[WORLD_MAT_VB]);
     glBufferData(GL_ARRAY_BUFFER, sizeof(Matrix4f) * NumInstances, WorldMats, GL_DYNAMIC_DRAW);
 
+    Render(NumInstances);
+}
+
+
+void BasicMesh::Render(unsigned int NumInstances)
+{
     glBindVertexArray(m_VAO);
 
     for (unsigned int i = 0 ; i < m_Meshes.size() ; i++) {
@@ -395,3 +592,54 @@ const Material& BasicMesh::GetMaterial()
 
     return m_Materials[0];
 }
+
+
+void BasicMesh::RenderDepth()
+{
+    if (m_numDepthIndices == 0) {
+        return;
+    }
+
+    glBindVertexArray(m_depthVAO);
+    glDrawElements(GL_TRIANGLES, m_numDepthIndices, m_depthIndexType, 0);
+    glBindVertexArray(0);
+}
+
+
+void BasicMesh::RenderDepth(unsigned int NumInstances)
+{
+    if (m_numDepthIndices == 0) {
+        return;
+    }
+
+    glBindVertexArray(m_depthVAO);
+    glDrawElementsInstanced(GL_TRIANGLES, m_numDepthIndices, m_depthIndexType, 0, NumInstances);
+    glBindVertexArray(0);
+}
+
+
+bool BasicMesh::Pick(const Vector3f& Origin, const Vector3f& Dir, BasicMeshHit& Hit) const
+{
+    BVHHit TriangleHit;
+
+    if (!m_bvh.Intersect(Origin, Dir, TriangleHit)) {
+        return false;
+    }
+
+    unsigned int FirstIndex = TriangleHit.Triangle * 3;
+    Hit.MeshIndex = 0;
+    Hit.PrimID = TriangleHit.Triangle;
+
+    for (unsigned int i = 0 ; i < m_Meshes.size() ; i++) {
+        if (FirstIndex >= m_Meshes[i].BaseIndex && FirstIndex < m_Meshes[i].BaseIndex + m_Meshes[i].NumIndices) {
+            Hit.MeshIndex = i;
+            Hit.PrimID = (FirstIndex - m_Meshes[i].BaseIndex) / 3;
+            break;
+        }
+    }
+
+    Hit.Distance = TriangleHit.Distance;
+    Hit.Pos = Origin + Dir * TriangleHit.Distance;
+
+    return true;
+}
@@ -0,0 +1,884 @@
+/*
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <algorithm>
+#include <thread>
+
+#include "ogldev_util.h"
+#include "ogldev_bvh.h"
+
+#define NUM_SAH_BINS 16
+#define MAX_LEAF_TRIANGLES 8
+#define SAH_TRAVERSAL_COST 1.0f
+#define MIN_PARALLEL_TRIANGLES 4096     // smaller ranges are not worth a thread
+#define TASKS_PER_THREAD 4
+#define MAX_BVH_DEPTH 64                // deeper ranges become leaves regardless of the SAH
+#define TRAVERSAL_STACK_SIZE MAX_BVH_DEPTH  // one pending far child per level at most
+
+#define BVH_FILE_VERSION 1
+
+
+struct TriangleBVH::BuildContext {
+    const vector<Vector3f>* pPositions;
+    const vector<uint>* pIndices;
+    vector<Vector3f> TriMin;
+    vector<Vector3f> TriMax;
+    vector<Vector3f> Centroids;
+    vector<uint> Refs;          // triangle indices, reordered by the build
+};
+
+
+struct BVHFileHeader {
+    char Magic[4];
+    uint Version;
+    uint Checksum;
+    uint NumTriangles;
+    uint NumNodes;
+    uint NumPackets;
+};
+
+
+static float SurfaceArea(const Vector3f& Min, const Vector3f& Max)
+{
+    Vector3f d = Max - Min;
+    return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+
+static void GrowBounds(Vector3f& Min, Vector3f& Max, const Vector3f& v)
+{
+    Min.x = MIN(Min.x, v.x);
+    Min.y = MIN(Min.y, v.y);
+    Min.z = MIN(Min.z, v.z);
+    Max.x = MAX(Max.x, v.x);
+    Max.y = MAX(Max.y, v.y);
+    Max.z = MAX(Max.z, v.z);
+}
+
+
+static inline float Dot(const Vector3f& a, const Vector3f& b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+
+static float GetAxis(const Vector3f& v, uint Axis)
+{
+    return (Axis == 0) ? v.x : ((Axis == 1) ? v.y : v.z);
+}
+
+
+TriangleBVH::TriangleBVH()
+{
+    m_numTriangles = 0;
+}
+
+
+void TriangleBVH::CalcBounds(const BuildContext& Ctx, uint Begin, uint End, Vector3f& Min, Vector3f& Max,
+                             Vector3f& CentroidMin, Vector3f& CentroidMax)
+{
+    Min = Vector3f(FLT_MAX, FLT_MAX, FLT_MAX);
+    Max = Vector3f(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    CentroidMin = Min;
+    CentroidMax = Max;
+
+    for (uint i = Begin ; i < End ; i++) {
+        uint t = Ctx.Refs[i];
+        GrowBounds(Min, Max, Ctx.TriMin[t]);
+        GrowBounds(Min, Max, Ctx.TriMax[t]);
+        GrowBounds(CentroidMin, CentroidMax, Ctx.Centroids[t]);
+    }
+}
+
+
+// Returns the first triangle of the right child or Begin when the range
+// should become a leaf. The centroids are binned along every axis and the
+// bin border with the lowest SAH cost wins.
+uint TriangleBVH::Split(BuildContext& Ctx, uint Begin, uint End, const Vector3f& Min, const Vector3f& Max,
+                        const Vector3f& CentroidMin, const Vector3f& CentroidMax)
+{
+    uint NumTriangles = End - Begin;
+
+    if (NumTriangles <= 2) {
+        return Begin;
+    }
+
+    float BestCost = FLT_MAX;
+    uint BestAxis = 0;
+    uint BestBin = 0;
+
+    for (uint Axis = 0 ; Axis < 3 ; Axis++) {
+        float AxisMin = GetAxis(CentroidMin, Axis);
+        float Extent = GetAxis(CentroidMax, Axis) - AxisMin;
+
+        if (Extent <= 0.0f) {
+            continue;
+        }
+
+        float Scale = NUM_SAH_BINS / Extent;
+
+        uint BinCount[NUM_SAH_BINS] = { 0 };
+        Vector3f BinMin[NUM_SAH_BINS];
+        Vector3f BinMax[NUM_SAH_BINS];
+
+        for (uint i = 0 ; i < NUM_SAH_BINS ; i++) {
+            BinMin[i] = Vector3f(FLT_MAX, FLT_MAX, FLT_MAX);
+            BinMax[i] = Vector3f(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+        }
+
+        for (uint i = Begin ; i < End ; i++) {
+            uint t = Ctx.Refs[i];
+            uint Bin = MIN((uint)((GetAxis(Ctx.Centroids[t], Axis) - AxisMin) * Scale), NUM_SAH_BINS - 1);
+            BinCount[Bin]++;
+            GrowBounds(BinMin[Bin], BinMax[Bin], Ctx.TriMin[t]);
+            GrowBounds(BinMin[Bin], BinMax[Bin], Ctx.TriMax[t]);
+        }
+
+        // Sweep from the right to get the area and count of every right side
+        float RightArea[NUM_SAH_BINS];
+        uint RightCount[NUM_SAH_BINS];
+        Vector3f SweepMin(FLT_MAX, FLT_MAX, FLT_MAX);
+        Vector3f SweepMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+        uint Count = 0;
+
+        for (uint i = NUM_SAH_BINS - 1 ; i > 0 ; i--) {
+            if (BinCount[i] > 0) {
+                GrowBounds(SweepMin, SweepMax, BinMin[i]);
+                GrowBounds(SweepMin, SweepMax, BinMax[i]);
+            }
+            Count += BinCount[i];
+            RightArea[i] = (Count > 0) ? SurfaceArea(SweepMin, SweepMax) : 0.0f;
+            RightCount[i] = Count;
+        }
+
+        SweepMin = Vector3f(FLT_MAX, FLT_MAX, FLT_MAX);
+        SweepMax = Vector3f(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+        Count = 0;
+
+        // Split between bin i - 1 and bin i
+        for (uint i = 1 ; i < NUM_SAH_BINS ; i++) {
+            if (BinCount[i - 1] > 0) {
+                GrowBounds(SweepMin, SweepMax, BinMin[i - 1]);
+                GrowBounds(SweepMin, SweepMax, BinMax[i - 1]);
+            }
+            Count += BinCount[i - 1];
+
+            if (Count == 0 || RightCount[i] == 0) {
+                continue;
+            }
+
+            float Cost = SurfaceArea(SweepMin, SweepMax) * Count + RightArea[i] * RightCount[i];
+
+            if (Cost < BestCost) {
+                BestCost = Cost;
+                BestAxis = Axis;
+                BestBin = i;
+            }
+        }
+    }
+
+    float NodeArea = SurfaceArea(Min, Max);
+    float LeafCost = (float)NumTriangles;
+    float SplitCost = SAH_TRAVERSAL_COST + ((NodeArea > 0.0f) ? BestCost / NodeArea : 0.0f);
+
+    uint* pBegin = &Ctx.Refs[0] + Begin;
+    uint* pEnd = &Ctx.Refs[0] + End;
+
+    if (BestCost < FLT_MAX && (SplitCost < LeafCost || NumTriangles > MAX_LEAF_TRIANGLES)) {
+        float AxisMin = GetAxis(CentroidMin, BestAxis);
+        float Scale = NUM_SAH_BINS / (GetAxis(CentroidMax, BestAxis) - AxisMin);
+        const vector<Vector3f>& Centroids = Ctx.Centroids;
+
+        uint* pMid = std::partition(pBegin, pEnd, [&](uint t) {
+            return MIN((uint)((GetAxis(Centroids[t], BestAxis) - AxisMin) * Scale), NUM_SAH_BINS - 1) < BestBin;
+        });
+
+        return (uint)(pMid - &Ctx.Refs[0]);
+    }
+
+    if (NumTriangles <= MAX_LEAF_TRIANGLES) {
+        return Begin;
+    }
+
+    // All the centroids are in the same spot - split by count
+    uint* pMid = pBegin + NumTriangles / 2;
+    std::nth_element(pBegin, pMid, pEnd);
+
+    return (uint)(pMid - &Ctx.Refs[0]);
+}
+
+
+void TriangleBVH::BuildSubtree(BuildContext& Ctx, vector<Node>& Nodes, uint NodeIndex, uint Begin, uint End, uint Depth)
+{
+    Vector3f CentroidMin, CentroidMax;
+    CalcBounds(Ctx, Begin, End, Nodes[NodeIndex].Min, Nodes[NodeIndex].Max, CentroidMin, CentroidMax);
+
+    uint Mid = Begin;
+
+    if (Depth < MAX_BVH_DEPTH - 1) {
+        Mid = Split(Ctx, Begin, End, Nodes[NodeIndex].Min, Nodes[NodeIndex].Max, CentroidMin, CentroidMax);
+    }
+
+    if (Mid == Begin) {
+        Nodes[NodeIndex].LeftOrFirst = Begin;
+        Nodes[NodeIndex].Count = End - Begin;
+        return;
+    }
+
+    uint Left = (uint)Nodes.size();
+    Nodes.resize(Nodes.size() + 2);
+
+    Nodes[NodeIndex].LeftOrFirst = Left;
+    Nodes[NodeIndex].Count = 0;
+
+    BuildSubtree(Ctx, Nodes, Left, Begin, Mid, Depth + 1);
+    BuildSubtree(Ctx, Nodes, Left + 1, Mid, End, Depth + 1);
+}
+
+
+void TriangleBVH::BuildSubtreeThread(BuildContext* pCtx, const vector<BuildTask>* pTasks,
+                                     vector<vector<Node> >* pSubtrees, uint FirstTask, uint LastTask)
+{
+    for (uint i = FirstTask ; i < LastTask ; i++) {
+        const BuildTask& Task = (*pTasks)[i];
+        vector<Node>& Nodes = (*pSubtrees)[i];
+        Nodes.resize(1);
+        BuildSubtree(*pCtx, Nodes, 0, Task.Begin, Task.End, Task.Depth);
+    }
+}
+
+
+void TriangleBVH::Build(const vector<Vector3f>& Positions, const vector<uint>& Indices, uint NumThreads)
+{
+    m_nodes.clear();
+    m_packets.clear();
+    m_numTriangles = (uint)Indices.size() / 3;
+
+    if (m_numTriangles == 0) {
+        return;
+    }
+
+    BuildContext Ctx;
+    Ctx.pPositions = &Positions;
+    Ctx.pIndices = &Indices;
+    Ctx.TriMin.resize(m_numTriangles);
+    Ctx.TriMax.resize(m_numTriangles);
+    Ctx.Centroids.resize(m_numTriangles);
+    Ctx.Refs.resize(m_numTriangles);
+
+    for (uint i = 0 ; i < m_numTriangles ; i++) {
+        const Vector3f& v0 = Positions[Indices[i * 3]];
+        const Vector3f& v1 = Positions[Indices[i * 3 + 1]];
+        const Vector3f& v2 = Positions[Indices[i * 3 + 2]];
+
+        Ctx.TriMin[i] = v0;
+        Ctx.TriMax[i] = v0;
+        GrowBounds(Ctx.TriMin[i], Ctx.TriMax[i], v1);
+        GrowBounds(Ctx.TriMin[i], Ctx.TriMax[i], v2);
+        Ctx.Centroids[i] = (Ctx.TriMin[i] + Ctx.TriMax[i]) * 0.5f;
+        Ctx.Refs[i] = i;
+    }
+
+    if (NumThreads == 0) {
+        NumThreads = MAX(std::thread::hardware_concurrency(), 1);
+    }
+
+    // Split the largest range on this thread until there are enough ranges
+    // to keep all the threads busy
+    m_nodes.resize(1);
+
+    vector<BuildTask> Tasks;
+    BuildTask Root = { 0, 0, m_numTriangles, 0 };
+    Tasks.push_back(Root);
+
+    while (Tasks.size() < NumThreads * TASKS_PER_THREAD) {
+        uint Largest = 0;
+
+        for (uint i = 1 ; i < Tasks.size() ; i++) {
+            if (Tasks[i].End - Tasks[i].Begin > Tasks[Largest].End - Tasks[Largest].Begin) {
+                Largest = i;
+            }
+        }
+
+        BuildTask Task = Tasks[Largest];
+
+        if (Task.End - Task.Begin < MIN_PARALLEL_TRIANGLES) {
+            break;
+        }
+
+        Tasks.erase(Tasks.begin() + Largest);
+
+        Node& n = m_nodes[Task.Node];
+        Vector3f CentroidMin, CentroidMax;
+        CalcBounds(Ctx, Task.Begin, Task.End, n.Min, n.Max, CentroidMin, CentroidMax);
+
+        uint Mid = Task.Begin;
+
+        if (Task.Depth < MAX_BVH_DEPTH - 1) {
+            Mid = Split(Ctx, Task.Begin, Task.End, n.Min, n.Max, CentroidMin, CentroidMax);
+        }
+
+        if (Mid == Task.Begin) {
+            n.LeftOrFirst = Task.Begin;
+            n.Count = Task.End - Task.Begin;
+            continue;
+        }
+
+        uint Left = (uint)m_nodes.size();
+        n.LeftOrFirst = Left;
+        n.Count = 0;
+        m_nodes.resize(m_nodes.size() + 2);
+
+        BuildTask LeftTask = { Left, Task.Begin, Mid, Task.Depth + 1 };
+        BuildTask RightTask = { Left + 1, Mid, Task.End, Task.Depth + 1 };
+        Tasks.push_back(LeftTask);
+        Tasks.push_back(RightTask);
+    }
+
+    // Every range is built into its own node array and appended to the tree
+    vector<vector<Node> > Subtrees(Tasks.size());
+    NumThreads = MIN(NumThreads, (uint)Tasks.size());
+
+    if (NumThreads <= 1) {
+        BuildSubtreeThread(&Ctx, &Tasks, &Subtrees, 0, (uint)Tasks.size());
+    }
+    else {
+        vector<std::thread> Threads;
+
+        for (uint i = 0 ; i < NumThreads ; i++) {
+            uint FirstTask = i * (uint)Tasks.size() / NumThreads;
+            uint LastTask = (i + 1) * (uint)Tasks.size() / NumThreads;
+            Threads.push_back(std::thread(BuildSubtreeThread, &Ctx, &Tasks, &Subtrees, FirstTask, LastTask));
+        }
+
+        for (uint i = 0 ; i < Threads.size() ; i++) {
+            Threads[i].join();
+        }
+    }
+
+    for (uint i = 0 ; i < Tasks.size() ; i++) {
+        const vector<Node>& Subtree = Subtrees[i];
+        uint Base = (uint)m_nodes.size() - 1;     // local node j > 0 goes to Base + j
+
+        for (uint j = 0 ; j < Subtree.size() ; j++) {
+            Node n = Subtree[j];
+
+            if (n.Count == 0) {
+                n.LeftOrFirst += Base;
+            }
+
+            if (j == 0) {
+                m_nodes[Tasks[i].Node] = n;
+            }
+            else {
+                m_nodes.push_back(n);
+            }
+        }
+    }
+
+    CreatePackets(Ctx);
+}
+
+
+// Replaces the triangle ranges of the leaves with packet ranges
+void TriangleBVH::CreatePackets(const BuildContext& Ctx)
+{
+    const vector<Vector3f>& Positions = *Ctx.pPositions;
+    const vector<uint>& Indices = *Ctx.pIndices;
+
+    for (uint i = 0 ; i < m_nodes.size() ; i++) {
+        Node& n = m_nodes[i];
+
+        if (n.Count == 0) {
+            continue;
+        }
+
+        uint FirstPacket = (uint)m_packets.size();
+        uint NumPackets = (n.Count + 3) / 4;
+
+        for (uint p = 0 ; p < NumPackets ; p++) {
+            TrianglePacket Packet;
+            memset(&Packet, 0, sizeof(Packet));
+
+            for (uint Lane = 0 ; Lane < 4 ; Lane++) {
+                uint Ref = p * 4 + Lane;
+
+                if (Ref >= n.Count) {
+                    Packet.Triangle[Lane] = INVALID_BVH_TRIANGLE;
+                    continue;
+                }
+
+                uint t = Ctx.Refs[n.LeftOrFirst + Ref];
+                const Vector3f& v0 = Positions[Indices[t * 3]];
+                Vector3f e1 = Positions[Indices[t * 3 + 1]] - v0;
+                Vector3f e2 = Positions[Indices[t * 3 + 2]] - v0;
+
+                Packet.V0[0][Lane] = v0.x;
+                Packet.V0[1][Lane] = v0.y;
+                Packet.V0[2][Lane] = v0.z;
+                Packet.E1[0][Lane] = e1.x;
+                Packet.E1[1][Lane] = e1.y;
+                Packet.E1[2][Lane] = e1.z;
+                Packet.E2[0][Lane] = e2.x;
+                Packet.E2[1][Lane] = e2.y;
+                Packet.E2[2][Lane] = e2.z;
+                Packet.Triangle[Lane] = t;
+            }
+
+            m_packets.push_back(Packet);
+        }
+
+        n.LeftOrFirst = FirstPacket;
+        n.Count = NumPackets;
+    }
+}
+
+
+// Moller-Trumbore against the four triangles of the packet
+void TriangleBVH::IntersectPacket(const TrianglePacket& Packet, const Vector3f& Origin, const Vector3f& Dir, BVHHit& Hit) const
+{
+#if defined(__SSE__) || defined(_M_X64)
+    __m128 dx = _mm_set1_ps(Dir.x);
+    __m128 dy = _mm_set1_ps(Dir.y);
+    __m128 dz = _mm_set1_ps(Dir.z);
+
+    __m128 e1x = _mm_loadu_ps(Packet.E1[0]);
+    __m128 e1y = _mm_loadu_ps(Packet.E1[1]);
+    __m128 e1z = _mm_loadu_ps(Packet.E1[2]);
+    __m128 e2x = _mm_loadu_ps(Packet.E2[0]);
+    __m128 e2y = _mm_loadu_ps(Packet.E2[1]);
+    __m128 e2z = _mm_loadu_ps(Packet.E2[2]);
+
+    // P = Dir x E2
+    __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+    __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+    __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+
+    __m128 Det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+    __m128 InvDet = _mm_div_ps(_mm_set1_ps(1.0f), Det);
+
+    // T = Origin - V0
+    __m128 tx = _mm_sub_ps(_mm_set1_ps(Origin.x), _mm_loadu_ps(Packet.V0[0]));
+    __m128 ty = _mm_sub_ps(_mm_set1_ps(Origin.y), _mm_loadu_ps(Packet.V0[1]));
+    __m128 tz = _mm_sub_ps(_mm_set1_ps(Origin.z), _mm_loadu_ps(Packet.V0[2]));
+
+    __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)), _mm_mul_ps(tz, pz)), InvDet);
+
+    // Q = T x E1
+    __m128 qx = _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(tz, e1y));
+    __m128 qy = _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(tx, e1z));
+    __m128 qz = _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(ty, e1x));
+
+    __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), InvDet);
+    __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), InvDet);
+
+    __m128 Zero = _mm_setzero_ps();
+    __m128 Mask = _mm_cmpneq_ps(Det, Zero);
+    Mask = _mm_and_ps(Mask, _mm_cmpge_ps(u, Zero));
+    Mask = _mm_and_ps(Mask, _mm_cmpge_ps(v, Zero));
+    Mask = _mm_and_ps(Mask, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+    Mask = _mm_and_ps(Mask, _mm_cmpgt_ps(t, Zero));
+    Mask = _mm_and_ps(Mask, _mm_cmplt_ps(t, _mm_set1_ps(Hit.Distance)));
+
+    int HitMask = _mm_movemask_ps(Mask);
+
+    if (HitMask == 0) {
+        return;
+    }
+
+    float T[4], U[4], V[4];
+    _mm_storeu_ps(T, t);
+    _mm_storeu_ps(U, u);
+    _mm_storeu_ps(V, v);
+
+    for (uint Lane = 0 ; Lane < 4 ; Lane++) {
+        if ((HitMask & (1 << Lane)) && (T[Lane] < Hit.Distance)) {
+            Hit.Distance = T[Lane];
+            Hit.Triangle = Packet.Triangle[Lane];
+            Hit.u = U[Lane];
+            Hit.v = V[Lane];
+        }
+    }
+#else
+    for (uint Lane = 0 ; Lane < 4 ; Lane++) {
+        if (Packet.Triangle[Lane] == INVALID_BVH_TRIANGLE) {
+            continue;
+        }
+
+        Vector3f e1(Packet.E1[0][Lane], Packet.E1[1][Lane], Packet.E1[2][Lane]);
+        Vector3f e2(Packet.E2[0][Lane], Packet.E2[1][Lane], Packet.E2[2][Lane]);
+        Vector3f p = Dir.Cross(e2);
+        float Det = Dot(e1, p);
+
+        if (Det == 0.0f) {
+            continue;
+        }
+
+        float InvDet = 1.0f / Det;
+        Vector3f t = Origin - Vector3f(Packet.V0[0][Lane], Packet.V0[1][Lane], Packet.V0[2][Lane]);
+        float u = Dot(t, p) * InvDet;
+        Vector3f q = t.Cross(e1);
+        float v = Dot(Dir, q) * InvDet;
+        float Distance = Dot(e2, q) * InvDet;
+
+        if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && Distance > 0.0f && Distance < Hit.Distance) {
+            Hit.Distance = Distance;
+            Hit.Triangle = Packet.Triangle[Lane];
+            Hit.u = u;
+            Hit.v = v;
+        }
+    }
+#endif
+}
+
+
+// Entry distance of the ray into the box or FLT_MAX if it misses the box or
+// enters it beyond MaxDistance
+static float IntersectBox(const Vector3f& Min, const Vector3f& Max, const Vector3f& Origin,
+                          const Vector3f& InvDir, float MaxDistance)
+{
+    float t1 = (Min.x - Origin.x) * InvDir.x;
+    float t2 = (Max.x - Origin.x) * InvDir.x;
+    float tMin = MIN(t1, t2);
+    float tMax = MAX(t1, t2);
+
+    t1 = (Min.y - Origin.y) * InvDir.y;
+    t2 = (Max.y - Origin.y) * InvDir.y;
+    tMin = MAX(tMin, MIN(t1, t2));
+    tMax = MIN(tMax, MAX(t1, t2));
+
+    t1 = (Min.z - Origin.z) * InvDir.z;
+    t2 = (Max.z - Origin.z) * InvDir.z;
+    tMin = MAX(tMin, MIN(t1, t2));
+    tMax = MIN(tMax, MAX(t1, t2));
+
+    if (tMax < tMin || tMax <= 0.0f || tMin >= MaxDistance) {
+        return FLT_MAX;
+    }
+
+    return MAX(tMin, 0.0f);
+}
+
+
+static float SafeInverse(float f)
+{
+    // Avoids inf * 0 = NaN in the slab test when the ray starts on a slab
+    if (fabsf(f) < 1e-20f) {
+        return (f < 0.0f) ? -1e20f : 1e20f;
+    }
+
+    return 1.0f / f;
+}
+
+
+bool TriangleBVH::Intersect(const Vector3f& Origin, const Vector3f& Dir, BVHHit& Hit, float MaxDistance) const
+{
+    Hit.Distance = MaxDistance;
+    Hit.Triangle = INVALID_BVH_TRIANGLE;
+    Hit.u = 0.0f;
+    Hit.v = 0.0f;
+
+    if (m_nodes.empty()) {
+        return false;
+    }
+
+    Vector3f InvDir(SafeInverse(Dir.x), SafeInverse(Dir.y), SafeInverse(Dir.z));
+
+    if (IntersectBox(m_nodes[0].Min, m_nodes[0].Max, Origin, InvDir, MaxDistance) == FLT_MAX) {
+        return false;
+    }
+
+    uint Stack[TRAVERSAL_STACK_SIZE];
+    uint StackSize = 0;
+    uint NodeIndex = 0;
+
+    while (true) {
+        const Node& n = m_nodes[NodeIndex];
+
+        if (n.Count > 0) {
+            for (uint i = 0 ; i < n.Count ; i++) {
+                IntersectPacket(m_packets[n.LeftOrFirst + i], Origin, Dir, Hit);
+            }
+        }
+        else {
+            // Visit the closer child first so the far one can be culled by
+            // the hit distance
+            uint Near = n.LeftOrFirst;
+            uint Far = n.LeftOrFirst + 1;
+            float NearDistance = IntersectBox(m_nodes[Near].Min, m_nodes[Near].Max, Origin, InvDir, Hit.Distance);
+            float FarDistance = IntersectBox(m_nodes[Far].Min, m_nodes[Far].Max, Origin, InvDir, Hit.Distance);
+
+            if (FarDistance < NearDistance) {
+                std::swap(Near, Far);
+                std::swap(NearDistance, FarDistance);
+            }
+
+            if (NearDistance < FLT_MAX) {
+                if (FarDistance < FLT_MAX) {
+                    // Build and Validate limit the depth so this can't overflow
+                    assert(StackSize < TRAVERSAL_STACK_SIZE);
+                    Stack[StackSize++] = Far;
+                }
+
+                NodeIndex = Near;
+                continue;
+            }
+        }
+
+        if (StackSize == 0) {
+            break;
+        }
+
+        NodeIndex = Stack[--StackSize];
+    }
+
+    return Hit.Triangle != INVALID_BVH_TRIANGLE;
+}
+
+
+bool TriangleBVH::IntersectBruteForce(const Vector3f& Origin, const Vector3f& Dir, BVHHit& Hit, float MaxDistance) const
+{
+    Hit.Distance = MaxDistance;
+    Hit.Triangle = INVALID_BVH_TRIANGLE;
+    Hit.u = 0.0f;
+    Hit.v = 0.0f;
+
+    for (uint i = 0 ; i < m_packets.size() ; i++) {
+        IntersectPacket(m_packets[i], Origin, Dir, Hit);
+    }
+
+    return Hit.Triangle != INVALID_BVH_TRIANGLE;
+}
+
+
+// Rays between random points of the bounding box (grown a bit so some of
+// them start outside) must get the same closest hit from both queries
+uint TriangleBVH::Verify(uint NumRays) const
+{
+    if (m_nodes.empty()) {
+        return 0;
+    }
+
+    Vector3f Min = m_nodes[0].Min;
+    Vector3f Extent = m_nodes[0].Max - Min;
+    Min -= Extent * 0.25f;
+    Extent = Extent * 1.5f;
+
+    uint NumErrors = 0;
+
+    for (uint i = 0 ; i < NumRays ; i++) {
+        Vector3f Origin(Min.x + RandomFloat() * Extent.x, Min.y + RandomFloat() * Extent.y, Min.z + RandomFloat() * Extent.z);
+        Vector3f Target(Min.x + RandomFloat() * Extent.x, Min.y + RandomFloat() * Extent.y, Min.z + RandomFloat() * Extent.z);
+        Vector3f Dir = Target - Origin;
+
+        BVHHit Hit, ExpectedHit;
+        bool IsHit = Intersect(Origin, Dir, Hit);
+        bool IsExpectedHit = IntersectBruteForce(Origin, Dir, ExpectedHit);
+
+        // Ties between triangles at the same distance may pick either one
+        if ((IsHit != IsExpectedHit) ||
+            (IsHit && fabsf(Hit.Distance - ExpectedHit.Distance) > 1e-5f * MAX(ExpectedHit.Distance, 1.0f))) {
+            if (NumErrors < 10) {
+                printf("BVH mismatch: ray (%f, %f, %f) -> (%f, %f, %f) hit %u at %f, expected %u at %f\n",
+                       Origin.x, Origin.y, Origin.z, Dir.x, Dir.y, Dir.z,
+                       Hit.Triangle, Hit.Distance, ExpectedHit.Triangle, ExpectedHit.Distance);
+            }
+
+            NumErrors++;
+        }
+    }
+
+    return NumErrors;
+}
+
+
+uint TriangleBVH::CalcChecksum(const vector<Vector3f>& Positions, const vector<uint>& Indices)
+{
+    // FNV-1a
+    uint Hash = 2166136261u;
+
+    const unsigned char* pData = (const unsigned char*)(Positions.empty() ? NULL : &Positions[0]);
+    size_t Size = sizeof(Vector3f) * Positions.size();
+
+    for (size_t i = 0 ; i < Size ; i++) {
+        Hash = (Hash ^ pData[i]) * 16777619u;
+    }
+
+    pData = (const unsigned char*)(Indices.empty() ? NULL : &Indices[0]);
+    Size = sizeof(uint) * Indices.size();
+
+    for (size_t i = 0 ; i < Size ; i++) {
+        Hash = (Hash ^ pData[i]) * 16777619u;
+    }
+
+    return Hash;
+}
+
+
+bool TriangleBVH::Save(const string& Filename, uint Checksum) const
+{
+    FILE* f = fopen(Filename.c_str(), "wb");
+
+    if (!f) {
+        return false;
+    }
+
+    BVHFileHeader Header;
+    memcpy(Header.Magic, "OBVH", 4);
+    Header.Version = BVH_FILE_VERSION;
+    Header.Checksum = Checksum;
+    Header.NumTriangles = m_numTriangles;
+    Header.NumNodes = (uint)m_nodes.size();
+    Header.NumPackets = (uint)m_packets.size();
+
+    bool Ret = (fwrite(&Header, sizeof(Header), 1, f) == 1);
+
+    if (Ret && !m_nodes.empty()) {
+        Ret = (fwrite(&m_nodes[0], sizeof(Node), m_nodes.size(), f) == m_nodes.size()) &&
+              (fwrite(&m_packets[0], sizeof(TrianglePacket), m_packets.size(), f) == m_packets.size());
+    }
+
+    fclose(f);
+
+    return Ret;
+}
+
+
+// Checks the links of the tree so Intersect can't index out of the arrays or
+// loop. The children are always stored after their parent and the depth must
+// fit the traversal stack.
+bool TriangleBVH::Validate() const
+{
+    uint NumNodes = (uint)m_nodes.size();
+    uint NumPackets = (uint)m_packets.size();
+
+    vector<uint> Depth(NumNodes, 0);
+
+    for (uint i = 0 ; i < NumNodes ; i++) {
+        const Node& n = m_nodes[i];
+
+        if (n.Count == 0) {
+            if (n.LeftOrFirst <= i || n.LeftOrFirst >= NumNodes - 1) {
+                return false;
+            }
+
+            if (Depth[i] + 1 >= MAX_BVH_DEPTH) {
+                return false;
+            }
+
+            Depth[n.LeftOrFirst] = MAX(Depth[n.LeftOrFirst], Depth[i] + 1);
+            Depth[n.LeftOrFirst + 1] = MAX(Depth[n.LeftOrFirst + 1], Depth[i] + 1);
+        }
+        else if (n.LeftOrFirst > NumPackets || n.Count > NumPackets - n.LeftOrFirst) {
+            return false;
+        }
+    }
+
+    for (uint i = 0 ; i < NumPackets ; i++) {
+        for (uint Lane = 0 ; Lane < 4 ; Lane++) {
+            uint t = m_packets[i].Triangle[Lane];
+
+            if (t != INVALID_BVH_TRIANGLE && t >= m_numTriangles) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+bool TriangleBVH::Load(const string& Filename, uint Checksum)
+{
+    FILE* f = fopen(Filename.c_str(), "rb");
+
+    if (!f) {
+        return false;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long FileSize = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    BVHFileHeader Header;
+
+    bool Ret = (FileSize >= (long)sizeof(Header)) &&
+               (fread(&Header, sizeof(Header), 1, f) == 1) &&
+               (memcmp(Header.Magic, "OBVH", 4) == 0) &&
+               (Header.Version == BVH_FILE_VERSION) &&
+               (Header.Checksum == Checksum) &&
+               (Header.NumNodes > 0);
+
+    if (Ret) {
+        // Don't trust the counts of the header before they match the file
+        // length - a truncated or corrupt file must not cause a huge allocation
+        unsigned long long ExpectedSize = (unsigned long long)sizeof(Header) +
+                                          (unsigned long long)Header.NumNodes * sizeof(Node) +
+                                          (unsigned long long)Header.NumPackets * sizeof(TrianglePacket);
+
+        if (ExpectedSize != (unsigned long long)FileSize) {
+            printf("Error: the size of '%s' doesn't match its header\n", Filename.c_str());
+            fclose(f);
+            return false;
+        }
+
+        m_numTriangles = Header.NumTriangles;
+        m_nodes.resize(Header.NumNodes);
+        m_packets.resize(Header.NumPackets);
+
+        Ret = (fread(&m_nodes[0], sizeof(Node), m_nodes.size(), f) == m_nodes.size()) &&
+              (m_packets.empty() || fread(&m_packets[0], sizeof(TrianglePacket), m_packets.size(), f) == m_packets.size()) &&
+              Validate();
+
+        if (!Ret) {
+            printf("Error reading '%s'\n", Filename.c_str());
+            m_nodes.clear();
+            m_packets.clear();
+            m_numTriangles = 0;
+        }
+    }
+
+    fclose(f);
+
+    return Ret;
+}
+
+
+void CalcPickRay(int x, int y, uint WindowWidth, uint WindowHeight, const Matrix4f& VP,
+                 Vector3f& Origin, Vector3f& Dir)
+{
+    Matrix4f InvVP = VP;
+    InvVP.Inverse();
+
+    // Center of the pixel in NDC. The window y axis points down.
+    float NdcX = 2.0f * ((float)x + 0.5f) / (float)WindowWidth - 1.0f;
+    float NdcY = 1.0f - 2.0f * ((float)y + 0.5f) / (float)WindowHeight;
+
+    Vector4f Near = InvVP * Vector4f(NdcX, NdcY, -1.0f, 1.0f);
+    Vector4f Far = InvVP * Vector4f(NdcX, NdcY, 1.0f, 1.0f);
+
+    Origin = Vector3f(Near / Near.w);
+    Dir = Vector3f(Far / Far.w) - Origin;
+}
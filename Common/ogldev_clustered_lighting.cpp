@@ -0,0 +1,514 @@
+/*
+
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
+#include <string.h>
+
+#include "ogldev_util.h"
+#include "ogldev_clustered_lighting.h"
+
+#define CLUSTERS_PER_SLICE (CLUSTER_GRID_X * CLUSTER_GRID_Y)
+
+
+static void UploadStorageBuffer(GLuint Buffer, const void* pData, size_t Size)
+{
+    // Never leave a binding without storage, even when there are no lights
+    static const uint Dummy[4] = { 0 };
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, Buffer);
+
+    if (Size == 0) {
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(Dummy), Dummy, GL_DYNAMIC_DRAW);
+    }
+    else {
+        glBufferData(GL_SHADER_STORAGE_BUFFER, Size, pData, GL_DYNAMIC_DRAW);
+    }
+}
+
+
+LightClusterGrid::LightClusterGrid()
+{
+    ZERO_MEM(m_buffers);
+    m_numThreads = 1;
+    m_sliceScale = 0.0f;
+    m_sliceBias = 0.0f;
+    m_numLightIndices = 0;
+    m_numDroppedLights = 0;
+    m_workGeneration = 0;
+    m_numBusyWorkers = 0;
+    m_quit = false;
+}
+
+
+LightClusterGrid::~LightClusterGrid()
+{
+    StopWorkers();
+
+    if (m_buffers[0] != 0) {
+        glDeleteBuffers(ARRAY_SIZE_IN_ELEMENTS(m_buffers), m_buffers);
+    }
+}
+
+
+bool LightClusterGrid::Init(const PersProjInfo& ProjInfo, uint NumThreads)
+{
+    StopWorkers();
+
+    m_projInfo = ProjInfo;
+
+    m_numThreads = (NumThreads == 0) ? std::thread::hardware_concurrency() : NumThreads;
+
+    if (m_numThreads == 0) {
+        m_numThreads = 1;
+    }
+
+    if (m_numThreads > CLUSTER_GRID_Z) {
+        m_numThreads = CLUSTER_GRID_Z;
+    }
+
+    // Slice k starts at zNear * (zFar / zNear) ^ (k / CLUSTER_GRID_Z)
+    float LogDepthRange = logf(m_projInfo.zFar / m_projInfo.zNear);
+    m_sliceScale = (float)CLUSTER_GRID_Z / LogDepthRange;
+    m_sliceBias = -(float)CLUSTER_GRID_Z * logf(m_projInfo.zNear) / LogDepthRange;
+
+    const float TanHalfFOV = tanf(ToRadian(m_projInfo.FOV / 2.0f));
+    const float TanHalfFOVX = TanHalfFOV * m_projInfo.Width / m_projInfo.Height;
+
+    m_minX.resize(NUM_CLUSTERS);
+    m_minY.resize(NUM_CLUSTERS);
+    m_minZ.resize(NUM_CLUSTERS);
+    m_maxX.resize(NUM_CLUSTERS);
+    m_maxY.resize(NUM_CLUSTERS);
+    m_maxZ.resize(NUM_CLUSTERS);
+
+    // The view space box of every cluster. Along x and y the cluster is bounded
+    // by its NDC range scaled by the depth at its near and far planes.
+    for (uint z = 0 ; z < CLUSTER_GRID_Z ; z++) {
+        float Near = m_projInfo.zNear * powf(m_projInfo.zFar / m_projInfo.zNear, (float)z / CLUSTER_GRID_Z);
+        float Far = m_projInfo.zNear * powf(m_projInfo.zFar / m_projInfo.zNear, (float)(z + 1) / CLUSTER_GRID_Z);
+
+        for (uint y = 0 ; y < CLUSTER_GRID_Y ; y++) {
+            float y0 = (-1.0f + 2.0f * y / CLUSTER_GRID_Y) * TanHalfFOV;
+            float y1 = (-1.0f + 2.0f * (y + 1) / CLUSTER_GRID_Y) * TanHalfFOV;
+
+            for (uint x = 0 ; x < CLUSTER_GRID_X ; x++) {
+                float x0 = (-1.0f + 2.0f * x / CLUSTER_GRID_X) * TanHalfFOVX;
+                float x1 = (-1.0f + 2.0f * (x + 1) / CLUSTER_GRID_X) * TanHalfFOVX;
+
+                uint Index = (z * CLUSTER_GRID_Y + y) * CLUSTER_GRID_X + x;
+
+                m_minX[Index] = MIN(x0 * Near, x0 * Far);
+                m_maxX[Index] = MAX(x1 * Near, x1 * Far);
+                m_minY[Index] = MIN(y0 * Near, y0 * Far);
+                m_maxY[Index] = MAX(y1 * Near, y1 * Far);
+                m_minZ[Index] = Near;
+                m_maxZ[Index] = Far;
+            }
+        }
+    }
+
+    m_clusterCounts.resize(NUM_CLUSTERS);
+    m_clusterLists.resize(NUM_CLUSTERS * MAX_LIGHTS_PER_CLUSTER);
+    m_clusterTable.resize(NUM_CLUSTERS * 2);
+
+    glGenBuffers(ARRAY_SIZE_IN_ELEMENTS(m_buffers), m_buffers);
+
+    // The calling thread does the first range of slices
+    for (uint i = 1 ; i < m_numThreads ; i++) {
+        m_workers.push_back(std::thread(WorkerThread, this, i));
+    }
+
+    return GLCheckError();
+}
+
+
+void LightClusterGrid::StopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> Lock(m_workMutex);
+        m_quit = true;
+    }
+
+    m_workStart.notify_all();
+
+    for (uint i = 0 ; i < m_workers.size() ; i++) {
+        m_workers[i].join();
+    }
+
+    m_workers.clear();
+    m_quit = false;
+}
+
+
+void LightClusterGrid::WorkerThread(LightClusterGrid* pGrid, uint Worker)
+{
+    pGrid->WorkerLoop(Worker);
+}
+
+
+void LightClusterGrid::WorkerLoop(uint Worker)
+{
+    uint Generation = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> Lock(m_workMutex);
+            m_workStart.wait(Lock, [&]() { return m_quit || (m_workGeneration != Generation); });
+
+            if (m_quit) {
+                return;
+            }
+
+            Generation = m_workGeneration;
+        }
+
+        AssignSlices(Worker * CLUSTER_GRID_Z / m_numThreads, (Worker + 1) * CLUSTER_GRID_Z / m_numThreads);
+
+        bool IsLast;
+
+        {
+            std::lock_guard<std::mutex> Lock(m_workMutex);
+            IsLast = (--m_numBusyWorkers == 0);
+        }
+
+        if (IsLast) {
+            m_workDone.notify_one();
+        }
+    }
+}
+
+
+// The quadratic in the attenuation is solved for the distance where the
+// brightest channel drops to 1/256 (same as the deferred shading tutorials)
+float LightClusterGrid::CalcLightRange(const PointLight& Light, float MaxRange)
+{
+    float MaxChannel = MAX(MAX(Light.Color.x, Light.Color.y), Light.Color.z);
+    float Threshold = 256.0f * MaxChannel * Light.DiffuseIntensity;
+    const LightAttenuation& Atten = Light.Attenuation;
+
+    float Range = MaxRange;
+
+    if (Atten.Exp > 0.0f) {
+        Range = (-Atten.Linear + sqrtf(Atten.Linear * Atten.Linear - 4.0f * Atten.Exp * (Atten.Constant - Threshold))) / (2.0f * Atten.Exp);
+    }
+    else if (Atten.Linear > 0.0f) {
+        Range = (Threshold - Atten.Constant) / Atten.Linear;
+    }
+
+    return MIN(MAX(Range, 0.0f), MaxRange);
+}
+
+
+void LightClusterGrid::Update(const Matrix4f& View,
+                              const PointLight* pPointLights, uint NumPointLights,
+                              const SpotLight* pSpotLights, uint NumSpotLights)
+{
+    const uint NumLights = NumPointLights + NumSpotLights;
+
+    m_lights.resize(NumLights);
+    m_spheres.resize(NumLights);
+
+    for (uint i = 0 ; i < NumLights ; i++) {
+        const PointLight& Light = (i < NumPointLights) ? pPointLights[i] : (const PointLight&)pSpotLights[i - NumPointLights];
+
+        float Range = CalcLightRange(Light, m_projInfo.zFar);
+
+        ClusterLight& l = m_lights[i];
+        l.PositionRange = Vector4f(Light.Position, Range);
+        l.ColorDiffuse = Vector4f(Light.Color, Light.DiffuseIntensity);
+        l.Atten = Vector4f(Light.Attenuation.Constant, Light.Attenuation.Linear, Light.Attenuation.Exp, Light.AmbientIntensity);
+
+        if (i < NumPointLights) {
+            l.DirectionCutoff = Vector4f(0.0f, 0.0f, 0.0f, -2.0f);
+        }
+        else {
+            const SpotLight& Spot = pSpotLights[i - NumPointLights];
+            Vector3f Direction = Spot.Direction;
+            Direction.Normalize();
+            l.DirectionCutoff = Vector4f(Direction, cosf(ToRadian(Spot.Cutoff)));
+        }
+
+        // Spot lights are bounded by the sphere of their range
+        Vector4f ViewPos = View * Vector4f(Light.Position, 1.0f);
+        m_spheres[i].x = ViewPos.x;
+        m_spheres[i].y = ViewPos.y;
+        m_spheres[i].z = ViewPos.z;
+        m_spheres[i].r = Range;
+    }
+
+    memset(&m_clusterCounts[0], 0, sizeof(uint) * NUM_CLUSTERS);
+
+    // Every thread owns a range of slices so the cluster lists need no locking
+    {
+        std::lock_guard<std::mutex> Lock(m_workMutex);
+        m_numBusyWorkers = (uint)m_workers.size();
+        m_workGeneration++;
+    }
+
+    m_workStart.notify_all();
+
+    AssignSlices(0, CLUSTER_GRID_Z / m_numThreads);
+
+    {
+        std::unique_lock<std::mutex> Lock(m_workMutex);
+        m_workDone.wait(Lock, [&]() { return m_numBusyWorkers == 0; });
+    }
+
+    // Pack the lists of all the clusters into a single array. The counts
+    // include the lights that didn't fit so they are clamped here.
+    m_numLightIndices = 0;
+    uint NumDroppedLights = 0;
+
+    for (uint i = 0 ; i < NUM_CLUSTERS ; i++) {
+        if (m_clusterCounts[i] > MAX_LIGHTS_PER_CLUSTER) {
+            NumDroppedLights += m_clusterCounts[i] - MAX_LIGHTS_PER_CLUSTER;
+            m_clusterCounts[i] = MAX_LIGHTS_PER_CLUSTER;
+        }
+
+        m_numLightIndices += m_clusterCounts[i];
+    }
+
+    // Report only when the overflow starts so that it doesn't flood the console every frame
+    if ((NumDroppedLights > 0) && (m_numDroppedLights == 0)) {
+        printf("Warning! %d light assignments were dropped because a cluster has more than %d lights\n",
+               NumDroppedLights, MAX_LIGHTS_PER_CLUSTER);
+    }
+
+    m_numDroppedLights = NumDroppedLights;
+
+    m_lightIndices.resize(m_numLightIndices);
+
+    uint Offset = 0;
+
+    for (uint i = 0 ; i < NUM_CLUSTERS ; i++) {
+        m_clusterTable[i * 2] = Offset;
+        m_clusterTable[i * 2 + 1] = m_clusterCounts[i];
+
+        if (m_clusterCounts[i] > 0) {
+            memcpy(&m_lightIndices[Offset], &m_clusterLists[i * MAX_LIGHTS_PER_CLUSTER], sizeof(uint) * m_clusterCounts[i]);
+            Offset += m_clusterCounts[i];
+        }
+    }
+
+    UploadStorageBuffer(m_buffers[0], NumLights ? &m_lights[0] : NULL, sizeof(ClusterLight) * NumLights);
+    UploadStorageBuffer(m_buffers[1], &m_clusterTable[0], sizeof(uint) * m_clusterTable.size());
+    UploadStorageBuffer(m_buffers[2], m_numLightIndices ? &m_lightIndices[0] : NULL, sizeof(uint) * m_numLightIndices);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+
+// The count keeps growing past MAX_LIGHTS_PER_CLUSTER so that Update can
+// report the lights that were dropped
+inline void LightClusterGrid::AddToCluster(uint Cluster, uint LightIndex)
+{
+    uint& Count = m_clusterCounts[Cluster];
+
+    if (Count < MAX_LIGHTS_PER_CLUSTER) {
+        m_clusterLists[Cluster * MAX_LIGHTS_PER_CLUSTER + Count] = LightIndex;
+    }
+
+    Count++;
+}
+
+
+// Assigns the lights to the clusters of slices [FirstSlice, LastSlice)
+void LightClusterGrid::AssignSlices(uint FirstSlice, uint LastSlice)
+{
+    for (uint LightIndex = 0 ; LightIndex < m_spheres.size() ; LightIndex++) {
+        const LightSphere& s = m_spheres[LightIndex];
+
+        if ((s.z + s.r <= m_projInfo.zNear) || (s.z - s.r >= m_projInfo.zFar)) {
+            continue;
+        }
+
+        // Depth slices covered by the sphere. One extra slice on each side
+        // absorbs the rounding of the log - the box test has the final word.
+        float zMin = MAX(s.z - s.r, m_projInfo.zNear);
+        float zMax = MIN(s.z + s.r, m_projInfo.zFar);
+        int First = (int)(logf(zMin) * m_sliceScale + m_sliceBias) - 1;
+        int Last = (int)(logf(zMax) * m_sliceScale + m_sliceBias) + 1;
+        First = MAX(First, (int)FirstSlice);
+        Last = MIN(Last, (int)LastSlice - 1);
+
+        for (int Slice = First ; Slice <= Last ; Slice++) {
+            uint Base = Slice * CLUSTERS_PER_SLICE;
+
+#if defined(__SSE__) || defined(_M_X64)
+            const __m128 x = _mm_set1_ps(s.x);
+            const __m128 y = _mm_set1_ps(s.y);
+            const __m128 z = _mm_set1_ps(s.z);
+            const __m128 r2 = _mm_set1_ps(s.r * s.r);
+            const __m128 Zero = _mm_setzero_ps();
+
+            // Squared distance from the center to the box of 4 clusters at a time
+            for (uint i = Base ; i < Base + CLUSTERS_PER_SLICE ; i += 4) {
+                __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_minX[i]), x), _mm_sub_ps(x, _mm_loadu_ps(&m_maxX[i]))), Zero);
+                __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_minY[i]), y), _mm_sub_ps(y, _mm_loadu_ps(&m_maxY[i]))), Zero);
+                __m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_minZ[i]), z), _mm_sub_ps(z, _mm_loadu_ps(&m_maxZ[i]))), Zero);
+                __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+                int Mask = _mm_movemask_ps(_mm_cmple_ps(d2, r2));
+
+                for (uint j = 0 ; Mask != 0 ; j++, Mask >>= 1) {
+                    if (Mask & 1) {
+                        AddToCluster(i + j, LightIndex);
+                    }
+                }
+            }
+#else
+            for (uint i = Base ; i < Base + CLUSTERS_PER_SLICE ; i++) {
+                float dx = MAX(MAX(m_minX[i] - s.x, s.x - m_maxX[i]), 0.0f);
+                float dy = MAX(MAX(m_minY[i] - s.y, s.y - m_maxY[i]), 0.0f);
+                float dz = MAX(MAX(m_minZ[i] - s.z, s.z - m_maxZ[i]), 0.0f);
+
+                if (dx * dx + dy * dy + dz * dz <= s.r * s.r) {
+                    AddToCluster(i, LightIndex);
+                }
+            }
+#endif
+        }
+    }
+}
+
+
+void LightClusterGrid::Bind()
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_LIGHTS_BINDING, m_buffers[0]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_TABLE_BINDING, m_buffers[1]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_LIGHT_INDICES_BINDING, m_buffers[2]);
+}
+
+
+ClusteredLightingTechnique::ClusteredLightingTechnique()
+{
+}
+
+
+bool ClusteredLightingTechnique::Init()
+{
+    if (!Technique::Init()) {
+        return false;
+    }
+
+    if (!AddShader(GL_VERTEX_SHADER, "../Common/Shaders/basic_lighting.vs")) {
+        return false;
+    }
+
+    if (!AddShader(GL_FRAGMENT_SHADER, "../Common/Shaders/clustered_lighting.fs")) {
+        return false;
+    }
+
+    if (!Finalize()) {
+        return false;
+    }
+
+    m_WVPLocation = GetUniformLocation("gWVP");
+    m_WorldMatrixLocation = GetUniformLocation("gWorld");
+    m_viewMatrixLocation = GetUniformLocation("gView");
+    m_colorTextureLocation = GetUniformLocation("gColorMap");
+    m_eyeWorldPosLocation = GetUniformLocation("gEyeWorldPos");
+    m_dirLightLocation.Color = GetUniformLocation("gDirectionalLight.Base.Color");
+    m_dirLightLocation.AmbientIntensity = GetUniformLocation("gDirectionalLight.Base.AmbientIntensity");
+    m_dirLightLocation.Direction = GetUniformLocation("gDirectionalLight.Direction");
+    m_dirLightLocation.DiffuseIntensity = GetUniformLocation("gDirectionalLight.Base.DiffuseIntensity");
+    m_matSpecularIntensityLocation = GetUniformLocation("gMatSpecularIntensity");
+    m_matSpecularPowerLocation = GetUniformLocation("gSpecularPower");
+    m_tileScaleLocation = GetUniformLocation("gTileScale");
+    m_sliceParamsLocation = GetUniformLocation("gSliceParams");
+
+    if (m_dirLightLocation.AmbientIntensity == INVALID_UNIFORM_LOCATION ||
+        m_WVPLocation == INVALID_UNIFORM_LOCATION ||
+        m_WorldMatrixLocation == INVALID_UNIFORM_LOCATION ||
+        m_viewMatrixLocation == INVALID_UNIFORM_LOCATION ||
+        m_colorTextureLocation == INVALID_UNIFORM_LOCATION ||
+        m_eyeWorldPosLocation == INVALID_UNIFORM_LOCATION ||
+        m_dirLightLocation.Color == INVALID_UNIFORM_LOCATION ||
+        m_dirLightLocation.DiffuseIntensity == INVALID_UNIFORM_LOCATION ||
+        m_dirLightLocation.Direction == INVALID_UNIFORM_LOCATION ||
+        m_matSpecularIntensityLocation == INVALID_UNIFORM_LOCATION ||
+        m_matSpecularPowerLocation == INVALID_UNIFORM_LOCATION ||
+        m_tileScaleLocation == INVALID_UNIFORM_LOCATION ||
+        m_sliceParamsLocation == INVALID_UNIFORM_LOCATION) {
+        return false;
+    }
+
+    return true;
+}
+
+
+void ClusteredLightingTechnique::SetWVP(const Matrix4f& WVP)
+{
+    glUniformMatrix4fv(m_WVPLocation, 1, GL_TRUE, (const GLfloat*)WVP.m);
+}
+
+
+void ClusteredLightingTechnique::SetWorldMatrix(const Matrix4f& World)
+{
+    glUniformMatrix4fv(m_WorldMatrixLocation, 1, GL_TRUE, (const GLfloat*)World.m);
+}
+
+
+void ClusteredLightingTechnique::SetViewMatrix(const Matrix4f& View)
+{
+    glUniformMatrix4fv(m_viewMatrixLocation, 1, GL_TRUE, (const GLfloat*)View.m);
+}
+
+
+void ClusteredLightingTechnique::SetColorTextureUnit(unsigned int TextureUnit)
+{
+    glUniform1i(m_colorTextureLocation, TextureUnit);
+}
+
+
+void ClusteredLightingTechnique::SetDirectionalLight(const DirectionalLight& Light)
+{
+    glUniform3f(m_dirLightLocation.Color, Light.Color.x, Light.Color.y, Light.Color.z);
+    glUniform1f(m_dirLightLocation.AmbientIntensity, Light.AmbientIntensity);
+    Vector3f Direction = Light.Direction;
+    Direction.Normalize();
+    glUniform3f(m_dirLightLocation.Direction, Direction.x, Direction.y, Direction.z);
+    glUniform1f(m_dirLightLocation.DiffuseIntensity, Light.DiffuseIntensity);
+}
+
+
+void ClusteredLightingTechnique::SetEyeWorldPos(const Vector3f& EyeWorldPos)
+{
+    glUniform3f(m_eyeWorldPosLocation, EyeWorldPos.x, EyeWorldPos.y, EyeWorldPos.z);
+}
+
+
+void ClusteredLightingTechnique::SetMatSpecularIntensity(float Intensity)
+{
+    glUniform1f(m_matSpecularIntensityLocation, Intensity);
+}
+
+
+void ClusteredLightingTechnique::SetMatSpecularPower(float Power)
+{
+    glUniform1f(m_matSpecularPowerLocation, Power);
+}
+
+
+void ClusteredLightingTechnique::SetClusterGrid(const LightClusterGrid& Grid)
+{
+    glUniform2f(m_tileScaleLocation, (float)CLUSTER_GRID_X / Grid.GetScreenWidth(), (float)CLUSTER_GRID_Y / Grid.GetScreenHeight());
+    glUniform2f(m_sliceParamsLocation, Grid.GetSliceScale(), Grid.GetSliceBias());
+}
@@ -0,0 +1,208 @@
+/*
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <math.h>
+#include <vector>
+
+#include "ogldev_util.h"
+#include "ogldev_gpu_sort.h"
+
+using namespace std;
+
+
+BitonicSortStepTechnique::BitonicSortStepTechnique()
+{
+}
+
+
+bool BitonicSortStepTechnique::Init()
+{
+    if (!Technique::Init()) {
+        return false;
+    }
+
+    if (!AddShader(GL_COMPUTE_SHADER, "../Common/Shaders/bitonic_sort.cs")) {
+        return false;
+    }
+
+    if (!Finalize()) {
+        return false;
+    }
+
+    m_blockSizeLocation = GetUniformLocation("gBlockSize");
+    m_flipLocation = GetUniformLocation("gFlip");
+
+    if (m_blockSizeLocation == INVALID_UNIFORM_LOCATION ||
+        m_flipLocation == INVALID_UNIFORM_LOCATION) {
+        return false;
+    }
+
+    return GLCheckError();
+}
+
+
+void BitonicSortStepTechnique::SetStep(uint BlockSize, bool Flip)
+{
+    glUniform1ui(m_blockSizeLocation, BlockSize);
+    glUniform1i(m_flipLocation, Flip ? 1 : 0);
+}
+
+
+BitonicSortLocalTechnique::BitonicSortLocalTechnique()
+{
+}
+
+
+bool BitonicSortLocalTechnique::Init()
+{
+    if (!Technique::Init()) {
+        return false;
+    }
+
+    if (!AddShader(GL_COMPUTE_SHADER, "../Common/Shaders/bitonic_sort_local.cs")) {
+        return false;
+    }
+
+    if (!Finalize()) {
+        return false;
+    }
+
+    m_blockOffsetLocation = GetUniformLocation("gBlockOffset");
+    m_presortLocation = GetUniformLocation("gPresort");
+
+    if (m_blockOffsetLocation == INVALID_UNIFORM_LOCATION ||
+        m_presortLocation == INVALID_UNIFORM_LOCATION) {
+        return false;
+    }
+
+    return GLCheckError();
+}
+
+
+void BitonicSortLocalTechnique::SetParams(uint BlockOffset, bool Presort)
+{
+    glUniform1ui(m_blockOffsetLocation, BlockOffset);
+    glUniform1i(m_presortLocation, Presort ? 1 : 0);
+}
+
+
+GPUBitonicSort::GPUBitonicSort()
+{
+    m_size = 0;
+    m_shiftBlocks = false;
+
+    ZERO_MEM(m_buffers);
+}
+
+
+GPUBitonicSort::~GPUBitonicSort()
+{
+    if (m_buffers[0] != 0) {
+        glDeleteBuffers(ARRAY_SIZE_IN_ELEMENTS(m_buffers), m_buffers);
+    }
+}
+
+
+bool GPUBitonicSort::Init(uint MaxElements)
+{
+    m_size = BITONIC_SORT_BLOCK_SIZE;
+
+    while (m_size < MaxElements) {
+        m_size *= 2;
+    }
+
+    vector<float> Keys(m_size, INFINITY);
+    vector<uint> Values(m_size);
+
+    for (uint i = 0 ; i < m_size ; i++) {
+        Values[i] = i;
+    }
+
+    glGenBuffers(ARRAY_SIZE_IN_ELEMENTS(m_buffers), m_buffers);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[KEY_BUFFER]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(float) * m_size, &Keys[0], GL_DYNAMIC_COPY);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[VALUE_BUFFER]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(uint) * m_size, &Values[0], GL_DYNAMIC_COPY);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    if (!m_stepTech.Init() || !m_localTech.Init()) {
+        return false;
+    }
+
+    return GLCheckError();
+}
+
+
+void GPUBitonicSort::Bind()
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BITONIC_SORT_KEYS_BINDING, m_buffers[KEY_BUFFER]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BITONIC_SORT_VALUES_BINDING, m_buffers[VALUE_BUFFER]);
+}
+
+
+void GPUBitonicSort::DispatchLocal(uint BlockOffset, bool Presort)
+{
+    m_localTech.Enable();
+    m_localTech.SetParams(BlockOffset, Presort);
+    glDispatchCompute((m_size - BlockOffset) / BITONIC_SORT_BLOCK_SIZE, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+
+// Every stage merges sorted runs of BlockSize/2 into runs of BlockSize. The
+// steps that compare elements further apart than a block go through the
+// global pass, one dispatch per step, and the rest of the stage is done in
+// shared memory by a single dispatch.
+void GPUBitonicSort::Sort()
+{
+    Bind();
+
+    DispatchLocal(0, true);
+
+    uint NumGroups = m_size / 2 / BITONIC_SORT_GROUP_SIZE;
+
+    for (uint BlockSize = 2 * BITONIC_SORT_BLOCK_SIZE ; BlockSize <= m_size ; BlockSize *= 2) {
+        m_stepTech.Enable();
+
+        m_stepTech.SetStep(BlockSize, true);
+        glDispatchCompute(NumGroups, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        for (uint HalfSize = BlockSize / 2 ; HalfSize > BITONIC_SORT_BLOCK_SIZE ; HalfSize /= 2) {
+            m_stepTech.SetStep(HalfSize, false);
+            glDispatchCompute(NumGroups, 1, 1);
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        }
+
+        DispatchLocal(0, false);
+    }
+}
+
+
+// An element can move up to half a block per call. Alternating the block
+// boundaries lets it keep moving in the following calls.
+void GPUBitonicSort::SortBlocks()
+{
+    Bind();
+
+    DispatchLocal(m_shiftBlocks ? BITONIC_SORT_BLOCK_SIZE / 2 : 0, true);
+
+    m_shiftBlocks = !m_shiftBlocks;
+}
@@ -0,0 +1,225 @@
+/*
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include "ogldev_util.h"
+#include "ogldev_mesh_adjacency.h"
+
+#define INVALID_ADJACENCY_INDEX 0xFFFFFFFF
+
+
+struct EdgeSlot {
+    uint a;             // INVALID_ADJACENCY_INDEX when the slot is empty
+    uint b;
+    uint HalfEdge;      // triangle * 3 + edge of the first triangle seen
+};
+
+
+// Smallest power of two that keeps the table at most half full
+static uint CalcTableSize(uint NumItems)
+{
+    uint Size = 16;
+
+    while (Size < NumItems * 2) {
+        Size *= 2;
+    }
+
+    return Size;
+}
+
+
+static uint HashPosition(const Vector3f& v)
+{
+    // Adding zero turns -0 into +0 so both hash the same
+    float f[3] = { v.x + 0.0f, v.y + 0.0f, v.z + 0.0f };
+    uint u[3];
+    memcpy(u, f, sizeof(u));
+
+    uint Hash = (u[0] * 0x8da6b343u) ^ (u[1] * 0xd8163841u) ^ (u[2] * 0xcb1ab31fu);
+
+    return Hash ^ (Hash >> 16);
+}
+
+
+static uint HashEdge(uint a, uint b)
+{
+    uint Hash = a * 0x9e3779b1u + b * 0x85ebca6bu;
+
+    return Hash ^ (Hash >> 15);
+}
+
+
+// Maps every vertex to the first vertex with the same position
+static void WeldVertices(const AdjacencyJob& Job, vector<uint>& Remap)
+{
+    uint TableSize = CalcTableSize(Job.NumVertices);
+    uint Mask = TableSize - 1;
+    vector<uint> Table(TableSize, INVALID_ADJACENCY_INDEX);
+
+    Remap.resize(Job.NumVertices);
+
+    for (uint i = 0 ; i < Job.NumVertices ; i++) {
+        const Vector3f& v = Job.pPositions[i];
+        uint Slot = HashPosition(v) & Mask;
+
+        while (true) {
+            uint Index = Table[Slot];
+
+            if (Index == INVALID_ADJACENCY_INDEX) {
+                Table[Slot] = i;
+                Remap[i] = i;
+                break;
+            }
+
+            const Vector3f& Other = Job.pPositions[Index];
+
+            if (Other.x == v.x && Other.y == v.y && Other.z == v.z) {
+                Remap[i] = Index;
+                break;
+            }
+
+            Slot = (Slot + 1) & Mask;
+        }
+    }
+}
+
+
+void BuildAdjacency(const AdjacencyJob& Job)
+{
+    if (Job.NumTriangles == 0) {
+        return;
+    }
+
+    vector<uint> Remap;
+    WeldVertices(Job, Remap);
+
+    uint NumHalfEdges = Job.NumTriangles * 3;
+    vector<uint> Indices(NumHalfEdges);
+
+    for (uint i = 0 ; i < NumHalfEdges ; i++) {
+        Indices[i] = Remap[Job.pIndices[i]];
+    }
+
+    // Every edge is stored once. The second triangle that reaches it links
+    // the two half edges, any further triangle is left without a twin.
+    uint TableSize = CalcTableSize(NumHalfEdges);
+    uint Mask = TableSize - 1;
+    EdgeSlot EmptySlot = { INVALID_ADJACENCY_INDEX, INVALID_ADJACENCY_INDEX, INVALID_ADJACENCY_INDEX };
+    vector<EdgeSlot> Table(TableSize, EmptySlot);
+    vector<uint> Twins(NumHalfEdges, INVALID_ADJACENCY_INDEX);
+
+    for (uint i = 0 ; i < NumHalfEdges ; i++) {
+        uint a = Indices[i];
+        uint b = Indices[(i % 3 == 2) ? i - 2 : i + 1];
+
+        if (a == b) {
+            continue;   // degenerate
+        }
+
+        if (a > b) {
+            std::swap(a, b);
+        }
+
+        uint Slot = HashEdge(a, b) & Mask;
+
+        while (true) {
+            EdgeSlot& e = Table[Slot];
+
+            if (e.a == INVALID_ADJACENCY_INDEX) {
+                e.a = a;
+                e.b = b;
+                e.HalfEdge = i;
+                break;
+            }
+
+            if (e.a == a && e.b == b) {
+                if (Twins[e.HalfEdge] == INVALID_ADJACENCY_INDEX) {
+                    Twins[e.HalfEdge] = i;
+                    Twins[i] = e.HalfEdge;
+                }
+                break;
+            }
+
+            Slot = (Slot + 1) & Mask;
+        }
+    }
+
+    // The vertex opposite to edge j of a triangle is vertex (j + 2) % 3
+    for (uint i = 0 ; i < NumHalfEdges ; i++) {
+        uint Twin = (Twins[i] != INVALID_ADJACENCY_INDEX) ? Twins[i] : i;
+        uint Opposite = Twin - Twin % 3 + (Twin % 3 + 2) % 3;
+
+        Job.pAdjIndices[i * 2]     = Indices[i];
+        Job.pAdjIndices[i * 2 + 1] = Indices[Opposite];
+    }
+}
+
+
+static void BuildAdjacencyThread(const vector<AdjacencyJob>* pJobs, const vector<uint>* pOrder, std::atomic<uint>* pNextJob)
+{
+    while (true) {
+        uint i = (*pNextJob)++;
+
+        if (i >= pOrder->size()) {
+            break;
+        }
+
+        BuildAdjacency((*pJobs)[(*pOrder)[i]]);
+    }
+}
+
+
+void BuildAdjacency(const vector<AdjacencyJob>& Jobs, uint NumThreads)
+{
+    if (NumThreads == 0) {
+        NumThreads = MAX(std::thread::hardware_concurrency(), 1);
+    }
+
+    NumThreads = MIN(NumThreads, (uint)Jobs.size());
+
+    // Starting with the largest submeshes keeps the threads evenly loaded
+    vector<uint> Order(Jobs.size());
+
+    for (uint i = 0 ; i < Order.size() ; i++) {
+        Order[i] = i;
+    }
+
+    std::sort(Order.begin(), Order.end(), [&Jobs](uint a, uint b) {
+        return Jobs[a].NumTriangles > Jobs[b].NumTriangles;
+    });
+
+    std::atomic<uint> NextJob(0);
+
+    if (NumThreads <= 1) {
+        BuildAdjacencyThread(&Jobs, &Order, &NextJob);
+        return;
+    }
+
+    vector<std::thread> Threads;
+
+    for (uint i = 0 ; i < NumThreads ; i++) {
+        Threads.push_back(std::thread(BuildAdjacencyThread, &Jobs, &Order, &NextJob));
+    }
+
+    for (uint i = 0 ; i < Threads.size() ; i++) {
+        Threads[i].join();
+    }
+}
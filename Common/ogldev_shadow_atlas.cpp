@@ -0,0 +1,246 @@
+/*
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+
+#include "ogldev_shadow_atlas.h"
+#include "ogldev_util.h"
+
+// How far (in log2 units) past the rounding point the importance must move
+// before the tile changes its size
+#define SHADOW_ATLAS_HYSTERESIS 0.25f
+
+
+static uint Log2(uint n)
+{
+    uint Ret = 0;
+
+    while (n > 1) {
+        n >>= 1;
+        Ret++;
+    }
+
+    return Ret;
+}
+
+
+// Returns the even (x) and odd (y) bits of a Z order index
+static void MortonDecode(uint Index, uint& x, uint& y)
+{
+    x = 0;
+    y = 0;
+
+    for (uint i = 0 ; i < 16 ; i++) {
+        x |= ((Index >> (2 * i)) & 1) << i;
+        y |= ((Index >> (2 * i + 1)) & 1) << i;
+    }
+}
+
+
+ShadowAtlas::ShadowAtlas()
+{
+    m_fbo = 0;
+    m_shadowMap = 0;
+    m_size = 0;
+    m_minLevel = 0;
+    m_maxLevel = 0;
+}
+
+
+ShadowAtlas::~ShadowAtlas()
+{
+    if (m_fbo != 0) {
+        glDeleteFramebuffers(1, &m_fbo);
+    }
+
+    if (m_shadowMap != 0) {
+        glDeleteTextures(1, &m_shadowMap);
+    }
+}
+
+
+bool ShadowAtlas::Init(uint Size, uint MinTileSize, uint MaxTileSize, uint MaxLights)
+{
+    if ((MinTileSize < 2) || (MinTileSize > MaxTileSize) || (MaxTileSize > Size)) {
+        printf("Invalid shadow atlas tile sizes %d %d (atlas size %d)\n", MinTileSize, MaxTileSize, Size);
+        return false;
+    }
+
+    m_size = Size;
+    m_minLevel = Log2(MinTileSize);
+    m_maxLevel = Log2(MaxTileSize);
+
+    ShadowAtlasTile Empty = { 0, 0, 0 };
+    m_tiles.resize(MaxLights, Empty);
+    m_levels.resize(MaxLights, 0);
+    m_order.resize(MaxLights);
+
+    glGenFramebuffers(1, &m_fbo);
+
+    glGenTextures(1, &m_shadowMap);
+    glBindTexture(GL_TEXTURE_2D, m_shadowMap);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32, Size, Size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_shadowMap, 0);
+
+    // Disable writes to the color buffer
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+
+    GLenum Status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+
+    if (Status != GL_FRAMEBUFFER_COMPLETE) {
+        printf("FB error, status: 0x%x\n", Status);
+        return false;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    return true;
+}
+
+
+uint ShadowAtlas::CalcLevel(float Importance, uint PrevLevel) const
+{
+    float Desired = log2f(MAX(Importance, 1e-6f) * m_size);
+    Desired = MIN(MAX(Desired, (float)m_minLevel), (float)m_maxLevel);
+
+    if ((PrevLevel != 0) && (fabsf(Desired - PrevLevel) < 0.5f + SHADOW_ATLAS_HYSTERESIS)) {
+        return PrevLevel;
+    }
+
+    return (uint)floorf(Desired + 0.5f);
+}
+
+
+uint ShadowAtlas::Allocate(const float* pImportance, uint NumLights)
+{
+    assert(NumLights <= m_tiles.size());
+
+    // Everything is counted in units of the smallest tile
+    uint Capacity = 1 << (2 * (Log2(m_size) - m_minLevel));
+    uint Total = 0;
+
+    vector<uint> Levels(NumLights);
+
+    for (uint i = 0 ; i < NumLights ; i++) {
+        m_levels[i] = CalcLevel(pImportance[i], m_levels[i]);
+        Levels[i] = m_levels[i];
+        Total += 1 << (2 * (Levels[i] - m_minLevel));
+        m_order[i] = i;
+    }
+
+    // Most important first
+    sort(m_order.begin(), m_order.begin() + NumLights,
+         [pImportance](uint l, uint r) { return pImportance[l] > pImportance[r]; });
+
+    // Shrink the least important of the largest tiles until everything fits.
+    // When all the tiles are minimal drop the least important light.
+    while (Total > Capacity) {
+        uint MaxLevel = 0;
+        int Victim = -1;
+
+        for (int i = (int)NumLights - 1 ; i >= 0 ; i--) {
+            uint Light = m_order[i];
+
+            if (Levels[Light] > MaxLevel) {
+                MaxLevel = Levels[Light];
+                Victim = Light;
+            }
+        }
+
+        assert(Victim >= 0);
+
+        if (MaxLevel > m_minLevel) {
+            Total -= 3 << (2 * (MaxLevel - 1 - m_minLevel));
+            Levels[Victim]--;
+        }
+        else {
+            for (int i = (int)NumLights - 1 ; i >= 0 ; i--) {
+                if (Levels[m_order[i]] != 0) {
+                    Levels[m_order[i]] = 0;
+                    Total--;
+                    break;
+                }
+            }
+        }
+    }
+
+    // Large tiles first. The sort is stable so the important lights come first among equals.
+    stable_sort(m_order.begin(), m_order.begin() + NumLights,
+                [&Levels](uint l, uint r) { return Levels[l] > Levels[r]; });
+
+    uint Cursor = 0;
+    uint NumAllocated = 0;
+
+    for (uint i = 0 ; i < NumLights ; i++) {
+        uint Light = m_order[i];
+        ShadowAtlasTile& Tile = m_tiles[Light];
+
+        if (Levels[Light] == 0) {
+            Tile.x = Tile.y = Tile.Size = 0;
+            continue;
+        }
+
+        MortonDecode(Cursor, Tile.x, Tile.y);
+        Tile.x <<= m_minLevel;
+        Tile.y <<= m_minLevel;
+        Tile.Size = 1 << Levels[Light];
+
+        Cursor += 1 << (2 * (Levels[Light] - m_minLevel));
+        NumAllocated++;
+    }
+
+    return NumAllocated;
+}
+
+
+Vector4f ShadowAtlas::GetTileUVRect(uint LightIndex) const
+{
+    const ShadowAtlasTile& Tile = m_tiles[LightIndex];
+    float InvSize = 1.0f / m_size;
+
+    return Vector4f(Tile.x * InvSize, Tile.y * InvSize, Tile.Size * InvSize, Tile.Size * InvSize);
+}
+
+
+void ShadowAtlas::BindForWriting()
+{
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo);
+}
+
+
+void ShadowAtlas::SetViewport(uint LightIndex)
+{
+    const ShadowAtlasTile& Tile = m_tiles[LightIndex];
+    glViewport(Tile.x, Tile.y, Tile.Size, Tile.Size);
+}
+
+
+void ShadowAtlas::BindForReading(GLenum TextureUnit)
+{
+    glActiveTexture(TextureUnit);
+    glBindTexture(GL_TEXTURE_2D, m_shadowMap);
+}
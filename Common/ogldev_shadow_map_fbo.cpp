@@ -26,6 +26,11 @@ ShadowMapFBO::ShadowMapFBO()
 {
     m_fbo = 0;
     m_shadowMap = 0;
+    m_staticFbo = 0;
+    m_staticShadowMap = 0;
+    m_staticValid = false;
+    m_width = 0;
+    m_height = 0;
 }
 
 ShadowMapFBO::~ShadowMapFBO()
@@ -37,16 +42,25 @@ ShadowMapFBO::~ShadowMapFBO()
     if (m_shadowMap != 0) {
         glDeleteTextures(1, &m_shadowMap);
     }
+
+    if (m_staticFbo != 0) {
+        glDeleteFramebuffers(1, &m_staticFbo);
+    }
+
+    if (m_staticShadowMap != 0) {
+        glDeleteTextures(1, &m_staticShadowMap);
+    }
 }
 
-bool ShadowMapFBO::Init(unsigned int WindowWidth, unsigned int WindowHeight)
+
+static bool CreateShadowMap(unsigned int WindowWidth, unsigned int WindowHeight, GLuint& Fbo, GLuint& ShadowMap)
 {
     // Create the FBO
-    glGenFramebuffers(1, &m_fbo);
+    glGenFramebuffers(1, &Fbo);
 
     // Create the depth buffer
-    glGenTextures(1, &m_shadowMap);
-    glBindTexture(GL_TEXTURE_2D, m_shadowMap);
+    glGenTextures(1, &ShadowMap);
+    glBindTexture(GL_TEXTURE_2D, ShadowMap);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32, WindowWidth, WindowHeight, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -55,8 +69,8 @@ bool ShadowMapFBO::Init(unsigned int WindowWidth, unsigned int WindowHeight)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_shadowMap, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, Fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, ShadowMap, 0);
 
     // Disable writes to the color buffer
     glDrawBuffer(GL_NONE);
@@ -73,12 +87,49 @@ bool ShadowMapFBO::Init(unsigned int WindowWidth, unsigned int WindowHeight)
 }
 
 
+bool ShadowMapFBO::Init(unsigned int WindowWidth, unsigned int WindowHeight, bool StaticCache)
+{
+    m_width = WindowWidth;
+    m_height = WindowHeight;
+
+    if (!CreateShadowMap(WindowWidth, WindowHeight, m_fbo, m_shadowMap)) {
+        return false;
+    }
+
+    if (StaticCache && !CreateShadowMap(WindowWidth, WindowHeight, m_staticFbo, m_staticShadowMap)) {
+        return false;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    return true;
+}
+
+
 void ShadowMapFBO::BindForWriting()
 {
     glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo);
 }
 
 
+void ShadowMapFBO::BindForWritingStatic()
+{
+    assert(m_staticFbo != 0);
+    m_staticValid = true;
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_staticFbo);
+}
+
+
+void ShadowMapFBO::BindForWritingDynamic()
+{
+    assert(m_staticValid);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_staticFbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo);
+    glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, m_width, m_height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+
 void ShadowMapFBO::BindForReading(GLenum TextureUnit)
 {
     glActiveTexture(TextureUnit);
@@ -89,7 +140,9 @@ void ShadowMapFBO::BindForReading(GLenum TextureUnit)
 CascadedShadowMapFBO::CascadedShadowMapFBO()
 {
     m_fbo = 0;
-    ZERO_MEM(m_shadowMap);
+    m_layeredFbo = 0;
+    m_shadowMap = 0;
+    m_numCascades = 0;
 }
 
 CascadedShadowMapFBO::~CascadedShadowMapFBO()
@@ -98,29 +151,33 @@ CascadedShadowMapFBO::~CascadedShadowMapFBO()
         glDeleteFramebuffers(1, &m_fbo);
     }
 
-    glDeleteTextures(ARRAY_SIZE_IN_ELEMENTS(m_shadowMap), m_shadowMap);
+    if (m_layeredFbo != 0) {
+        glDeleteFramebuffers(1, &m_layeredFbo);
+    }
+
+    if (m_shadowMap != 0) {
+        glDeleteTextures(1, &m_shadowMap);
+    }
 }
 
-bool CascadedShadowMapFBO::Init(unsigned int WindowWidth, unsigned int WindowHeight)
+bool CascadedShadowMapFBO::Init(unsigned int WindowWidth, unsigned int WindowHeight, unsigned int NumCascades)
 {
-    // Create the FBO
-    glGenFramebuffers(1, &m_fbo);
-
-    // Create the depth buffer    
-    glGenTextures(ARRAY_SIZE_IN_ELEMENTS(m_shadowMap), m_shadowMap);
-    
-    for (uint i = 0 ; i < ARRAY_SIZE_IN_ELEMENTS(m_shadowMap) ; i++) {
-        glBindTexture(GL_TEXTURE_2D, m_shadowMap[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32, WindowWidth, WindowHeight, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    }
+    m_numCascades = NumCascades;
 
+    // Create the depth buffer
+    glGenTextures(1, &m_shadowMap);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_shadowMap);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32, WindowWidth, WindowHeight, NumCascades, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    // Create the FBOs
+    glGenFramebuffers(1, &m_fbo);
     glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_shadowMap[0], 0);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_shadowMap, 0, 0);
 
     // Disable writes to the color buffer
     glDrawBuffer(GL_NONE);
@@ -133,26 +190,41 @@ bool CascadedShadowMapFBO::Init(unsigned int WindowWidth, unsigned int WindowHei
         return false;
     }
 
+    glGenFramebuffers(1, &m_layeredFbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_layeredFbo);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_shadowMap, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+
+    Status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+
+    if (Status != GL_FRAMEBUFFER_COMPLETE) {
+        printf("Layered FB error, status: 0x%x\n", Status);
+        return false;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
     return true;
 }
 
 
 void CascadedShadowMapFBO::BindForWriting(uint CascadeIndex)
 {
-    assert(CascadeIndex < ARRAY_SIZE_IN_ELEMENTS(m_shadowMap));
+    assert(CascadeIndex < m_numCascades);
     glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_shadowMap[CascadeIndex], 0);    
+    glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_shadowMap, 0, CascadeIndex);
 }
 
 
-void CascadedShadowMapFBO::BindForReading()
+void CascadedShadowMapFBO::BindForWritingLayered()
 {
-    glActiveTexture(CASCACDE_SHADOW_TEXTURE_UNIT0);
-    glBindTexture(GL_TEXTURE_2D, m_shadowMap[0]);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_layeredFbo);
+}
 
-    glActiveTexture(CASCACDE_SHADOW_TEXTURE_UNIT1);
-    glBindTexture(GL_TEXTURE_2D, m_shadowMap[1]);
 
-    glActiveTexture(CASCACDE_SHADOW_TEXTURE_UNIT2);
-    glBindTexture(GL_TEXTURE_2D, m_shadowMap[2]);
-}
\ No newline at end of file
+void CascadedShadowMapFBO::BindForReading()
+{
+    glActiveTexture(CASCACDE_SHADOW_TEXTURE_UNIT0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_shadowMap);
+}
@@ -18,6 +18,23 @@
 
 
 
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#define SKINNING_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// The AVX kernel is compiled for AVX on its own so the rest of the program
+// still runs on CPUs without it. The kernel is picked at runtime (see
+// IsAVXSupported).
+#if defined(SKINNING_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_AVX __attribute__((target("avx")))
+#else
+#define TARGET_AVX
+#endif
+
 #include "ogldev_skinned_mesh.h"
 
 #define POSITION_LOCATION    0
@@ -25,19 +42,75 @@
 #define NORMAL_LOCATION      2
 #define BONE_ID_LOCATION     3
 #define BONE_WEIGHT_LOCATION 4
+#define WVP_LOCATION         5
+#define WORLD_LOCATION       9
+#define ANIM_PARAMS_LOCATION 13
+#define BONE_ID2_LOCATION     14   // bones 4-7 of the vertex
+#define BONE_WEIGHT2_LOCATION 15
+#define PREV_POSITION_LOCATION 3   // pre-skinned VAO only - takes the place of the bone IDs
 
 void SkinnedMesh::VertexBoneData::AddBoneData(uint BoneID, float Weight)
 {
-    for (uint i = 0 ; i < ARRAY_SIZE_IN_ELEMENTS(IDs) ; i++) {
-        if (Weights[i] == 0.0) {
-            IDs[i]     = BoneID;
-            Weights[i] = Weight;
-            return;
-        }
+    if (Weight <= 0.0f) {
+        return;
+    }
+
+    // Find the slot that keeps the influences sorted by decreasing weight
+    uint Slot = NumBones;
+
+    while ((Slot > 0) && (Weights[Slot - 1] < Weight)) {
+        Slot--;
+    }
+
+    // When all the slots are taken the smallest influence falls off the end
+    if (Slot == MAX_BONES_PER_VERTEX) {
+        return;
+    }
+
+    uint Last = (NumBones < MAX_BONES_PER_VERTEX) ? NumBones : MAX_BONES_PER_VERTEX - 1;
+
+    for (uint i = Last ; i > Slot ; i--) {
+        IDs[i]     = IDs[i - 1];
+        Weights[i] = Weights[i - 1];
+    }
+
+    IDs[Slot]     = BoneID;
+    Weights[Slot] = Weight;
+
+    if (NumBones < MAX_BONES_PER_VERTEX) {
+        NumBones++;
+    }
+}
+
+
+void SkinnedMesh::VertexBoneData::Normalize(uint MaxBones)
+{
+    for (uint i = MaxBones ; i < NumBones ; i++) {
+        IDs[i]     = 0;
+        Weights[i] = 0.0f;
     }
 
-    // should never get here - more bones than we have space for
-    //    assert(0);
+    if (NumBones > MaxBones) {
+        NumBones = MaxBones;
+    }
+
+    float Sum = 0.0f;
+
+    for (uint i = 0 ; i < NumBones ; i++) {
+        Sum += Weights[i];
+    }
+
+    if (Sum > 0.0f) {
+        for (uint i = 0 ; i < NumBones ; i++) {
+            Weights[i] /= Sum;
+        }
+    }
+    else {
+        // An unskinned vertex follows the first bone
+        IDs[0]     = 0;
+        Weights[0] = 1.0f;
+        NumBones   = 1;
+    }
 }
 
 SkinnedMesh::SkinnedMesh()
@@ -46,6 +119,13 @@ SkinnedMesh::SkinnedMesh()
     ZERO_MEM(m_Buffers);
     m_NumBones = 0;
     m_pScene = NULL;
+    m_UseCompressedAnim = false;
+    m_NumVertices = 0;
+    m_MaxBonesPerVertex = NUM_BONES_PER_VEREX;
+    ZERO_MEM(m_SkinnedVAO);
+    ZERO_MEM(m_SkinnedVB);
+    m_CurrSkinned = 0;
+    m_UseAVX = false;
 }
 
 
@@ -69,14 +149,34 @@ void SkinnedMesh::Clear()
         glDeleteVertexArrays(1, &m_VAO);
         m_VAO = 0;
     }
+
+    if (m_SkinnedVB[0] != 0) {
+        glDeleteBuffers(ARRAY_SIZE_IN_ELEMENTS(m_SkinnedVB), m_SkinnedVB);
+        ZERO_MEM(m_SkinnedVB);
+    }
+
+    if (m_SkinnedVAO[0] != 0) {
+        glDeleteVertexArrays(ARRAY_SIZE_IN_ELEMENTS(m_SkinnedVAO), m_SkinnedVAO);
+        ZERO_MEM(m_SkinnedVAO);
+    }
 }
 
 
-bool SkinnedMesh::LoadMesh(const string& Filename)
+bool SkinnedMesh::LoadMesh(const string& Filename, uint MaxBonesPerVertex)
 {
     // Release the previously loaded mesh (if it exists)
     Clear();
 
+    if ((MaxBonesPerVertex == 0) || (MaxBonesPerVertex > MAX_BONES_PER_VERTEX)) {
+        printf("Invalid number of bones per vertex %d (max is %d)\n", MaxBonesPerVertex, MAX_BONES_PER_VERTEX);
+        return false;
+    }
+
+    m_MaxBonesPerVertex = MaxBonesPerVertex;
+
+    m_Nodes.clear();
+    m_UseCompressedAnim = false;
+
     // Create the VAO
     glGenVertexArrays(1, &m_VAO);
     glBindVertexArray(m_VAO);
@@ -94,6 +194,10 @@ bool SkinnedMesh::LoadMesh(const string& Filename)
    //     m_GlobalInverseTransform.Print();
     //    exit(0);
         Ret = InitFromScene(m_pScene, Filename);
+
+        if (Ret) {
+            InitNodes();
+        }
     }
     else {
         printf("Error parsing '%s': '%s'\n", Filename.c_str(), m_Importer.GetErrorString());
@@ -131,6 +235,8 @@ bool SkinnedMesh::InitFromScene(const aiScene* pScene, const string& Filename)
         NumIndices  += m_Entries[i].NumIndices;
     }
 
+    m_NumVertices = NumVertices;
+
     // Reserve space in the vectors for the vertex attributes and indices
     Positions.reserve(NumVertices);
     Normals.reserve(NumVertices);
@@ -164,20 +270,71 @@ bool SkinnedMesh::InitFromScene(const aiScene* pScene, const string& Filename)
     glEnableVertexAttribArray(NORMAL_LOCATION);
     glVertexAttribPointer(NORMAL_LOCATION, 3, GL_FLOAT, GL_FALSE, 0, 0);
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[SKINNED_MESH_BONE_VB]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(Bones[0]) * Bones.size(), &Bones[0], GL_STATIC_DRAW);
-    glEnableVertexAttribArray(BONE_ID_LOCATION);
-    glVertexAttribIPointer(BONE_ID_LOCATION, 4, GL_INT, sizeof(VertexBoneData), (const GLvoid*)0);
-    glEnableVertexAttribArray(BONE_WEIGHT_LOCATION);
-    glVertexAttribPointer(BONE_WEIGHT_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(VertexBoneData), (const GLvoid*)16);
+    InitBoneBuffers(Bones);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_Buffers[SKINNED_MESH_INDEX_BUFFER]);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(Indices[0]) * Indices.size(), &Indices[0], GL_STATIC_DRAW);
 
+    // The instancing attributes are only enabled while rendering instances
+    glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[SKINNED_MESH_WVP_MAT_VB]);
+
+    for (unsigned int i = 0; i < 4 ; i++) {
+        glVertexAttribPointer(WVP_LOCATION + i, 4, GL_FLOAT, GL_FALSE, sizeof(Matrix4f), (const GLvoid*)(sizeof(GLfloat) * i * 4));
+        glVertexAttribDivisor(WVP_LOCATION + i, 1);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[SKINNED_MESH_WORLD_MAT_VB]);
+
+    for (unsigned int i = 0; i < 4 ; i++) {
+        glVertexAttribPointer(WORLD_LOCATION + i, 4, GL_FLOAT, GL_FALSE, sizeof(Matrix4f), (const GLvoid*)(sizeof(GLfloat) * i * 4));
+        glVertexAttribDivisor(WORLD_LOCATION + i, 1);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[SKINNED_MESH_ANIM_VB]);
+    glVertexAttribPointer(ANIM_PARAMS_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(Vector4f), 0);
+    glVertexAttribDivisor(ANIM_PARAMS_LOCATION, 1);
+
     return GLCheckError();
 }
 
 
+void SkinnedMesh::InitBoneBuffers(const vector<VertexBoneData>& Bones)
+{
+    const uint NumVertices = (uint)Bones.size();
+    vector<VertexBoneAttribs> Attribs(NumVertices);
+
+    for (uint i = 0 ; i < NumVertices ; i++) {
+        memcpy(Attribs[i].IDs, Bones[i].IDs, sizeof(Attribs[i].IDs));
+        memcpy(Attribs[i].Weights, Bones[i].Weights, sizeof(Attribs[i].Weights));
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[SKINNED_MESH_BONE_VB]);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(Attribs[0]) * NumVertices, &Attribs[0], GL_STATIC_DRAW);
+    glEnableVertexAttribArray(BONE_ID_LOCATION);
+    glVertexAttribIPointer(BONE_ID_LOCATION, 4, GL_INT, sizeof(VertexBoneAttribs), (const GLvoid*)0);
+    glEnableVertexAttribArray(BONE_WEIGHT_LOCATION);
+    glVertexAttribPointer(BONE_WEIGHT_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(VertexBoneAttribs), (const GLvoid*)16);
+
+    // The second set of influences costs an extra 32 bytes per vertex so
+    // it is only created when the mesh was loaded with more than 4 bones
+    if (m_MaxBonesPerVertex <= NUM_BONES_PER_VEREX) {
+        return;
+    }
+
+    for (uint i = 0 ; i < NumVertices ; i++) {
+        memcpy(Attribs[i].IDs, &Bones[i].IDs[NUM_BONES_PER_VEREX], sizeof(Attribs[i].IDs));
+        memcpy(Attribs[i].Weights, &Bones[i].Weights[NUM_BONES_PER_VEREX], sizeof(Attribs[i].Weights));
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[SKINNED_MESH_BONE2_VB]);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(Attribs[0]) * NumVertices, &Attribs[0], GL_STATIC_DRAW);
+    glEnableVertexAttribArray(BONE_ID2_LOCATION);
+    glVertexAttribIPointer(BONE_ID2_LOCATION, 4, GL_INT, sizeof(VertexBoneAttribs), (const GLvoid*)0);
+    glEnableVertexAttribArray(BONE_WEIGHT2_LOCATION);
+    glVertexAttribPointer(BONE_WEIGHT2_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(VertexBoneAttribs), (const GLvoid*)16);
+}
+
+
 void SkinnedMesh::InitMesh(uint MeshIndex,
                     const aiMesh* paiMesh,
                     vector<Vector3f>& Positions,
@@ -201,13 +358,57 @@ void SkinnedMesh::InitMesh(uint MeshIndex,
 
     LoadBones(MeshIndex, paiMesh, Bones);
 
-    // Populate the index buffer
+    const uint BaseVertex = m_Entries[MeshIndex].BaseVertex;
+
+    for (uint i = 0 ; i < paiMesh->mNumVertices ; i++) {
+        Bones[BaseVertex + i].Normalize(m_MaxBonesPerVertex);
+    }
+
+    InitInfluenceGroups(MeshIndex, paiMesh, Bones, Indices);
+}
+
+
+static uint GetInfluenceGroup(uint NumBones)
+{
+    uint Group = 0;
+
+    while (SkinnedMesh::GetInfluenceGroupSize(Group) < NumBones) {
+        Group++;
+    }
+
+    return Group;
+}
+
+
+// Populate the index buffer. The triangles are bucketed by the largest number
+// of influences among their vertices so every group is a contiguous range.
+void SkinnedMesh::InitInfluenceGroups(uint MeshIndex, const aiMesh* paiMesh, const vector<VertexBoneData>& Bones, vector<uint>& Indices)
+{
+    MeshEntry& Entry = m_Entries[MeshIndex];
+
+    vector<uint> GroupIndices[NUM_INFLUENCE_GROUPS];
+
     for (uint i = 0 ; i < paiMesh->mNumFaces ; i++) {
         const aiFace& Face = paiMesh->mFaces[i];
         assert(Face.mNumIndices == 3);
-        Indices.push_back(Face.mIndices[0]);
-        Indices.push_back(Face.mIndices[1]);
-        Indices.push_back(Face.mIndices[2]);
+
+        uint MaxBones = 1;
+
+        for (uint j = 0 ; j < 3 ; j++) {
+            uint NumBones = Bones[Entry.BaseVertex + Face.mIndices[j]].NumBones;
+            MaxBones = (NumBones > MaxBones) ? NumBones : MaxBones;
+        }
+
+        vector<uint>& Group = GroupIndices[GetInfluenceGroup(MaxBones)];
+        Group.push_back(Face.mIndices[0]);
+        Group.push_back(Face.mIndices[1]);
+        Group.push_back(Face.mIndices[2]);
+    }
+
+    for (uint i = 0 ; i < NUM_INFLUENCE_GROUPS ; i++) {
+        Entry.GroupBaseIndex[i] = (uint)Indices.size();
+        Entry.GroupNumIndices[i] = (uint)GroupIndices[i].size();
+        Indices.insert(Indices.end(), GroupIndices[i].begin(), GroupIndices[i].end());
     }
 }
 
@@ -320,6 +521,409 @@ void SkinnedMesh::Render()
 }
 
 
+void SkinnedMesh::RenderInfluenceGroup(uint Group)
+{
+    assert(Group < NUM_INFLUENCE_GROUPS);
+
+    glBindVertexArray(m_VAO);
+
+    for (uint i = 0 ; i < m_Entries.size() ; i++) {
+        if (m_Entries[i].GroupNumIndices[Group] == 0) {
+            continue;
+        }
+
+        const uint MaterialIndex = m_Entries[i].MaterialIndex;
+
+        assert(MaterialIndex < m_Textures.size());
+
+        if (m_Textures[MaterialIndex]) {
+            m_Textures[MaterialIndex]->Bind(GL_TEXTURE0);
+        }
+
+        glDrawElementsBaseVertex(GL_TRIANGLES,
+                                 m_Entries[i].GroupNumIndices[Group],
+                                 GL_UNSIGNED_INT,
+                                 (void*)(sizeof(uint) * m_Entries[i].GroupBaseIndex[Group]),
+                                 m_Entries[i].BaseVertex);
+    }
+
+    // Make sure the VAO is not changed from the outside
+    glBindVertexArray(0);
+}
+
+
+// Used only by instancing
+void SkinnedMesh::Render(uint NumInstances, const Matrix4f* WVPMats, const Matrix4f* WorldMats, const Vector4f* AnimParams)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[SKINNED_MESH_WVP_MAT_VB]);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(Matrix4f) * NumInstances, WVPMats, GL_DYNAMIC_DRAW);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[SKINNED_MESH_WORLD_MAT_VB]);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(Matrix4f) * NumInstances, WorldMats, GL_DYNAMIC_DRAW);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[SKINNED_MESH_ANIM_VB]);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(Vector4f) * NumInstances, AnimParams, GL_DYNAMIC_DRAW);
+
+    glBindVertexArray(m_VAO);
+
+    for (uint i = WVP_LOCATION ; i <= ANIM_PARAMS_LOCATION ; i++) {
+        glEnableVertexAttribArray(i);
+    }
+
+    for (uint i = 0 ; i < m_Entries.size() ; i++) {
+        const uint MaterialIndex = m_Entries[i].MaterialIndex;
+
+        assert(MaterialIndex < m_Textures.size());
+
+        if (m_Textures[MaterialIndex]) {
+            m_Textures[MaterialIndex]->Bind(GL_TEXTURE0);
+        }
+
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES,
+                                          m_Entries[i].NumIndices,
+                                          GL_UNSIGNED_INT,
+                                          (void*)(sizeof(uint) * m_Entries[i].BaseIndex),
+                                          NumInstances,
+                                          m_Entries[i].BaseVertex);
+    }
+
+    for (uint i = WVP_LOCATION ; i <= ANIM_PARAMS_LOCATION ; i++) {
+        glDisableVertexAttribArray(i);
+    }
+
+    // Make sure the VAO is not changed from the outside
+    glBindVertexArray(0);
+}
+
+
+bool SkinnedMesh::IsAVXSupported()
+{
+#if defined(SKINNING_X86) && (defined(__GNUC__) || defined(__clang__))
+    return __builtin_cpu_supports("avx");
+#elif defined(SKINNING_X86) && defined(_MSC_VER)
+    // The CPU must have AVX and the OS must save the YMM registers
+    int Info[4];
+    __cpuid(Info, 1);
+
+    bool HasAVX = (Info[2] & (1 << 28)) != 0;
+    bool HasOSXSave = (Info[2] & (1 << 27)) != 0;
+
+    return HasAVX && HasOSXSave && ((_xgetbv(0) & 6) == 6);
+#else
+    return false;
+#endif
+}
+
+
+bool SkinnedMesh::InitPreSkinning()
+{
+    m_UseAVX = IsAVXSupported();
+
+    // Bring the bind pose back from the GPU for the CPU skinning
+    m_Positions.resize(m_NumVertices);
+    m_Normals.resize(m_NumVertices);
+    m_Bones.assign(m_NumVertices, VertexBoneData());
+    m_SkinnedVertices.resize(m_NumVertices);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[SKINNED_MESH_POS_VB]);
+    glGetBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(Vector3f) * m_NumVertices, &m_Positions[0]);
+    glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[SKINNED_MESH_NORMAL_VB]);
+    glGetBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(Vector3f) * m_NumVertices, &m_Normals[0]);
+    ReadBackBones();
+
+    // Both buffers start with the bind pose
+    for (uint i = 0 ; i < m_NumVertices ; i++) {
+        m_SkinnedVertices[i].Pos = m_Positions[i];
+        m_SkinnedVertices[i].Normal = m_Normals[i];
+    }
+
+    glGenBuffers(ARRAY_SIZE_IN_ELEMENTS(m_SkinnedVB), m_SkinnedVB);
+
+    for (uint i = 0 ; i < ARRAY_SIZE_IN_ELEMENTS(m_SkinnedVB) ; i++) {
+        glBindBuffer(GL_ARRAY_BUFFER, m_SkinnedVB[i]);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(SkinnedVertex) * m_NumVertices, &m_SkinnedVertices[0], GL_DYNAMIC_DRAW);
+    }
+
+    glGenVertexArrays(ARRAY_SIZE_IN_ELEMENTS(m_SkinnedVAO), m_SkinnedVAO);
+
+    for (uint i = 0 ; i < ARRAY_SIZE_IN_ELEMENTS(m_SkinnedVAO) ; i++) {
+        InitPreSkinnedVAO(i);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    m_CurrSkinned = 0;
+
+    return GLCheckError();
+}
+
+
+// Rebuild the sorted influences of every vertex from the bone vertex buffers
+void SkinnedMesh::ReadBackBones()
+{
+    vector<VertexBoneAttribs> Attribs(m_NumVertices);
+
+    const uint NumSets = (m_MaxBonesPerVertex > NUM_BONES_PER_VEREX) ? 2 : 1;
+
+    for (uint Set = 0 ; Set < NumSets ; Set++) {
+        glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[Set == 0 ? SKINNED_MESH_BONE_VB : SKINNED_MESH_BONE2_VB]);
+        glGetBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(VertexBoneAttribs) * m_NumVertices, &Attribs[0]);
+
+        for (uint i = 0 ; i < m_NumVertices ; i++) {
+            for (uint j = 0 ; j < NUM_BONES_PER_VEREX ; j++) {
+                if (Attribs[i].Weights[j] > 0.0f) {
+                    m_Bones[i].AddBoneData(Attribs[i].IDs[j], Attribs[i].Weights[j]);
+                }
+            }
+        }
+    }
+}
+
+
+// VAO 'Index' reads the current frame from buffer 'Index' and the previous one from the other buffer
+void SkinnedMesh::InitPreSkinnedVAO(uint Index)
+{
+    glBindVertexArray(m_SkinnedVAO[Index]);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_SkinnedVB[Index]);
+    glEnableVertexAttribArray(POSITION_LOCATION);
+    glVertexAttribPointer(POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, sizeof(SkinnedVertex), 0);
+    glEnableVertexAttribArray(NORMAL_LOCATION);
+    glVertexAttribPointer(NORMAL_LOCATION, 3, GL_FLOAT, GL_FALSE, sizeof(SkinnedVertex), (const GLvoid*)12);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_SkinnedVB[Index ^ 1]);
+    glEnableVertexAttribArray(PREV_POSITION_LOCATION);
+    glVertexAttribPointer(PREV_POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, sizeof(SkinnedVertex), 0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[SKINNED_MESH_TEXCOORD_VB]);
+    glEnableVertexAttribArray(TEX_COORD_LOCATION);
+    glVertexAttribPointer(TEX_COORD_LOCATION, 2, GL_FLOAT, GL_FALSE, 0, 0);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_Buffers[SKINNED_MESH_INDEX_BUFFER]);
+
+    glBindVertexArray(0);
+}
+
+
+#ifdef SKINNING_X86
+
+// A row major 4x4 matrix is exactly two AVX registers - rows 0/1 and rows 2/3
+static TARGET_AVX void SkinVertexAVX(const Matrix4f* pBones, const uint* pIDs, const float* pWeights, uint NumBones,
+                       const Vector3f& Pos, const Vector3f& Normal, Vector3f& OutPos, Vector3f& OutNormal)
+{
+    __m256 Rows01 = _mm256_setzero_ps();
+    __m256 Rows23 = _mm256_setzero_ps();
+
+    for (uint i = 0 ; i < NumBones ; i++) {
+        __m256 w = _mm256_set1_ps(pWeights[i]);
+        const float* m = &pBones[pIDs[i]].m[0][0];
+        Rows01 = _mm256_add_ps(Rows01, _mm256_mul_ps(w, _mm256_loadu_ps(m)));
+        Rows23 = _mm256_add_ps(Rows23, _mm256_mul_ps(w, _mm256_loadu_ps(m + 8)));
+    }
+
+    __m256 P = _mm256_setr_ps(Pos.x, Pos.y, Pos.z, 1.0f, Pos.x, Pos.y, Pos.z, 1.0f);
+    __m256 N = _mm256_setr_ps(Normal.x, Normal.y, Normal.z, 0.0f, Normal.x, Normal.y, Normal.z, 0.0f);
+
+    // After two horizontal adds the low lane holds (row0.v, row2.v, ...) and the high lane (row1.v, row3.v, ...)
+    __m256 PosSums = _mm256_hadd_ps(_mm256_mul_ps(Rows01, P), _mm256_mul_ps(Rows23, P));
+    PosSums = _mm256_hadd_ps(PosSums, PosSums);
+    __m256 NormalSums = _mm256_hadd_ps(_mm256_mul_ps(Rows01, N), _mm256_mul_ps(Rows23, N));
+    NormalSums = _mm256_hadd_ps(NormalSums, NormalSums);
+
+    float PosLow[4], PosHigh[4], NormalLow[4], NormalHigh[4];
+    _mm_storeu_ps(PosLow, _mm256_castps256_ps128(PosSums));
+    _mm_storeu_ps(PosHigh, _mm256_extractf128_ps(PosSums, 1));
+    _mm_storeu_ps(NormalLow, _mm256_castps256_ps128(NormalSums));
+    _mm_storeu_ps(NormalHigh, _mm256_extractf128_ps(NormalSums, 1));
+
+    OutPos = Vector3f(PosLow[0], PosHigh[0], PosLow[1]);
+    OutNormal = Vector3f(NormalLow[0], NormalHigh[0], NormalLow[1]);
+}
+
+#endif
+
+#if defined(__SSE__) || defined(_M_X64)
+
+// SSE is always available on x86-64 so this is the path for the CPUs without AVX
+static void SkinVertex(const Matrix4f* pBones, const uint* pIDs, const float* pWeights, uint NumBones,
+                       const Vector3f& Pos, const Vector3f& Normal, Vector3f& OutPos, Vector3f& OutNormal)
+{
+    __m128 Rows[3] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+
+    for (uint i = 0 ; i < NumBones ; i++) {
+        __m128 w = _mm_set1_ps(pWeights[i]);
+        const Matrix4f& m = pBones[pIDs[i]];
+
+        for (uint Row = 0 ; Row < 3 ; Row++) {
+            Rows[Row] = _mm_add_ps(Rows[Row], _mm_mul_ps(w, _mm_loadu_ps(m.m[Row])));
+        }
+    }
+
+    // Transpose so that the dot products become three multiply-adds
+    __m128 Row3 = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(Rows[0], Rows[1], Rows[2], Row3);
+
+    __m128 p = _mm_add_ps(_mm_add_ps(_mm_mul_ps(Rows[0], _mm_set1_ps(Pos.x)),
+                                     _mm_mul_ps(Rows[1], _mm_set1_ps(Pos.y))),
+                          _mm_add_ps(_mm_mul_ps(Rows[2], _mm_set1_ps(Pos.z)), Row3));
+
+    __m128 n = _mm_add_ps(_mm_add_ps(_mm_mul_ps(Rows[0], _mm_set1_ps(Normal.x)),
+                                     _mm_mul_ps(Rows[1], _mm_set1_ps(Normal.y))),
+                          _mm_mul_ps(Rows[2], _mm_set1_ps(Normal.z)));
+
+    float PosOut[4], NormalOut[4];
+    _mm_storeu_ps(PosOut, p);
+    _mm_storeu_ps(NormalOut, n);
+
+    OutPos = Vector3f(PosOut[0], PosOut[1], PosOut[2]);
+    OutNormal = Vector3f(NormalOut[0], NormalOut[1], NormalOut[2]);
+}
+
+#else
+
+static void SkinVertex(const Matrix4f* pBones, const uint* pIDs, const float* pWeights, uint NumBones,
+                       const Vector3f& Pos, const Vector3f& Normal, Vector3f& OutPos, Vector3f& OutNormal)
+{
+    Matrix4f BoneTransform;
+    BoneTransform.SetZero();
+
+    for (uint i = 0 ; i < NumBones ; i++) {
+        const Matrix4f& m = pBones[pIDs[i]];
+
+        for (uint Row = 0 ; Row < 3 ; Row++) {
+            for (uint Col = 0 ; Col < 4 ; Col++) {
+                BoneTransform.m[Row][Col] += m.m[Row][Col] * pWeights[i];
+            }
+        }
+    }
+
+    const float (*m)[4] = BoneTransform.m;
+
+    OutPos = Vector3f(m[0][0] * Pos.x + m[0][1] * Pos.y + m[0][2] * Pos.z + m[0][3],
+                      m[1][0] * Pos.x + m[1][1] * Pos.y + m[1][2] * Pos.z + m[1][3],
+                      m[2][0] * Pos.x + m[2][1] * Pos.y + m[2][2] * Pos.z + m[2][3]);
+
+    OutNormal = Vector3f(m[0][0] * Normal.x + m[0][1] * Normal.y + m[0][2] * Normal.z,
+                         m[1][0] * Normal.x + m[1][1] * Normal.y + m[1][2] * Normal.z,
+                         m[2][0] * Normal.x + m[2][1] * Normal.y + m[2][2] * Normal.z);
+}
+
+#endif
+
+
+void SkinnedMesh::SkinVerticesCPU(const vector<Matrix4f>& Transforms)
+{
+    assert(m_SkinnedVB[0] != 0);
+
+    const Matrix4f* pBones = &Transforms[0];
+
+#ifdef SKINNING_X86
+    if (m_UseAVX) {
+        for (uint i = 0 ; i < m_NumVertices ; i++) {
+            SkinVertexAVX(pBones, m_Bones[i].IDs, m_Bones[i].Weights, m_Bones[i].NumBones, m_Positions[i], m_Normals[i],
+                          m_SkinnedVertices[i].Pos, m_SkinnedVertices[i].Normal);
+        }
+    }
+    else
+#endif
+    {
+        for (uint i = 0 ; i < m_NumVertices ; i++) {
+            SkinVertex(pBones, m_Bones[i].IDs, m_Bones[i].Weights, m_Bones[i].NumBones, m_Positions[i], m_Normals[i],
+                       m_SkinnedVertices[i].Pos, m_SkinnedVertices[i].Normal);
+        }
+    }
+
+    m_CurrSkinned ^= 1;
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_SkinnedVB[m_CurrSkinned]);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(SkinnedVertex) * m_NumVertices, &m_SkinnedVertices[0]);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+
+void SkinnedMesh::SkinVerticesGPU()
+{
+    assert(m_SkinnedVB[0] != 0);
+
+    m_CurrSkinned ^= 1;
+
+    glEnable(GL_RASTERIZER_DISCARD);
+
+    glBindVertexArray(m_VAO);
+
+    // The second bone attributes are disabled for meshes with up to 4 bones
+    // per vertex. The default weights would be (0, 0, 0, 1).
+    if (m_MaxBonesPerVertex <= NUM_BONES_PER_VEREX) {
+        glVertexAttribI4i(BONE_ID2_LOCATION, 0, 0, 0, 0);
+        glVertexAttrib4f(BONE_WEIGHT2_LOCATION, 0.0f, 0.0f, 0.0f, 0.0f);
+    }
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, m_SkinnedVB[m_CurrSkinned]);
+
+    // Every vertex is skinned exactly once regardless of how many triangles share it
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, m_NumVertices);
+    glEndTransformFeedback();
+
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glBindVertexArray(0);
+
+    glDisable(GL_RASTERIZER_DISCARD);
+}
+
+
+float SkinnedMesh::CompareSkinning(const vector<Matrix4f>& Transforms, uint& NumMultiBoneVertices)
+{
+    SkinVerticesCPU(Transforms);
+
+    vector<SkinnedVertex> CPUVertices = m_SkinnedVertices;
+
+    SkinVerticesGPU();
+
+    vector<SkinnedVertex> GPUVertices(m_NumVertices);
+    glBindBuffer(GL_ARRAY_BUFFER, m_SkinnedVB[m_CurrSkinned]);
+    glGetBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(SkinnedVertex) * m_NumVertices, &GPUVertices[0]);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    float MaxError = 0.0f;
+    NumMultiBoneVertices = 0;
+
+    for (uint i = 0 ; i < m_NumVertices ; i++) {
+        MaxError = MAX(MaxError, (CPUVertices[i].Pos - GPUVertices[i].Pos).Length());
+
+        if (m_Bones[i].NumBones > NUM_BONES_PER_VEREX) {
+            NumMultiBoneVertices++;
+        }
+    }
+
+    return MaxError;
+}
+
+
+void SkinnedMesh::RenderPreSkinned()
+{
+    glBindVertexArray(m_SkinnedVAO[m_CurrSkinned]);
+
+    for (uint i = 0 ; i < m_Entries.size() ; i++) {
+        const uint MaterialIndex = m_Entries[i].MaterialIndex;
+
+        assert(MaterialIndex < m_Textures.size());
+
+        if (m_Textures[MaterialIndex]) {
+            m_Textures[MaterialIndex]->Bind(GL_TEXTURE0);
+        }
+
+        glDrawElementsBaseVertex(GL_TRIANGLES,
+                                 m_Entries[i].NumIndices,
+                                 GL_UNSIGNED_INT,
+                                 (void*)(sizeof(uint) * m_Entries[i].BaseIndex),
+                                 m_Entries[i].BaseVertex);
+    }
+
+    // Make sure the VAO is not changed from the outside
+    glBindVertexArray(0);
+}
+
+
 uint SkinnedMesh::FindPosition(float AnimationTime, const aiNodeAnim* pNodeAnim)
 {
     for (uint i = 0 ; i < pNodeAnim->mNumPositionKeys - 1 ; i++) {
@@ -481,16 +1085,122 @@ void SkinnedMesh::ReadNodeHeirarchy(float AnimationTime, const aiNode* pNode, co
 }
 
 
-void SkinnedMesh::BoneTransform(float TimeInSeconds, vector<Matrix4f>& Transforms)
+void SkinnedMesh::FlattenNodeHeirarchy(const aiNode* pNode, int ParentIndex)
 {
-    Matrix4f Identity;
-    Identity.InitIdentity();
+    string NodeName(pNode->mName.data);
+
+    NodeInfo Node;
+    Node.Transformation = Matrix4f(pNode->mTransformation);
+    Node.ParentIndex = ParentIndex;
+    Node.BoneIndex = (m_BoneMapping.find(NodeName) != m_BoneMapping.end()) ? (int)m_BoneMapping[NodeName] : -1;
+    Node.TrackIndex = m_UseCompressedAnim ? m_AnimClip.FindTrack(NodeName) : -1;
+    Node.pNodeAnim = (!m_UseCompressedAnim && (m_pScene->mNumAnimations > 0)) ? FindNodeAnim(m_pScene->mAnimations[0], NodeName) : NULL;
+    Node.Height = 0;
+
+    int NodeIndex = (int)m_Nodes.size();
+    m_Nodes.push_back(Node);
+
+    for (uint i = 0 ; i < pNode->mNumChildren ; i++) {
+        FlattenNodeHeirarchy(pNode->mChildren[i], NodeIndex);
+    }
+}
+
+
+void SkinnedMesh::InitNodes()
+{
+    m_Nodes.clear();
+    FlattenNodeHeirarchy(m_pScene->mRootNode, -1);
+
+    // Children come after their parents so walking backwards sees every
+    // child before its parent
+    for (int i = (int)m_Nodes.size() - 1 ; i > 0 ; i--) {
+        NodeInfo& Parent = m_Nodes[m_Nodes[i].ParentIndex];
+
+        if (Parent.Height < m_Nodes[i].Height + 1) {
+            Parent.Height = m_Nodes[i].Height + 1;
+        }
+    }
+}
+
+
+bool SkinnedMesh::CompressAnimation(float SampleRate, float PositionTolerance, float RotationTolerance, float ScaleTolerance)
+{
+    if (!m_pScene || (m_pScene->mNumAnimations == 0)) {
+        printf("No animation to compress\n");
+        return false;
+    }
+
+    if (!m_AnimClip.Init(m_pScene->mAnimations[0], SampleRate, PositionTolerance, RotationTolerance, ScaleTolerance)) {
+        return false;
+    }
+
+    m_UseCompressedAnim = true;
+    InitNodes();
+
+    printf("Compressed animation: %d tracks, %d bytes -> %d bytes\n", m_AnimClip.NumTracks(),
+           m_AnimClip.GetSourceSize(), m_AnimClip.GetCompressedSize());
+    printf("Max error: position %f, rotation %f degrees, scale %f\n", m_AnimClip.GetMaxPositionError(),
+           ToDegree(m_AnimClip.GetMaxRotationError()), m_AnimClip.GetMaxScaleError());
+
+    // Everything we need from the scene has been copied so it can go now
+    m_Importer.FreeScene();
+    m_pScene = NULL;
+
+    return true;
+}
+
+
+void SkinnedMesh::ReadCompressedHeirarchy(float AnimationTime)
+{
+    // Global transformation of every node. Since the parents precede their
+    // children a single pass over the array is enough.
+    vector<Matrix4f> GlobalTransforms(m_Nodes.size());
+
+    for (uint i = 0 ; i < m_Nodes.size() ; i++) {
+        const NodeInfo& Node = m_Nodes[i];
+
+        Matrix4f NodeTransformation = SampleNodeTransform(Node, AnimationTime);
+
+        if (Node.ParentIndex >= 0) {
+            GlobalTransforms[i] = GlobalTransforms[Node.ParentIndex] * NodeTransformation;
+        }
+        else {
+            GlobalTransforms[i] = NodeTransformation;
+        }
+
+        if (Node.BoneIndex >= 0) {
+            m_BoneInfo[Node.BoneIndex].FinalTransformation = m_GlobalInverseTransform * GlobalTransforms[i] * m_BoneInfo[Node.BoneIndex].BoneOffset;
+        }
+    }
+}
+
+
+float SkinnedMesh::GetAnimationTime(float TimeInSeconds) const
+{
+    if (m_UseCompressedAnim) {
+        float TimeInTicks = TimeInSeconds * m_AnimClip.GetTicksPerSecond();
+        return fmod(TimeInTicks, m_AnimClip.GetDuration());
+    }
 
     float TicksPerSecond = (float)(m_pScene->mAnimations[0]->mTicksPerSecond != 0 ? m_pScene->mAnimations[0]->mTicksPerSecond : 25.0f);
     float TimeInTicks = TimeInSeconds * TicksPerSecond;
-    float AnimationTime = fmod(TimeInTicks, (float)m_pScene->mAnimations[0]->mDuration);
+    return fmod(TimeInTicks, (float)m_pScene->mAnimations[0]->mDuration);
+}
 
-    ReadNodeHeirarchy(AnimationTime, m_pScene->mRootNode, Identity);
+
+void SkinnedMesh::BoneTransform(float TimeInSeconds, vector<Matrix4f>& Transforms)
+{
+    float AnimationTime = GetAnimationTime(TimeInSeconds);
+
+    if (m_UseCompressedAnim) {
+        ReadCompressedHeirarchy(AnimationTime);
+    }
+    else {
+        Matrix4f Identity;
+        Identity.InitIdentity();
+
+        ReadNodeHeirarchy(AnimationTime, m_pScene->mRootNode, Identity);
+    }
 
     Transforms.resize(m_NumBones);
 
@@ -500,6 +1210,144 @@ void SkinnedMesh::BoneTransform(float TimeInSeconds, vector<Matrix4f>& Transform
 }
 
 
+Matrix4f SkinnedMesh::SampleNodeTransform(const NodeInfo& Node, float AnimationTime)
+{
+    aiVector3D Scaling, Translation;
+    aiQuaternion RotationQ;
+
+    if (Node.TrackIndex >= 0) {
+        m_AnimClip.Sample(Node.TrackIndex, AnimationTime, Scaling, RotationQ, Translation);
+    }
+    else if (Node.pNodeAnim) {
+        CalcInterpolatedScaling(Scaling, AnimationTime, Node.pNodeAnim);
+        CalcInterpolatedRotation(RotationQ, AnimationTime, Node.pNodeAnim);
+        CalcInterpolatedPosition(Translation, AnimationTime, Node.pNodeAnim);
+    }
+    else {
+        return Node.Transformation;
+    }
+
+    Matrix4f ScalingM;
+    ScalingM.InitScaleTransform(Scaling.x, Scaling.y, Scaling.z);
+    Matrix4f RotationM = Matrix4f(RotationQ.GetMatrix());
+    Matrix4f TranslationM;
+    TranslationM.InitTranslationTransform(Translation.x, Translation.y, Translation.z);
+
+    return TranslationM * RotationM * ScalingM;
+}
+
+
+// Nodes that are less than FrozenLevels away from a leaf keep the local
+// transform they had the last time they were sampled. Returns the number
+// of bones that were sampled.
+uint SkinnedMesh::EvaluatePose(float TimeInSeconds, uint FrozenLevels, AnimationLODState& State, vector<Matrix4f>& Pose)
+{
+    float AnimationTime = GetAnimationTime(TimeInSeconds);
+
+    bool FirstPose = (State.NodeTransforms.size() != m_Nodes.size());
+
+    if (FirstPose) {
+        State.NodeTransforms.resize(m_Nodes.size());
+    }
+
+    vector<Matrix4f> GlobalTransforms(m_Nodes.size());
+    Pose.resize(m_NumBones);
+
+    uint BonesEvaluated = 0;
+
+    for (uint i = 0 ; i < m_Nodes.size() ; i++) {
+        const NodeInfo& Node = m_Nodes[i];
+
+        if (FirstPose || (Node.Height >= FrozenLevels)) {
+            State.NodeTransforms[i] = SampleNodeTransform(Node, AnimationTime);
+
+            if (Node.BoneIndex >= 0) {
+                BonesEvaluated++;
+            }
+        }
+
+        if (Node.ParentIndex >= 0) {
+            GlobalTransforms[i] = GlobalTransforms[Node.ParentIndex] * State.NodeTransforms[i];
+        }
+        else {
+            GlobalTransforms[i] = State.NodeTransforms[i];
+        }
+
+        if (Node.BoneIndex >= 0) {
+            Pose[Node.BoneIndex] = m_GlobalInverseTransform * GlobalTransforms[i] * m_BoneInfo[Node.BoneIndex].BoneOffset;
+        }
+    }
+
+    return BonesEvaluated;
+}
+
+
+void SkinnedMesh::BoneTransform(float TimeInSeconds, vector<Matrix4f>& Transforms,
+                                const AnimationLODConfig& Config, float ScreenSize, AnimationLODState& State)
+{
+    uint FrozenLevels = 0;
+
+    if (ScreenSize < Config.FreezeScreenSize2) {
+        FrozenLevels = 2;
+    }
+    else if (ScreenSize < Config.FreezeScreenSize) {
+        FrozenLevels = 1;
+    }
+
+    State.BonesEvaluated = 0;
+
+    if (ScreenSize >= Config.FullRateScreenSize) {
+        State.BonesEvaluated = EvaluatePose(TimeInSeconds, FrozenLevels, State, Transforms);
+        State.NextTime = -1.0f;  // interpolation starts over if the character moves away
+        return;
+    }
+
+    float UpdateRate = Config.MinUpdateRate + (Config.MaxUpdateRate - Config.MinUpdateRate) * ScreenSize / Config.FullRateScreenSize;
+    float Interval = 1.0f / UpdateRate;
+
+    if ((State.NextTime < 0.0f) || (TimeInSeconds < State.PrevTime) || (TimeInSeconds > State.NextTime + Interval)) {
+        // No usable pose (first call, time went backwards or a long pause) - evaluate both ends
+        State.PrevTime = TimeInSeconds;
+        State.NextTime = TimeInSeconds + Interval;
+        State.BonesEvaluated += EvaluatePose(State.PrevTime, FrozenLevels, State, State.PrevPose);
+        State.BonesEvaluated += EvaluatePose(State.NextTime, FrozenLevels, State, State.NextPose);
+    }
+    else if (TimeInSeconds > State.NextTime) {
+        // The next pose is always evaluated ahead so only one evaluation per interval is needed
+        State.PrevTime = State.NextTime;
+        State.PrevPose.swap(State.NextPose);
+        State.NextTime = State.PrevTime + Interval;
+        State.BonesEvaluated += EvaluatePose(State.NextTime, FrozenLevels, State, State.NextPose);
+    }
+
+    float Factor = (TimeInSeconds - State.PrevTime) / (State.NextTime - State.PrevTime);
+
+    Transforms.resize(m_NumBones);
+
+    // Linear blend of the matrices. Good enough between poses that are a fraction of a second apart.
+    for (uint i = 0 ; i < m_NumBones ; i++) {
+        for (uint Row = 0 ; Row < 4 ; Row++) {
+            for (uint Col = 0 ; Col < 4 ; Col++) {
+                Transforms[i].m[Row][Col] = State.PrevPose[i].m[Row][Col] * (1.0f - Factor) + State.NextPose[i].m[Row][Col] * Factor;
+            }
+        }
+    }
+}
+
+
+float SkinnedMesh::GetAnimationDuration() const
+{
+    if (m_UseCompressedAnim) {
+        return m_AnimClip.GetDuration() / m_AnimClip.GetTicksPerSecond();
+    }
+
+    const aiAnimation* pAnimation = m_pScene->mAnimations[0];
+    float TicksPerSecond = (float)(pAnimation->mTicksPerSecond != 0 ? pAnimation->mTicksPerSecond : 25.0f);
+
+    return (float)pAnimation->mDuration / TicksPerSecond;
+}
+
+
 const aiNodeAnim* SkinnedMesh::FindNodeAnim(const aiAnimation* pAnimation, const string NodeName)
 {
     for (uint i = 0 ; i < pAnimation->mNumChannels ; i++) {
@@ -0,0 +1,127 @@
+/*
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ogldev_util.h"
+#include "ogldev_temporal_accumulation.h"
+
+#define CURRENT_TEXTURE_UNIT            GL_TEXTURE0
+#define CURRENT_TEXTURE_UNIT_INDEX      0
+#define HISTORY_TEXTURE_UNIT            GL_TEXTURE1
+#define HISTORY_TEXTURE_UNIT_INDEX      1
+#define DEPTH_TEXTURE_UNIT              GL_TEXTURE2
+#define DEPTH_TEXTURE_UNIT_INDEX        2
+
+
+TemporalAccumulation::TemporalAccumulation()
+{
+    m_writeIndex = 0;
+    m_frameCount = 0;
+    m_historyValid = false;
+    m_blendFactor = 1.0f / (float)NUM_FRAMES;
+    m_prevVP.InitIdentity();
+    m_VAO = 0;
+}
+
+
+TemporalAccumulation::~TemporalAccumulation()
+{
+    if (m_VAO != 0) {
+        glDeleteVertexArrays(1, &m_VAO);
+    }
+}
+
+
+bool TemporalAccumulation::Init(uint Width, uint Height, GLenum InternalType)
+{
+    for (uint i = 0 ; i < ARRAY_SIZE_IN_ELEMENTS(m_history) ; i++) {
+        if (!m_history[i].Init(Width, Height, false, InternalType)) {
+            return false;
+        }
+    }
+
+    if (!Technique::Init()) {
+        return false;
+    }
+
+    if (!AddShader(GL_VERTEX_SHADER, "../Common/Shaders/temporal_accumulation.vs")) {
+        return false;
+    }
+
+    if (!AddShader(GL_FRAGMENT_SHADER, "../Common/Shaders/temporal_accumulation.fs")) {
+        return false;
+    }
+
+    if (!Finalize()) {
+        return false;
+    }
+
+    m_currentTextureLocation = GetUniformLocation("gCurrentMap");
+    m_historyTextureLocation = GetUniformLocation("gHistoryMap");
+    m_depthTextureLocation = GetUniformLocation("gDepthMap");
+    m_reprojectionLocation = GetUniformLocation("gReprojection");
+    m_blendFactorLocation = GetUniformLocation("gBlendFactor");
+
+    if (m_currentTextureLocation == INVALID_UNIFORM_LOCATION ||
+        m_historyTextureLocation == INVALID_UNIFORM_LOCATION ||
+        m_depthTextureLocation == INVALID_UNIFORM_LOCATION ||
+        m_reprojectionLocation == INVALID_UNIFORM_LOCATION ||
+        m_blendFactorLocation == INVALID_UNIFORM_LOCATION) {
+        return false;
+    }
+
+    Enable();
+
+    glUniform1i(m_currentTextureLocation, CURRENT_TEXTURE_UNIT_INDEX);
+    glUniform1i(m_historyTextureLocation, HISTORY_TEXTURE_UNIT_INDEX);
+    glUniform1i(m_depthTextureLocation, DEPTH_TEXTURE_UNIT_INDEX);
+
+    // The full screen triangle is generated from gl_VertexID
+    glGenVertexArrays(1, &m_VAO);
+
+    return GLCheckError();
+}
+
+
+void TemporalAccumulation::Accumulate(IOBuffer& Current, IOBuffer& DepthBuffer, const Matrix4f& VP)
+{
+    uint ReadIndex = m_writeIndex;
+    m_writeIndex = 1 - m_writeIndex;
+
+    // Clip space of the current frame -> clip space of the previous frame
+    Matrix4f InvVP = VP;
+    InvVP.Inverse();
+    Matrix4f Reprojection = m_prevVP * InvVP;
+
+    Enable();
+
+    glUniformMatrix4fv(m_reprojectionLocation, 1, GL_TRUE, (const GLfloat*)Reprojection.m);
+    glUniform1f(m_blendFactorLocation, m_historyValid ? m_blendFactor : 1.0f);
+
+    Current.BindForReading(CURRENT_TEXTURE_UNIT);
+    m_history[ReadIndex].BindForReading(HISTORY_TEXTURE_UNIT);
+    DepthBuffer.BindForReading(DEPTH_TEXTURE_UNIT);
+
+    m_history[m_writeIndex].BindForWriting();
+
+    glBindVertexArray(m_VAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+
+    m_prevVP = VP;
+    m_historyValid = true;
+    m_frameCount++;
+}
@@ -0,0 +1,123 @@
+/*
+
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OGLDEV_ANIM_CLIP_H
+#define OGLDEV_ANIM_CLIP_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <assimp/scene.h>
+
+#include "ogldev_types.h"
+
+using namespace std;
+
+// A compact copy of an aiAnimation. Every channel is resampled at a uniform
+// rate, keys that linear (or nlerp for rotations) interpolation can predict
+// within the tolerance are dropped and the remaining keys are quantized:
+// rotations use the 48 bit "smallest three" encoding and positions/scales
+// are stored as 16 bit fixed point inside the bounding box of the channel.
+// The tolerance is checked again on the quantized keys and keys are added
+// back where the quantization pushed the error over it. A channel whose
+// quantization step is coarser than the tolerance stays above it; the
+// GetMax*Error functions report the error that was actually reached.
+// Once the clip is built the aiScene that owns the animation can be released.
+class CompressedAnimClip
+{
+public:
+    CompressedAnimClip();
+
+    // PositionTolerance is in model units, RotationTolerance in radians and
+    // ScaleTolerance is the difference of the scale factors
+    bool Init(const aiAnimation* pAnimation, float SampleRate,
+              float PositionTolerance, float RotationTolerance, float ScaleTolerance);
+
+    // Returns -1 if the node is not animated by this clip
+    int FindTrack(const string& NodeName) const;
+
+    // AnimationTime is in ticks, same as SkinnedMesh::ReadNodeHeirarchy
+    void Sample(uint Track, float AnimationTime, aiVector3D& Scaling, aiQuaternion& Rotation, aiVector3D& Translation) const;
+
+    float GetTicksPerSecond() const { return m_ticksPerSecond; }
+
+    float GetDuration() const { return m_duration; }
+
+    uint NumTracks() const { return (uint)m_tracks.size(); }
+
+    // Size in bytes of the source keys and of the compressed clip
+    uint GetSourceSize() const { return m_sourceSize; }
+
+    uint GetCompressedSize() const;
+
+    // Largest difference between the source samples and the compressed clip
+    float GetMaxPositionError() const { return m_maxPositionError; }
+
+    float GetMaxRotationError() const { return m_maxRotationError; }
+
+    float GetMaxScaleError() const { return m_maxScaleError; }
+
+private:
+
+    struct QuantizedVec3 {
+        ushort Data[3];
+    };
+
+    struct QuantizedQuat {
+        ushort Data[3];
+    };
+
+    struct Vec3Channel {
+        aiVector3D Min;
+        aiVector3D Extent;
+        vector<ushort> Frames;
+        vector<QuantizedVec3> Keys;
+    };
+
+    struct QuatChannel {
+        vector<ushort> Frames;
+        vector<QuantizedQuat> Keys;
+    };
+
+    struct Track {
+        Vec3Channel Scaling;
+        QuatChannel Rotation;
+        Vec3Channel Translation;
+    };
+
+    float CompressVec3(const vector<aiVector3D>& Samples, float Tolerance, Vec3Channel& Channel);
+    float CompressQuat(const vector<aiQuaternion>& Samples, float Tolerance, QuatChannel& Channel);
+    void QuantizeVec3(const vector<aiVector3D>& Samples, Vec3Channel& Channel);
+    aiVector3D DecodeVec3(const Vec3Channel& Channel, uint KeyIndex) const;
+    aiVector3D SampleVec3(const Vec3Channel& Channel, float Frame) const;
+    aiQuaternion SampleQuat(const QuatChannel& Channel, float Frame) const;
+
+    float m_ticksPerSecond;
+    float m_duration;
+    float m_ticksPerFrame;
+    uint m_numFrames;
+    uint m_sourceSize;
+    float m_maxPositionError;
+    float m_maxRotationError;
+    float m_maxScaleError;
+    vector<Track> m_tracks;
+    map<string, uint> m_trackMapping; // maps a node name to its track
+};
+
+#endif  /* OGLDEV_ANIM_CLIP_H */
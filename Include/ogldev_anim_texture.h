@@ -0,0 +1,70 @@
+/*
+
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OGLDEV_ANIM_TEXTURE_H
+#define OGLDEV_ANIM_TEXTURE_H
+
+#include <vector>
+#include <GL/glew.h>
+
+#include "ogldev_math_3d.h"
+#include "ogldev_skinned_mesh.h"
+
+// Holds the bone matrices of every frame of one or more animation clips in a
+// float texture. Each row is a frame and each bone takes three RGBA32F texels
+// (the top three rows of its matrix - the last one is always 0,0,0,1).
+// The vertex shader fetches the bones directly so an entire crowd can be
+// drawn with a single instanced draw and no per frame CPU animation work.
+class AnimationTexture
+{
+public:
+    AnimationTexture();
+
+    ~AnimationTexture();
+
+    // Samples the animation of the mesh at a fixed rate. All the clips must
+    // share the same skeleton. Clips are indexed in the order they are added.
+    bool AddClip(SkinnedMesh& Mesh, float FramesPerSecond);
+
+    // Uploads all the clips to the GPU
+    bool Finalize();
+
+    void Bind(GLenum TextureUnit);
+
+    // Per instance vertex attribute: first row, number of frames,
+    // frames per second and the time offset of the instance
+    Vector4f GetInstanceParams(uint Clip, float TimeOffset) const;
+
+    uint NumClips() const { return (uint)m_clips.size(); }
+
+private:
+
+    struct ClipInfo {
+        uint FirstFrame;
+        uint NumFrames;
+        float FramesPerSecond;
+    };
+
+    vector<ClipInfo> m_clips;
+    vector<Vector4f> m_texels;
+    uint m_numBones;
+    uint m_numFrames;
+    GLuint m_texture;
+};
+
+#endif  /* OGLDEV_ANIM_TEXTURE_H */
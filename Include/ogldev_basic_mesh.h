@@ -32,6 +32,15 @@
 #include "ogldev_texture.h"
 #include "ogldev_world_transform.h"
 #include "ogldev_material.h"
+#include "ogldev_bvh.h"
+
+
+struct BasicMeshHit {
+    unsigned int MeshIndex;     // submesh that was hit
+    unsigned int PrimID;        // triangle index inside the submesh
+    float Distance;             // in units of the ray direction
+    Vector3f Pos;               // object space
+};
 
 class BasicMesh
 {
@@ -40,16 +49,37 @@ public:
 
     ~BasicMesh();
 
-    bool LoadMesh(const std::string& Filename);
+    // HalfFloatDepthStream stores the positions of the depth stream as half
+    // floats. This is fine for shadow maps but not for a Z-prepass which
+    // needs exactly the same positions as the main pass.
+    bool LoadMesh(const std::string& Filename, bool HalfFloatDepthStream = false);
 
     void Render();
 
     void Render(unsigned int NumInstances, const Matrix4f* WVPMats, const Matrix4f* WorldMats);
 
+    // Instanced draw without per instance attributes. The shader fetches the
+    // data of every instance using gl_InstanceID.
+    void Render(unsigned int NumInstances);
+
+    // Depth only rendering (shadow maps, Z-prepass). Only the positions are
+    // bound (attribute 0) and all the submeshes go out in a single draw.
+    void RenderDepth();
+
+    void RenderDepth(unsigned int NumInstances);
+
     WorldTrans& GetWorldTransform() { return m_worldTransform; }
 
     const Material& GetMaterial();
 
+    // Object space sphere that encloses all the vertices
+    const Vector3f& GetBoundingSphereCenter() const { return m_boundingSphereCenter; }
+    float GetBoundingSphereRadius() const { return m_boundingSphereRadius; }
+
+    // Traces an object space ray against the triangles on the CPU (see
+    // CalcPickRay). Doesn't touch the GPU.
+    bool Pick(const Vector3f& Origin, const Vector3f& Dir, BasicMeshHit& Hit) const;
+
 private:
     void Clear();
 
@@ -67,6 +97,12 @@ private:
 
     void PopulateBuffers();
 
+    void PopulateDepthBuffers();
+
+    void CalcBoundingSphere();
+
+    void InitBVH(const std::string& Filename);
+
     void LoadTextures(const string& Dir, const aiMaterial* pMaterial, int index);
 
     void LoadDiffuseTexture(const string& Dir, const aiMaterial* pMaterial, int index);
@@ -84,12 +120,21 @@ private:
         NORMAL_VB    = 3,
         WVP_MAT_VB   = 4,  // required only for instancing
         WORLD_MAT_VB = 5,  // required only for instancing
-        NUM_BUFFERS  = 6
+        DEPTH_POS_VB = 6,  // de-duplicated positions
+        DEPTH_INDEX_BUFFER = 7,
+        NUM_BUFFERS  = 8
     };
 
     WorldTrans m_worldTransform;
     GLuint m_VAO = 0;
     GLuint m_Buffers[NUM_BUFFERS] = { 0 };
+    GLuint m_depthVAO = 0;
+    unsigned int m_numDepthIndices = 0;
+    GLenum m_depthIndexType = GL_UNSIGNED_INT;
+    bool m_halfFloatDepthStream = false;
+    Vector3f m_boundingSphereCenter = Vector3f(0.0f, 0.0f, 0.0f);
+    float m_boundingSphereRadius = 0.0f;
+    TriangleBVH m_bvh;
 
     struct BasicMeshEntry {
         BasicMeshEntry()
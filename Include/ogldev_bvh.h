@@ -0,0 +1,142 @@
+/*
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OGLDEV_BVH_H
+#define OGLDEV_BVH_H
+
+#include <string>
+#include <vector>
+#include <float.h>
+
+#include "ogldev_types.h"
+#include "ogldev_math_3d.h"
+
+using namespace std;
+
+#define INVALID_BVH_TRIANGLE 0xFFFFFFFF
+
+struct BVHHit {
+    float Distance;     // in units of the ray direction
+    uint Triangle;      // index of the triangle in the index buffer of Build
+    float u;            // barycentric coordinates of the hit
+    float v;
+};
+
+
+// Bounding volume hierarchy over a triangle list for ray queries on the
+// CPU (picking, visibility). The tree is built with the binned surface area
+// heuristic. The top levels are split on the calling thread and the
+// subtrees below are built in parallel. The leaves keep their triangles in
+// packets of four in SoA layout, so a ray is tested against four triangles
+// at once with SSE.
+//
+// The tree doesn't reference the input arrays after Build and can be saved
+// to a file to skip the build the next time the same mesh is loaded.
+class TriangleBVH
+{
+public:
+
+    TriangleBVH();
+
+    // Three indices per triangle. NumThreads == 0 uses all the hardware threads.
+    void Build(const vector<Vector3f>& Positions, const vector<uint>& Indices, uint NumThreads = 0);
+
+    // Closest hit with a distance in (0, MaxDistance). Dir doesn't have to
+    // be normalized.
+    bool Intersect(const Vector3f& Origin, const Vector3f& Dir, BVHHit& Hit, float MaxDistance = FLT_MAX) const;
+
+    // Same result as Intersect without the tree - for checking the tree
+    bool IntersectBruteForce(const Vector3f& Origin, const Vector3f& Dir, BVHHit& Hit, float MaxDistance = FLT_MAX) const;
+
+    // Compares Intersect and IntersectBruteForce on random rays through the
+    // bounds of the mesh. Returns the number of rays that got different hits.
+    uint Verify(uint NumRays) const;
+
+    // The checksum identifies the mesh the tree was built for (CalcChecksum)
+    bool Save(const string& Filename, uint Checksum) const;
+
+    // Fails if the file is missing, corrupt or was saved with another checksum.
+    // The size and every node and packet index are checked before use.
+    bool Load(const string& Filename, uint Checksum);
+
+    static uint CalcChecksum(const vector<Vector3f>& Positions, const vector<uint>& Indices);
+
+    bool IsEmpty() const { return m_nodes.empty(); }
+
+    uint GetNumNodes() const { return (uint)m_nodes.size(); }
+
+    uint GetNumTriangles() const { return m_numTriangles; }
+
+private:
+
+    // Inner nodes have Count == 0 and their children at LeftOrFirst and
+    // LeftOrFirst + 1. Leaves have Count packets starting at LeftOrFirst.
+    struct Node {
+        Vector3f Min;
+        uint LeftOrFirst;
+        Vector3f Max;
+        uint Count;
+    };
+
+    // Unused lanes have INVALID_BVH_TRIANGLE and zero edges so they never hit
+    struct TrianglePacket {
+        float V0[3][4];
+        float E1[3][4];
+        float E2[3][4];
+        uint Triangle[4];
+    };
+
+    // A range of the triangle reference array that still has to be split
+    struct BuildTask {
+        uint Node;
+        uint Begin;
+        uint End;
+        uint Depth;
+    };
+
+    struct BuildContext;
+
+    static void CalcBounds(const BuildContext& Ctx, uint Begin, uint End, Vector3f& Min, Vector3f& Max,
+                           Vector3f& CentroidMin, Vector3f& CentroidMax);
+
+    static uint Split(BuildContext& Ctx, uint Begin, uint End, const Vector3f& Min, const Vector3f& Max,
+                      const Vector3f& CentroidMin, const Vector3f& CentroidMax);
+
+    static void BuildSubtree(BuildContext& Ctx, vector<Node>& Nodes, uint NodeIndex, uint Begin, uint End, uint Depth);
+
+    static void BuildSubtreeThread(BuildContext* pCtx, const vector<BuildTask>* pTasks,
+                                   vector<vector<Node> >* pSubtrees, uint FirstTask, uint LastTask);
+
+    void CreatePackets(const BuildContext& Ctx);
+
+    void IntersectPacket(const TrianglePacket& Packet, const Vector3f& Origin, const Vector3f& Dir, BVHHit& Hit) const;
+
+    bool Validate() const;
+
+    vector<Node> m_nodes;
+    vector<TrianglePacket> m_packets;
+    uint m_numTriangles;
+};
+
+
+// World space ray through the pixel (x, y) of the window. (0, 0) is the top
+// left corner like the mouse callbacks. Passing the WVP matrix of an object
+// instead of the VP matrix gives the ray in the object space.
+void CalcPickRay(int x, int y, uint WindowWidth, uint WindowHeight, const Matrix4f& VP,
+                 Vector3f& Origin, Vector3f& Dir);
+
+#endif  /* OGLDEV_BVH_H */
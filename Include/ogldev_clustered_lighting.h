@@ -0,0 +1,185 @@
+/*
+
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OGLDEV_CLUSTERED_LIGHTING_H
+#define OGLDEV_CLUSTERED_LIGHTING_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "technique.h"
+#include "ogldev_math_3d.h"
+#include "ogldev_lights_common.h"
+
+using namespace std;
+
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24       // exponential depth slices between zNear and zFar
+#define NUM_CLUSTERS (CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z)
+#define MAX_LIGHTS_PER_CLUSTER 256
+
+// SSBO binding points used by clustered_lighting.fs
+#define CLUSTER_LIGHTS_BINDING        0
+#define CLUSTER_TABLE_BINDING         1
+#define CLUSTER_LIGHT_INDICES_BINDING 2
+
+
+// Splits the view frustum into a 3D grid of clusters and assigns the point
+// and spot lights to the clusters they touch. The assignment runs on the CPU
+// using SSE sphere-vs-box tests on several threads (each thread owns a range
+// of depth slices). The worker threads are started by Init and wait for the
+// next Update between frames. The results are uploaded as three shader storage buffers:
+// the lights, an (offset, count) pair per cluster and the light index lists.
+class LightClusterGrid
+{
+public:
+
+    LightClusterGrid();
+
+    ~LightClusterGrid();
+
+    // NumThreads == 0 uses all the hardware threads
+    bool Init(const PersProjInfo& ProjInfo, uint NumThreads = 0);
+
+    // View is the camera transformation (Pipeline::GetViewTrans)
+    void Update(const Matrix4f& View,
+                const PointLight* pPointLights, uint NumPointLights,
+                const SpotLight* pSpotLights, uint NumSpotLights);
+
+    void Bind();
+
+    // log(ViewZ) * SliceScale + SliceBias is the depth slice of a view space depth
+    float GetSliceScale() const { return m_sliceScale; }
+    float GetSliceBias() const { return m_sliceBias; }
+
+    float GetScreenWidth() const { return m_projInfo.Width; }
+    float GetScreenHeight() const { return m_projInfo.Height; }
+
+    uint GetNumLightIndices() const { return m_numLightIndices; }
+
+    // Number of (light, cluster) pairs of the last Update that didn't fit in
+    // MAX_LIGHTS_PER_CLUSTER. Update prints a warning when this becomes non zero.
+    uint GetNumDroppedLights() const { return m_numDroppedLights; }
+
+    // Range beyond which the contribution of the light is below 1/256
+    static float CalcLightRange(const PointLight& Light, float MaxRange);
+
+private:
+
+    // std430 layout of a light in clustered_lighting.fs
+    struct ClusterLight {
+        Vector4f PositionRange;     // world space
+        Vector4f ColorDiffuse;      // color, diffuse intensity
+        Vector4f Atten;             // constant, linear, exp, ambient intensity
+        Vector4f DirectionCutoff;   // spot direction, cos(cutoff). Point lights use a cutoff of -2.
+    };
+
+    // View space sphere of a light
+    struct LightSphere {
+        float x, y, z, r;
+    };
+
+    void AssignSlices(uint FirstSlice, uint LastSlice);
+
+    void AddToCluster(uint Cluster, uint LightIndex);
+
+    // Worker i (1 <= i < m_numThreads) assigns the slices of thread i
+    void WorkerLoop(uint Worker);
+    static void WorkerThread(LightClusterGrid* pGrid, uint Worker);
+
+    void StopWorkers();
+
+    PersProjInfo m_projInfo;
+    uint m_numThreads;
+    float m_sliceScale;
+    float m_sliceBias;
+
+    // View space bounding boxes of the clusters in SoA layout for the SIMD test.
+    // Cluster index = (z * CLUSTER_GRID_Y + y) * CLUSTER_GRID_X + x.
+    vector<float> m_minX;
+    vector<float> m_minY;
+    vector<float> m_minZ;
+    vector<float> m_maxX;
+    vector<float> m_maxY;
+    vector<float> m_maxZ;
+
+    vector<ClusterLight> m_lights;
+    vector<LightSphere> m_spheres;
+    vector<uint> m_clusterCounts;
+    vector<uint> m_clusterLists;      // MAX_LIGHTS_PER_CLUSTER entries per cluster
+    vector<uint> m_clusterTable;      // offset and count per cluster
+    vector<uint> m_lightIndices;
+    uint m_numLightIndices;
+    uint m_numDroppedLights;
+
+    GLuint m_buffers[3];
+
+    vector<std::thread> m_workers;
+    std::mutex m_workMutex;
+    std::condition_variable m_workStart;
+    std::condition_variable m_workDone;
+    uint m_workGeneration;          // incremented by every Update
+    uint m_numBusyWorkers;
+    bool m_quit;
+};
+
+
+// Same lighting model as BasicLightingTechnique but the point and spot
+// lights come from a LightClusterGrid and every fragment only loops over
+// the lights of its cluster.
+class ClusteredLightingTechnique : public Technique {
+public:
+
+    ClusteredLightingTechnique();
+
+    virtual bool Init();
+
+    void SetWVP(const Matrix4f& WVP);
+    void SetWorldMatrix(const Matrix4f& World);
+    void SetViewMatrix(const Matrix4f& View);
+    void SetColorTextureUnit(unsigned int TextureUnit);
+    void SetDirectionalLight(const DirectionalLight& Light);
+    void SetEyeWorldPos(const Vector3f& EyeWorldPos);
+    void SetMatSpecularIntensity(float Intensity);
+    void SetMatSpecularPower(float Power);
+    void SetClusterGrid(const LightClusterGrid& Grid);
+
+private:
+
+    GLuint m_WVPLocation;
+    GLuint m_WorldMatrixLocation;
+    GLuint m_viewMatrixLocation;
+    GLuint m_colorTextureLocation;
+    GLuint m_eyeWorldPosLocation;
+    GLuint m_matSpecularIntensityLocation;
+    GLuint m_matSpecularPowerLocation;
+    GLuint m_tileScaleLocation;
+    GLuint m_sliceParamsLocation;
+
+    struct {
+        GLuint Color;
+        GLuint AmbientIntensity;
+        GLuint DiffuseIntensity;
+        GLuint Direction;
+    } m_dirLightLocation;
+};
+
+#endif  /* OGLDEV_CLUSTERED_LIGHTING_H */
@@ -39,6 +39,10 @@
 #define CASCACDE_SHADOW_TEXTURE_UNIT1_INDEX 6
 #define CASCACDE_SHADOW_TEXTURE_UNIT2       GL_TEXTURE7
 #define CASCACDE_SHADOW_TEXTURE_UNIT2_INDEX 7
+#define ANIMATION_TEXTURE_UNIT              GL_TEXTURE8
+#define ANIMATION_TEXTURE_UNIT_INDEX        8
+#define SHADOW_DEPTH_TEXTURE_UNIT           GL_TEXTURE9     // raw depth view of the shadow map
+#define SHADOW_DEPTH_TEXTURE_UNIT_INDEX     9
 
 
 #endif  /* OGLDEV_ENGINE_COMMON_H */
@@ -0,0 +1,125 @@
+/*
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OGLDEV_GPU_SORT_H
+#define OGLDEV_GPU_SORT_H
+
+#include "technique.h"
+
+// Shader storage binding points of the key and value buffers
+#define BITONIC_SORT_KEYS_BINDING       6
+#define BITONIC_SORT_VALUES_BINDING     7
+
+// Must match bitonic_sort.cs and bitonic_sort_local.cs
+#define BITONIC_SORT_GROUP_SIZE         256
+#define BITONIC_SORT_BLOCK_SIZE         1024
+
+
+// A single compare-and-swap step of the sort that spans the whole buffer
+class BitonicSortStepTechnique : public Technique
+{
+public:
+
+    BitonicSortStepTechnique();
+
+    virtual bool Init();
+
+    // Flip steps compare mirrored elements of each BlockSize run, the other
+    // steps compare the two halves of each run
+    void SetStep(uint BlockSize, bool Flip);
+
+private:
+
+    GLuint m_blockSizeLocation;
+    GLuint m_flipLocation;
+};
+
+
+// Runs all the steps that stay inside BITONIC_SORT_BLOCK_SIZE elements in
+// shared memory
+class BitonicSortLocalTechnique : public Technique
+{
+public:
+
+    BitonicSortLocalTechnique();
+
+    virtual bool Init();
+
+    // Presort sorts every block from scratch. Otherwise only the last steps
+    // of a merge are done.
+    void SetParams(uint BlockOffset, bool Presort);
+
+private:
+
+    GLuint m_blockOffsetLocation;
+    GLuint m_presortLocation;
+};
+
+
+// Sorts float keys with uint values in ascending order on the GPU. The
+// buffers are owned by the sorter and persist across frames: the caller
+// writes new keys for the current order of the values and sorts again.
+// The size is rounded up to a power of two and the padding has +INF keys
+// so it never moves from the end of the buffers.
+//
+// When the keys change slowly (e.g. view depth of particles) the order of
+// the previous frame is almost correct. SortBlocks then fixes it up by
+// sorting independent blocks, alternating the block boundaries between
+// calls, at a fraction of the cost of Sort.
+class GPUBitonicSort
+{
+public:
+
+    GPUBitonicSort();
+
+    ~GPUBitonicSort();
+
+    // The values start as 0..MaxElements-1
+    bool Init(uint MaxElements);
+
+    // Binds the key and value buffers to their binding points
+    void Bind();
+
+    void Sort();
+
+    void SortBlocks();
+
+    GLuint GetKeyBuffer() const { return m_buffers[KEY_BUFFER]; }
+
+    // Tightly packed uints that can be used as an element array buffer
+    GLuint GetValueBuffer() const { return m_buffers[VALUE_BUFFER]; }
+
+    uint GetSize() const { return m_size; }
+
+private:
+
+    void DispatchLocal(uint BlockOffset, bool Presort);
+
+    enum BUFFER_TYPE {
+        KEY_BUFFER   = 0,
+        VALUE_BUFFER = 1,
+        NUM_BUFFERS  = 2
+    };
+
+    uint m_size;
+    bool m_shiftBlocks;
+    GLuint m_buffers[NUM_BUFFERS];
+    BitonicSortStepTechnique m_stepTech;
+    BitonicSortLocalTechnique m_localTech;
+};
+
+#endif  /* OGLDEV_GPU_SORT_H */
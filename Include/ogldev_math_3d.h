@@ -151,6 +151,11 @@ struct Vector3f
 
     Vector3f Cross(const Vector3f& v) const;
 
+    float Length() const
+    {
+        return sqrtf(x * x + y * y + z * z);
+    }
+
     Vector3f& Normalize();
 
     void Rotate(float Angle, const Vector3f& Axis);
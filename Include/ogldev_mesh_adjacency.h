@@ -0,0 +1,52 @@
+/*
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OGLDEV_MESH_ADJACENCY_H
+#define OGLDEV_MESH_ADJACENCY_H
+
+#include <vector>
+
+#include "ogldev_types.h"
+#include "ogldev_math_3d.h"
+
+using namespace std;
+
+// One submesh for BuildAdjacency. The indices are relative to pPositions.
+struct AdjacencyJob {
+    const Vector3f* pPositions;
+    uint NumVertices;
+    const uint* pIndices;       // 3 per triangle
+    uint NumTriangles;
+    uint* pAdjIndices;          // output, 6 per triangle
+};
+
+
+// Builds the index buffer for GL_TRIANGLES_ADJACENCY. Vertices that were
+// split by the normals or texture coordinates are welded by position (the
+// first occurrence wins) so the triangles on both sides of a hard edge still
+// see each other. Edges without a neighbor, or with more than two triangles,
+// get the third vertex of the triangle itself as the opposite vertex.
+//
+// The vertices and edges are found with open addressing hash tables so a
+// submesh is processed in linear time.
+void BuildAdjacency(const AdjacencyJob& Job);
+
+// The submeshes are distributed between the threads, largest first.
+// NumThreads == 0 uses all the hardware threads.
+void BuildAdjacency(const vector<AdjacencyJob>& Jobs, uint NumThreads = 0);
+
+#endif  /* OGLDEV_MESH_ADJACENCY_H */
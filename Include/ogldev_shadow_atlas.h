@@ -0,0 +1,91 @@
+/*
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OGLDEV_SHADOW_ATLAS_H
+#define OGLDEV_SHADOW_ATLAS_H
+
+#include <vector>
+#include <GL/glew.h>
+
+#include "ogldev_types.h"
+#include "ogldev_math_3d.h"
+
+using namespace std;
+
+struct ShadowAtlasTile
+{
+    uint x;
+    uint y;
+    uint Size;      // zero if the light didn't get a tile
+};
+
+
+// A single large depth texture shared by the shadow maps of many lights.
+// Every frame each light gets a square power of two tile sized by its
+// importance (the fraction of the screen that it covers). The size of a
+// tile only changes when the importance moves well past the threshold of
+// the next size in order to prevent the resolution of the shadows from
+// flickering. When the tiles don't fit the least important lights are
+// shrunk first and dropped last.
+//
+// The tiles are placed by walking a quadtree of the atlas in Z order. The
+// tiles are sorted from large to small so each one starts on a node of its
+// own size and there is no fragmentation.
+class ShadowAtlas
+{
+public:
+    ShadowAtlas();
+
+    ~ShadowAtlas();
+
+    // All the sizes must be powers of two
+    bool Init(uint Size, uint MinTileSize, uint MaxTileSize, uint MaxLights);
+
+    // Returns the number of lights that got a tile
+    uint Allocate(const float* pImportance, uint NumLights);
+
+    const ShadowAtlasTile& GetTile(uint LightIndex) const { return m_tiles[LightIndex]; }
+
+    // Offset (xy) and scale (zw) that map [0, 1] to the tile in texture space
+    Vector4f GetTileUVRect(uint LightIndex) const;
+
+    // Binds the FBO once for all the lights. The caller clears the entire atlas.
+    void BindForWriting();
+
+    // Limits rendering to the tile of the light
+    void SetViewport(uint LightIndex);
+
+    void BindForReading(GLenum TextureUnit);
+
+    uint GetSize() const { return m_size; }
+
+private:
+
+    uint CalcLevel(float Importance, uint PrevLevel) const;
+
+    GLuint m_fbo;
+    GLuint m_shadowMap;
+    uint m_size;
+    uint m_minLevel;        // log2 of the tile size
+    uint m_maxLevel;
+
+    vector<ShadowAtlasTile> m_tiles;
+    vector<uint> m_levels;  // requested level per light before fitting. Zero for none.
+    vector<uint> m_order;
+};
+
+#endif  /* OGLDEV_SHADOW_ATLAS_H */
@@ -27,18 +27,41 @@ public:
 
     ~ShadowMapFBO();
 
-    bool Init(unsigned int WindowWidth, unsigned int WindowHeight);
+    // StaticCache adds a second shadow map for the casters that don't move
+    bool Init(unsigned int WindowWidth, unsigned int WindowHeight, bool StaticCache = false);
 
     void BindForWriting();
 
     void BindForReading(GLenum TextureUnit);
 
+    // The static casters are rendered into their own shadow map only after it
+    // has been invalidated (e.g. when the light or a static caster moves).
+    // Every frame the static map is copied into the main shadow map and only
+    // the dynamic casters are rendered on top of it. The depth test keeps the
+    // minimum of the two.
+    bool IsStaticValid() const { return m_staticValid; }
+
+    void InvalidateStatic() { m_staticValid = false; }
+
+    // Marks the static map as valid. The caller clears it and renders the static casters.
+    void BindForWritingStatic();
+
+    // Copies the static map into the main shadow map and binds the main map
+    // for rendering the dynamic casters. Don't clear it after this call.
+    void BindForWritingDynamic();
+
 private:
     GLuint m_fbo;
     GLuint m_shadowMap;
+    GLuint m_staticFbo;
+    GLuint m_staticShadowMap;
+    bool m_staticValid;
+    unsigned int m_width;
+    unsigned int m_height;
 };
 
 
+// All the cascades live in the layers of a single depth texture array
 class CascadedShadowMapFBO
 {
 public:
@@ -46,15 +69,23 @@ public:
 
     ~CascadedShadowMapFBO();
 
-    bool Init(unsigned int WindowWidth, unsigned int WindowHeight);
+    bool Init(unsigned int WindowWidth, unsigned int WindowHeight, unsigned int NumCascades = 3);
 
+    // Attaches a single cascade (e.g. in order to clear it)
     void BindForWriting(uint CascadeIndex);
 
+    // Attaches the entire array. The layer is selected by gl_Layer in the shader.
+    void BindForWritingLayered();
+
     void BindForReading();
 
+    unsigned int GetNumCascades() const { return m_numCascades; }
+
 private:
     GLuint m_fbo;
-    GLuint m_shadowMap[3];
+    GLuint m_layeredFbo;
+    GLuint m_shadowMap;
+    unsigned int m_numCascades;
 };
 
 
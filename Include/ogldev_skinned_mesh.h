@@ -30,9 +30,52 @@
 #include "ogldev_util.h"
 #include "ogldev_math_3d.h"
 #include "ogldev_texture.h"
+#include "ogldev_anim_clip.h"
 
 using namespace std;
 
+#define NUM_BONES_PER_VEREX  4  // per bone attribute (ivec4 IDs + vec4 weights)
+#define MAX_BONES_PER_VERTEX 8  // uses a second pair of bone attributes
+
+// Animation LOD policy. Screen sizes are the fraction of the viewport
+// height that the character covers.
+struct AnimationLODConfig
+{
+    float FullRateScreenSize;   // at or above this the pose is evaluated every frame
+    float MinUpdateRate;        // poses per second at a screen size of zero
+    float MaxUpdateRate;        // poses per second just below FullRateScreenSize
+    float FreezeScreenSize;     // below this the leaf bones (fingers, face) are frozen
+    float FreezeScreenSize2;    // below this their parents are frozen as well
+
+    AnimationLODConfig()
+    {
+        FullRateScreenSize = 0.25f;
+        MinUpdateRate      = 5.0f;
+        MaxUpdateRate      = 30.0f;
+        FreezeScreenSize   = 0.1f;
+        FreezeScreenSize2  = 0.03f;
+    }
+};
+
+// Per character state of the animation LOD. Every character that uses the
+// mesh needs its own copy since it holds the poses that are interpolated.
+struct AnimationLODState
+{
+    float PrevTime;                 // in seconds
+    float NextTime;
+    vector<Matrix4f> PrevPose;      // final bone transforms at PrevTime/NextTime
+    vector<Matrix4f> NextPose;
+    vector<Matrix4f> NodeTransforms; // last sampled local transform of every node - used by the frozen bones
+    uint BonesEvaluated;            // bone tracks sampled by the last BoneTransform call
+
+    AnimationLODState()
+    {
+        PrevTime = 0.0f;
+        NextTime = -1.0f;
+        BonesEvaluated = 0;
+    }
+};
+
 class SkinnedMesh
 {
 public:
@@ -40,9 +83,29 @@ public:
 
     ~SkinnedMesh();
 
-    bool LoadMesh(const string& Filename);
+    // Influences beyond MaxBonesPerVertex are dropped (the smallest first)
+    // and the remaining ones are renormalized
+    bool LoadMesh(const string& Filename, uint MaxBonesPerVertex = NUM_BONES_PER_VEREX);
 
     void Render();
+
+    // The triangles of every subset are sorted by the number of bones that
+    // influence their vertices so each group can be rendered with a VS that
+    // only fetches the bones it needs. Rigid (single bone) triangles come first.
+    enum INFLUENCE_GROUP {
+        INFLUENCE_GROUP_RIGID,
+        INFLUENCE_GROUP_2_BONES,
+        INFLUENCE_GROUP_4_BONES,
+        INFLUENCE_GROUP_8_BONES,
+        NUM_INFLUENCE_GROUPS
+    };
+
+    static uint GetInfluenceGroupSize(uint Group) { return 1 << Group; }
+
+    void RenderInfluenceGroup(uint Group);
+
+    // Used only by instancing. AnimParams comes from AnimationTexture::GetInstanceParams.
+    void Render(uint NumInstances, const Matrix4f* WVPMats, const Matrix4f* WorldMats, const Vector4f* AnimParams);
 	
     uint NumBones() const
     {
@@ -50,9 +113,46 @@ public:
     }
     
     void BoneTransform(float TimeInSeconds, vector<Matrix4f>& Transforms);
-    
+
+    // Same as above but far characters are evaluated at a lower rate (the
+    // poses in between are interpolated) and their leaf bones are frozen.
+    // The number of bones that were actually sampled goes into State.BonesEvaluated.
+    void BoneTransform(float TimeInSeconds, vector<Matrix4f>& Transforms,
+                       const AnimationLODConfig& Config, float ScreenSize, AnimationLODState& State);
+
+    float GetAnimationDuration() const; // in seconds
+
+    // Replaces the Assimp animation with a compressed clip and releases the
+    // Assimp scene. Must be called after LoadMesh. The tolerances are the
+    // same as in CompressedAnimClip::Init.
+    bool CompressAnimation(float SampleRate, float PositionTolerance, float RotationTolerance, float ScaleTolerance);
+
+    // Pre-skinning: the mesh is skinned once per frame into a vertex buffer
+    // that all the following passes read using a VS without bones. Location 0
+    // is the skinned position, 2 is the skinned normal and 3 is the skinned
+    // position of the previous frame.
+    bool InitPreSkinning();
+
+    // SIMD kernel over the bone data stream. AVX is used when the CPU supports it.
+    void SkinVerticesCPU(const vector<Matrix4f>& Transforms);
+
+    bool IsUsingAVX() const { return m_UseAVX; }
+
+    // Transform feedback pass. The caller must enable a SkinningStreamOutTechnique
+    // and set the bone transforms.
+    void SkinVerticesGPU();
+
+    // Skins the vertices with both paths and returns the largest distance
+    // between the CPU and the GPU positions. Same requirements as
+    // SkinVerticesGPU. NumMultiBoneVertices is the number of vertices with
+    // more than 4 influences (the ones that use the second bone attributes).
+    float CompareSkinning(const vector<Matrix4f>& Transforms, uint& NumMultiBoneVertices);
+
+    void RenderPreSkinned();
+
+    uint NumVertices() const { return m_NumVertices; }
+
 private:
-    #define NUM_BONES_PER_VEREX 4
 
     struct BoneInfo
     {
@@ -66,10 +166,12 @@ private:
         }
     };
     
+    // Influences are kept sorted by decreasing weight
     struct VertexBoneData
     {        
-        uint IDs[NUM_BONES_PER_VEREX];
-        float Weights[NUM_BONES_PER_VEREX];
+        uint IDs[MAX_BONES_PER_VERTEX];
+        float Weights[MAX_BONES_PER_VERTEX];
+        uint NumBones;
 
         VertexBoneData()
         {
@@ -80,9 +182,31 @@ private:
         {
             ZERO_MEM(IDs);
             ZERO_MEM(Weights);        
+            NumBones = 0;
         }
         
         void AddBoneData(uint BoneID, float Weight);
+
+        void Normalize(uint MaxBones);
+    };
+
+    // What goes into a bone vertex buffer - influences 0-3 or 4-7
+    struct VertexBoneAttribs
+    {
+        uint IDs[NUM_BONES_PER_VEREX];
+        float Weights[NUM_BONES_PER_VEREX];
+    };
+
+    // The node hierarchy is copied here so that the animation LOD can walk
+    // it without recursion and so that the scene can be released when the
+    // animation is compressed. Parents always precede their children.
+    struct NodeInfo {
+        Matrix4f Transformation;
+        int ParentIndex;
+        int BoneIndex;
+        int TrackIndex;
+        const aiNodeAnim* pNodeAnim;    // NULL once the animation is compressed
+        uint Height;                    // 0 for a leaf, otherwise 1 + the height of the tallest child
     };
 
     void CalcInterpolatedScaling(aiVector3D& Out, float AnimationTime, const aiNodeAnim* pNodeAnim);
@@ -93,6 +217,12 @@ private:
     uint FindPosition(float AnimationTime, const aiNodeAnim* pNodeAnim);
     const aiNodeAnim* FindNodeAnim(const aiAnimation* pAnimation, const string NodeName);
     void ReadNodeHeirarchy(float AnimationTime, const aiNode* pNode, const Matrix4f& ParentTransform);
+    void FlattenNodeHeirarchy(const aiNode* pNode, int ParentIndex);
+    void InitNodes();
+    void ReadCompressedHeirarchy(float AnimationTime);
+    Matrix4f SampleNodeTransform(const NodeInfo& Node, float AnimationTime);
+    uint EvaluatePose(float TimeInSeconds, uint FrozenLevels, AnimationLODState& State, vector<Matrix4f>& Pose);
+    float GetAnimationTime(float TimeInSeconds) const; // in ticks
     bool InitFromScene(const aiScene* pScene, const string& Filename);
     void InitMesh(uint MeshIndex,
                   const aiMesh* paiMesh,
@@ -102,8 +232,13 @@ private:
                   vector<VertexBoneData>& Bones,
                   vector<unsigned int>& Indices);
     void LoadBones(uint MeshIndex, const aiMesh* paiMesh, vector<VertexBoneData>& Bones);
+    void InitInfluenceGroups(uint MeshIndex, const aiMesh* paiMesh, const vector<VertexBoneData>& Bones, vector<uint>& Indices);
+    void InitBoneBuffers(const vector<VertexBoneData>& Bones);
+    void ReadBackBones();
     bool InitMaterials(const aiScene* pScene, const string& Filename);
     void Clear();
+    void InitPreSkinnedVAO(uint Index);
+    static bool IsAVXSupported();
 
 #define INVALID_MATERIAL 0xFFFFFFFF
   
@@ -113,6 +248,10 @@ private:
         SKINNED_MESH_NORMAL_VB,
         SKINNED_MESH_TEXCOORD_VB,
         SKINNED_MESH_BONE_VB,
+        SKINNED_MESH_BONE2_VB,     // required only for more than 4 bones per vertex
+        SKINNED_MESH_WVP_MAT_VB,   // required only for instancing
+        SKINNED_MESH_WORLD_MAT_VB, // required only for instancing
+        SKINNED_MESH_ANIM_VB,      // required only for instancing
         SKINNED_MESH_NUM_VBs            
     };
 
@@ -126,16 +265,39 @@ private:
             BaseVertex    = 0;
             BaseIndex     = 0;
             MaterialIndex = INVALID_MATERIAL;
+            ZERO_MEM(GroupBaseIndex);
+            ZERO_MEM(GroupNumIndices);
         }
         
         unsigned int NumIndices;
         unsigned int BaseVertex;
         unsigned int BaseIndex;
         unsigned int MaterialIndex;
+        unsigned int GroupBaseIndex[NUM_INFLUENCE_GROUPS];
+        unsigned int GroupNumIndices[NUM_INFLUENCE_GROUPS];
     };
     
     vector<MeshEntry> m_Entries;
     vector<Texture*> m_Textures;
+    uint m_NumVertices;
+    uint m_MaxBonesPerVertex;
+
+    struct SkinnedVertex {
+        Vector3f Pos;
+        Vector3f Normal;
+    };
+
+    // Two buffers so that the previous frame is still around
+    GLuint m_SkinnedVAO[2];
+    GLuint m_SkinnedVB[2];
+    uint m_CurrSkinned;
+    bool m_UseAVX;
+
+    // Copies of the bind pose for the CPU skinning
+    vector<Vector3f> m_Positions;
+    vector<Vector3f> m_Normals;
+    vector<VertexBoneData> m_Bones;
+    vector<SkinnedVertex> m_SkinnedVertices;
      
     map<string,uint> m_BoneMapping; // maps a bone name to its index
     uint m_NumBones;
@@ -144,6 +306,10 @@ private:
     
     const aiScene* m_pScene;
     Assimp::Importer m_Importer;
+
+    vector<NodeInfo> m_Nodes;
+    CompressedAnimClip m_AnimClip;
+    bool m_UseCompressedAnim;
 };
 
 
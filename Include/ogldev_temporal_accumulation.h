@@ -0,0 +1,77 @@
+/*
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OGLDEV_TEMPORAL_ACCUMULATION_H
+#define OGLDEV_TEMPORAL_ACCUMULATION_H
+
+#include "technique.h"
+#include "ogldev_math_3d.h"
+#include "ogldev_io_buffer.h"
+
+// Blends the output of a noisy screen space effect (SSAO, PCF, ...) with the
+// result of the previous frames. The history is reprojected using the depth
+// buffer and the view-projection matrix of the previous frame, and it is
+// clamped to the neighbourhood of the current pixel to reject stale values
+// after disocclusion. An effect can spread its samples over NUM_FRAMES
+// frames (see GetFrameIndex) and converge to the full sample count.
+class TemporalAccumulation : public Technique {
+public:
+
+    static const uint NUM_FRAMES = 4;
+
+    TemporalAccumulation();
+
+    ~TemporalAccumulation();
+
+    // InternalType is one of the IOBuffer types
+    bool Init(uint Width, uint Height, GLenum InternalType = GL_R32F);
+
+    // Current is this frame's result and DepthBuffer is the hardware depth of
+    // the scene (any resolution). VP is the current view-projection matrix
+    // (Pipeline::GetVPTrans). The caller sets the viewport to Width x Height.
+    void Accumulate(IOBuffer& Current, IOBuffer& DepthBuffer, const Matrix4f& VP);
+
+    // The accumulated result of the last call to Accumulate
+    IOBuffer& GetOutput() { return m_history[m_writeIndex]; }
+
+    // Drops the history, e.g. after a camera cut or when the effect changes
+    void Reset() { m_historyValid = false; }
+
+    // Selects which 1/NUM_FRAMES of the samples the effect takes this frame
+    uint GetFrameIndex() const { return m_frameCount % NUM_FRAMES; }
+
+    // Weight of the current frame in the blend
+    void SetBlendFactor(float BlendFactor) { m_blendFactor = BlendFactor; }
+
+private:
+
+    IOBuffer m_history[2];
+    uint m_writeIndex;
+    uint m_frameCount;
+    bool m_historyValid;
+    float m_blendFactor;
+    Matrix4f m_prevVP;
+    GLuint m_VAO;
+
+    GLuint m_currentTextureLocation;
+    GLuint m_historyTextureLocation;
+    GLuint m_depthTextureLocation;
+    GLuint m_reprojectionLocation;
+    GLuint m_blendFactorLocation;
+};
+
+#endif  /* OGLDEV_TEMPORAL_ACCUMULATION_H */
@@ -50,6 +50,10 @@ void OgldevFileError(const char* pFileName, uint line, const char* pFileError);
 #define MAX(a,b) ((a) > (b) ? (a) : (b))
 #endif
 
+#ifndef MIN
+#define MIN(a,b) ((a) < (b) ? (a) : (b))
+#endif
+
 #ifdef _WIN64
 #define SNPRINTF _snprintf_s
 #define VSNPRINTF vsnprintf_s
@@ -4,6 +4,6 @@ CC=g++
 CPPFLAGS=`pkg-config --cflags glew ImageMagick++ assimp`
 CPPFLAGS="$CPPFLAGS -I../Include"
 LDFLAGS=`pkg-config --libs glew assimp`
-LDFLAGS="$LDFLAGS -lglut -lX11"
+LDFLAGS="$LDFLAGS -pthread -lglut -lX11"
 
-$CC tutorial19.cpp ../Common/ogldev_util.cpp  ../Common/math_3d.cpp ../Common/ogldev_texture.cpp ../Common/3rdparty/stb_image.cpp ../Common/ogldev_world_transform.cpp camera.cpp ../Common/ogldev_basic_mesh.cpp lighting_technique.cpp ../Common/technique.cpp $CPPFLAGS $LDFLAGS -o tutorial19
+$CC tutorial19.cpp ../Common/ogldev_util.cpp  ../Common/math_3d.cpp ../Common/ogldev_texture.cpp ../Common/3rdparty/stb_image.cpp ../Common/ogldev_world_transform.cpp camera.cpp ../Common/ogldev_basic_mesh.cpp ../Common/ogldev_bvh.cpp lighting_technique.cpp ../Common/technique.cpp $CPPFLAGS $LDFLAGS -o tutorial19
@@ -29,11 +29,15 @@
 #include "ogldev_lights_common.h"
 #include "ogldev_app.h"
 #include "ogldev_basic_lighting.h"
+#include "ogldev_clustered_lighting.h"
 #include "mesh.h"
 
 #define WINDOW_WIDTH  1920
 #define WINDOW_HEIGHT 1200
 
+#define NUM_CLUSTERED_POINT_LIGHTS 1024
+#define NUM_CLUSTERED_SPOT_LIGHTS  64
+
 static float FieldDepth = 10.0f;
 
 
@@ -46,6 +50,9 @@ public:
     {
         m_pGameCamera = NULL;
         m_pEffect = NULL;
+        m_pClusteredEffect = NULL;
+        m_clustered = false;
+        m_isClusteredAvailable = false;
         m_scale = 0.0f;
         m_directionalLight.Color = Vector3f(1.0f, 1.0f, 1.0f);
         m_directionalLight.AmbientIntensity = 1.0f;
@@ -62,6 +69,7 @@ public:
     ~Tutorial22()
     {
         delete m_pEffect;
+        delete m_pClusteredEffect;
         delete m_pGameCamera;
         delete m_pMesh;
     }
@@ -85,6 +93,23 @@ public:
 
         m_pEffect->SetColorTextureUnit(0);
 
+        // Clustered lighting reads the lights from SSBOs (OpenGL 4.3). Without
+        // them the tutorial keeps the forward path.
+        m_pClusteredEffect = new ClusteredLightingTechnique();
+
+        m_isClusteredAvailable = m_pClusteredEffect->Init() && m_clusterGrid.Init(m_persProjInfo);
+
+        if (m_isClusteredAvailable) {
+            m_pClusteredEffect->Enable();
+            m_pClusteredEffect->SetColorTextureUnit(0);
+            m_pClusteredEffect->SetClusterGrid(m_clusterGrid);
+
+            InitClusteredLights();
+        }
+        else {
+            printf("Error initializing clustered lighting - clustered mode is disabled\n");
+        }
+
         m_pMesh = new Mesh();
 
         return m_pMesh->LoadMesh("../Content/phoenix_ugv.md2");
@@ -103,6 +128,14 @@ public:
 
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+        if (m_clustered) {
+            RenderClustered();
+            glutSwapBuffers();
+            return;
+        }
+
+        m_pEffect->Enable();
+
         PointLight pl[2];
         pl[0].DiffuseIntensity = 0.25f;
         pl[0].Color = Vector3f(1.0f, 0.5f, 0.0f);
@@ -143,6 +176,56 @@ public:
     }
 
 
+    // Lots of small lights scattered around the model
+    void InitClusteredLights()
+    {
+        for (uint i = 0 ; i < NUM_CLUSTERED_POINT_LIGHTS ; i++) {
+            PointLight& l = m_clusteredPointLights[i];
+            l.Color = Vector3f(RandomFloat(), RandomFloat(), RandomFloat());
+            l.DiffuseIntensity = 0.2f;
+            l.Position = Vector3f(RandomFloat() * 20.0f - 10.0f, RandomFloat() * 3.0f, RandomFloat() * 20.0f);
+            l.Attenuation.Exp = 5.0f;
+        }
+
+        for (uint i = 0 ; i < NUM_CLUSTERED_SPOT_LIGHTS ; i++) {
+            SpotLight& l = m_clusteredSpotLights[i];
+            l.Color = Vector3f(RandomFloat(), RandomFloat(), RandomFloat());
+            l.DiffuseIntensity = 0.5f;
+            l.Position = Vector3f(RandomFloat() * 20.0f - 10.0f, 4.0f, RandomFloat() * 20.0f);
+            l.Direction = Vector3f(0.0f, -1.0f, 0.0f);
+            l.Attenuation.Exp = 1.0f;
+            l.Cutoff = 20.0f;
+        }
+    }
+
+
+    void RenderClustered()
+    {
+        Pipeline p;
+        p.Scale(0.1f, 0.1f, 0.1f);
+        p.Rotate(0.0f, m_scale, 0.0f);
+        p.WorldPos(0.0f, 0.0f, 10.0f);
+        p.SetCamera(m_pGameCamera->GetPos(), m_pGameCamera->GetTarget(), m_pGameCamera->GetUp());
+        p.SetPerspectiveProj(m_persProjInfo);
+
+        m_clusterGrid.Update(p.GetViewTrans(),
+                             m_clusteredPointLights, NUM_CLUSTERED_POINT_LIGHTS,
+                             m_clusteredSpotLights, NUM_CLUSTERED_SPOT_LIGHTS);
+        m_clusterGrid.Bind();
+
+        m_pClusteredEffect->Enable();
+        m_pClusteredEffect->SetWVP(p.GetWVPTrans());
+        m_pClusteredEffect->SetWorldMatrix(p.GetWorldTrans());
+        m_pClusteredEffect->SetViewMatrix(p.GetViewTrans());
+        m_pClusteredEffect->SetDirectionalLight(m_directionalLight);
+        m_pClusteredEffect->SetEyeWorldPos(m_pGameCamera->GetPos());
+        m_pClusteredEffect->SetMatSpecularIntensity(0.0f);
+        m_pClusteredEffect->SetMatSpecularPower(0);
+
+        m_pMesh->Render();
+    }
+
+
 
     void KeyboardCB(OGLDEV_KEY OgldevKey, OGLDEV_KEY_STATE State)
     {
@@ -163,6 +246,11 @@ public:
         case OGLDEV_KEY_x:
             m_directionalLight.DiffuseIntensity -= 0.05f;
             break;
+        case OGLDEV_KEY_c:
+            if (m_isClusteredAvailable) {
+                m_clustered = !m_clustered;
+            }
+            break;
         default:
             m_pGameCamera->OnKeyboard(OgldevKey);
         }
@@ -177,6 +265,12 @@ public:
 private:
 
     BasicLightingTechnique* m_pEffect;
+    ClusteredLightingTechnique* m_pClusteredEffect;
+    LightClusterGrid m_clusterGrid;
+    bool m_clustered;
+    bool m_isClusteredAvailable;
+    PointLight m_clusteredPointLights[NUM_CLUSTERED_POINT_LIGHTS];
+    SpotLight m_clusteredSpotLights[NUM_CLUSTERED_SPOT_LIGHTS];
     Camera* m_pGameCamera;
     float m_scale;
     DirectionalLight m_directionalLight;
@@ -1,9 +1,8 @@
 #version 330                                                                        
                                                                                     
 const int MAX_POINT_LIGHTS = 2;                                                     
-const int MAX_SPOT_LIGHTS = 2;                                                      
+const int MAX_SPOT_LIGHTS = 16;                                                     
                                                                                     
-in vec4 LightSpacePos;                                                              
 in vec2 TexCoord0;                                                                  
 in vec3 Normal0;                                                                    
 in vec3 WorldPos0;                                                                  
@@ -50,25 +49,38 @@ uniform DirectionalLight gDirectionalLight;
 uniform PointLight gPointLights[MAX_POINT_LIGHTS];                                          
 uniform SpotLight gSpotLights[MAX_SPOT_LIGHTS];                                             
 uniform sampler2D gSampler;                                                                 
-uniform sampler2D gShadowMap;                                                               
+uniform sampler2D gShadowMap;       // shadow atlas
+uniform mat4 gSpotLightVP[MAX_SPOT_LIGHTS];
+uniform vec4 gSpotShadowTile[MAX_SPOT_LIGHTS];  // offset and scale of the atlas tile
 uniform vec3 gEyeWorldPos;                                                                  
 uniform float gMatSpecularIntensity;                                                        
 uniform float gSpecularPower;                                                               
                                                                                             
-float CalcShadowFactor(vec4 LightSpacePos)                                                  
-{                                                                                           
-    vec3 ProjCoords = LightSpacePos.xyz / LightSpacePos.w;                                  
-    vec2 UVCoords;                                                                          
-    UVCoords.x = 0.5 * ProjCoords.x + 0.5;                                                  
-    UVCoords.y = 0.5 * ProjCoords.y + 0.5;                                                  
-    float z = 0.5 * ProjCoords.z + 0.5;                                                     
-    float Depth = texture(gShadowMap, UVCoords).x;                                          
-    if (Depth < z + 0.00001)                                                                 
-        return 0.5;                                                                         
-    else                                                                                    
-        return 1.0;                                                                         
-}                                                                                           
-                                                                                            
+float CalcShadowFactor(int SpotLightIndex)
+{
+    vec4 Tile = gSpotShadowTile[SpotLightIndex];
+
+    if (Tile.z == 0.0)
+        return 1.0;
+
+    vec4 LightSpacePos = gSpotLightVP[SpotLightIndex] * vec4(WorldPos0, 1.0);
+    vec3 ProjCoords = LightSpacePos.xyz / LightSpacePos.w;
+    vec2 UVCoords;
+    UVCoords.x = 0.5 * ProjCoords.x + 0.5;
+    UVCoords.y = 0.5 * ProjCoords.y + 0.5;
+
+    // Don't let the bilinear filter read the neighboring tiles
+    vec2 HalfTexel = 0.5 / vec2(textureSize(gShadowMap, 0));
+    UVCoords = clamp(Tile.xy + UVCoords * Tile.zw, Tile.xy + HalfTexel, Tile.xy + Tile.zw - HalfTexel);
+
+    float z = 0.5 * ProjCoords.z + 0.5;
+    float Depth = texture(gShadowMap, UVCoords).x;
+    if (Depth < z + 0.00001)
+        return 0.5;
+    else
+        return 1.0;
+}
+
 vec4 CalcLightInternal(BaseLight Light, vec3 LightDirection, vec3 Normal,            
                        float ShadowFactor)                                                  
 {                                                                                           
@@ -98,12 +110,11 @@ vec4 CalcDirectionalLight(vec3 Normal)
     return CalcLightInternal(gDirectionalLight.Base, gDirectionalLight.Direction, Normal, 1.0);  
 }                                                                                                
                                                                                             
-vec4 CalcPointLight(PointLight l, vec3 Normal, vec4 LightSpacePos)                   
+vec4 CalcPointLight(PointLight l, vec3 Normal, float ShadowFactor)                 
 {                                                                                           
     vec3 LightDirection = WorldPos0 - l.Position;                                           
     float Distance = length(LightDirection);                                                
     LightDirection = normalize(LightDirection);                                             
-    float ShadowFactor = CalcShadowFactor(LightSpacePos);                                   
                                                                                             
     vec4 Color = CalcLightInternal(l.Base, LightDirection, Normal, ShadowFactor);           
     float Attenuation =  l.Atten.Constant +                                                 
@@ -113,13 +124,13 @@ vec4 CalcPointLight(PointLight l, vec3 Normal, vec4 LightSpacePos)
     return Color / Attenuation;                                                             
 }                                                                                           
                                                                                             
-vec4 CalcSpotLight(SpotLight l, vec3 Normal, vec4 LightSpacePos)                     
+vec4 CalcSpotLight(SpotLight l, vec3 Normal, int Index)                         
 {                                                                                           
     vec3 LightToPixel = normalize(WorldPos0 - l.Base.Position);                             
     float SpotFactor = dot(LightToPixel, l.Direction);                                      
                                                                                             
     if (SpotFactor > l.Cutoff) {                                                            
-        vec4 Color = CalcPointLight(l.Base, Normal, LightSpacePos);                         
+        vec4 Color = CalcPointLight(l.Base, Normal, CalcShadowFactor(Index));                         
         return Color * (1.0 - (1.0 - SpotFactor) * 1.0/(1.0 - l.Cutoff));                   
     }                                                                                       
     else {                                                                                  
@@ -133,11 +144,11 @@ void main()
     vec4 TotalLight = CalcDirectionalLight(Normal);                                         
                                                                                             
     for (int i = 0 ; i < gNumPointLights ; i++) {                                           
-        TotalLight += CalcPointLight(gPointLights[i], Normal, LightSpacePos);               
+        TotalLight += CalcPointLight(gPointLights[i], Normal, 1.0);               
     }                                                                                       
                                                                                             
     for (int i = 0 ; i < gNumSpotLights ; i++) {                                            
-        TotalLight += CalcSpotLight(gSpotLights[i], Normal, LightSpacePos);                 
+        TotalLight += CalcSpotLight(gSpotLights[i], Normal, i);                 
     }                                                                                       
                                                                                             
     vec4 SampledColor = texture2D(gSampler, TexCoord0.xy);                                  
@@ -48,7 +48,6 @@ bool LightingTechnique::Init()
     }
 
     m_WVPLocation = GetUniformLocation("gWVP");
-    m_LightWVPLocation = GetUniformLocation("gLightWVP");
     m_WorldMatrixLocation = GetUniformLocation("gWorld");
     m_samplerLocation = GetUniformLocation("gSampler");
     m_shadowMapLocation = GetUniformLocation("gShadowMap");
@@ -64,7 +63,6 @@ bool LightingTechnique::Init()
 
     if (m_dirLightLocation.AmbientIntensity == INVALID_UNIFORM_LOCATION ||
         m_WVPLocation == INVALID_UNIFORM_LOCATION ||
-        m_LightWVPLocation == INVALID_UNIFORM_LOCATION ||
         m_WorldMatrixLocation == INVALID_UNIFORM_LOCATION ||
         m_samplerLocation == INVALID_UNIFORM_LOCATION ||
         m_shadowMapLocation == INVALID_UNIFORM_LOCATION ||
@@ -145,6 +143,12 @@ bool LightingTechnique::Init()
         SNPRINTF(Name, sizeof(Name), "gSpotLights[%d].Base.Atten.Exp", i);
         m_spotLightsLocation[i].Atten.Exp = GetUniformLocation(Name);
 
+        SNPRINTF(Name, sizeof(Name), "gSpotLightVP[%d]", i);
+        m_spotLightsLocation[i].LightVP = GetUniformLocation(Name);
+
+        SNPRINTF(Name, sizeof(Name), "gSpotShadowTile[%d]", i);
+        m_spotLightsLocation[i].ShadowTile = GetUniformLocation(Name);
+
         if (m_spotLightsLocation[i].Color == INVALID_UNIFORM_LOCATION ||
             m_spotLightsLocation[i].AmbientIntensity == INVALID_UNIFORM_LOCATION ||
             m_spotLightsLocation[i].Position == INVALID_UNIFORM_LOCATION ||
@@ -153,7 +157,9 @@ bool LightingTechnique::Init()
             m_spotLightsLocation[i].DiffuseIntensity == INVALID_UNIFORM_LOCATION ||
             m_spotLightsLocation[i].Atten.Constant == INVALID_UNIFORM_LOCATION ||
             m_spotLightsLocation[i].Atten.Linear == INVALID_UNIFORM_LOCATION ||
-            m_spotLightsLocation[i].Atten.Exp == INVALID_UNIFORM_LOCATION) {
+            m_spotLightsLocation[i].Atten.Exp == INVALID_UNIFORM_LOCATION ||
+            m_spotLightsLocation[i].LightVP == INVALID_UNIFORM_LOCATION ||
+            m_spotLightsLocation[i].ShadowTile == INVALID_UNIFORM_LOCATION) {
             return false;
         }
     }
@@ -168,11 +174,6 @@ void LightingTechnique::SetWVP(const Matrix4f& WVP)
 }
 
 
-void LightingTechnique::SetLightWVP(const Matrix4f& LightWVP)
-{
-    glUniformMatrix4fv(m_LightWVPLocation, 1, GL_TRUE, (const GLfloat*)LightWVP.m);
-}
-
 
 void LightingTechnique::SetWorldMatrix(const Matrix4f& WorldInverse)
 {
@@ -254,4 +255,11 @@ void LightingTechnique::SetSpotLights(uint NumLights, const SpotLight* pLights)
         glUniform1f(m_spotLightsLocation[i].Atten.Linear,   pLights[i].Attenuation.Linear);
         glUniform1f(m_spotLightsLocation[i].Atten.Exp,      pLights[i].Attenuation.Exp);
     }
-}
\ No newline at end of file
+}
+
+
+void LightingTechnique::SetSpotLightShadow(uint LightIndex, const Matrix4f& LightVP, const Vector4f& TileRect)
+{
+    glUniformMatrix4fv(m_spotLightsLocation[LightIndex].LightVP, 1, GL_TRUE, (const GLfloat*)LightVP.m);
+    glUniform4f(m_spotLightsLocation[LightIndex].ShadowTile, TileRect.x, TileRect.y, TileRect.z, TileRect.w);
+}
@@ -30,20 +30,21 @@ class LightingTechnique : public Technique {
 public:
 
     static const unsigned int MAX_POINT_LIGHTS = 2;
-    static const unsigned int MAX_SPOT_LIGHTS = 2;
+    static const unsigned int MAX_SPOT_LIGHTS = 16;
 
     LightingTechnique();
 
     virtual bool Init();
 
     void SetWVP(const Matrix4f& WVP);
-    void SetLightWVP(const Matrix4f& LightWVP);
     void SetWorldMatrix(const Matrix4f& WVP);
     void SetTextureUnit(unsigned int TextureUnit);
     void SetShadowMapTextureUnit(unsigned int TextureUnit);
     void SetDirectionalLight(const DirectionalLight& Light);
     void SetPointLights(unsigned int NumLights, const PointLight* pLights);
     void SetSpotLights(unsigned int NumLights, const SpotLight* pLights);
+    // TileRect is the offset (xy) and scale (zw) of the shadow atlas tile of the light. A zero scale disables the shadow.
+    void SetSpotLightShadow(unsigned int LightIndex, const Matrix4f& LightVP, const Vector4f& TileRect);
     void SetEyeWorldPos(const Vector3f& EyeWorldPos);
     void SetMatSpecularIntensity(float Intensity);
     void SetMatSpecularPower(float Power);
@@ -51,7 +52,6 @@ public:
 private:
 
     GLuint m_WVPLocation;
-    GLuint m_LightWVPLocation;
     GLuint m_WorldMatrixLocation;
     GLuint m_samplerLocation;
     GLuint m_shadowMapLocation;
@@ -87,6 +87,8 @@ private:
         GLuint Position;
         GLuint Direction;
         GLuint Cutoff;
+        GLuint LightVP;
+        GLuint ShadowTile;
         struct {
             GLuint Constant;
             GLuint Linear;
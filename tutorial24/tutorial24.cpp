@@ -28,6 +28,7 @@
 #include "ogldev_texture.h"
 #include "ogldev_lights_common.h"
 #include "ogldev_app.h"
+#include "ogldev_shadow_atlas.h"
 #include "lighting_technique.h"
 #include "mesh.h"
 #include "shadow_map_technique.h"
@@ -36,6 +37,13 @@
 #define WINDOW_WIDTH  1920
 #define WINDOW_HEIGHT 1200
 
+#define NUM_SPOT_LIGHTS LightingTechnique::MAX_SPOT_LIGHTS
+
+#define SHADOW_ATLAS_SIZE     4096
+#define SHADOW_MIN_TILE_SIZE  128
+#define SHADOW_MAX_TILE_SIZE  1024
+#define SPOT_LIGHT_RADIUS     10.0f     // size of the lit area used for the atlas importance
+
 
 class Tutorial24 : public ICallbacks, public OgldevApp
 {
@@ -51,19 +59,38 @@ public:
         m_scale = 0.0f;
         m_pGroundTex = NULL;
 
-        m_spotLight.AmbientIntensity = 0.1f;
-        m_spotLight.DiffuseIntensity = 0.9f;
-        m_spotLight.Color = Vector3f(1.0f, 1.0f, 1.0f);
-        m_spotLight.Attenuation.Linear = 0.01f;
-        m_spotLight.Position  = Vector3f(-20.0, 20.0, 1.0f);
-        m_spotLight.Direction = Vector3f(1.0f, -1.0f, 0.0f);
-        m_spotLight.Cutoff =  20.0f;
+        m_spotLights[0].AmbientIntensity = 0.1f;
+        m_spotLights[0].DiffuseIntensity = 0.9f;
+        m_spotLights[0].Color = Vector3f(1.0f, 1.0f, 1.0f);
+        m_spotLights[0].Attenuation.Linear = 0.01f;
+        m_spotLights[0].Position  = Vector3f(-20.0, 20.0, 1.0f);
+        m_spotLights[0].Direction = Vector3f(1.0f, -1.0f, 0.0f);
+        m_spotLights[0].Cutoff =  20.0f;
+
+        // The rest of the lights are on a ring around the mesh and each one
+        // lights a different part of the ground
+        for (uint i = 1 ; i < NUM_SPOT_LIGHTS ; i++) {
+            float Angle = ToRadian(360.0f * i / (NUM_SPOT_LIGHTS - 1));
+            Vector3f Target(6.0f * cosf(Angle), 0.0f, 3.0f + 6.0f * sinf(Angle));
+
+            m_spotLights[i].AmbientIntensity = 0.0f;
+            m_spotLights[i].DiffuseIntensity = 0.5f;
+            m_spotLights[i].Color = Vector3f(RandomFloat(), RandomFloat(), RandomFloat());
+            m_spotLights[i].Attenuation.Linear = 0.01f;
+            m_spotLights[i].Position  = Vector3f(15.0f * cosf(Angle), 12.0f, 3.0f + 15.0f * sinf(Angle));
+            m_spotLights[i].Direction = Target - m_spotLights[i].Position;
+            m_spotLights[i].Cutoff =  20.0f;
+        }
 
         m_persProjInfo.FOV = 60.0f;
         m_persProjInfo.Height = WINDOW_HEIGHT;
         m_persProjInfo.Width = WINDOW_WIDTH;
         m_persProjInfo.zNear = 1.0f;
         m_persProjInfo.zFar = 50.0f;
+
+        // The atlas tiles are square
+        m_shadowProjInfo = m_persProjInfo;
+        m_shadowProjInfo.Width = m_shadowProjInfo.Height = 1.0f;
     }
 
 
@@ -84,7 +111,7 @@ public:
         Vector3f Target(0.0f, -0.2f, 1.0f);
         Vector3f Up(0.0, 1.0f, 0.0f);
 
-        if (!m_shadowMapFBO.Init(WINDOW_WIDTH, WINDOW_HEIGHT)) {
+        if (!m_shadowAtlas.Init(SHADOW_ATLAS_SIZE, SHADOW_MIN_TILE_SIZE, SHADOW_MAX_TILE_SIZE, NUM_SPOT_LIGHTS)) {
             return false;
         }
 
@@ -98,7 +125,7 @@ public:
         }
 
         m_pLightingEffect->Enable();
-        m_pLightingEffect->SetSpotLights(1, &m_spotLight);
+        m_pLightingEffect->SetSpotLights(NUM_SPOT_LIGHTS, m_spotLights);
         m_pLightingEffect->SetTextureUnit(0);
         m_pLightingEffect->SetShadowMapTextureUnit(1);
 
@@ -145,9 +172,29 @@ public:
     }
 
 
+    // The tile sizes follow the fraction of the screen covered by the lit
+    // area of every light so nearby lights get sharper shadows
+    void AllocateShadowTiles()
+    {
+        float Importance[NUM_SPOT_LIGHTS];
+        float TanHalfFOV = tanf(ToRadian(m_persProjInfo.FOV / 2.0f));
+
+        for (uint i = 0 ; i < NUM_SPOT_LIGHTS ; i++) {
+            float Distance = (m_spotLights[i].Position - m_pGameCamera->GetPos()).Length();
+            Importance[i] = MIN(SPOT_LIGHT_RADIUS / (MAX(Distance, 1.0f) * TanHalfFOV), 1.0f);
+        }
+
+        m_shadowAtlas.Allocate(Importance, NUM_SPOT_LIGHTS);
+    }
+
+
+    // All the shadow maps are rendered into a single FBO. Each light only
+    // changes the viewport to its tile.
     void ShadowMapPass()
     {
-        m_shadowMapFBO.BindForWriting();
+        AllocateShadowTiles();
+
+        m_shadowAtlas.BindForWriting();
 
         glClear(GL_DEPTH_BUFFER_BIT);
 
@@ -157,12 +204,21 @@ public:
         p.Scale(0.1f, 0.1f, 0.1f);
         p.Rotate(0.0f, m_scale, 0.0f);
         p.WorldPos(0.0f, 0.0f, 3.0f);
-        p.SetCamera(m_spotLight.Position, m_spotLight.Direction, Vector3f(0.0f, 1.0f, 0.0f));
-        p.SetPerspectiveProj(m_persProjInfo);
-        m_pShadowMapEffect->SetWVP(p.GetWVPTrans());
-        m_pMesh->Render();
+        p.SetPerspectiveProj(m_shadowProjInfo);
+
+        for (uint i = 0 ; i < NUM_SPOT_LIGHTS ; i++) {
+            if (m_shadowAtlas.GetTile(i).Size == 0) {
+                continue;
+            }
+
+            m_shadowAtlas.SetViewport(i);
+            p.SetCamera(m_spotLights[i].Position, m_spotLights[i].Direction, Vector3f(0.0f, 1.0f, 0.0f));
+            m_pShadowMapEffect->SetWVP(p.GetWVPTrans());
+            m_pMesh->Render();
+        }
 
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
     }
 
 
@@ -174,30 +230,33 @@ public:
 
         m_pLightingEffect->SetEyeWorldPos(m_pGameCamera->GetPos());
 
-        m_shadowMapFBO.BindForReading(GL_TEXTURE1);
+        m_shadowAtlas.BindForReading(GL_TEXTURE1);
 
+        // The light matrices are in world space so they are shared by all the meshes
         Pipeline p;
+        p.SetPerspectiveProj(m_shadowProjInfo);
+
+        for (uint i = 0 ; i < NUM_SPOT_LIGHTS ; i++) {
+            p.SetCamera(m_spotLights[i].Position, m_spotLights[i].Direction, Vector3f(0.0f, 1.0f, 0.0f));
+            m_pLightingEffect->SetSpotLightShadow(i, p.GetVPTrans(), m_shadowAtlas.GetTileUVRect(i));
+        }
+
         p.SetPerspectiveProj(m_persProjInfo);
+        p.SetCamera(m_pGameCamera->GetPos(), m_pGameCamera->GetTarget(), m_pGameCamera->GetUp());
 
         p.Scale(10.0f, 10.0f, 10.0f);
         p.WorldPos(0.0f, 0.0f, 1.0f);
         p.Rotate(90.0f, 0.0f, 0.0f);
-        p.SetCamera(m_pGameCamera->GetPos(), m_pGameCamera->GetTarget(), m_pGameCamera->GetUp());
         m_pLightingEffect->SetWVP(p.GetWVPTrans());
         m_pLightingEffect->SetWorldMatrix(p.GetWorldTrans());
-        p.SetCamera(m_spotLight.Position, m_spotLight.Direction, Vector3f(0.0f, 1.0f, 0.0f));
-        m_pLightingEffect->SetLightWVP(p.GetWVPTrans());
         m_pGroundTex->Bind(GL_TEXTURE0);
         m_pQuad->Render();
 
         p.Scale(0.1f, 0.1f, 0.1f);
         p.Rotate(0.0f, m_scale, 0.0f);
         p.WorldPos(0.0f, 0.0f, 3.0f);
-        p.SetCamera(m_pGameCamera->GetPos(), m_pGameCamera->GetTarget(), m_pGameCamera->GetUp());
         m_pLightingEffect->SetWVP(p.GetWVPTrans());
         m_pLightingEffect->SetWorldMatrix(p.GetWorldTrans());
-        p.SetCamera(m_spotLight.Position, m_spotLight.Direction, Vector3f(0.0f, 1.0f, 0.0f));
-        m_pLightingEffect->SetLightWVP(p.GetWVPTrans());
         m_pMesh->Render();
     }
 
@@ -226,12 +285,13 @@ public:
     ShadowMapTechnique* m_pShadowMapEffect;
     Camera* m_pGameCamera;
     float m_scale;
-    SpotLight m_spotLight;
+    SpotLight m_spotLights[NUM_SPOT_LIGHTS];
     Mesh* m_pMesh;
     Mesh* m_pQuad;
     Texture* m_pGroundTex;
-    ShadowMapFBO m_shadowMapFBO;
+    ShadowAtlas m_shadowAtlas;
     PersProjInfo m_persProjInfo;
+    PersProjInfo m_shadowProjInfo;
 };
 
 
@@ -0,0 +1,19 @@
+#version 330
+
+uniform sampler2D gColorMap;
+
+in vec2 TexCoord;
+in vec4 Color;
+
+out vec4 FragColor;
+
+void main()
+{
+    FragColor = texture2D(gColorMap, TexCoord);
+
+    if (FragColor.r == 0 && FragColor.g == 0 && FragColor.b == 0) {
+        discard;
+    }
+
+    FragColor *= Color;
+}
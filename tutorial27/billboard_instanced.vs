@@ -0,0 +1,43 @@
+#version 430
+
+// BillboardInstance of InstancedBillboardList - 6 words per billboard:
+// position, size, RGBA8 color and atlas index
+layout (std430, binding = 0) readonly buffer InstanceBuffer {
+    uint gInstances[];
+};
+
+uniform mat4 gVP;
+uniform vec3 gCameraPos;
+uniform uint gFirstInstance;    // region of the current frame
+uniform uvec2 gAtlasSize;       // columns, rows
+
+out vec2 TexCoord;
+out vec4 Color;
+
+// Triangle strip in the same order as billboard.gs. x is along the right
+// vector and y is up, both in units of the billboard size.
+const vec2 Corners[4] = vec2[](vec2(-0.5, 0.0), vec2(-0.5, 1.0), vec2(0.5, 0.0), vec2(0.5, 1.0));
+
+void main()
+{
+    uint Base = (gFirstInstance + uint(gl_InstanceID)) * 6u;
+
+    vec3 Pos = vec3(uintBitsToFloat(gInstances[Base]),
+                    uintBitsToFloat(gInstances[Base + 1u]),
+                    uintBitsToFloat(gInstances[Base + 2u]));
+    float Size = uintBitsToFloat(gInstances[Base + 3u]);
+    uint AtlasIndex = gInstances[Base + 5u];
+
+    vec3 toCamera = normalize(gCameraPos - Pos);
+    vec3 up = vec3(0.0, 1.0, 0.0);
+    vec3 right = cross(toCamera, up);
+
+    vec2 Corner = Corners[gl_VertexID];
+    Pos += (right * Corner.x + up * Corner.y) * Size;
+    gl_Position = gVP * vec4(Pos, 1.0);
+
+    vec2 AtlasCell = vec2(AtlasIndex % gAtlasSize.x, AtlasIndex / gAtlasSize.x);
+    TexCoord = (AtlasCell + vec2(Corner.x + 0.5, Corner.y)) / vec2(gAtlasSize);
+
+    Color = unpackUnorm4x8(gInstances[Base + 4u]);
+}
@@ -22,12 +22,18 @@
 
 #define NUM_ROWS 10
 #define NUM_COLUMNS 10
+#define NUM_BILLBOARDS (NUM_ROWS * NUM_COLUMNS)
+
+// Must match local_size_x in billboard_sort_keys.cs
+#define SORT_KEYS_GROUP_SIZE 64
 
 
 BillboardList::BillboardList()
 {
     m_pTexture = NULL;
     m_VB = INVALID_OGL_VALUE;
+    m_depthSorted = false;
+    m_isSortAvailable = false;
 }
 
 
@@ -52,9 +58,17 @@ bool BillboardList::Init(const std::string& TexFilename)
 
     CreatePositionBuffer();
     
-    if (!m_technique.Init()) {
+    if (!m_technique.Init() || !m_blendTechnique.InitBlended()) {
         return false;
     }
+
+    // The depth sort runs in compute shaders (OpenGL 4.3). Without them the
+    // billboards are only rendered alpha tested.
+    m_isSortAvailable = m_sortKeysTech.Init() && m_sorter.Init(NUM_BILLBOARDS);
+
+    if (!m_isSortAvailable) {
+        printf("Warning! Cannot initialize the billboard depth sort - sorting is disabled\n");
+    }
     
     return true;
 }
@@ -62,7 +76,7 @@ bool BillboardList::Init(const std::string& TexFilename)
 
 void BillboardList::CreatePositionBuffer()
 {    
-    Vector3f Positions[NUM_ROWS * NUM_COLUMNS];
+    Vector3f Positions[NUM_BILLBOARDS];
     
     for (unsigned int j = 0 ; j < NUM_ROWS ; j++) {
         for (unsigned int i = 0 ; i < NUM_COLUMNS ; i++) {
@@ -77,11 +91,34 @@ void BillboardList::CreatePositionBuffer()
 }
 
 
+void BillboardList::SortByDepth(const Vector3f& CameraPos)
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_VB);
+    m_sorter.Bind();
+
+    m_sortKeysTech.Enable();
+    m_sortKeysTech.SetCameraPosition(CameraPos);
+    m_sortKeysTech.SetNumBillboards(NUM_BILLBOARDS);
+    glDispatchCompute((NUM_BILLBOARDS + SORT_KEYS_GROUP_SIZE - 1) / SORT_KEYS_GROUP_SIZE, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    m_sorter.Sort();
+
+    glMemoryBarrier(GL_ELEMENT_ARRAY_BARRIER_BIT);
+}
+
+
 void BillboardList::Render(const Matrix4f& VP, const Vector3f& CameraPos)
 {
-    m_technique.Enable();
-    m_technique.SetVP(VP);
-    m_technique.SetCameraPosition(CameraPos);
+    if (m_depthSorted) {
+        SortByDepth(CameraPos);
+    }
+
+    BillboardTechnique& Tech = m_depthSorted ? m_blendTechnique : m_technique;
+
+    Tech.Enable();
+    Tech.SetVP(VP);
+    Tech.SetCameraPosition(CameraPos);
     
     m_pTexture->Bind(COLOR_TEXTURE_UNIT);
     
@@ -90,7 +127,21 @@ void BillboardList::Render(const Matrix4f& VP, const Vector3f& CameraPos)
     glBindBuffer(GL_ARRAY_BUFFER, m_VB);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);   // position
     
-    glDrawArrays(GL_POINTS, 0, NUM_ROWS * NUM_COLUMNS);
+    if (m_depthSorted) {
+        // The first NUM_BILLBOARDS values of the sorter are the billboard
+        // indices in back to front order
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_sorter.GetValueBuffer());
+        glDrawElements(GL_POINTS, NUM_BILLBOARDS, GL_UNSIGNED_INT, NULL);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+        glDisable(GL_BLEND);
+    }
+    else {
+        glDrawArrays(GL_POINTS, 0, NUM_BILLBOARDS);
+    }
     
     glDisableVertexAttribArray(0);
 }
\ No newline at end of file
@@ -23,6 +23,7 @@
 
 #include "ogldev_texture.h"
 #include "billboard_technique.h"
+#include "ogldev_gpu_sort.h"
 
 class BillboardList
 {
@@ -34,12 +35,27 @@ public:
     
     void Render(const Matrix4f& VP, const Vector3f& CameraPos);
 
+    // Sorted billboards are alpha blended back to front. The order is
+    // computed on the GPU every frame. Ignored if the sort is not available.
+    void SetDepthSorted(bool DepthSorted) { m_depthSorted = DepthSorted && m_isSortAvailable; }
+
+    bool IsDepthSorted() const { return m_depthSorted; }
+
+    bool IsSortAvailable() const { return m_isSortAvailable; }
+
 private:
     void CreatePositionBuffer();
+
+    void SortByDepth(const Vector3f& CameraPos);
     
     GLuint m_VB;
     Texture* m_pTexture;
     BillboardTechnique m_technique;
+    BillboardTechnique m_blendTechnique;
+    BillboardSortKeysTechnique m_sortKeysTech;
+    GPUBitonicSort m_sorter;
+    bool m_depthSorted;
+    bool m_isSortAvailable;
 };
 
 
@@ -0,0 +1,36 @@
+#version 430
+
+layout (local_size_x = 64) in;
+
+// The vertex buffer of the billboards - tightly packed vec3 positions
+layout (std430, binding = 0) readonly buffer PositionBuffer {
+    float gPositions[];
+};
+
+// Bindings of GPUBitonicSort
+layout (std430, binding = 6) writeonly buffer KeyBuffer {
+    float gKeys[];
+};
+
+layout (std430, binding = 7) readonly buffer ValueBuffer {
+    uint gValues[];
+};
+
+uniform vec3 gCameraPos;
+uniform uint gNumBillboards;
+
+// The farthest billboards get the smallest keys so an ascending sort gives
+// back to front order
+void main()
+{
+    uint i = gl_GlobalInvocationID.x;
+
+    if (i >= gNumBillboards) {
+        return;
+    }
+
+    uint Index = gValues[i] * 3u;
+    vec3 Pos = vec3(gPositions[Index], gPositions[Index + 1u], gPositions[Index + 2u]);
+    vec3 ToCamera = Pos - gCameraPos;
+    gKeys[i] = -dot(ToCamera, ToCamera);
+}
@@ -25,6 +25,18 @@ BillboardTechnique::BillboardTechnique()
  
 
 bool BillboardTechnique::Init()
+{
+    return InitCommon("billboard.fs");
+}
+
+
+bool BillboardTechnique::InitBlended()
+{
+    return InitCommon("billboard_blend.fs");
+}
+
+
+bool BillboardTechnique::InitCommon(const char* pFSFilename)
 {
     if (!Technique::Init()) {
         return false;
@@ -38,7 +50,7 @@ bool BillboardTechnique::Init()
         return false;
     }
     
-    if (!AddShader(GL_FRAGMENT_SHADER, "billboard.fs")) {
+    if (!AddShader(GL_FRAGMENT_SHADER, pFSFilename)) {
         return false;
     }
 
@@ -76,3 +88,117 @@ void BillboardTechnique::SetColorTextureUnit(unsigned int TextureUnit)
 {
     glUniform1i(m_colorMapLocation, TextureUnit);
 }
+
+
+BillboardSortKeysTechnique::BillboardSortKeysTechnique()
+{
+}
+
+
+bool BillboardSortKeysTechnique::Init()
+{
+    if (!Technique::Init()) {
+        return false;
+    }
+
+    if (!AddShader(GL_COMPUTE_SHADER, "billboard_sort_keys.cs")) {
+        return false;
+    }
+
+    if (!Finalize()) {
+        return false;
+    }
+
+    m_cameraPosLocation = GetUniformLocation("gCameraPos");
+    m_numBillboardsLocation = GetUniformLocation("gNumBillboards");
+
+    if (m_cameraPosLocation == INVALID_UNIFORM_LOCATION ||
+        m_numBillboardsLocation == INVALID_UNIFORM_LOCATION) {
+        return false;
+    }
+
+    return true;
+}
+
+
+void BillboardSortKeysTechnique::SetCameraPosition(const Vector3f& Pos)
+{
+    glUniform3f(m_cameraPosLocation, Pos.x, Pos.y, Pos.z);
+}
+
+
+void BillboardSortKeysTechnique::SetNumBillboards(uint NumBillboards)
+{
+    glUniform1ui(m_numBillboardsLocation, NumBillboards);
+}
+
+
+InstancedBillboardTechnique::InstancedBillboardTechnique()
+{
+}
+
+
+bool InstancedBillboardTechnique::Init()
+{
+    if (!Technique::Init()) {
+        return false;
+    }
+
+    if (!AddShader(GL_VERTEX_SHADER, "billboard_instanced.vs")) {
+        return false;
+    }
+
+    if (!AddShader(GL_FRAGMENT_SHADER, "billboard_instanced.fs")) {
+        return false;
+    }
+
+    if (!Finalize()) {
+        return false;
+    }
+
+    m_VPLocation = GetUniformLocation("gVP");
+    m_cameraPosLocation = GetUniformLocation("gCameraPos");
+    m_colorMapLocation = GetUniformLocation("gColorMap");
+    m_firstInstanceLocation = GetUniformLocation("gFirstInstance");
+    m_atlasSizeLocation = GetUniformLocation("gAtlasSize");
+
+    if (m_VPLocation == INVALID_UNIFORM_LOCATION ||
+        m_cameraPosLocation == INVALID_UNIFORM_LOCATION ||
+        m_colorMapLocation == INVALID_UNIFORM_LOCATION ||
+        m_firstInstanceLocation == INVALID_UNIFORM_LOCATION ||
+        m_atlasSizeLocation == INVALID_UNIFORM_LOCATION) {
+        return false;
+    }
+
+    return true;
+}
+
+
+void InstancedBillboardTechnique::SetVP(const Matrix4f& VP)
+{
+    glUniformMatrix4fv(m_VPLocation, 1, GL_TRUE, (const GLfloat*)VP.m);
+}
+
+
+void InstancedBillboardTechnique::SetCameraPosition(const Vector3f& Pos)
+{
+    glUniform3f(m_cameraPosLocation, Pos.x, Pos.y, Pos.z);
+}
+
+
+void InstancedBillboardTechnique::SetColorTextureUnit(unsigned int TextureUnit)
+{
+    glUniform1i(m_colorMapLocation, TextureUnit);
+}
+
+
+void InstancedBillboardTechnique::SetFirstInstance(uint FirstInstance)
+{
+    glUniform1ui(m_firstInstanceLocation, FirstInstance);
+}
+
+
+void InstancedBillboardTechnique::SetAtlasSize(uint Columns, uint Rows)
+{
+    glUniform2ui(m_atlasSizeLocation, Columns, Rows);
+}
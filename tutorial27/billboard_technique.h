@@ -28,16 +28,69 @@ public:
     BillboardTechnique();
  
     virtual bool Init();
+
+    // No alpha test - the billboards are alpha blended in back to front order
+    bool InitBlended();
     
     void SetVP(const Matrix4f& VP);
     void SetCameraPosition(const Vector3f& Pos);
     void SetColorTextureUnit(unsigned int TextureUnit);
     
+private:
+
+    bool InitCommon(const char* pFSFilename);
+
+    GLuint m_VPLocation;
+    GLuint m_cameraPosLocation;
+    GLuint m_colorMapLocation;
+};
+
+
+// Writes the sort keys (negative squared distance from the camera) of the
+// billboards in the sort list of GPUBitonicSort. The positions are read
+// from the vertex buffer of the billboards.
+class BillboardSortKeysTechnique : public Technique
+{
+public:
+
+    BillboardSortKeysTechnique();
+
+    virtual bool Init();
+
+    void SetCameraPosition(const Vector3f& Pos);
+
+    void SetNumBillboards(uint NumBillboards);
+
+private:
+
+    GLuint m_cameraPosLocation;
+    GLuint m_numBillboardsLocation;
+};
+
+
+// Builds the billboard quads in the vertex shader from the instance data
+// of InstancedBillboardList
+class InstancedBillboardTechnique : public Technique
+{
+public:
+
+    InstancedBillboardTechnique();
+
+    virtual bool Init();
+
+    void SetVP(const Matrix4f& VP);
+    void SetCameraPosition(const Vector3f& Pos);
+    void SetColorTextureUnit(unsigned int TextureUnit);
+    void SetFirstInstance(uint FirstInstance);
+    void SetAtlasSize(uint Columns, uint Rows);
+
 private:
 
     GLuint m_VPLocation;
     GLuint m_cameraPosLocation;
     GLuint m_colorMapLocation;
+    GLuint m_firstInstanceLocation;
+    GLuint m_atlasSizeLocation;
 };
 
 #endif	/* BILLBOARD_TECHNIQUE_H */
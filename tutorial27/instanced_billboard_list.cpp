@@ -0,0 +1,314 @@
+/*
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <math.h>
+#include <string.h>
+
+#include "ogldev_util.h"
+#include "ogldev_engine_common.h"
+#include "instanced_billboard_list.h"
+
+#define FENCE_TIMEOUT_NANOS 1000000000
+
+
+InstancedBillboardList::InstancedBillboardList()
+{
+    m_maxBillboards = 0;
+    m_cellSize = 1.0f;
+    m_numVisible = 0;
+    m_frameCount = 0;
+    m_instanceBuffer = INVALID_OGL_VALUE;
+    m_pMappedInstances = NULL;
+    m_VAO = 0;
+    m_pTexture = NULL;
+
+    for (uint i = 0 ; i < NUM_REGIONS ; i++) {
+        m_fences[i] = 0;
+    }
+}
+
+
+InstancedBillboardList::~InstancedBillboardList()
+{
+    SAFE_DELETE(m_pTexture);
+
+    for (uint i = 0 ; i < NUM_REGIONS ; i++) {
+        if (m_fences[i]) {
+            glDeleteSync(m_fences[i]);
+        }
+    }
+
+    if (m_instanceBuffer != INVALID_OGL_VALUE) {
+        if (m_pMappedInstances) {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_instanceBuffer);
+            glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+        }
+
+        glDeleteBuffers(1, &m_instanceBuffer);
+    }
+
+    if (m_VAO != 0) {
+        glDeleteVertexArrays(1, &m_VAO);
+    }
+}
+
+
+bool InstancedBillboardList::Init(const string& TexFilename, uint AtlasColumns, uint AtlasRows,
+                                  uint MaxBillboards, float CellSize)
+{
+    m_maxBillboards = MaxBillboards;
+    m_cellSize = CellSize;
+
+    // The instances live in a persistently mapped shader storage buffer
+    if (!GLEW_VERSION_4_4 && !GLEW_ARB_buffer_storage) {
+        printf("Instanced billboards need GL_ARB_buffer_storage\n");
+        return false;
+    }
+
+    if (!GLEW_VERSION_4_3 && !GLEW_ARB_shader_storage_buffer_object) {
+        printf("Instanced billboards need GL_ARB_shader_storage_buffer_object\n");
+        return false;
+    }
+
+    m_pTexture = new Texture(GL_TEXTURE_2D, TexFilename.c_str());
+
+    if (!m_pTexture->Load()) {
+        return false;
+    }
+
+    GLsizeiptr BufferSize = sizeof(BillboardInstance) * MaxBillboards * NUM_REGIONS;
+    GLbitfield Flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    glGenBuffers(1, &m_instanceBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_instanceBuffer);
+    glBufferStorage(GL_SHADER_STORAGE_BUFFER, BufferSize, NULL, Flags);
+    m_pMappedInstances = (BillboardInstance*)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, BufferSize, Flags);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    if (!m_pMappedInstances) {
+        printf("Error mapping the billboard instance buffer\n");
+        return false;
+    }
+
+    // The quads are built from gl_VertexID and the instance data but a VAO
+    // must still be bound
+    glGenVertexArrays(1, &m_VAO);
+
+    if (!m_technique.Init()) {
+        return false;
+    }
+
+    m_technique.Enable();
+    m_technique.SetColorTextureUnit(COLOR_TEXTURE_UNIT_INDEX);
+    m_technique.SetAtlasSize(AtlasColumns, AtlasRows);
+
+    return GLCheckError();
+}
+
+
+uint InstancedBillboardList::GetCell(const Vector3f& Pos)
+{
+    int x = (int)floorf(Pos.x / m_cellSize);
+    int z = (int)floorf(Pos.z / m_cellSize);
+    long long Key = ((long long)x << 32) | (unsigned int)z;
+
+    map<long long, uint>::const_iterator it = m_cellMap.find(Key);
+
+    if (it != m_cellMap.end()) {
+        return it->second;
+    }
+
+    Cell NewCell;
+    NewCell.Min = Vector3f(INFINITY, INFINITY, INFINITY);
+    NewCell.Max = Vector3f(-INFINITY, -INFINITY, -INFINITY);
+
+    uint CellIndex = (uint)m_cells.size();
+    m_cells.push_back(NewCell);
+    m_cellMap[Key] = CellIndex;
+
+    return CellIndex;
+}
+
+
+void InstancedBillboardList::AddToCell(uint Handle, uint CellIndex, const BillboardInstance& Billboard)
+{
+    Cell& c = m_cells[CellIndex];
+
+    m_locations[Handle].Cell = CellIndex;
+    m_locations[Handle].Slot = (uint)c.Billboards.size();
+
+    c.Billboards.push_back(Billboard);
+    c.Handles.push_back(Handle);
+
+    GrowBounds(c, Billboard);
+}
+
+
+// The quad extends Size/2 to the sides and Size up
+void InstancedBillboardList::GrowBounds(Cell& c, const BillboardInstance& Billboard)
+{
+    float HalfSize = Billboard.Size * 0.5f;
+    c.Min.x = MIN(c.Min.x, Billboard.Pos.x - HalfSize);
+    c.Min.y = MIN(c.Min.y, Billboard.Pos.y);
+    c.Min.z = MIN(c.Min.z, Billboard.Pos.z - HalfSize);
+    c.Max.x = MAX(c.Max.x, Billboard.Pos.x + HalfSize);
+    c.Max.y = MAX(c.Max.y, Billboard.Pos.y + Billboard.Size);
+    c.Max.z = MAX(c.Max.z, Billboard.Pos.z + HalfSize);
+}
+
+
+// The last billboard of the cell takes the place of the removed one
+void InstancedBillboardList::RemoveFromCell(uint Handle)
+{
+    Location& l = m_locations[Handle];
+    Cell& c = m_cells[l.Cell];
+
+    uint LastSlot = (uint)c.Billboards.size() - 1;
+
+    if (l.Slot != LastSlot) {
+        c.Billboards[l.Slot] = c.Billboards[LastSlot];
+        c.Handles[l.Slot] = c.Handles[LastSlot];
+        m_locations[c.Handles[l.Slot]].Slot = l.Slot;
+    }
+
+    c.Billboards.pop_back();
+    c.Handles.pop_back();
+}
+
+
+uint InstancedBillboardList::AddBillboard(const BillboardInstance& Billboard)
+{
+    if (m_locations.size() >= m_maxBillboards) {
+        return INVALID_BILLBOARD;
+    }
+
+    uint Handle = (uint)m_locations.size();
+    m_locations.push_back(Location());
+
+    AddToCell(Handle, GetCell(Billboard.Pos), Billboard);
+
+    return Handle;
+}
+
+
+void InstancedBillboardList::UpdateBillboard(uint Handle, const BillboardInstance& Billboard)
+{
+    uint CellIndex = GetCell(Billboard.Pos);
+    Location& l = m_locations[Handle];
+
+    if (CellIndex == l.Cell) {
+        m_cells[CellIndex].Billboards[l.Slot] = Billboard;
+        GrowBounds(m_cells[CellIndex], Billboard);
+    }
+    else {
+        RemoveFromCell(Handle);
+        AddToCell(Handle, CellIndex, Billboard);
+    }
+}
+
+
+// Gribb/Hartmann extraction. The planes are not normalized - only the sign
+// of the distance is used.
+void InstancedBillboardList::CalcFrustumPlanes(const Matrix4f& VP, Vector4f* pPlanes)
+{
+    for (uint i = 0 ; i < 3 ; i++) {
+        pPlanes[i * 2]     = Vector4f(VP.m[3][0] + VP.m[i][0], VP.m[3][1] + VP.m[i][1],
+                                      VP.m[3][2] + VP.m[i][2], VP.m[3][3] + VP.m[i][3]);
+        pPlanes[i * 2 + 1] = Vector4f(VP.m[3][0] - VP.m[i][0], VP.m[3][1] - VP.m[i][1],
+                                      VP.m[3][2] - VP.m[i][2], VP.m[3][3] - VP.m[i][3]);
+    }
+}
+
+
+// The box is outside if the corner that is furthest along the normal of a
+// plane is behind it
+bool InstancedBillboardList::IsBoxVisible(const Vector4f* pPlanes, const Vector3f& Min, const Vector3f& Max)
+{
+    for (uint i = 0 ; i < 6 ; i++) {
+        const Vector4f& p = pPlanes[i];
+
+        float x = (p.x >= 0.0f) ? Max.x : Min.x;
+        float y = (p.y >= 0.0f) ? Max.y : Min.y;
+        float z = (p.z >= 0.0f) ? Max.z : Min.z;
+
+        if (p.x * x + p.y * y + p.z * z + p.w < 0.0f) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+void InstancedBillboardList::Render(const Matrix4f& VP, const Vector3f& CameraPos)
+{
+    uint Region = m_frameCount % NUM_REGIONS;
+
+    // Wait until the GPU is done with the draw that used this region
+    // NUM_REGIONS frames ago. The region is written only after the fence
+    // signaled - a timeout just means the GPU is slow so keep waiting (the
+    // flush is needed only once).
+    if (m_fences[Region]) {
+        GLenum Status = glClientWaitSync(m_fences[Region], GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NANOS);
+
+        while (Status == GL_TIMEOUT_EXPIRED) {
+            Status = glClientWaitSync(m_fences[Region], 0, FENCE_TIMEOUT_NANOS);
+        }
+
+        if (Status == GL_WAIT_FAILED) {
+            printf("Error waiting for the billboard fence\n");
+            glFinish();
+        }
+
+        glDeleteSync(m_fences[Region]);
+        m_fences[Region] = 0;
+    }
+
+    Vector4f Planes[6];
+    CalcFrustumPlanes(VP, Planes);
+
+    uint FirstInstance = Region * m_maxBillboards;
+    BillboardInstance* pDst = m_pMappedInstances + FirstInstance;
+    m_numVisible = 0;
+
+    for (uint i = 0 ; i < m_cells.size() ; i++) {
+        const Cell& c = m_cells[i];
+
+        if (!c.Billboards.empty() && IsBoxVisible(Planes, c.Min, c.Max)) {
+            memcpy(pDst + m_numVisible, &c.Billboards[0], sizeof(BillboardInstance) * c.Billboards.size());
+            m_numVisible += (uint)c.Billboards.size();
+        }
+    }
+
+    if (m_numVisible > 0) {
+        m_technique.Enable();
+        m_technique.SetVP(VP);
+        m_technique.SetCameraPosition(CameraPos);
+        m_technique.SetFirstInstance(FirstInstance);
+
+        m_pTexture->Bind(COLOR_TEXTURE_UNIT);
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_instanceBuffer);
+        glBindVertexArray(m_VAO);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, m_numVisible);
+        glBindVertexArray(0);
+
+        m_fences[Region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    m_frameCount++;
+}
@@ -0,0 +1,120 @@
+/*
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INSTANCED_BILLBOARD_LIST_H
+#define	INSTANCED_BILLBOARD_LIST_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ogldev_texture.h"
+#include "billboard_technique.h"
+
+using namespace std;
+
+#define INVALID_BILLBOARD 0xFFFFFFFF
+
+// Must match billboard_instanced.vs
+struct BillboardInstance
+{
+    Vector3f Pos;           // bottom center
+    float Size;
+    uint Color;             // RGBA8 tint, red in the low byte
+    uint AtlasIndex;        // row major image index in the texture atlas
+};
+
+
+// Billboard renderer for large dynamic sets. The billboards are binned
+// into square cells on the XZ plane and every frame the cells that
+// intersect the view frustum are copied into a persistently mapped buffer.
+// The buffer has one region per frame in flight so the CPU never writes
+// over data the GPU may still be reading. The billboards are drawn with one
+// instanced draw and the vertex shader builds the quads from the instance
+// data, without a geometry shader.
+class InstancedBillboardList
+{
+public:
+
+    InstancedBillboardList();
+
+    ~InstancedBillboardList();
+
+    // The texture is an atlas of AtlasColumns x AtlasRows images
+    bool Init(const string& TexFilename, uint AtlasColumns, uint AtlasRows,
+              uint MaxBillboards, float CellSize);
+
+    // Returns the handle for UpdateBillboard or INVALID_BILLBOARD when the
+    // list is full
+    uint AddBillboard(const BillboardInstance& Billboard);
+
+    // The billboard moves to another cell when it crosses a cell border
+    void UpdateBillboard(uint Handle, const BillboardInstance& Billboard);
+
+    void Render(const Matrix4f& VP, const Vector3f& CameraPos);
+
+    uint GetNumBillboards() const { return (uint)m_locations.size(); }
+
+    // Number of billboards that passed the culling in the last Render
+    uint GetNumVisible() const { return m_numVisible; }
+
+private:
+
+    // The bounds only grow when billboards leave the cell so they are
+    // conservative
+    struct Cell {
+        Vector3f Min;
+        Vector3f Max;
+        vector<BillboardInstance> Billboards;
+        vector<uint> Handles;
+    };
+
+    struct Location {
+        uint Cell;
+        uint Slot;
+    };
+
+    uint GetCell(const Vector3f& Pos);
+
+    void AddToCell(uint Handle, uint CellIndex, const BillboardInstance& Billboard);
+
+    void RemoveFromCell(uint Handle);
+
+    static void GrowBounds(Cell& c, const BillboardInstance& Billboard);
+
+    static void CalcFrustumPlanes(const Matrix4f& VP, Vector4f* pPlanes);
+
+    static bool IsBoxVisible(const Vector4f* pPlanes, const Vector3f& Min, const Vector3f& Max);
+
+    static const uint NUM_REGIONS = 3;
+
+    uint m_maxBillboards;
+    float m_cellSize;
+    uint m_numVisible;
+    uint m_frameCount;
+    vector<Cell> m_cells;
+    map<long long, uint> m_cellMap;
+    vector<Location> m_locations;
+    GLuint m_instanceBuffer;
+    BillboardInstance* m_pMappedInstances;
+    GLsync m_fences[NUM_REGIONS];
+    GLuint m_VAO;
+    Texture* m_pTexture;
+    InstancedBillboardTechnique m_technique;
+};
+
+#endif	/* INSTANCED_BILLBOARD_LIST_H */
@@ -31,10 +31,17 @@
 #include "ogldev_glut_backend.h"
 #include "mesh.h"
 #include "billboard_list.h"
+#include "instanced_billboard_list.h"
 
 #define WINDOW_WIDTH  1920
 #define WINDOW_HEIGHT 1200
 
+#define FIELD_ROWS 1000
+#define FIELD_COLUMNS 1000
+#define FIELD_SPACING 0.2f
+#define FIELD_CELL_SIZE 8.0f
+#define NUM_MOVING_BILLBOARDS 1000
+
 
 class Tutorial27 : public ICallbacks, public OgldevApp
 {
@@ -47,6 +54,8 @@ public:
         m_pGround = NULL;
         m_pTexture = NULL;
         m_pNormalMap = NULL;
+        m_instancedMode = false;
+        m_isInstancedAvailable = false;
 
         m_dirLight.AmbientIntensity = 0.2f;
         m_dirLight.DiffuseIntensity = 0.8f;
@@ -116,6 +125,18 @@ public:
             return false;
         }
 
+        // The instanced list needs persistent mapping and SSBOs (OpenGL 4.4).
+        // Without them only the geometry shader billboards are available.
+        m_isInstancedAvailable = m_instancedList.Init("../Content/monster_hellknight.png", 1, 1,
+                                                      FIELD_ROWS * FIELD_COLUMNS, FIELD_CELL_SIZE);
+
+        if (m_isInstancedAvailable) {
+            CreateBillboardField();
+        }
+        else {
+            printf("Error initializing the instanced billboard list - instanced mode is disabled\n");
+        }
+
         return true;
     }
 
@@ -147,11 +168,57 @@ public:
         m_pLightingTechnique->SetWorldMatrix(p.GetWorldTrans());
         m_pGround->Render();
                 
-        m_billboardList.Render(p.GetVPTrans(), m_pGameCamera->GetPos());
+        if (m_instancedMode) {
+            MoveBillboards();
+            m_instancedList.Render(p.GetVPTrans(), m_pGameCamera->GetPos());
+        }
+        else {
+            m_billboardList.Render(p.GetVPTrans(), m_pGameCamera->GetPos());
+        }
+
         glutSwapBuffers();
     }
 
 
+    // A field of randomly tinted billboards in front of the camera
+    void CreateBillboardField()
+    {
+        for (uint j = 0 ; j < FIELD_ROWS ; j++) {
+            for (uint i = 0 ; i < FIELD_COLUMNS ; i++) {
+                BillboardInstance b;
+                b.Pos = Vector3f(((float)i - FIELD_COLUMNS / 2) * FIELD_SPACING + RandomFloat() * 0.1f,
+                                 0.0f,
+                                 (float)j * FIELD_SPACING + RandomFloat() * 0.1f);
+                b.Size = 0.3f + RandomFloat() * 0.3f;
+                b.Color = 0xFF000000 |
+                          ((uint)(128 + RandomFloat() * 127) << 16) |
+                          ((uint)(128 + RandomFloat() * 127) << 8) |
+                          (uint)(128 + RandomFloat() * 127);
+                b.AtlasIndex = 0;
+
+                uint Handle = m_instancedList.AddBillboard(b);
+
+                if (Handle < NUM_MOVING_BILLBOARDS) {
+                    m_movingBillboards[Handle] = b;
+                }
+            }
+        }
+    }
+
+
+    // The first billboards of the field hop up and down
+    void MoveBillboards()
+    {
+        float Time = GetRunningTime();
+
+        for (uint i = 0 ; i < NUM_MOVING_BILLBOARDS ; i++) {
+            BillboardInstance b = m_movingBillboards[i];
+            b.Pos.y = fabsf(sinf(Time * 4.0f + (float)i));
+            m_instancedList.UpdateBillboard(i, b);
+        }
+    }
+
+
 	void KeyboardCB(OGLDEV_KEY OgldevKey, OGLDEV_KEY_STATE State)
 	{
 		switch (OgldevKey) {
@@ -159,6 +226,27 @@ public:
 		case OGLDEV_KEY_q:
 			GLUTBackendLeaveMainLoop();
 			break;
+		case OGLDEV_KEY_s:
+			if (m_billboardList.IsSortAvailable()) {
+				m_billboardList.SetDepthSorted(!m_billboardList.IsDepthSorted());
+			}
+			else {
+				printf("Depth sorting is not available\n");
+			}
+			break;
+		case OGLDEV_KEY_i:
+			if (m_isInstancedAvailable) {
+				m_instancedMode = !m_instancedMode;
+			}
+			else {
+				printf("Instanced mode is not available\n");
+			}
+			break;
+		case OGLDEV_KEY_v:
+			if (m_isInstancedAvailable) {
+				printf("%d of %d billboards visible\n", m_instancedList.GetNumVisible(), m_instancedList.GetNumBillboards());
+			}
+			break;
 		default:
 			m_pGameCamera->OnKeyboard(OgldevKey);
 		}
@@ -180,6 +268,10 @@ public:
     Texture* m_pNormalMap;
     PersProjInfo m_persProjInfo;
     BillboardList m_billboardList;
+    InstancedBillboardList m_instancedList;
+    BillboardInstance m_movingBillboards[NUM_MOVING_BILLBOARDS];
+    bool m_instancedMode;
+    bool m_isInstancedAvailable;
 };
 
 
@@ -27,20 +27,38 @@ BillboardTechnique::BillboardTechnique()
  
 
 bool BillboardTechnique::Init()
+{
+    return InitCommon("billboard.vs", "billboard.gs", "billboard.fs");
+}
+
+
+bool BillboardTechnique::InitVertexPulling()
+{
+    return InitCommon("ps_render.vs", "billboard.gs", "billboard.fs");
+}
+
+
+bool BillboardTechnique::InitDepthSorted()
+{
+    return InitCommon("ps_render_sorted.vs", "ps_billboard.gs", "ps_billboard.fs");
+}
+
+
+bool BillboardTechnique::InitCommon(const char* pVSFilename, const char* pGSFilename, const char* pFSFilename)
 {
     if (!Technique::Init()) {
         return false;
     }
 
-    if (!AddShader(GL_VERTEX_SHADER, "billboard.vs")) {
+    if (!AddShader(GL_VERTEX_SHADER, pVSFilename)) {
         return false;
     }
 
-    if (!AddShader(GL_GEOMETRY_SHADER, "billboard.gs")) {
+    if (!AddShader(GL_GEOMETRY_SHADER, pGSFilename)) {
         return false;
     }
     
-    if (!AddShader(GL_FRAGMENT_SHADER, "billboard.fs")) {
+    if (!AddShader(GL_FRAGMENT_SHADER, pFSFilename)) {
         return false;
     }
 
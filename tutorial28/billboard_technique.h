@@ -28,6 +28,14 @@ public:
     BillboardTechnique();
  
     virtual bool Init();
+
+    // The positions are read by the vertex shader from the particle buffers
+    // of GPUParticleSystem instead of a vertex buffer
+    bool InitVertexPulling();
+
+    // Vertex pulling in the order of a depth sort. The billboards are faded
+    // out with age and alpha blended.
+    bool InitDepthSorted();
     
     void SetVP(const Matrix4f& VP);
     void SetCameraPosition(const Vector3f& Pos);
@@ -36,6 +44,8 @@ public:
     
 private:
 
+    bool InitCommon(const char* pVSFilename, const char* pGSFilename, const char* pFSFilename);
+
     GLuint m_VPLocation;
     GLuint m_cameraPosLocation;
     GLuint m_colorMapLocation;
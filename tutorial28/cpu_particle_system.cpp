@@ -0,0 +1,416 @@
+/*
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#define PARTICLES_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// The AVX path is compiled for AVX on its own so the rest of the program
+// still runs on CPUs without it. The choice between the paths is made at
+// runtime (see IsAVXSupported).
+#if defined(PARTICLES_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_AVX __attribute__((target("avx")))
+#else
+#define TARGET_AVX
+#endif
+
+#include <string.h>
+#include <thread>
+
+#include "ogldev_engine_common.h"
+#include "ogldev_util.h"
+#include "cpu_particle_system.h"
+
+
+struct IntegrateParams {
+    float* pPosX;
+    float* pPosY;
+    float* pPosZ;
+    float* pVelX;
+    float* pVelY;
+    float* pVelZ;
+    float* pAge;
+    float DeltaTimeSecs;
+    float gx;           // velocity change of the step
+    float gy;
+    float gz;
+};
+
+// Chunk boundaries are multiples of the widest SIMD width
+#define SIMD_WIDTH 8
+
+
+CPUParticleSystem::CPUParticleSystem()
+{
+    m_maxParticles = 0;
+    m_numParticles = 0;
+    m_numThreads = 1;
+    m_useAVX = false;
+    m_gravity = Vector3f(0.0f, -9.81f, 0.0f);
+    m_VB = 0;
+    m_pTexture = NULL;
+}
+
+
+CPUParticleSystem::~CPUParticleSystem()
+{
+    SAFE_DELETE(m_pTexture);
+
+    if (m_VB != 0) {
+        glDeleteBuffers(1, &m_VB);
+    }
+}
+
+
+bool CPUParticleSystem::Init(uint MaxParticles, uint NumThreads)
+{
+    m_maxParticles = MaxParticles;
+
+    m_numThreads = (NumThreads == 0) ? std::thread::hardware_concurrency() : NumThreads;
+
+    if (m_numThreads == 0) {
+        m_numThreads = 1;
+    }
+
+    m_useAVX = IsAVXSupported();
+
+    m_posX.resize(MaxParticles);
+    m_posY.resize(MaxParticles);
+    m_posZ.resize(MaxParticles);
+    m_velX.resize(MaxParticles);
+    m_velY.resize(MaxParticles);
+    m_velZ.resize(MaxParticles);
+    m_age.resize(MaxParticles);
+    m_lifetime.resize(MaxParticles);
+
+    m_chunkStart.resize(m_numThreads + 1);
+    m_chunkSurvivors.resize(m_numThreads);
+
+    return true;
+}
+
+
+bool CPUParticleSystem::InitRendering()
+{
+    glGenBuffers(1, &m_VB);
+
+    if (!m_billboardTech.Init()) {
+        return false;
+    }
+
+    m_billboardTech.Enable();
+    m_billboardTech.SetColorTextureUnit(COLOR_TEXTURE_UNIT_INDEX);
+    m_billboardTech.SetBillboardSize(0.01f);
+
+    m_pTexture = new Texture(GL_TEXTURE_2D, "../Content/fireworks_red.jpg");
+
+    if (!m_pTexture->Load()) {
+        return false;
+    }
+
+    return GLCheckError();
+}
+
+
+void CPUParticleSystem::AddEmitter(const ParticleEmitter& Emitter)
+{
+    EmitterState State;
+    State.Emitter = Emitter;
+    State.Accumulator = 0.0f;
+    m_emitters.push_back(State);
+}
+
+
+void CPUParticleSystem::Burst(const ParticleEmitter& Emitter, uint Count)
+{
+    Emit(Emitter, Count);
+}
+
+
+// Same distribution as ps_emit.cs. New particles go to the end so the order
+// of the particles is the order of emission.
+void CPUParticleSystem::Emit(const ParticleEmitter& Emitter, uint Count)
+{
+    Count = MIN(Count, m_maxParticles - m_numParticles);
+
+    for (uint i = m_numParticles ; i < m_numParticles + Count ; i++) {
+        float z = RandomFloat() * 2.0f - 1.0f;
+        float Phi = RandomFloat() * 2.0f * (float)M_PI;
+        float r = sqrtf(1.0f - z * z);
+        Vector3f RandomDir(r * cosf(Phi), r * sinf(Phi), z);
+        Vector3f Dir = Emitter.Dir * (1.0f - Emitter.Spread) + RandomDir * Emitter.Spread + Emitter.Dir * 0.001f;
+        Dir.Normalize();
+
+        float Speed = Emitter.MinSpeed + (Emitter.MaxSpeed - Emitter.MinSpeed) * RandomFloat();
+
+        m_posX[i] = Emitter.Pos.x;
+        m_posY[i] = Emitter.Pos.y;
+        m_posZ[i] = Emitter.Pos.z;
+        m_velX[i] = Dir.x * Speed;
+        m_velY[i] = Dir.y * Speed;
+        m_velZ[i] = Dir.z * Speed;
+        m_age[i] = 0.0f;
+        m_lifetime[i] = Emitter.MinLifetime + (Emitter.MaxLifetime - Emitter.MinLifetime) * RandomFloat();
+    }
+
+    m_numParticles += Count;
+}
+
+
+void CPUParticleSystem::Update(float DeltaTimeSecs)
+{
+    uint ChunkSize = (m_numParticles + m_numThreads - 1) / m_numThreads;
+    ChunkSize = (ChunkSize + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+
+    for (uint i = 0 ; i <= m_numThreads ; i++) {
+        m_chunkStart[i] = MIN(i * ChunkSize, m_numParticles);
+    }
+
+    vector<std::thread> Threads;
+
+    for (uint i = 1 ; i < m_numThreads ; i++) {
+        Threads.push_back(std::thread(UpdateChunkThread, this, i, DeltaTimeSecs));
+    }
+
+    UpdateChunk(0, DeltaTimeSecs);
+
+    for (uint i = 0 ; i < Threads.size() ; i++) {
+        Threads[i].join();
+    }
+
+    // Pack the survivors of all the chunks. Every chunk is moved down as a
+    // whole so the order is kept.
+    uint NumParticles = m_chunkSurvivors[0];
+
+    for (uint i = 1 ; i < m_numThreads ; i++) {
+        MoveParticles(NumParticles, m_chunkStart[i], m_chunkSurvivors[i]);
+        NumParticles += m_chunkSurvivors[i];
+    }
+
+    m_numParticles = NumParticles;
+
+    for (uint i = 0 ; i < m_emitters.size() ; i++) {
+        EmitterState& State = m_emitters[i];
+        State.Accumulator += State.Emitter.EmitRate * DeltaTimeSecs;
+        uint Count = (uint)State.Accumulator;
+        State.Accumulator -= (float)Count;
+        Emit(State.Emitter, Count);
+    }
+}
+
+
+bool CPUParticleSystem::IsAVXSupported()
+{
+#if defined(PARTICLES_X86) && (defined(__GNUC__) || defined(__clang__))
+    return __builtin_cpu_supports("avx");
+#elif defined(PARTICLES_X86) && defined(_MSC_VER)
+    // The CPU must have AVX and the OS must save the YMM registers
+    int Info[4];
+    __cpuid(Info, 1);
+
+    bool HasAVX = (Info[2] & (1 << 28)) != 0;
+    bool HasOSXSave = (Info[2] & (1 << 27)) != 0;
+
+    return HasAVX && HasOSXSave && ((_xgetbv(0) & 6) == 6);
+#else
+    return false;
+#endif
+}
+
+
+// The integration of the particles [Start, End) 8 at a time. Returns the
+// first particle that is left for the scalar loop.
+#ifdef PARTICLES_X86
+static TARGET_AVX uint IntegrateAVX(const IntegrateParams& p, uint Start, uint End)
+{
+    const __m256 dt = _mm256_set1_ps(p.DeltaTimeSecs);
+    const __m256 dvx = _mm256_set1_ps(p.gx);
+    const __m256 dvy = _mm256_set1_ps(p.gy);
+    const __m256 dvz = _mm256_set1_ps(p.gz);
+
+    uint i = Start;
+
+    for ( ; i + 8 <= End ; i += 8) {
+        __m256 vx = _mm256_add_ps(_mm256_loadu_ps(p.pVelX + i), dvx);
+        __m256 vy = _mm256_add_ps(_mm256_loadu_ps(p.pVelY + i), dvy);
+        __m256 vz = _mm256_add_ps(_mm256_loadu_ps(p.pVelZ + i), dvz);
+        _mm256_storeu_ps(p.pVelX + i, vx);
+        _mm256_storeu_ps(p.pVelY + i, vy);
+        _mm256_storeu_ps(p.pVelZ + i, vz);
+        _mm256_storeu_ps(p.pPosX + i, _mm256_add_ps(_mm256_loadu_ps(p.pPosX + i), _mm256_mul_ps(vx, dt)));
+        _mm256_storeu_ps(p.pPosY + i, _mm256_add_ps(_mm256_loadu_ps(p.pPosY + i), _mm256_mul_ps(vy, dt)));
+        _mm256_storeu_ps(p.pPosZ + i, _mm256_add_ps(_mm256_loadu_ps(p.pPosZ + i), _mm256_mul_ps(vz, dt)));
+        _mm256_storeu_ps(p.pAge + i, _mm256_add_ps(_mm256_loadu_ps(p.pAge + i), dt));
+    }
+
+    return i;
+}
+#endif
+
+
+// Same as IntegrateAVX 4 particles at a time
+static uint IntegrateSSE(const IntegrateParams& p, uint Start, uint End)
+{
+    uint i = Start;
+
+#if defined(__SSE__) || defined(_M_X64)
+    const __m128 dt = _mm_set1_ps(p.DeltaTimeSecs);
+    const __m128 dvx = _mm_set1_ps(p.gx);
+    const __m128 dvy = _mm_set1_ps(p.gy);
+    const __m128 dvz = _mm_set1_ps(p.gz);
+
+    for ( ; i + 4 <= End ; i += 4) {
+        __m128 vx = _mm_add_ps(_mm_loadu_ps(p.pVelX + i), dvx);
+        __m128 vy = _mm_add_ps(_mm_loadu_ps(p.pVelY + i), dvy);
+        __m128 vz = _mm_add_ps(_mm_loadu_ps(p.pVelZ + i), dvz);
+        _mm_storeu_ps(p.pVelX + i, vx);
+        _mm_storeu_ps(p.pVelY + i, vy);
+        _mm_storeu_ps(p.pVelZ + i, vz);
+        _mm_storeu_ps(p.pPosX + i, _mm_add_ps(_mm_loadu_ps(p.pPosX + i), _mm_mul_ps(vx, dt)));
+        _mm_storeu_ps(p.pPosY + i, _mm_add_ps(_mm_loadu_ps(p.pPosY + i), _mm_mul_ps(vy, dt)));
+        _mm_storeu_ps(p.pPosZ + i, _mm_add_ps(_mm_loadu_ps(p.pPosZ + i), _mm_mul_ps(vz, dt)));
+        _mm_storeu_ps(p.pAge + i, _mm_add_ps(_mm_loadu_ps(p.pAge + i), dt));
+    }
+#endif
+
+    return i;
+}
+
+
+void CPUParticleSystem::UpdateChunkThread(CPUParticleSystem* pSystem, uint Chunk, float DeltaTimeSecs)
+{
+    pSystem->UpdateChunk(Chunk, DeltaTimeSecs);
+}
+
+
+void CPUParticleSystem::UpdateChunk(uint Chunk, float DeltaTimeSecs)
+{
+    uint Start = m_chunkStart[Chunk];
+    uint End = m_chunkStart[Chunk + 1];
+
+    float* pPosX = &m_posX[0];
+    float* pPosY = &m_posY[0];
+    float* pPosZ = &m_posZ[0];
+    float* pVelX = &m_velX[0];
+    float* pVelY = &m_velY[0];
+    float* pVelZ = &m_velZ[0];
+    float* pAge = &m_age[0];
+
+    float gx = m_gravity.x * DeltaTimeSecs;
+    float gy = m_gravity.y * DeltaTimeSecs;
+    float gz = m_gravity.z * DeltaTimeSecs;
+
+    IntegrateParams Params = { pPosX, pPosY, pPosZ, pVelX, pVelY, pVelZ, pAge, DeltaTimeSecs, gx, gy, gz };
+    uint i;
+
+#ifdef PARTICLES_X86
+    if (m_useAVX) {
+        i = IntegrateAVX(Params, Start, End);
+    }
+    else {
+        i = IntegrateSSE(Params, Start, End);
+    }
+#else
+    i = IntegrateSSE(Params, Start, End);
+#endif
+
+    for ( ; i < End ; i++) {
+        pVelX[i] += gx;
+        pVelY[i] += gy;
+        pVelZ[i] += gz;
+        pPosX[i] += pVelX[i] * DeltaTimeSecs;
+        pPosY[i] += pVelY[i] * DeltaTimeSecs;
+        pPosZ[i] += pVelZ[i] * DeltaTimeSecs;
+        pAge[i] += DeltaTimeSecs;
+    }
+
+    // Remove the dead particles while the chunk is still in the cache
+    float* pLifetime = &m_lifetime[0];
+    uint Dst = Start;
+
+    for (i = Start ; i < End ; i++) {
+        if (pAge[i] >= pLifetime[i]) {
+            continue;
+        }
+
+        if (Dst != i) {
+            pPosX[Dst] = pPosX[i];
+            pPosY[Dst] = pPosY[i];
+            pPosZ[Dst] = pPosZ[i];
+            pVelX[Dst] = pVelX[i];
+            pVelY[Dst] = pVelY[i];
+            pVelZ[Dst] = pVelZ[i];
+            pAge[Dst] = pAge[i];
+            pLifetime[Dst] = pLifetime[i];
+        }
+
+        Dst++;
+    }
+
+    m_chunkSurvivors[Chunk] = Dst - Start;
+}
+
+
+// Moves whole chunks down. The ranges may overlap but Dst is never above Src.
+void CPUParticleSystem::MoveParticles(uint Dst, uint Src, uint Count)
+{
+    if ((Dst == Src) || (Count == 0)) {
+        return;
+    }
+
+    memmove(&m_posX[Dst], &m_posX[Src], sizeof(float) * Count);
+    memmove(&m_posY[Dst], &m_posY[Src], sizeof(float) * Count);
+    memmove(&m_posZ[Dst], &m_posZ[Src], sizeof(float) * Count);
+    memmove(&m_velX[Dst], &m_velX[Src], sizeof(float) * Count);
+    memmove(&m_velY[Dst], &m_velY[Src], sizeof(float) * Count);
+    memmove(&m_velZ[Dst], &m_velZ[Src], sizeof(float) * Count);
+    memmove(&m_age[Dst], &m_age[Src], sizeof(float) * Count);
+    memmove(&m_lifetime[Dst], &m_lifetime[Src], sizeof(float) * Count);
+}
+
+
+void CPUParticleSystem::Render(const Matrix4f& VP, const Vector3f& CameraPos)
+{
+    if (m_numParticles == 0) {
+        return;
+    }
+
+    m_renderPositions.resize(m_numParticles);
+
+    for (uint i = 0 ; i < m_numParticles ; i++) {
+        m_renderPositions[i] = Vector3f(m_posX[i], m_posY[i], m_posZ[i]);
+    }
+
+    m_billboardTech.Enable();
+    m_billboardTech.SetCameraPosition(CameraPos);
+    m_billboardTech.SetVP(VP);
+    m_pTexture->Bind(COLOR_TEXTURE_UNIT);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_VB);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(Vector3f) * m_numParticles, &m_renderPositions[0], GL_STREAM_DRAW);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+
+    glDrawArrays(GL_POINTS, 0, m_numParticles);
+
+    glDisableVertexAttribArray(0);
+}
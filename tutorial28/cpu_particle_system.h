@@ -0,0 +1,114 @@
+/*
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CPU_PARTICLE_SYSTEM_H
+#define	CPU_PARTICLE_SYSTEM_H
+
+#include <vector>
+#include <GL/glew.h>
+
+#include "billboard_technique.h"
+#include "particle_emitter.h"
+#include "ogldev_texture.h"
+
+using namespace std;
+
+// Particle system that runs on the CPU with the same emitters as
+// GPUParticleSystem. Every attribute is stored in its own array so the
+// integration runs on 8 (AVX, when the CPU has it) or 4 (SSE) particles at a
+// time. The particles
+// are split into one chunk per thread; every thread integrates its chunk and
+// removes the dead particles from it, and the chunks are then packed so the
+// order of the survivors is kept. Init does not touch OpenGL so the
+// simulation can run without a window.
+class CPUParticleSystem
+{
+public:
+
+    CPUParticleSystem();
+
+    ~CPUParticleSystem();
+
+    // NumThreads == 0 uses all the hardware threads
+    bool Init(uint MaxParticles, uint NumThreads = 0);
+
+    bool InitRendering();
+
+    void AddEmitter(const ParticleEmitter& Emitter);
+
+    void Burst(const ParticleEmitter& Emitter, uint Count);
+
+    void SetGravity(const Vector3f& Gravity) { m_gravity = Gravity; }
+
+    void Update(float DeltaTimeSecs);
+
+    void Render(const Matrix4f& VP, const Vector3f& CameraPos);
+
+    uint GetNumParticles() const { return m_numParticles; }
+
+    uint GetNumThreads() const { return m_numThreads; }
+
+    bool IsUsingAVX() const { return m_useAVX; }
+
+    // Particle i is at (PosX[i], PosY[i], PosZ[i])
+    const float* GetPosX() const { return &m_posX[0]; }
+    const float* GetPosY() const { return &m_posY[0]; }
+    const float* GetPosZ() const { return &m_posZ[0]; }
+
+private:
+
+    struct EmitterState {
+        ParticleEmitter Emitter;
+        float Accumulator;
+    };
+
+    void Emit(const ParticleEmitter& Emitter, uint Count);
+
+    void UpdateChunk(uint Chunk, float DeltaTimeSecs);
+    static void UpdateChunkThread(CPUParticleSystem* pSystem, uint Chunk, float DeltaTimeSecs);
+
+    void MoveParticles(uint Dst, uint Src, uint Count);
+
+    static bool IsAVXSupported();
+
+    uint m_maxParticles;
+    uint m_numParticles;
+    uint m_numThreads;
+    bool m_useAVX;
+    Vector3f m_gravity;
+
+    vector<float> m_posX;
+    vector<float> m_posY;
+    vector<float> m_posZ;
+    vector<float> m_velX;
+    vector<float> m_velY;
+    vector<float> m_velZ;
+    vector<float> m_age;
+    vector<float> m_lifetime;
+
+    vector<uint> m_chunkStart;
+    vector<uint> m_chunkSurvivors;
+
+    vector<EmitterState> m_emitters;
+
+    vector<Vector3f> m_renderPositions;
+    GLuint m_VB;
+    BillboardTechnique m_billboardTech;
+    Texture* m_pTexture;
+};
+
+#endif	/* CPU_PARTICLE_SYSTEM_H */
@@ -0,0 +1,291 @@
+/*
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stddef.h>
+
+#include "ogldev_engine_common.h"
+#include "ogldev_util.h"
+#include "gpu_particle_system.h"
+
+
+GPUParticleSystem::GPUParticleSystem()
+{
+    m_maxParticles = 0;
+    m_currAliveList = 0;
+    m_seed = 0;
+    m_gravity = Vector3f(0.0f, -9.81f, 0.0f);
+    m_depthSorted = false;
+    m_fullSortInterval = 1;
+    m_frameCount = 0;
+    m_VAO = 0;
+    m_pTexture = NULL;
+
+    ZERO_MEM(m_buffers);
+}
+
+
+GPUParticleSystem::~GPUParticleSystem()
+{
+    SAFE_DELETE(m_pTexture);
+
+    if (m_buffers[0] != 0) {
+        glDeleteBuffers(ARRAY_SIZE_IN_ELEMENTS(m_buffers), m_buffers);
+    }
+
+    if (m_VAO != 0) {
+        glDeleteVertexArrays(1, &m_VAO);
+    }
+}
+
+
+bool GPUParticleSystem::Init(uint MaxParticles)
+{
+    m_maxParticles = MaxParticles;
+
+    glGenBuffers(ARRAY_SIZE_IN_ELEMENTS(m_buffers), m_buffers);
+
+    // The sorted path draws every slot so the age and lifetime of the slots
+    // that were never emitted must mark them as dead
+    vector<Vector4f> Zeros(MaxParticles, Vector4f(0.0f, 0.0f, 0.0f, 0.0f));
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[POS_AGE_BUFFER]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(Vector4f) * MaxParticles, &Zeros[0], GL_DYNAMIC_COPY);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[VEL_LIFETIME_BUFFER]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(Vector4f) * MaxParticles, &Zeros[0], GL_DYNAMIC_COPY);
+
+    // All the particles start dead
+    vector<uint> DeadList(MaxParticles);
+
+    for (uint i = 0 ; i < MaxParticles ; i++) {
+        DeadList[i] = MaxParticles - 1 - i;
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[DEAD_LIST_BUFFER]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(uint) * MaxParticles, &DeadList[0], GL_DYNAMIC_COPY);
+
+    for (uint i = ALIVE_LIST_BUFFER_0 ; i <= ALIVE_LIST_BUFFER_1 ; i++) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[i]);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(uint) * MaxParticles, NULL, GL_DYNAMIC_COPY);
+    }
+
+    Counters c;
+    memset(&c, 0, sizeof(c));
+    c.DrawInstanceCount = 1;
+    c.DispatchY = 1;
+    c.DispatchZ = 1;
+    c.NumDead = (int)MaxParticles;
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[COUNTERS_BUFFER]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(c), &c, GL_DYNAMIC_COPY);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // Rendering pulls the vertices from the storage buffers but a VAO must
+    // still be bound
+    glGenVertexArrays(1, &m_VAO);
+
+    if (!m_emitTech.Init() || !m_simulateTech.Init() || !m_prepareTech.Init() || !m_sortKeysTech.Init()) {
+        return false;
+    }
+
+    if (!m_sorter.Init(MaxParticles)) {
+        return false;
+    }
+
+    if (!m_billboardTech.InitVertexPulling() || !m_sortedBillboardTech.InitDepthSorted()) {
+        return false;
+    }
+
+    m_billboardTech.Enable();
+    m_billboardTech.SetColorTextureUnit(COLOR_TEXTURE_UNIT_INDEX);
+    m_billboardTech.SetBillboardSize(0.01f);
+
+    m_sortedBillboardTech.Enable();
+    m_sortedBillboardTech.SetColorTextureUnit(COLOR_TEXTURE_UNIT_INDEX);
+    m_sortedBillboardTech.SetBillboardSize(0.01f);
+
+    m_pTexture = new Texture(GL_TEXTURE_2D, "../Content/fireworks_red.jpg");
+
+    if (!m_pTexture->Load()) {
+        return false;
+    }
+
+    return GLCheckError();
+}
+
+
+void GPUParticleSystem::AddEmitter(const ParticleEmitter& Emitter)
+{
+    EmitterState State;
+    State.Emitter = Emitter;
+    State.Accumulator = 0.0f;
+    m_emitters.push_back(State);
+}
+
+
+void GPUParticleSystem::Burst(const ParticleEmitter& Emitter, uint Count)
+{
+    PendingBurst b;
+    b.Emitter = Emitter;
+    b.Count = Count;
+    m_bursts.push_back(b);
+}
+
+
+void GPUParticleSystem::BindBuffers()
+{
+    uint NextAliveList = 1 - m_currAliveList;
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PS_POS_AGE_BINDING, m_buffers[POS_AGE_BUFFER]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PS_VEL_LIFETIME_BINDING, m_buffers[VEL_LIFETIME_BUFFER]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PS_DEAD_LIST_BINDING, m_buffers[DEAD_LIST_BUFFER]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PS_CURRENT_ALIVE_LIST_BINDING, m_buffers[ALIVE_LIST_BUFFER_0 + m_currAliveList]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PS_NEXT_ALIVE_LIST_BINDING, m_buffers[ALIVE_LIST_BUFFER_0 + NextAliveList]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PS_COUNTERS_BINDING, m_buffers[COUNTERS_BUFFER]);
+}
+
+
+// Simulate the current alive list into the next one and then append the new
+// particles to it. The next list is drawn and becomes the current list of the
+// following update.
+void GPUParticleSystem::Update(float DeltaTimeSecs)
+{
+    m_currAliveList = 1 - m_currAliveList;
+
+    BindBuffers();
+
+    m_prepareTech.Enable();
+    glDispatchCompute(1, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+    m_simulateTech.Enable();
+    m_simulateTech.SetDeltaTime(DeltaTimeSecs);
+    m_simulateTech.SetGravity(m_gravity);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, m_buffers[COUNTERS_BUFFER]);
+    glDispatchComputeIndirect(offsetof(Counters, DispatchX));
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    for (uint i = 0 ; i < m_emitters.size() ; i++) {
+        EmitterState& State = m_emitters[i];
+        State.Accumulator += State.Emitter.EmitRate * DeltaTimeSecs;
+        uint Count = (uint)State.Accumulator;
+        State.Accumulator -= (float)Count;
+        Emit(State.Emitter, Count);
+    }
+
+    for (uint i = 0 ; i < m_bursts.size() ; i++) {
+        Emit(m_bursts[i].Emitter, m_bursts[i].Count);
+    }
+
+    m_bursts.clear();
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+}
+
+
+void GPUParticleSystem::Emit(const ParticleEmitter& Emitter, uint Count)
+{
+    Count = MIN(Count, m_maxParticles);
+
+    if (Count == 0) {
+        return;
+    }
+
+    m_emitTech.Enable();
+    m_emitTech.SetEmitter(Emitter);
+    m_emitTech.SetEmitCount(Count);
+    m_emitTech.SetSeed(m_seed++);
+
+    glDispatchCompute((Count + PS_EMIT_GROUP_SIZE - 1) / PS_EMIT_GROUP_SIZE, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+
+void GPUParticleSystem::Render(const Matrix4f& VP, const Vector3f& CameraPos)
+{
+    if (m_depthSorted) {
+        RenderSorted(VP, CameraPos);
+        return;
+    }
+
+    m_billboardTech.Enable();
+    m_billboardTech.SetCameraPosition(CameraPos);
+    m_billboardTech.SetVP(VP);
+    m_pTexture->Bind(COLOR_TEXTURE_UNIT);
+
+    BindBuffers();
+
+    glBindVertexArray(m_VAO);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_buffers[COUNTERS_BUFFER]);
+    glDrawArraysIndirect(GL_POINTS, (const void*)offsetof(Counters, DrawCount));
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+
+// The first m_maxParticles entries of the sort list are always the particle
+// slots because the padding of the sorter never moves
+void GPUParticleSystem::SortByDepth(const Vector3f& CameraPos)
+{
+    BindBuffers();
+    m_sorter.Bind();
+
+    m_sortKeysTech.Enable();
+    m_sortKeysTech.SetCameraPosition(CameraPos);
+    m_sortKeysTech.SetNumParticles(m_maxParticles);
+    glDispatchCompute((m_maxParticles + PS_SORT_KEYS_GROUP_SIZE - 1) / PS_SORT_KEYS_GROUP_SIZE, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    if (m_frameCount % m_fullSortInterval == 0) {
+        m_sorter.Sort();
+    }
+    else {
+        m_sorter.SortBlocks();
+    }
+
+    m_frameCount++;
+
+    glMemoryBarrier(GL_ELEMENT_ARRAY_BARRIER_BIT);
+}
+
+
+void GPUParticleSystem::RenderSorted(const Matrix4f& VP, const Vector3f& CameraPos)
+{
+    SortByDepth(CameraPos);
+
+    m_sortedBillboardTech.Enable();
+    m_sortedBillboardTech.SetCameraPosition(CameraPos);
+    m_sortedBillboardTech.SetVP(VP);
+    m_pTexture->Bind(COLOR_TEXTURE_UNIT);
+
+    BindBuffers();
+
+    // Back to front so the particles don't need to write depth
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_FALSE);
+
+    glBindVertexArray(m_VAO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_sorter.GetValueBuffer());
+    glDrawElements(GL_POINTS, m_maxParticles, GL_UNSIGNED_INT, NULL);
+    glBindVertexArray(0);
+
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+}
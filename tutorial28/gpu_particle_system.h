@@ -0,0 +1,142 @@
+/*
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GPU_PARTICLE_SYSTEM_H
+#define	GPU_PARTICLE_SYSTEM_H
+
+#include <vector>
+#include <GL/glew.h>
+
+#include "ps_compute_technique.h"
+#include "billboard_technique.h"
+#include "particle_emitter.h"
+#include "ogldev_texture.h"
+#include "ogldev_gpu_sort.h"
+#include "ogldev_util.h"
+
+using namespace std;
+
+// Particle system that runs entirely in compute shaders. The particles live
+// in shader storage buffers, one buffer per attribute. Free slots are kept
+// in a dead list and the live ones in an alive list so emitting and killing
+// a particle are O(1). The alive count feeds the indirect simulation
+// dispatch and the indirect draw so the CPU never reads anything back.
+//
+// When depth sorting is enabled every particle slot is kept in a sort list
+// that persists across frames. The list is sorted back to front on the GPU
+// and used as the element array of the draw so the particles can be alpha
+// blended. A full sort runs every FullSortInterval frames and the frames in
+// between only sort blocks of the list, which is enough to follow the slow
+// changes in depth of the particles that were already sorted.
+class GPUParticleSystem
+{
+public:
+
+    GPUParticleSystem();
+
+    ~GPUParticleSystem();
+
+    bool Init(uint MaxParticles);
+
+    // Emits continuously at Emitter.EmitRate
+    void AddEmitter(const ParticleEmitter& Emitter);
+
+    // Emits Count particles at the next update
+    void Burst(const ParticleEmitter& Emitter, uint Count);
+
+    void SetGravity(const Vector3f& Gravity) { m_gravity = Gravity; }
+
+    void Update(float DeltaTimeSecs);
+
+    void Render(const Matrix4f& VP, const Vector3f& CameraPos);
+
+    void SetDepthSorted(bool DepthSorted) { m_depthSorted = DepthSorted; }
+
+    bool IsDepthSorted() const { return m_depthSorted; }
+
+    // 1 sorts the whole list every frame
+    void SetFullSortInterval(uint Frames) { m_fullSortInterval = MAX(Frames, 1); }
+
+    uint GetFullSortInterval() const { return m_fullSortInterval; }
+
+    uint GetMaxParticles() const { return m_maxParticles; }
+
+private:
+
+    // Must match CountersBuffer in the shaders
+    struct Counters {
+        uint DrawCount;
+        uint DrawInstanceCount;
+        uint DrawFirst;
+        uint DrawBaseInstance;
+        uint DispatchX;
+        uint DispatchY;
+        uint DispatchZ;
+        int NumAlive;
+        int NumDead;
+    };
+
+    struct EmitterState {
+        ParticleEmitter Emitter;
+        float Accumulator;      // fraction of a particle carried to the next frame
+    };
+
+    struct PendingBurst {
+        ParticleEmitter Emitter;
+        uint Count;
+    };
+
+    void Emit(const ParticleEmitter& Emitter, uint Count);
+
+    void BindBuffers();
+
+    void SortByDepth(const Vector3f& CameraPos);
+
+    void RenderSorted(const Matrix4f& VP, const Vector3f& CameraPos);
+
+    enum BUFFER_TYPE {
+        POS_AGE_BUFFER      = 0,
+        VEL_LIFETIME_BUFFER = 1,
+        DEAD_LIST_BUFFER    = 2,
+        ALIVE_LIST_BUFFER_0 = 3,
+        ALIVE_LIST_BUFFER_1 = 4,
+        COUNTERS_BUFFER     = 5,
+        NUM_BUFFERS         = 6
+    };
+
+    uint m_maxParticles;
+    uint m_currAliveList;
+    uint m_seed;
+    Vector3f m_gravity;
+    bool m_depthSorted;
+    uint m_fullSortInterval;
+    uint m_frameCount;
+    GLuint m_buffers[NUM_BUFFERS];
+    GLuint m_VAO;
+    vector<EmitterState> m_emitters;
+    vector<PendingBurst> m_bursts;
+    PSEmitTechnique m_emitTech;
+    PSSimulateTechnique m_simulateTech;
+    PSPrepareTechnique m_prepareTech;
+    PSSortKeysTechnique m_sortKeysTech;
+    BillboardTechnique m_billboardTech;
+    BillboardTechnique m_sortedBillboardTech;
+    GPUBitonicSort m_sorter;
+    Texture* m_pTexture;
+};
+
+#endif	/* GPU_PARTICLE_SYSTEM_H */
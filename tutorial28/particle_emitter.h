@@ -0,0 +1,49 @@
+/*
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PARTICLE_EMITTER_H
+#define	PARTICLE_EMITTER_H
+
+#include "ogldev_math_3d.h"
+
+// Describes where new particles come from and how they start. Used by all
+// the particle system backends.
+struct ParticleEmitter
+{
+    Vector3f Pos;
+    Vector3f Dir;           // normalized
+    float Spread;           // 0 - exactly along Dir, 1 - any direction
+    float MinSpeed;
+    float MaxSpeed;
+    float MinLifetime;      // seconds
+    float MaxLifetime;
+    float EmitRate;         // particles per second
+
+    ParticleEmitter()
+    {
+        Pos = Vector3f(0.0f, 0.0f, 0.0f);
+        Dir = Vector3f(0.0f, 1.0f, 0.0f);
+        Spread = 0.2f;
+        MinSpeed = 1.0f;
+        MaxSpeed = 2.0f;
+        MinLifetime = 1.0f;
+        MaxLifetime = 2.0f;
+        EmitRate = 100.0f;
+    }
+};
+
+#endif	/* PARTICLE_EMITTER_H */
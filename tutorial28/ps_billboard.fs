@@ -0,0 +1,19 @@
+#version 330
+
+uniform sampler2D gColorMap;
+
+in vec2 TexCoord;
+in float Alpha;
+
+out vec4 FragColor;
+
+void main()
+{
+    vec4 Color = texture(gColorMap, TexCoord);
+
+    // The sprite is drawn on white and has no alpha channel so the distance
+    // from white is used as coverage
+    float Coverage = 1.0 - min(Color.r, min(Color.g, Color.b));
+
+    FragColor = vec4(Color.rgb, Coverage * Alpha);
+}
@@ -0,0 +1,51 @@
+#version 330
+
+layout(points) in;
+layout(triangle_strip) out;
+layout(max_vertices = 4) out;
+
+uniform mat4 gVP;
+uniform vec3 gCameraPos;
+uniform float gBillboardSize;
+
+in float Alpha0[];
+
+out vec2 TexCoord;
+out float Alpha;
+
+void main()
+{
+    if (Alpha0[0] <= 0.0) {
+        return;
+    }
+
+    vec3 Pos = gl_in[0].gl_Position.xyz;
+    vec3 toCamera = normalize(gCameraPos - Pos);
+    vec3 up = vec3(0.0, 1.0, 0.0);
+    vec3 right = cross(toCamera, up) * gBillboardSize;
+
+    Alpha = Alpha0[0];
+
+    Pos -= right;
+    gl_Position = gVP * vec4(Pos, 1.0);
+    TexCoord = vec2(0.0, 0.0);
+    EmitVertex();
+
+    Pos.y += gBillboardSize;
+    gl_Position = gVP * vec4(Pos, 1.0);
+    TexCoord = vec2(0.0, 1.0);
+    EmitVertex();
+
+    Pos.y -= gBillboardSize;
+    Pos += right;
+    gl_Position = gVP * vec4(Pos, 1.0);
+    TexCoord = vec2(1.0, 0.0);
+    EmitVertex();
+
+    Pos.y += gBillboardSize;
+    gl_Position = gVP * vec4(Pos, 1.0);
+    TexCoord = vec2(1.0, 1.0);
+    EmitVertex();
+
+    EndPrimitive();
+}
@@ -0,0 +1,191 @@
+/*
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ogldev_util.h"
+#include "ps_compute_technique.h"
+
+
+PSEmitTechnique::PSEmitTechnique()
+{
+}
+
+
+bool PSEmitTechnique::Init()
+{
+    if (!Technique::Init()) {
+        return false;
+    }
+
+    if (!AddShader(GL_COMPUTE_SHADER, "ps_emit.cs")) {
+        return false;
+    }
+
+    if (!Finalize()) {
+        return false;
+    }
+
+    m_emitCountLocation = GetUniformLocation("gEmitCount");
+    m_seedLocation = GetUniformLocation("gSeed");
+    m_posLocation = GetUniformLocation("gEmitterPos");
+    m_dirLocation = GetUniformLocation("gEmitterDir");
+    m_spreadLocation = GetUniformLocation("gSpread");
+    m_speedLocation = GetUniformLocation("gSpeed");
+    m_lifetimeLocation = GetUniformLocation("gLifetime");
+
+    if (m_emitCountLocation == INVALID_UNIFORM_LOCATION ||
+        m_seedLocation == INVALID_UNIFORM_LOCATION ||
+        m_posLocation == INVALID_UNIFORM_LOCATION ||
+        m_dirLocation == INVALID_UNIFORM_LOCATION ||
+        m_spreadLocation == INVALID_UNIFORM_LOCATION ||
+        m_speedLocation == INVALID_UNIFORM_LOCATION ||
+        m_lifetimeLocation == INVALID_UNIFORM_LOCATION) {
+        return false;
+    }
+
+    return GLCheckError();
+}
+
+
+void PSEmitTechnique::SetEmitter(const ParticleEmitter& Emitter)
+{
+    glUniform3f(m_posLocation, Emitter.Pos.x, Emitter.Pos.y, Emitter.Pos.z);
+    glUniform3f(m_dirLocation, Emitter.Dir.x, Emitter.Dir.y, Emitter.Dir.z);
+    glUniform1f(m_spreadLocation, Emitter.Spread);
+    glUniform2f(m_speedLocation, Emitter.MinSpeed, Emitter.MaxSpeed);
+    glUniform2f(m_lifetimeLocation, Emitter.MinLifetime, Emitter.MaxLifetime);
+}
+
+
+void PSEmitTechnique::SetEmitCount(uint Count)
+{
+    glUniform1ui(m_emitCountLocation, Count);
+}
+
+
+void PSEmitTechnique::SetSeed(uint Seed)
+{
+    glUniform1ui(m_seedLocation, Seed);
+}
+
+
+PSSimulateTechnique::PSSimulateTechnique()
+{
+}
+
+
+bool PSSimulateTechnique::Init()
+{
+    if (!Technique::Init()) {
+        return false;
+    }
+
+    if (!AddShader(GL_COMPUTE_SHADER, "ps_simulate.cs")) {
+        return false;
+    }
+
+    if (!Finalize()) {
+        return false;
+    }
+
+    m_deltaTimeLocation = GetUniformLocation("gDeltaTime");
+    m_gravityLocation = GetUniformLocation("gGravity");
+
+    if (m_deltaTimeLocation == INVALID_UNIFORM_LOCATION ||
+        m_gravityLocation == INVALID_UNIFORM_LOCATION) {
+        return false;
+    }
+
+    return GLCheckError();
+}
+
+
+void PSSimulateTechnique::SetDeltaTime(float DeltaTimeSecs)
+{
+    glUniform1f(m_deltaTimeLocation, DeltaTimeSecs);
+}
+
+
+void PSSimulateTechnique::SetGravity(const Vector3f& Gravity)
+{
+    glUniform3f(m_gravityLocation, Gravity.x, Gravity.y, Gravity.z);
+}
+
+
+PSPrepareTechnique::PSPrepareTechnique()
+{
+}
+
+
+bool PSPrepareTechnique::Init()
+{
+    if (!Technique::Init()) {
+        return false;
+    }
+
+    if (!AddShader(GL_COMPUTE_SHADER, "ps_prepare.cs")) {
+        return false;
+    }
+
+    if (!Finalize()) {
+        return false;
+    }
+
+    return GLCheckError();
+}
+
+
+PSSortKeysTechnique::PSSortKeysTechnique()
+{
+}
+
+
+bool PSSortKeysTechnique::Init()
+{
+    if (!Technique::Init()) {
+        return false;
+    }
+
+    if (!AddShader(GL_COMPUTE_SHADER, "ps_sort_keys.cs")) {
+        return false;
+    }
+
+    if (!Finalize()) {
+        return false;
+    }
+
+    m_cameraPosLocation = GetUniformLocation("gCameraPos");
+    m_numParticlesLocation = GetUniformLocation("gNumParticles");
+
+    if (m_cameraPosLocation == INVALID_UNIFORM_LOCATION ||
+        m_numParticlesLocation == INVALID_UNIFORM_LOCATION) {
+        return false;
+    }
+
+    return GLCheckError();
+}
+
+
+void PSSortKeysTechnique::SetCameraPosition(const Vector3f& Pos)
+{
+    glUniform3f(m_cameraPosLocation, Pos.x, Pos.y, Pos.z);
+}
+
+
+void PSSortKeysTechnique::SetNumParticles(uint NumParticles)
+{
+    glUniform1ui(m_numParticlesLocation, NumParticles);
+}
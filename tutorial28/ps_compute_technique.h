@@ -0,0 +1,120 @@
+/*
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PS_COMPUTE_TECHNIQUE_H
+#define	PS_COMPUTE_TECHNIQUE_H
+
+#include "technique.h"
+#include "ogldev_math_3d.h"
+#include "particle_emitter.h"
+
+// Shader storage binding points of GPUParticleSystem. Must match the ps_*.cs
+// shaders and ps_render.vs.
+#define PS_POS_AGE_BINDING              0
+#define PS_VEL_LIFETIME_BINDING         1
+#define PS_DEAD_LIST_BINDING            2
+#define PS_CURRENT_ALIVE_LIST_BINDING   3
+#define PS_NEXT_ALIVE_LIST_BINDING      4
+#define PS_COUNTERS_BINDING             5
+
+// Must match local_size_x in ps_emit.cs, ps_simulate.cs and ps_sort_keys.cs
+#define PS_EMIT_GROUP_SIZE              256
+#define PS_SIMULATE_GROUP_SIZE          256
+#define PS_SORT_KEYS_GROUP_SIZE         256
+
+
+// Takes dead particles and appends them to the next alive list
+class PSEmitTechnique : public Technique
+{
+public:
+
+    PSEmitTechnique();
+
+    virtual bool Init();
+
+    void SetEmitter(const ParticleEmitter& Emitter);
+
+    void SetEmitCount(uint Count);
+
+    void SetSeed(uint Seed);
+
+private:
+
+    GLuint m_emitCountLocation;
+    GLuint m_seedLocation;
+    GLuint m_posLocation;
+    GLuint m_dirLocation;
+    GLuint m_spreadLocation;
+    GLuint m_speedLocation;
+    GLuint m_lifetimeLocation;
+};
+
+
+// Integrates the current alive list. Survivors go to the next alive list
+// and the rest are pushed back to the dead list.
+class PSSimulateTechnique : public Technique
+{
+public:
+
+    PSSimulateTechnique();
+
+    virtual bool Init();
+
+    void SetDeltaTime(float DeltaTimeSecs);
+
+    void SetGravity(const Vector3f& Gravity);
+
+private:
+
+    GLuint m_deltaTimeLocation;
+    GLuint m_gravityLocation;
+};
+
+
+// Single thread that turns the alive count of the previous frame into the
+// arguments of the indirect simulation dispatch
+class PSPrepareTechnique : public Technique
+{
+public:
+
+    PSPrepareTechnique();
+
+    virtual bool Init();
+};
+
+
+// Writes the sort keys (negative squared distance from the camera) of the
+// particle slots in the sort list of GPUBitonicSort
+class PSSortKeysTechnique : public Technique
+{
+public:
+
+    PSSortKeysTechnique();
+
+    virtual bool Init();
+
+    void SetCameraPosition(const Vector3f& Pos);
+
+    void SetNumParticles(uint NumParticles);
+
+private:
+
+    GLuint m_cameraPosLocation;
+    GLuint m_numParticlesLocation;
+};
+
+#endif	/* PS_COMPUTE_TECHNIQUE_H */
@@ -0,0 +1,96 @@
+#version 430
+
+layout (local_size_x = 256) in;
+
+layout (std430, binding = 0) writeonly buffer PosAgeBuffer {
+    vec4 gPosAge[];
+};
+
+layout (std430, binding = 1) writeonly buffer VelLifetimeBuffer {
+    vec4 gVelLifetime[];
+};
+
+layout (std430, binding = 2) readonly buffer DeadListBuffer {
+    uint gDeadList[];
+};
+
+layout (std430, binding = 4) writeonly buffer NextAliveListBuffer {
+    uint gNextAliveList[];
+};
+
+// Must match GPUParticleSystem::Counters
+layout (std430, binding = 5) buffer CountersBuffer {
+    uint gDrawCount;
+    uint gDrawInstanceCount;
+    uint gDrawFirst;
+    uint gDrawBaseInstance;
+    uint gDispatchX;
+    uint gDispatchY;
+    uint gDispatchZ;
+    int gNumAlive;
+    int gNumDead;
+};
+
+uniform uint gEmitCount;
+uniform uint gSeed;
+uniform vec3 gEmitterPos;
+uniform vec3 gEmitterDir;
+uniform float gSpread;
+uniform vec2 gSpeed;            // min, max
+uniform vec2 gLifetime;         // min, max
+
+const float PI = 3.14159265;
+
+
+uint Hash(uint x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+
+float Random(inout uint State)
+{
+    State = Hash(State);
+    return float(State) / 4294967295.0;
+}
+
+
+void main()
+{
+    if (gl_GlobalInvocationID.x >= gEmitCount) {
+        return;
+    }
+
+    // Nothing else pushes to the dead list during this dispatch so a failed
+    // pop can simply be undone
+    int NumDead = atomicAdd(gNumDead, -1);
+
+    if (NumDead <= 0) {
+        atomicAdd(gNumDead, 1);
+        return;
+    }
+
+    uint Index = gDeadList[NumDead - 1];
+
+    uint State = Hash(gSeed ^ Hash(gl_GlobalInvocationID.x));
+
+    // Uniform direction on the sphere, pulled towards the emitter direction
+    float z = Random(State) * 2.0 - 1.0;
+    float Phi = Random(State) * 2.0 * PI;
+    float r = sqrt(1.0 - z * z);
+    vec3 RandomDir = vec3(r * cos(Phi), r * sin(Phi), z);
+    vec3 Dir = normalize(mix(gEmitterDir, RandomDir, gSpread) + gEmitterDir * 0.001);
+
+    float Speed = mix(gSpeed.x, gSpeed.y, Random(State));
+    float Lifetime = mix(gLifetime.x, gLifetime.y, Random(State));
+
+    gPosAge[Index] = vec4(gEmitterPos, 0.0);
+    gVelLifetime[Index] = vec4(Dir * Speed, Lifetime);
+
+    gNextAliveList[atomicAdd(gDrawCount, 1u)] = Index;
+}
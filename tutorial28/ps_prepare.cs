@@ -0,0 +1,27 @@
+#version 430
+
+layout (local_size_x = 1) in;
+
+// Must match GPUParticleSystem::Counters
+layout (std430, binding = 5) buffer CountersBuffer {
+    uint gDrawCount;            // DrawArraysIndirectCommand
+    uint gDrawInstanceCount;
+    uint gDrawFirst;
+    uint gDrawBaseInstance;
+    uint gDispatchX;            // DispatchIndirectCommand
+    uint gDispatchY;
+    uint gDispatchZ;
+    int gNumAlive;              // in the current alive list
+    int gNumDead;
+};
+
+// The draw count of the previous frame is the size of the list that is now
+// the current alive list. The simulation counts the survivors into it again.
+void main()
+{
+    gNumAlive = int(gDrawCount);
+    gDispatchX = (gDrawCount + 255u) / 256u;
+    gDispatchY = 1u;
+    gDispatchZ = 1u;
+    gDrawCount = 0u;
+}
@@ -0,0 +1,16 @@
+#version 430
+
+layout (std430, binding = 0) readonly buffer PosAgeBuffer {
+    vec4 gPosAge[];
+};
+
+layout (std430, binding = 4) readonly buffer NextAliveListBuffer {
+    uint gNextAliveList[];
+};
+
+// Vertex pulling - there are no vertex attributes. The draw count comes
+// from the simulation so only the alive particles are drawn.
+void main()
+{
+    gl_Position = vec4(gPosAge[gNextAliveList[gl_VertexID]].xyz, 1.0);
+}
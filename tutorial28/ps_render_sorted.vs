@@ -0,0 +1,23 @@
+#version 430
+
+layout (std430, binding = 0) readonly buffer PosAgeBuffer {
+    vec4 gPosAge[];
+};
+
+layout (std430, binding = 1) readonly buffer VelLifetimeBuffer {
+    vec4 gVelLifetime[];
+};
+
+out float Alpha0;
+
+// The element array is the sorted list of particle slots so gl_VertexID is
+// the slot. Every slot is drawn and the dead ones get a zero alpha which
+// makes the geometry shader skip them.
+void main()
+{
+    vec4 PosAge = gPosAge[gl_VertexID];
+    float Lifetime = gVelLifetime[gl_VertexID].w;
+
+    gl_Position = vec4(PosAge.xyz, 1.0);
+    Alpha0 = (PosAge.w < Lifetime) ? 1.0 - PosAge.w / Lifetime : 0.0;
+}
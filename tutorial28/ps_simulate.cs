@@ -0,0 +1,68 @@
+#version 430
+
+layout (local_size_x = 256) in;
+
+layout (std430, binding = 0) buffer PosAgeBuffer {
+    vec4 gPosAge[];             // xyz - position, w - age in seconds
+};
+
+layout (std430, binding = 1) buffer VelLifetimeBuffer {
+    vec4 gVelLifetime[];        // xyz - velocity, w - lifetime in seconds
+};
+
+layout (std430, binding = 2) buffer DeadListBuffer {
+    uint gDeadList[];
+};
+
+layout (std430, binding = 3) readonly buffer CurrentAliveListBuffer {
+    uint gCurrentAliveList[];
+};
+
+layout (std430, binding = 4) writeonly buffer NextAliveListBuffer {
+    uint gNextAliveList[];
+};
+
+// Must match GPUParticleSystem::Counters
+layout (std430, binding = 5) buffer CountersBuffer {
+    uint gDrawCount;
+    uint gDrawInstanceCount;
+    uint gDrawFirst;
+    uint gDrawBaseInstance;
+    uint gDispatchX;
+    uint gDispatchY;
+    uint gDispatchZ;
+    int gNumAlive;
+    int gNumDead;
+};
+
+uniform float gDeltaTime;
+uniform vec3 gGravity;
+
+void main()
+{
+    uint i = gl_GlobalInvocationID.x;
+
+    if (i >= uint(gNumAlive)) {
+        return;
+    }
+
+    uint Index = gCurrentAliveList[i];
+
+    vec4 PosAge = gPosAge[Index];
+    vec4 VelLifetime = gVelLifetime[Index];
+
+    PosAge.w += gDeltaTime;
+
+    if (PosAge.w >= VelLifetime.w) {
+        gDeadList[atomicAdd(gNumDead, 1)] = Index;
+        return;
+    }
+
+    VelLifetime.xyz += gGravity * gDeltaTime;
+    PosAge.xyz += VelLifetime.xyz * gDeltaTime;
+
+    gPosAge[Index] = PosAge;
+    gVelLifetime[Index] = VelLifetime;
+
+    gNextAliveList[atomicAdd(gDrawCount, 1u)] = Index;
+}
@@ -0,0 +1,46 @@
+#version 430
+
+layout (local_size_x = 256) in;
+
+layout (std430, binding = 0) readonly buffer PosAgeBuffer {
+    vec4 gPosAge[];
+};
+
+layout (std430, binding = 1) readonly buffer VelLifetimeBuffer {
+    vec4 gVelLifetime[];
+};
+
+// Bindings of GPUBitonicSort
+layout (std430, binding = 6) writeonly buffer KeyBuffer {
+    float gKeys[];
+};
+
+layout (std430, binding = 7) readonly buffer ValueBuffer {
+    uint gValues[];
+};
+
+uniform vec3 gCameraPos;
+uniform uint gNumParticles;
+
+// The sort list holds every particle slot in the order of the last sort.
+// The farthest particles get the smallest keys so an ascending sort gives
+// back to front order. Dead particles go to the end.
+void main()
+{
+    uint i = gl_GlobalInvocationID.x;
+
+    if (i >= gNumParticles) {
+        return;
+    }
+
+    uint Index = gValues[i];
+    vec4 PosAge = gPosAge[Index];
+
+    if (PosAge.w < gVelLifetime[Index].w) {
+        vec3 ToCamera = PosAge.xyz - gCameraPos;
+        gKeys[i] = -dot(ToCamera, ToCamera);
+    }
+    else {
+        gKeys[i] = uintBitsToFloat(0x7f800000u);     // +INF
+    }
+}
@@ -33,10 +33,26 @@
 #include "ogldev_glut_backend.h"
 #include "mesh.h"
 #include "particle_system.h"
+#include "gpu_particle_system.h"
+#include "cpu_particle_system.h"
 
 #define WINDOW_WIDTH  1920
 #define WINDOW_HEIGHT 1200
 
+#define GPU_MAX_PARTICLES 100000
+#define CPU_MAX_PARTICLES 100000
+#define NUM_BENCHMARK_FRAMES 100
+#define CPU_BENCHMARK_PARTICLES 1000000
+
+static const uint FullSortIntervals[] = { 1, 4, 16 };
+
+enum PARTICLE_BACKEND {
+    PARTICLE_BACKEND_TRANSFORM_FEEDBACK,
+    PARTICLE_BACKEND_COMPUTE,
+    PARTICLE_BACKEND_CPU,
+    NUM_PARTICLE_BACKENDS
+};
+
 
 class Tutorial28 : public ICallbacks, public OgldevApp
 {
@@ -62,6 +78,9 @@ public:
         m_persProjInfo.zFar = 100.0f;  
 
         m_currentTimeMillis = GetCurrentTimeMillis();
+        m_backend = PARTICLE_BACKEND_TRANSFORM_FEEDBACK;
+        m_sortIntervalIndex = 0;
+        m_isComputeAvailable = false;
     }
     
 
@@ -115,7 +134,50 @@ public:
         }
         
         Vector3f ParticleSystemPos = Vector3f(0.0f, 0.0f, 1.0f);
-                        
+
+        // The compute backend needs OpenGL 4.3 - without it the other two
+        // backends still run
+        m_isComputeAvailable = m_gpuParticleSystem.Init(GPU_MAX_PARTICLES);
+
+        if (!m_isComputeAvailable) {
+            printf("Error initializing the compute particle system - the compute backend is disabled\n");
+        }
+
+        ParticleEmitter Fountain;
+        Fountain.Pos = ParticleSystemPos;
+        Fountain.Dir = Vector3f(0.0f, 1.0f, 0.0f);
+        Fountain.Spread = 0.15f;
+        Fountain.MinSpeed = 2.0f;
+        Fountain.MaxSpeed = 3.0f;
+        Fountain.MinLifetime = 0.5f;
+        Fountain.MaxLifetime = 0.7f;
+        Fountain.EmitRate = 50000.0f;
+
+        if (m_isComputeAvailable) {
+            m_gpuParticleSystem.AddEmitter(Fountain);
+        }
+
+        if (!m_cpuParticleSystem.Init(CPU_MAX_PARTICLES) || !m_cpuParticleSystem.InitRendering()) {
+            printf("Error initializing the CPU particle system\n");
+            return false;
+        }
+
+        m_cpuParticleSystem.AddEmitter(Fountain);
+
+        ParticleEmitter Sparks;
+        Sparks.Pos = ParticleSystemPos + Vector3f(0.3f, 0.1f, 0.0f);
+        Sparks.Spread = 1.0f;
+        Sparks.MinSpeed = 0.1f;
+        Sparks.MaxSpeed = 0.5f;
+        Sparks.MinLifetime = 1.0f;
+        Sparks.MaxLifetime = 2.0f;
+        Sparks.EmitRate = 20000.0f;
+        if (m_isComputeAvailable) {
+            m_gpuParticleSystem.AddEmitter(Sparks);
+        }
+
+        m_cpuParticleSystem.AddEmitter(Sparks);
+
         return m_particleSystem.InitParticleSystem(ParticleSystemPos);
     }
 
@@ -152,12 +214,130 @@ public:
         
         m_pGround->Render();
         
-        m_particleSystem.Render(DeltaTimeMillis, p.GetVPTrans(), m_pGameCamera->GetPos());
+        switch (m_backend) {
+        case PARTICLE_BACKEND_TRANSFORM_FEEDBACK:
+            m_particleSystem.Render(DeltaTimeMillis, p.GetVPTrans(), m_pGameCamera->GetPos());
+            break;
+        case PARTICLE_BACKEND_COMPUTE:
+            m_gpuParticleSystem.Update((float)DeltaTimeMillis / 1000.0f);
+            m_gpuParticleSystem.Render(p.GetVPTrans(), m_pGameCamera->GetPos());
+            break;
+        case PARTICLE_BACKEND_CPU:
+            m_cpuParticleSystem.Update((float)DeltaTimeMillis / 1000.0f);
+            m_cpuParticleSystem.Render(p.GetVPTrans(), m_pGameCamera->GetPos());
+            break;
+        default:
+            break;
+        }
         
         glutSwapBuffers();
     }
 
 
+    // GPU time of the update and render of the compute particle system at
+    // increasing particle counts, unsorted with additive blending and depth
+    // sorted with a full sort every frame. The particles are emitted in one
+    // burst with a lifetime longer than the benchmark so the count stays
+    // constant.
+    void RunGPUBenchmark()
+    {
+        static const uint ParticleCounts[] = { 1000, 10000, 100000, 1000000, 2000000, 4000000 };
+
+        Pipeline p;
+        p.SetCamera(m_pGameCamera->GetPos(), m_pGameCamera->GetTarget(), m_pGameCamera->GetUp());
+        p.SetPerspectiveProj(m_persProjInfo);
+
+        ParticleEmitter Emitter;
+        Emitter.Pos = Vector3f(0.0f, 0.5f, 1.0f);
+        Emitter.Spread = 1.0f;
+        Emitter.MinSpeed = 0.0f;
+        Emitter.MaxSpeed = 0.1f;
+        Emitter.MinLifetime = 1000.0f;
+        Emitter.MaxLifetime = 1000.0f;
+
+        printf("Compute particle system benchmark (%d frames)\n", NUM_BENCHMARK_FRAMES);
+
+        GLuint Query;
+        glGenQueries(1, &Query);
+
+        for (uint i = 0 ; i < ARRAY_SIZE_IN_ELEMENTS(ParticleCounts) ; i++) {
+            GPUParticleSystem* pSystem = new GPUParticleSystem();
+
+            if (!pSystem->Init(ParticleCounts[i])) {
+                printf("    %8d particles: init failed\n", ParticleCounts[i]);
+                delete pSystem;
+                break;
+            }
+
+            pSystem->SetGravity(Vector3f(0.0f, 0.0f, 0.0f));
+            pSystem->Burst(Emitter, ParticleCounts[i]);
+            pSystem->Update(0.0f);
+
+            double TimeMillis[2];
+
+            for (uint Sorted = 0 ; Sorted < 2 ; Sorted++) {
+                pSystem->SetDepthSorted(Sorted == 1);
+                glFinish();
+
+                glBeginQuery(GL_TIME_ELAPSED, Query);
+
+                for (uint j = 0 ; j < NUM_BENCHMARK_FRAMES ; j++) {
+                    pSystem->Update(1.0f / 60.0f);
+                    pSystem->Render(p.GetVPTrans(), m_pGameCamera->GetPos());
+                }
+
+                glEndQuery(GL_TIME_ELAPSED);
+
+                GLuint64 GPUTimeNanos = 0;
+                glGetQueryObjectui64v(Query, GL_QUERY_RESULT, &GPUTimeNanos);
+                TimeMillis[Sorted] = (double)GPUTimeNanos / 1000000.0 / NUM_BENCHMARK_FRAMES;
+            }
+
+            printf("    %8d particles: %.3f ms per frame, %.3f ms depth sorted\n", ParticleCounts[i],
+                   TimeMillis[0], TimeMillis[1]);
+
+            delete pSystem;
+        }
+
+        glDeleteQueries(1, &Query);
+    }
+
+
+    // Simulation throughput of the CPU backend with 1 thread and with all
+    // the threads. Nothing is rendered.
+    void RunCPUBenchmark()
+    {
+        ParticleEmitter Emitter;
+        Emitter.Spread = 1.0f;
+        Emitter.MinLifetime = 1000.0f;
+        Emitter.MaxLifetime = 1000.0f;
+
+        uint NumThreads[2] = { 1, 0 };
+
+        printf("CPU particle system benchmark (%d particles x %d updates)\n", CPU_BENCHMARK_PARTICLES, NUM_BENCHMARK_FRAMES);
+
+        for (uint i = 0 ; i < ARRAY_SIZE_IN_ELEMENTS(NumThreads) ; i++) {
+            CPUParticleSystem System;
+            System.Init(CPU_BENCHMARK_PARTICLES, NumThreads[i]);
+            System.Burst(Emitter, CPU_BENCHMARK_PARTICLES);
+
+            long long StartTime = GetCurrentTimeMillis();
+
+            for (uint j = 0 ; j < NUM_BENCHMARK_FRAMES ; j++) {
+                System.Update(1.0f / 60.0f);
+            }
+
+            long long TimeMillis = MAX(GetCurrentTimeMillis() - StartTime, 1);
+
+            double ParticlesPerSec = (double)CPU_BENCHMARK_PARTICLES * NUM_BENCHMARK_FRAMES / ((double)TimeMillis / 1000.0);
+
+            printf("    %2d threads (%s): %lld ms, %.2f million particles per second, %.2f per thread\n",
+                   System.GetNumThreads(), System.IsUsingAVX() ? "AVX" : "SSE", TimeMillis, ParticlesPerSec / 1000000.0,
+                   ParticlesPerSec / 1000000.0 / System.GetNumThreads());
+        }
+    }
+
+
 	void KeyboardCB(OGLDEV_KEY OgldevKey, OGLDEV_KEY_STATE State)
 	{
 		switch (OgldevKey) {
@@ -165,6 +345,38 @@ public:
 		case OGLDEV_KEY_q:
 			GLUTBackendLeaveMainLoop();
 			break;
+		case OGLDEV_KEY_g:
+			m_backend = (m_backend + 1) % NUM_PARTICLE_BACKENDS;
+
+			if ((m_backend == PARTICLE_BACKEND_COMPUTE) && !m_isComputeAvailable) {
+				m_backend = (m_backend + 1) % NUM_PARTICLE_BACKENDS;
+			}
+			break;
+		case OGLDEV_KEY_s:
+			if (m_isComputeAvailable) {
+				m_gpuParticleSystem.SetDepthSorted(!m_gpuParticleSystem.IsDepthSorted());
+			}
+			break;
+		case OGLDEV_KEY_i:
+			if (!m_isComputeAvailable) {
+				break;
+			}
+
+			m_sortIntervalIndex = (m_sortIntervalIndex + 1) % ARRAY_SIZE_IN_ELEMENTS(FullSortIntervals);
+			m_gpuParticleSystem.SetFullSortInterval(FullSortIntervals[m_sortIntervalIndex]);
+			printf("Full depth sort every %d frames\n", FullSortIntervals[m_sortIntervalIndex]);
+			break;
+		case OGLDEV_KEY_b:
+			if (m_isComputeAvailable) {
+				RunGPUBenchmark();
+			}
+			else {
+				printf("The compute particle system is not available\n");
+			}
+			break;
+		case OGLDEV_KEY_n:
+			RunCPUBenchmark();
+			break;
 		default:
 			m_pGameCamera->OnKeyboard(OgldevKey);
 		}
@@ -187,6 +399,11 @@ public:
     Texture* m_pNormalMap;
     PersProjInfo m_persProjInfo;
     ParticleSystem m_particleSystem;
+    GPUParticleSystem m_gpuParticleSystem;
+    CPUParticleSystem m_cpuParticleSystem;
+    int m_backend;
+    uint m_sortIntervalIndex;
+    bool m_isComputeAvailable;
 };
 
 
@@ -141,6 +141,14 @@ void Mesh::InitMesh(unsigned int Index, const aiMesh* paiMesh)
     }
 
     m_Entries[Index].Init(Vertices, Indices);
+
+    std::vector<Vector3f> Positions(Vertices.size());
+
+    for (unsigned int i = 0 ; i < Vertices.size() ; i++) {
+        Positions[i] = Vertices[i].m_pos;
+    }
+
+    m_Entries[Index].BVH.Build(Positions, Indices);
 }
 
 bool Mesh::InitMaterials(const aiScene* pScene, const std::string& Filename)
@@ -252,4 +260,43 @@ void Mesh::Render(unsigned int DrawIndex, unsigned int PrimID)
     glDisableVertexAttribArray(0);
     glDisableVertexAttribArray(1);
     glDisableVertexAttribArray(2);    
-}
\ No newline at end of file
+}
+
+
+bool Mesh::Pick(const Vector3f& Origin, const Vector3f& Dir, unsigned int& DrawIndex, unsigned int& PrimID, float& Distance) const
+{
+    bool Ret = false;
+    Distance = FLT_MAX;
+
+    for (unsigned int i = 0 ; i < m_Entries.size() ; i++) {
+        BVHHit Hit;
+
+        if (m_Entries[i].BVH.Intersect(Origin, Dir, Hit, Distance)) {
+            DrawIndex = i;
+            PrimID = Hit.Triangle;
+            Distance = Hit.Distance;
+            Ret = true;
+        }
+    }
+
+    return Ret;
+}
+
+
+bool Mesh::VerifyBVH(unsigned int NumRays) const
+{
+    bool Ret = true;
+
+    for (unsigned int i = 0 ; i < m_Entries.size() ; i++) {
+        unsigned int NumErrors = m_Entries[i].BVH.Verify(NumRays);
+
+        printf("Entry %d: %d triangles, %d BVH nodes, %d/%d mismatches\n", i, m_Entries[i].BVH.GetNumTriangles(),
+               m_Entries[i].BVH.GetNumNodes(), NumErrors, NumRays);
+
+        if (NumErrors > 0) {
+            Ret = false;
+        }
+    }
+
+    return Ret;
+}
@@ -29,6 +29,7 @@
 #include "ogldev_util.h"
 #include "ogldev_math_3d.h"
 #include "ogldev_texture.h"
+#include "ogldev_bvh.h"
 #include "render_callbacks.h"
 
 struct Vertex
@@ -61,6 +62,14 @@ public:
     
     void Render(unsigned int DrawIndex, unsigned int PrimID);
 
+    // CPU picking with an object space ray. DrawIndex and PrimID match the
+    // values written by the picking pass (before the increment in the FS).
+    bool Pick(const Vector3f& Origin, const Vector3f& Dir, unsigned int& DrawIndex, unsigned int& PrimID, float& Distance) const;
+
+    // Compares the BVH of every entry against brute force on random rays.
+    // Returns false if any ray got a different hit.
+    bool VerifyBVH(unsigned int NumRays) const;
+
 private:
     bool InitFromScene(const aiScene* pScene, const std::string& Filename);
     void InitMesh(unsigned int Index, const aiMesh* paiMesh);
@@ -81,6 +90,7 @@ private:
         GLuint IB;
         unsigned int NumIndices;
         unsigned int MaterialIndex;
+        TriangleBVH BVH;
     };
 
     std::vector<MeshEntry> m_Entries;
@@ -17,16 +17,67 @@
 
 
 #include <stdio.h>
+#include <string.h>
 
 #include "picking_texture.h"
 #include "picking_technique.h"
 #include "ogldev_util.h"
 
+#define FENCE_TIMEOUT_NANOS 1000000000
+
+
+PickFuture::PickFuture()
+{
+    m_pTexture = NULL;
+    m_slot = 0;
+    m_serial = 0;
+    m_x = 0;
+    m_y = 0;
+    m_width = 0;
+    m_height = 0;
+}
+
+
+bool PickFuture::IsValid() const
+{
+    return m_pTexture && (m_pTexture->m_slots[m_slot].Serial == m_serial);
+}
+
+
+bool PickFuture::IsReady() const
+{
+    return m_pTexture && m_pTexture->IsSlotReady(m_slot, m_serial, false);
+}
+
+
+bool PickFuture::Get(std::vector<PickingPixelInfo>& Pixels) const
+{
+    if (!m_pTexture || !m_pTexture->IsSlotReady(m_slot, m_serial, true)) {
+        return false;
+    }
+
+    Pixels = m_pTexture->m_slots[m_slot].Pixels;
+
+    return true;
+}
+
+
 PickingTexture::PickingTexture()
 {
     m_fbo = 0;
     m_pickingTexture = 0;
     m_depthTexture = 0;
+    m_windowWidth = 0;
+    m_windowHeight = 0;
+    m_nextSlot = 0;
+    m_nextSerial = 1;
+
+    for (unsigned int i = 0 ; i < PICKING_NUM_PBOS ; i++) {
+        m_slots[i].PBO = 0;
+        m_slots[i].Fence = 0;
+        m_slots[i].Serial = 0;
+        m_slots[i].NumPixels = 0;
+    }
 }
 
 PickingTexture::~PickingTexture()
@@ -42,11 +93,24 @@ PickingTexture::~PickingTexture()
     if (m_depthTexture != 0) {
         glDeleteTextures(1, &m_depthTexture);
     }
+
+    for (unsigned int i = 0 ; i < PICKING_NUM_PBOS ; i++) {
+        if (m_slots[i].Fence) {
+            glDeleteSync(m_slots[i].Fence);
+        }
+
+        if (m_slots[i].PBO != 0) {
+            glDeleteBuffers(1, &m_slots[i].PBO);
+        }
+    }
 }
 
 
 bool PickingTexture::Init(unsigned int WindowWidth, unsigned int WindowHeight)
 {
+    m_windowWidth = WindowWidth;
+    m_windowHeight = WindowHeight;
+
     // Create the FBO
     glGenFramebuffers(1, &m_fbo);    
     glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
@@ -78,6 +142,15 @@ bool PickingTexture::Init(unsigned int WindowWidth, unsigned int WindowHeight)
     glBindTexture(GL_TEXTURE_2D, 0);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
+    // The pixel buffers of the asynchronous reads
+    for (unsigned int i = 0 ; i < PICKING_NUM_PBOS ; i++) {
+        glGenBuffers(1, &m_slots[i].PBO);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, m_slots[i].PBO);
+        glBufferData(GL_PIXEL_PACK_BUFFER, sizeof(PixelInfo) * PICKING_MAX_READ_SIZE * PICKING_MAX_READ_SIZE, NULL, GL_STREAM_READ);
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
     return GLCheckError();
 }
 
@@ -105,4 +178,98 @@ PickingTexture::PixelInfo PickingTexture::ReadPixel(unsigned int x, unsigned int
     glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
 
     return Pixel;
-}
\ No newline at end of file
+}
+
+
+// glReadPixels into a bound PIXEL_PACK buffer only queues the copy. The
+// fence tells when the copy is done and mapping the buffer won't stall.
+PickFuture PickingTexture::ReadRectAsync(unsigned int x, unsigned int y, unsigned int Width, unsigned int Height)
+{
+    PickFuture Future;
+
+    if (x >= m_windowWidth || y >= m_windowHeight) {
+        return Future;
+    }
+
+    Width = MIN(MIN(Width, (unsigned int)PICKING_MAX_READ_SIZE), m_windowWidth - x);
+    Height = MIN(MIN(Height, (unsigned int)PICKING_MAX_READ_SIZE), m_windowHeight - y);
+
+    if (Width == 0 || Height == 0) {
+        return Future;
+    }
+
+    unsigned int Slot = m_nextSlot;
+    m_nextSlot = (m_nextSlot + 1) % PICKING_NUM_PBOS;
+
+    // The read that used this slot before is dropped. Its future becomes
+    // invalid.
+    ReadSlot& s = m_slots[Slot];
+
+    if (s.Fence) {
+        glDeleteSync(s.Fence);
+    }
+
+    s.Serial = m_nextSerial++;
+    s.NumPixels = Width * Height;
+
+    if (m_nextSerial == 0) {
+        m_nextSerial = 1;
+    }
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, s.PBO);
+    glReadPixels(x, y, Width, Height, GL_RGB, GL_FLOAT, NULL);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glReadBuffer(GL_NONE);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+    s.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    Future.m_pTexture = this;
+    Future.m_slot = Slot;
+    Future.m_serial = s.Serial;
+    Future.m_x = x;
+    Future.m_y = y;
+    Future.m_width = Width;
+    Future.m_height = Height;
+
+    return Future;
+}
+
+
+// The first time the fence of a slot is found signaled the pixels are copied
+// from the PBO so later calls don't touch GL
+bool PickingTexture::IsSlotReady(unsigned int Slot, unsigned int Serial, bool Wait)
+{
+    ReadSlot& s = m_slots[Slot];
+
+    if (s.Serial != Serial) {
+        return false;
+    }
+
+    if (s.Fence) {
+        GLenum Status = glClientWaitSync(s.Fence, GL_SYNC_FLUSH_COMMANDS_BIT, Wait ? FENCE_TIMEOUT_NANOS : 0);
+
+        if (Status != GL_ALREADY_SIGNALED && Status != GL_CONDITION_SATISFIED) {
+            return false;
+        }
+
+        glDeleteSync(s.Fence);
+        s.Fence = 0;
+
+        s.Pixels.resize(s.NumPixels);
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, s.PBO);
+        void* pData = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, sizeof(PixelInfo) * s.NumPixels, GL_MAP_READ_BIT);
+
+        if (pData) {
+            memcpy(&s.Pixels[0], pData, sizeof(PixelInfo) * s.NumPixels);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    return true;
+}
@@ -18,8 +18,68 @@
 #ifndef SHADOWMAPFBO_H
 #define	SHADOWMAPFBO_H
 
+#include <vector>
 #include <GL/glew.h>
 
+// Number of asynchronous reads that can be in flight
+#define PICKING_NUM_PBOS 3
+
+// Largest rectangle that ReadRectAsync can read
+#define PICKING_MAX_READ_SIZE 16
+
+struct PickingPixelInfo {
+    float ObjectID;
+    float DrawID;
+    float PrimID;
+
+    PickingPixelInfo()
+    {
+        ObjectID = 0.0f;
+        DrawID = 0.0f;
+        PrimID = 0.0f;
+    }
+};
+
+
+class PickingTexture;
+
+// Result of PickingTexture::ReadRectAsync. The read is complete once the GPU
+// is done with the frame that issued it, which is normally one or two
+// frames later. Only IsReady is non blocking.
+class PickFuture
+{
+public:
+    PickFuture();
+
+    // False for a default constructed future or once the PBO of the read
+    // was taken by a newer read
+    bool IsValid() const;
+
+    bool IsReady() const;
+
+    // Blocks until the read is complete. The pixels are in rows from the
+    // bottom of the rectangle.
+    bool Get(std::vector<PickingPixelInfo>& Pixels) const;
+
+    // The rectangle after clipping
+    unsigned int GetX() const { return m_x; }
+    unsigned int GetY() const { return m_y; }
+    unsigned int GetWidth() const { return m_width; }
+    unsigned int GetHeight() const { return m_height; }
+
+private:
+    friend class PickingTexture;
+
+    PickingTexture* m_pTexture;
+    unsigned int m_slot;
+    unsigned int m_serial;
+    unsigned int m_x;
+    unsigned int m_y;
+    unsigned int m_width;
+    unsigned int m_height;
+};
+
+
 class PickingTexture
 {
 public:
@@ -33,25 +93,39 @@ public:
     
     void DisableWriting();
     
-    struct PixelInfo {
-        float ObjectID;
-        float DrawID;
-        float PrimID;
-        
-        PixelInfo()
-        {
-            ObjectID = 0.0f;
-            DrawID = 0.0f;
-            PrimID = 0.0f;
-        }
-    };
+    typedef PickingPixelInfo PixelInfo;
 
+    // Blocks until the GPU has finished rendering the picking texture
     PixelInfo ReadPixel(unsigned int x, unsigned int y);
+
+    // Starts copying the rectangle with its lower left corner at (x, y) into
+    // a pixel buffer object and returns without waiting for the GPU. The
+    // rectangle is clipped to the window and to PICKING_MAX_READ_SIZE.
+    PickFuture ReadRectAsync(unsigned int x, unsigned int y, unsigned int Width, unsigned int Height);
+
+    PickFuture ReadPixelAsync(unsigned int x, unsigned int y) { return ReadRectAsync(x, y, 1, 1); }
     
 private:
+    friend class PickFuture;
+
+    struct ReadSlot {
+        GLuint PBO;
+        GLsync Fence;
+        unsigned int Serial;
+        unsigned int NumPixels;
+        std::vector<PixelInfo> Pixels;
+    };
+
+    bool IsSlotReady(unsigned int Slot, unsigned int Serial, bool Wait);
+
     GLuint m_fbo;
     GLuint m_pickingTexture;
     GLuint m_depthTexture;
+    unsigned int m_windowWidth;
+    unsigned int m_windowHeight;
+    ReadSlot m_slots[PICKING_NUM_PBOS];
+    unsigned int m_nextSlot;
+    unsigned int m_nextSerial;
 };
 
 #endif	/* SHADOWMAPFBO_H */
@@ -38,6 +38,9 @@
 #define WINDOW_WIDTH  1680
 #define WINDOW_HEIGHT 1050
 
+// Size of the rectangle around the cursor that is read for hover picking
+#define HOVER_RECT_SIZE 5
+
 class Tutorial29 : public ICallbacks, public OgldevApp
 {
 public:
@@ -50,6 +53,10 @@ public:
         m_directionalLight.DiffuseIntensity = 0.01f;        
         m_directionalLight.Direction = Vector3f(1.0f, -1.0, 0.0);
         m_leftMouseButton.IsPressed = false;
+        m_mouseX = 0;
+        m_mouseY = 0;
+        m_hoverPicking = true;
+        m_cpuPicking = false;
         m_worldPos[0] = Vector3f(-10.0f, 0.0f, 5.0f);
         m_worldPos[1] = Vector3f(10.0f, 0.0f, 5.0f);
         
@@ -109,7 +116,14 @@ public:
     {
         m_pGameCamera->OnRender();        
 
-        PickingPhase();
+        if (m_cpuPicking) {
+            CPUPickingPhase();
+        }
+        else {
+            PickingPhase();
+            ResolvePicks();
+        }
+
         RenderPhase();
                
         glutSwapBuffers();
@@ -138,9 +152,93 @@ public:
         }
         
         m_pickingTexture.DisableWriting();        
+
+        // The result is used a frame or two later when the copy is done so
+        // the CPU never waits for the GPU
+        if ((m_hoverPicking || m_leftMouseButton.IsPressed) && (m_pendingPicks.size() < PICKING_NUM_PBOS)) {
+            int x = m_mouseX - HOVER_RECT_SIZE / 2;
+            int y = WINDOW_HEIGHT - m_mouseY - 1 - HOVER_RECT_SIZE / 2;
+            m_pendingPicks.push_back(m_pickingTexture.ReadRectAsync(MAX(x, 0), MAX(y, 0), HOVER_RECT_SIZE, HOVER_RECT_SIZE));
+        }
     }
 
-    
+
+    // Takes the newest completed read. Prefers the pixel under the cursor and
+    // falls back to the closest pixel of the rectangle that hit a triangle.
+    void ResolvePicks()
+    {
+        while (!m_pendingPicks.empty()) {
+            const PickFuture& Future = m_pendingPicks.front();
+
+            if (Future.IsValid() && !Future.IsReady()) {
+                break;
+            }
+
+            vector<PickingTexture::PixelInfo> Pixels;
+
+            if (Future.Get(Pixels)) {
+                int CursorX = m_mouseX;
+                int CursorY = WINDOW_HEIGHT - m_mouseY - 1;
+                int BestDistance = -1;
+
+                m_pickedPixel = PickingTexture::PixelInfo();
+
+                for (uint i = 0 ; i < Pixels.size() ; i++) {
+                    int dx = (int)(Future.GetX() + i % Future.GetWidth()) - CursorX;
+                    int dy = (int)(Future.GetY() + i / Future.GetWidth()) - CursorY;
+                    int Distance = dx * dx + dy * dy;
+
+                    if ((Pixels[i].PrimID != 0) && (BestDistance < 0 || Distance < BestDistance)) {
+                        m_pickedPixel = Pixels[i];
+                        BestDistance = Distance;
+                    }
+                }
+            }
+
+            m_pendingPicks.erase(m_pendingPicks.begin());
+        }
+    }
+
+
+    // Traces the ray under the cursor against the BVH of the mesh. Needs
+    // neither the picking pass nor a read back. The ray is moved into the
+    // object space of every instance so the tree is shared by all of them.
+    void CPUPickingPhase()
+    {
+        if (!m_hoverPicking && !m_leftMouseButton.IsPressed) {
+            return;
+        }
+
+        Pipeline p;
+        p.Scale(0.1f, 0.1f, 0.1f);
+        p.Rotate(0.0f, 90.0f, 0.0f);
+        p.SetCamera(m_pGameCamera->GetPos(), m_pGameCamera->GetTarget(), m_pGameCamera->GetUp());
+        p.SetPerspectiveProj(m_persProjInfo);
+
+        m_pickedPixel = PickingTexture::PixelInfo();
+        float BestDistance = FLT_MAX;
+
+        for (uint i = 0 ; i < ARRAY_SIZE_IN_ELEMENTS(m_worldPos) ; i++) {
+            p.WorldPos(m_worldPos[i]);
+
+            Vector3f Origin, Dir;
+            CalcPickRay(m_mouseX, m_mouseY, WINDOW_WIDTH, WINDOW_HEIGHT, p.GetWVPTrans(), Origin, Dir);
+
+            // The distance is a fraction of the near to far segment, so it
+            // can be compared between the objects
+            uint DrawIndex, PrimID;
+            float Distance;
+
+            if (m_pMesh->Pick(Origin, Dir, DrawIndex, PrimID, Distance) && (Distance < BestDistance)) {
+                BestDistance = Distance;
+                m_pickedPixel.ObjectID = (float)i;
+                m_pickedPixel.DrawID = (float)DrawIndex;
+                m_pickedPixel.PrimID = (float)(PrimID + 1);
+            }
+        }
+    }
+
+
     void RenderPhase()
     {
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -151,11 +249,10 @@ public:
         p.SetCamera(m_pGameCamera->GetPos(), m_pGameCamera->GetTarget(), m_pGameCamera->GetUp());
         p.SetPerspectiveProj(m_persProjInfo);
         
-        // If the left mouse button is clicked check if it hit a triangle
-        // and color it red
-        if (m_leftMouseButton.IsPressed) {
-            PickingTexture::PixelInfo Pixel = m_pickingTexture.ReadPixel(m_leftMouseButton.x, WINDOW_HEIGHT - m_leftMouseButton.y - 1);
-            GLExitIfError;
+        // If the cursor is over a triangle (or the left mouse button is
+        // clicked when hover picking is off) color it red
+        if (m_hoverPicking || m_leftMouseButton.IsPressed) {
+            const PickingTexture::PixelInfo& Pixel = m_pickedPixel;
             if (Pixel.PrimID != 0) {                
                 m_simpleColorEffect.Enable();
                 assert(Pixel.ObjectID < ARRAY_SIZE_IN_ELEMENTS(m_worldPos));
@@ -201,6 +298,19 @@ public:
 
             case 'x':
                 m_directionalLight.DiffuseIntensity -= 0.05f;
+                break;
+
+            case 'h':
+                m_hoverPicking = !m_hoverPicking;
+                break;
+
+            case 'c':
+                m_cpuPicking = !m_cpuPicking;
+                m_pendingPicks.clear();
+                break;
+
+            case 'v':
+                printf("BVH check %s\n", m_pMesh->VerifyBVH(1000) ? "passed" : "FAILED");
                 break;
 			default:
 				m_pGameCamera->OnKeyboard(OgldevKey);
@@ -210,6 +320,8 @@ public:
 
     virtual void PassiveMouseCB(int x, int y)
     {
+        m_mouseX = x;
+        m_mouseY = y;
         m_pGameCamera->OnMouse(x, y);
     }
     
@@ -220,6 +332,8 @@ public:
             m_leftMouseButton.IsPressed = (State == OGLDEV_KEY_STATE_PRESS);
             m_leftMouseButton.x = x;
             m_leftMouseButton.y = y;
+            m_mouseX = x;
+            m_mouseY = y;
         }
     }
 
@@ -237,6 +351,12 @@ private:
         int x;
         int y;
     } m_leftMouseButton;
+    int m_mouseX;
+    int m_mouseY;
+    bool m_hoverPicking;
+    bool m_cpuPicking;
+    vector<PickFuture> m_pendingPicks;
+    PickingTexture::PixelInfo m_pickedPixel;
     Vector3f m_worldPos[2];
     PersProjInfo m_persProjInfo;	
 };
@@ -30,22 +30,24 @@ DSLightPassTech::DSLightPassTech()
 bool DSLightPassTech::Init()
 {
     m_WVPLocation = GetUniformLocation("gWVP");
-	m_posTextureUnitLocation = GetUniformLocation("gPositionMap");
+	m_depthTextureUnitLocation = GetUniformLocation("gDepthMap");
 	m_colorTextureUnitLocation = GetUniformLocation("gColorMap");
 	m_normalTextureUnitLocation = GetUniformLocation("gNormalMap");
     m_eyeWorldPosLocation = GetUniformLocation("gEyeWorldPos");
     m_matSpecularIntensityLocation = GetUniformLocation("gMatSpecularIntensity");
     m_matSpecularPowerLocation = GetUniformLocation("gSpecularPower");
     m_screenSizeLocation = GetUniformLocation("gScreenSize");
+    m_invViewProjLocation = GetUniformLocation("gInvViewProj");
 
 	if (m_WVPLocation == INVALID_UNIFORM_LOCATION ||
-        m_posTextureUnitLocation == INVALID_UNIFORM_LOCATION ||
+        m_depthTextureUnitLocation == INVALID_UNIFORM_LOCATION ||
         m_colorTextureUnitLocation == INVALID_UNIFORM_LOCATION ||
 		m_normalTextureUnitLocation == INVALID_UNIFORM_LOCATION ||
         m_eyeWorldPosLocation == INVALID_UNIFORM_LOCATION ||
         m_matSpecularIntensityLocation == INVALID_UNIFORM_LOCATION ||
         m_matSpecularPowerLocation == INVALID_UNIFORM_LOCATION ||
-        m_screenSizeLocation == INVALID_UNIFORM_LOCATION) {
+        m_screenSizeLocation == INVALID_UNIFORM_LOCATION ||
+        m_invViewProjLocation == INVALID_UNIFORM_LOCATION) {
         return false;
     }
 
@@ -59,9 +61,9 @@ void DSLightPassTech::SetWVP(const Matrix4f& WVP)
 }
 
 
-void DSLightPassTech::SetPositionTextureUnit(unsigned int TextureUnit)
+void DSLightPassTech::SetDepthTextureUnit(unsigned int TextureUnit)
 {
-    glUniform1i(m_posTextureUnitLocation, TextureUnit);
+    glUniform1i(m_depthTextureUnitLocation, TextureUnit);
 }
 
 
@@ -86,4 +88,10 @@ void DSLightPassTech::SetEyeWorldPos(const Vector3f& EyePos)
 void DSLightPassTech::SetScreenSize(unsigned int Width, unsigned int Height)
 {
     glUniform2f(m_screenSizeLocation, (float)Width, (float)Height);
-}
\ No newline at end of file
+}
+
+
+void DSLightPassTech::SetInverseViewProjection(const Matrix4f& InvViewProj)
+{
+    glUniformMatrix4fv(m_invViewProjLocation, 1, GL_TRUE, (const GLfloat*)InvViewProj.m);
+}
@@ -56,9 +56,13 @@ bool GBuffer::Init(unsigned int WindowWidth, unsigned int WindowHeight)
     glGenTextures(ARRAY_SIZE_IN_ELEMENTS(m_textures), m_textures);
 	glGenTextures(1, &m_depthTexture);
 
+    // 8 bytes per pixel plus depth. The position is not stored.
+    GLenum InternalFormats[GBUFFER_NUM_TEXTURES] = { GL_RGBA8, GL_RG16 };
+    GLenum Formats[GBUFFER_NUM_TEXTURES] = { GL_RGBA, GL_RG };
+
     for (unsigned int i = 0 ; i < ARRAY_SIZE_IN_ELEMENTS(m_textures) ; i++) {
     	glBindTexture(GL_TEXTURE_2D, m_textures[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, WindowWidth, WindowHeight, 0, GL_RGB, GL_FLOAT, NULL);
+        glTexImage2D(GL_TEXTURE_2D, 0, InternalFormats[i], WindowWidth, WindowHeight, 0, Formats[i], GL_UNSIGNED_BYTE, NULL);
         glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
         glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, m_textures[i], 0);
@@ -67,11 +71,12 @@ bool GBuffer::Init(unsigned int WindowWidth, unsigned int WindowHeight)
 	// depth
 	glBindTexture(GL_TEXTURE_2D, m_depthTexture);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, WindowWidth, WindowHeight, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_depthTexture, 0);
 
-   	GLenum DrawBuffers[] = { GL_COLOR_ATTACHMENT0, 
-						     GL_COLOR_ATTACHMENT1,
-						     GL_COLOR_ATTACHMENT2 };
+   	GLenum DrawBuffers[] = { GL_COLOR_ATTACHMENT0,
+						     GL_COLOR_ATTACHMENT1 };
 
     glDrawBuffers(ARRAY_SIZE_IN_ELEMENTS(DrawBuffers), DrawBuffers);
 
@@ -100,7 +105,10 @@ void GBuffer::BindForReading()
 	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
 
 	for (unsigned int i = 0 ; i < ARRAY_SIZE_IN_ELEMENTS(m_textures); i++) {
-		glActiveTexture(GL_TEXTURE0 + i);		
-		glBindTexture(GL_TEXTURE_2D, m_textures[GBUFFER_TEXTURE_TYPE_POSITION + i]);
+		glActiveTexture(GL_TEXTURE0 + i);
+		glBindTexture(GL_TEXTURE_2D, m_textures[i]);
 	}
+
+	glActiveTexture(GL_TEXTURE0 + GBUFFER_DEPTH_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, m_depthTexture);
 }
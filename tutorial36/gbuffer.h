@@ -20,18 +20,17 @@
 
 #include <GL/glew.h>
 
-#define GBUFFER_POSITION_TEXTURE_UNIT 0
-#define GBUFFER_DIFFUSE_TEXTURE_UNIT  1
-#define GBUFFER_NORMAL_TEXTURE_UNIT   2
+#define GBUFFER_DIFFUSE_TEXTURE_UNIT  0
+#define GBUFFER_NORMAL_TEXTURE_UNIT   1
+#define GBUFFER_DEPTH_TEXTURE_UNIT    2     // the position is reconstructed from depth
 
 class GBuffer
 {
 public:
 
 	enum GBUFFER_TEXTURE_TYPE {
-		GBUFFER_TEXTURE_TYPE_POSITION,
-		GBUFFER_TEXTURE_TYPE_DIFFUSE,
-		GBUFFER_TEXTURE_TYPE_NORMAL,
+		GBUFFER_TEXTURE_TYPE_DIFFUSE,       // RGBA8: albedo and a free material channel
+		GBUFFER_TEXTURE_TYPE_NORMAL,        // RG16: octahedral encoded normal
 		GBUFFER_NUM_TEXTURES
 	};
 
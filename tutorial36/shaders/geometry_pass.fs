@@ -1,20 +1,30 @@
 #version 330
-                                                                        
-in vec2 TexCoord0;                                                                  
-in vec3 Normal0;                                                                    
-in vec3 WorldPos0;                                                                  
 
-layout (location = 0) out vec3 WorldPosOut;   
-layout (location = 1) out vec3 DiffuseOut;     
-layout (location = 2) out vec3 NormalOut;     
-layout (location = 3) out vec3 TexCoordOut;    
-										
-uniform sampler2D gColorMap;                
-											
-void main()									
-{											
-	WorldPosOut     = WorldPos0;					
-	DiffuseOut      = texture(gColorMap, TexCoord0).xyz;	
-	NormalOut       = normalize(Normal0);					
-	TexCoordOut     = vec3(TexCoord0, 0.0);				
+in vec2 TexCoord0;
+in vec3 Normal0;
+
+layout (location = 0) out vec4 DiffuseOut;
+layout (location = 1) out vec2 NormalOut;
+
+uniform sampler2D gColorMap;
+
+// Octahedral normal encoding: the unit sphere is projected on an octahedron
+// which is unfolded into a square. Two 16 bit channels are enough.
+vec2 OctWrap(vec2 v)
+{
+    return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec2 EncodeNormal(vec3 n)
+{
+    n /= (abs(n.x) + abs(n.y) + abs(n.z));
+    n.xy = (n.z >= 0.0) ? n.xy : OctWrap(n.xy);
+    return n.xy * 0.5 + 0.5;
+}
+
+void main()
+{
+    // The alpha channel is free for a material parameter
+    DiffuseOut = vec4(texture(gColorMap, TexCoord0).xyz, 1.0);
+    NormalOut  = EncodeNormal(normalize(Normal0));
 }
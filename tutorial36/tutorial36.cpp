@@ -86,7 +86,7 @@ public:
 
                 m_DSPointLightPassTech.Enable();
 
-                m_DSPointLightPassTech.SetPositionTextureUnit(GBuffer::GBUFFER_TEXTURE_TYPE_POSITION);
+                m_DSPointLightPassTech.SetDepthTextureUnit(GBUFFER_DEPTH_TEXTURE_UNIT);
                 m_DSPointLightPassTech.SetColorTextureUnit(GBuffer::GBUFFER_TEXTURE_TYPE_DIFFUSE);
                 m_DSPointLightPassTech.SetNormalTextureUnit(GBuffer::GBUFFER_TEXTURE_TYPE_NORMAL);
         m_DSPointLightPassTech.SetScreenSize(WINDOW_WIDTH, WINDOW_HEIGHT);
@@ -98,7 +98,7 @@ public:
 
                 m_DSDirLightPassTech.Enable();
 
-                m_DSDirLightPassTech.SetPositionTextureUnit(GBuffer::GBUFFER_TEXTURE_TYPE_POSITION);
+                m_DSDirLightPassTech.SetDepthTextureUnit(GBUFFER_DEPTH_TEXTURE_UNIT);
                 m_DSDirLightPassTech.SetColorTextureUnit(GBuffer::GBUFFER_TEXTURE_TYPE_DIFFUSE);
                 m_DSDirLightPassTech.SetNormalTextureUnit(GBuffer::GBUFFER_TEXTURE_TYPE_NORMAL);
                 m_DSDirLightPassTech.SetDirectionalLight(m_dirLight);
@@ -139,6 +139,13 @@ public:
 
         m_pGameCamera->OnRender();
 
+        // The light passes reconstruct the world position from the depth buffer
+        Pipeline p;
+        p.SetCamera(m_pGameCamera->GetPos(), m_pGameCamera->GetTarget(), m_pGameCamera->GetUp());
+        p.SetPerspectiveProj(m_persProjInfo);
+        m_invViewProj = p.GetVPTrans();
+        m_invViewProj.Inverse();
+
         DSGeometryPass();
 
         BeginLightPasses();
@@ -203,6 +210,7 @@ public:
     {
         m_DSPointLightPassTech.Enable();
         m_DSPointLightPassTech.SetEyeWorldPos(m_pGameCamera->GetPos());
+        m_DSPointLightPassTech.SetInverseViewProjection(m_invViewProj);
 
         Pipeline p;
         p.SetCamera(m_pGameCamera->GetPos(), m_pGameCamera->GetTarget(), m_pGameCamera->GetUp());
@@ -223,6 +231,7 @@ public:
     {
         m_DSDirLightPassTech.Enable();
         m_DSDirLightPassTech.SetEyeWorldPos(m_pGameCamera->GetPos());
+        m_DSDirLightPassTech.SetInverseViewProjection(m_invViewProj);
         Matrix4f WVP;
         WVP.InitIdentity();
         m_DSDirLightPassTech.SetWVP(WVP);
@@ -325,6 +334,7 @@ private:
     PersProjInfo m_persProjInfo;
     GBuffer m_gbuffer;
     Vector3f m_boxPositions[5];
+    Matrix4f m_invViewProj;
 };
 
 
@@ -0,0 +1,122 @@
+/*
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ds_point_light_batch_tech.h"
+#include "ogldev_util.h"
+
+
+DSPointLightBatchTech::DSPointLightBatchTech()
+{
+}
+
+
+bool DSPointLightBatchTech::Init()
+{
+    if (!Technique::Init()) {
+        return false;
+    }
+
+    if (!AddShader(GL_VERTEX_SHADER, "shaders/light_volume_instanced.vs")) {
+        return false;
+    }
+
+    if (!AddShader(GL_FRAGMENT_SHADER, "shaders/point_light_pass_instanced.fs")) {
+        return false;
+    }
+
+    if (!Finalize()) {
+        return false;
+    }
+
+    m_VPLocation = GetUniformLocation("gVP");
+    m_colorTextureUnitLocation = GetUniformLocation("gColorMap");
+    m_normalTextureUnitLocation = GetUniformLocation("gNormalMap");
+    m_depthTextureUnitLocation = GetUniformLocation("gDepthMap");
+    m_eyeWorldPosLocation = GetUniformLocation("gEyeWorldPos");
+    m_matSpecularIntensityLocation = GetUniformLocation("gMatSpecularIntensity");
+    m_matSpecularPowerLocation = GetUniformLocation("gSpecularPower");
+    m_screenSizeLocation = GetUniformLocation("gScreenSize");
+    m_invViewProjLocation = GetUniformLocation("gInvViewProj");
+
+    if (m_VPLocation == INVALID_UNIFORM_LOCATION ||
+        m_colorTextureUnitLocation == INVALID_UNIFORM_LOCATION ||
+        m_normalTextureUnitLocation == INVALID_UNIFORM_LOCATION ||
+        m_depthTextureUnitLocation == INVALID_UNIFORM_LOCATION ||
+        m_eyeWorldPosLocation == INVALID_UNIFORM_LOCATION ||
+        m_matSpecularIntensityLocation == INVALID_UNIFORM_LOCATION ||
+        m_matSpecularPowerLocation == INVALID_UNIFORM_LOCATION ||
+        m_screenSizeLocation == INVALID_UNIFORM_LOCATION ||
+        m_invViewProjLocation == INVALID_UNIFORM_LOCATION) {
+        return false;
+    }
+
+    return true;
+}
+
+
+void DSPointLightBatchTech::SetVP(const Matrix4f& VP)
+{
+    glUniformMatrix4fv(m_VPLocation, 1, GL_TRUE, (const GLfloat*)VP.m);
+}
+
+
+void DSPointLightBatchTech::SetColorTextureUnit(unsigned int TextureUnit)
+{
+    glUniform1i(m_colorTextureUnitLocation, TextureUnit);
+}
+
+
+void DSPointLightBatchTech::SetNormalTextureUnit(unsigned int TextureUnit)
+{
+    glUniform1i(m_normalTextureUnitLocation, TextureUnit);
+}
+
+
+void DSPointLightBatchTech::SetDepthTextureUnit(unsigned int TextureUnit)
+{
+    glUniform1i(m_depthTextureUnitLocation, TextureUnit);
+}
+
+
+void DSPointLightBatchTech::SetEyeWorldPos(const Vector3f& EyePos)
+{
+    glUniform3f(m_eyeWorldPosLocation, EyePos.x, EyePos.y, EyePos.z);
+}
+
+
+void DSPointLightBatchTech::SetMatSpecularIntensity(float Intensity)
+{
+    glUniform1f(m_matSpecularIntensityLocation, Intensity);
+}
+
+
+void DSPointLightBatchTech::SetMatSpecularPower(float Power)
+{
+    glUniform1f(m_matSpecularPowerLocation, Power);
+}
+
+
+void DSPointLightBatchTech::SetScreenSize(unsigned int Width, unsigned int Height)
+{
+    glUniform2f(m_screenSizeLocation, (float)Width, (float)Height);
+}
+
+
+void DSPointLightBatchTech::SetInverseViewProjection(const Matrix4f& InvViewProj)
+{
+    glUniformMatrix4fv(m_invViewProjLocation, 1, GL_TRUE, (const GLfloat*)InvViewProj.m);
+}
@@ -0,0 +1,58 @@
+/*
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DS_POINT_LIGHT_BATCH_TECH_H
+#define	DS_POINT_LIGHT_BATCH_TECH_H
+
+#include "technique.h"
+#include "ogldev_math_3d.h"
+
+// Instanced version of DSPointLightPassTech. The light volumes of all the
+// point lights are drawn by a single instanced draw and every instance reads
+// its light from the PointLightBuffer.
+class DSPointLightBatchTech : public Technique {
+public:
+
+    DSPointLightBatchTech();
+
+    virtual bool Init();
+
+    void SetVP(const Matrix4f& VP);
+    void SetColorTextureUnit(unsigned int TextureUnit);
+    void SetNormalTextureUnit(unsigned int TextureUnit);
+    void SetDepthTextureUnit(unsigned int TextureUnit);
+    void SetEyeWorldPos(const Vector3f& EyeWorldPos);
+    void SetMatSpecularIntensity(float Intensity);
+    void SetMatSpecularPower(float Power);
+    void SetScreenSize(unsigned int Width, unsigned int Height);
+    void SetInverseViewProjection(const Matrix4f& InvViewProj);
+
+private:
+
+    GLuint m_VPLocation;
+    GLuint m_colorTextureUnitLocation;
+    GLuint m_normalTextureUnitLocation;
+    GLuint m_depthTextureUnitLocation;
+    GLuint m_eyeWorldPosLocation;
+    GLuint m_matSpecularIntensityLocation;
+    GLuint m_matSpecularPowerLocation;
+    GLuint m_screenSizeLocation;
+    GLuint m_invViewProjLocation;
+};
+
+
+#endif
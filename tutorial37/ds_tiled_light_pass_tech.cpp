@@ -0,0 +1,165 @@
+/*
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ds_tiled_light_pass_tech.h"
+#include "ogldev_util.h"
+
+
+DSTiledLightPassTech::DSTiledLightPassTech()
+{
+    m_screenWidth = 0;
+    m_screenHeight = 0;
+}
+
+
+bool DSTiledLightPassTech::Init()
+{
+    if (!Technique::Init()) {
+        return false;
+    }
+
+    if (!AddShader(GL_COMPUTE_SHADER, "shaders/tiled_light_pass.cs")) {
+        return false;
+    }
+
+    if (!Finalize()) {
+        return false;
+    }
+
+    m_colorTextureUnitLocation = GetUniformLocation("gColorMap");
+    m_normalTextureUnitLocation = GetUniformLocation("gNormalMap");
+    m_depthTextureUnitLocation = GetUniformLocation("gDepthMap");
+    m_outputImageUnitLocation = GetUniformLocation("gOutput");
+    m_eyeWorldPosLocation = GetUniformLocation("gEyeWorldPos");
+    m_matSpecularIntensityLocation = GetUniformLocation("gMatSpecularIntensity");
+    m_matSpecularPowerLocation = GetUniformLocation("gSpecularPower");
+    m_screenSizeLocation = GetUniformLocation("gScreenSize");
+    m_tanHalfFOVLocation = GetUniformLocation("gTanHalfFOV");
+    m_projParamsLocation = GetUniformLocation("gProjParams");
+    m_viewMatrixLocation = GetUniformLocation("gView");
+    m_invViewProjLocation = GetUniformLocation("gInvViewProj");
+    m_numLightsLocation = GetUniformLocation("gNumLights");
+
+    if (m_colorTextureUnitLocation == INVALID_UNIFORM_LOCATION ||
+        m_normalTextureUnitLocation == INVALID_UNIFORM_LOCATION ||
+        m_depthTextureUnitLocation == INVALID_UNIFORM_LOCATION ||
+        m_outputImageUnitLocation == INVALID_UNIFORM_LOCATION ||
+        m_eyeWorldPosLocation == INVALID_UNIFORM_LOCATION ||
+        m_matSpecularIntensityLocation == INVALID_UNIFORM_LOCATION ||
+        m_matSpecularPowerLocation == INVALID_UNIFORM_LOCATION ||
+        m_screenSizeLocation == INVALID_UNIFORM_LOCATION ||
+        m_tanHalfFOVLocation == INVALID_UNIFORM_LOCATION ||
+        m_projParamsLocation == INVALID_UNIFORM_LOCATION ||
+        m_viewMatrixLocation == INVALID_UNIFORM_LOCATION ||
+        m_invViewProjLocation == INVALID_UNIFORM_LOCATION ||
+        m_numLightsLocation == INVALID_UNIFORM_LOCATION) {
+        return false;
+    }
+
+    return true;
+}
+
+
+void DSTiledLightPassTech::SetColorTextureUnit(unsigned int TextureUnit)
+{
+    glUniform1i(m_colorTextureUnitLocation, TextureUnit);
+}
+
+
+void DSTiledLightPassTech::SetNormalTextureUnit(unsigned int TextureUnit)
+{
+    glUniform1i(m_normalTextureUnitLocation, TextureUnit);
+}
+
+
+void DSTiledLightPassTech::SetDepthTextureUnit(unsigned int TextureUnit)
+{
+    glUniform1i(m_depthTextureUnitLocation, TextureUnit);
+}
+
+
+void DSTiledLightPassTech::SetOutputImageUnit(unsigned int ImageUnit)
+{
+    glUniform1i(m_outputImageUnitLocation, ImageUnit);
+}
+
+
+void DSTiledLightPassTech::SetEyeWorldPos(const Vector3f& EyePos)
+{
+    glUniform3f(m_eyeWorldPosLocation, EyePos.x, EyePos.y, EyePos.z);
+}
+
+
+void DSTiledLightPassTech::SetMatSpecularIntensity(float Intensity)
+{
+    glUniform1f(m_matSpecularIntensityLocation, Intensity);
+}
+
+
+void DSTiledLightPassTech::SetMatSpecularPower(float Power)
+{
+    glUniform1f(m_matSpecularPowerLocation, Power);
+}
+
+
+void DSTiledLightPassTech::SetProjection(const PersProjInfo& ProjInfo)
+{
+    m_screenWidth = (unsigned int)ProjInfo.Width;
+    m_screenHeight = (unsigned int)ProjInfo.Height;
+
+    glUniform2f(m_screenSizeLocation, ProjInfo.Width, ProjInfo.Height);
+
+    // Scales NDC x/y to view space x/y at a view space depth of one
+    const float ar = ProjInfo.Width / ProjInfo.Height;
+    const float tanHalfFOV = tanf(ToRadian(ProjInfo.FOV / 2.0f));
+    glUniform2f(m_tanHalfFOVLocation, tanHalfFOV * ar, tanHalfFOV);
+
+    // NDC depth is m[2][2] + m[2][3] / ViewZ (see InitPersProjTransform)
+    Matrix4f Proj;
+    Proj.InitPersProjTransform(ProjInfo);
+    glUniform2f(m_projParamsLocation, Proj.m[2][2], Proj.m[2][3]);
+}
+
+
+void DSTiledLightPassTech::SetViewMatrix(const Matrix4f& View)
+{
+    glUniformMatrix4fv(m_viewMatrixLocation, 1, GL_TRUE, (const GLfloat*)View.m);
+}
+
+
+void DSTiledLightPassTech::SetInverseViewProjection(const Matrix4f& InvViewProj)
+{
+    glUniformMatrix4fv(m_invViewProjLocation, 1, GL_TRUE, (const GLfloat*)InvViewProj.m);
+}
+
+
+void DSTiledLightPassTech::SetNumLights(unsigned int NumLights)
+{
+    glUniform1i(m_numLightsLocation, NumLights);
+}
+
+
+void DSTiledLightPassTech::Dispatch()
+{
+    GLuint NumGroupsX = (m_screenWidth + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE;
+    GLuint NumGroupsY = (m_screenHeight + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE;
+
+    glDispatchCompute(NumGroupsX, NumGroupsY, 1);
+
+    // The following passes blend into the output and blit it
+    glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+}
@@ -0,0 +1,77 @@
+/*
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DS_TILED_LIGHT_PASS_TECH_H
+#define	DS_TILED_LIGHT_PASS_TECH_H
+
+#include "technique.h"
+#include "ogldev_math_3d.h"
+
+// Must match shaders/tiled_light_pass.cs
+#define LIGHT_TILE_SIZE 16
+#define MAX_LIGHTS_PER_TILE 256
+
+// Point light pass that runs as a single compute dispatch. Every work group
+// shades one screen tile: it finds the depth range of the tile in the depth
+// buffer, culls all the point lights against the view space box of the tile
+// and accumulates only the surviving lights for each pixel of the tile.
+class DSTiledLightPassTech : public Technique {
+public:
+
+    DSTiledLightPassTech();
+
+    virtual bool Init();
+
+    void SetColorTextureUnit(unsigned int TextureUnit);
+    void SetNormalTextureUnit(unsigned int TextureUnit);
+    void SetDepthTextureUnit(unsigned int TextureUnit);
+    void SetOutputImageUnit(unsigned int ImageUnit);
+    void SetEyeWorldPos(const Vector3f& EyeWorldPos);
+    void SetMatSpecularIntensity(float Intensity);
+    void SetMatSpecularPower(float Power);
+    void SetProjection(const PersProjInfo& ProjInfo);
+    void SetViewMatrix(const Matrix4f& View);
+    void SetInverseViewProjection(const Matrix4f& InvViewProj);
+
+    void SetNumLights(unsigned int NumLights);
+
+    // The GBuffer textures, the depth texture, the output image and the
+    // PointLightBuffer must be bound
+    void Dispatch();
+
+private:
+
+    GLuint m_colorTextureUnitLocation;
+    GLuint m_normalTextureUnitLocation;
+    GLuint m_depthTextureUnitLocation;
+    GLuint m_outputImageUnitLocation;
+    GLuint m_eyeWorldPosLocation;
+    GLuint m_matSpecularIntensityLocation;
+    GLuint m_matSpecularPowerLocation;
+    GLuint m_screenSizeLocation;
+    GLuint m_tanHalfFOVLocation;
+    GLuint m_projParamsLocation;
+    GLuint m_viewMatrixLocation;
+    GLuint m_invViewProjLocation;
+    GLuint m_numLightsLocation;
+
+    unsigned int m_screenWidth;
+    unsigned int m_screenHeight;
+};
+
+
+#endif
@@ -62,9 +62,13 @@ bool GBuffer::Init(unsigned int WindowWidth, unsigned int WindowHeight)
 
 	glGenTextures(1, &m_finalTexture);
 
+    // 8 bytes per pixel plus depth. The position is not stored.
+    GLenum InternalFormats[GBUFFER_NUM_TEXTURES] = { GL_RGBA8, GL_RG16 };
+    GLenum Formats[GBUFFER_NUM_TEXTURES] = { GL_RGBA, GL_RG };
+
     for (unsigned int i = 0 ; i < ARRAY_SIZE_IN_ELEMENTS(m_textures) ; i++) {
     	glBindTexture(GL_TEXTURE_2D, m_textures[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, WindowWidth, WindowHeight, 0, GL_RGB, GL_FLOAT, NULL);
+        glTexImage2D(GL_TEXTURE_2D, 0, InternalFormats[i], WindowWidth, WindowHeight, 0, Formats[i], GL_UNSIGNED_BYTE, NULL);
         glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
         glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, m_textures[i], 0);
@@ -73,11 +77,13 @@ bool GBuffer::Init(unsigned int WindowWidth, unsigned int WindowHeight)
 	// depth
 	glBindTexture(GL_TEXTURE_2D, m_depthTexture);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH32F_STENCIL8, WindowWidth, WindowHeight, 0, GL_DEPTH_STENCIL, GL_FLOAT_32_UNSIGNED_INT_24_8_REV, NULL);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, m_depthTexture, 0);
 
 	// final
 	glBindTexture(GL_TEXTURE_2D, m_finalTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, WindowWidth, WindowHeight, 0, GL_RGB, GL_FLOAT, NULL);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, WindowWidth, WindowHeight, 0, GL_RGB, GL_FLOAT, NULL);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT4, GL_TEXTURE_2D, m_finalTexture, 0);	
 
     GLenum Status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
@@ -106,9 +112,8 @@ void GBuffer::BindForGeomPass()
 {
     glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo);
 
-	GLenum DrawBuffers[] = { GL_COLOR_ATTACHMENT0, 
-						     GL_COLOR_ATTACHMENT1,
-						     GL_COLOR_ATTACHMENT2 };
+	GLenum DrawBuffers[] = { GL_COLOR_ATTACHMENT0,
+						     GL_COLOR_ATTACHMENT1 };
 
     glDrawBuffers(ARRAY_SIZE_IN_ELEMENTS(DrawBuffers), DrawBuffers);
 }
@@ -127,9 +132,29 @@ void GBuffer::BindForLightPass()
 	glDrawBuffer(GL_COLOR_ATTACHMENT4);
 
 	for (unsigned int i = 0 ; i < ARRAY_SIZE_IN_ELEMENTS(m_textures); i++) {
-		glActiveTexture(GL_TEXTURE0 + i);		
-		glBindTexture(GL_TEXTURE_2D, m_textures[GBUFFER_TEXTURE_TYPE_POSITION + i]);
+		glActiveTexture(GL_TEXTURE0 + i);
+		glBindTexture(GL_TEXTURE_2D, m_textures[i]);
+	}
+
+	// Depth writes are disabled during the light passes so the depth
+	// texture can be sampled while it is attached
+	glActiveTexture(GL_TEXTURE0 + GBUFFER_DEPTH_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+}
+
+
+void GBuffer::BindForTiledLightPass()
+{
+	for (unsigned int i = 0 ; i < ARRAY_SIZE_IN_ELEMENTS(m_textures); i++) {
+		glActiveTexture(GL_TEXTURE0 + i);
+		glBindTexture(GL_TEXTURE_2D, m_textures[i]);
 	}
+
+	glActiveTexture(GL_TEXTURE0 + GBUFFER_DEPTH_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+
+	// The compute shader writes the final texture directly (it must have a sized format)
+	glBindImageTexture(GBUFFER_FINAL_IMAGE_UNIT, m_finalTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
 }
 
 
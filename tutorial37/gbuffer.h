@@ -25,12 +25,19 @@ class GBuffer
 public:
 
     enum GBUFFER_TEXTURE_TYPE {
-            GBUFFER_TEXTURE_TYPE_POSITION,
-            GBUFFER_TEXTURE_TYPE_DIFFUSE,
-            GBUFFER_TEXTURE_TYPE_NORMAL,
+            GBUFFER_TEXTURE_TYPE_DIFFUSE,       // RGBA8: albedo and a free material channel
+            GBUFFER_TEXTURE_TYPE_NORMAL,        // RG16: octahedral encoded normal
             GBUFFER_NUM_TEXTURES
     };
 
+    // The world position is reconstructed from the depth texture which the
+    // light passes read from this unit. The tiled light pass writes the final
+    // texture through this image unit.
+    enum {
+            GBUFFER_DEPTH_TEXTURE_UNIT = GBUFFER_NUM_TEXTURES,
+            GBUFFER_FINAL_IMAGE_UNIT = 0
+    };
+
     GBuffer();
 
     ~GBuffer();
@@ -41,6 +48,7 @@ public:
     void BindForGeomPass();
     void BindForStencilPass();
     void BindForLightPass();
+    void BindForTiledLightPass();
     void BindForFinalPass();
 
 private:
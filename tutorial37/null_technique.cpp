@@ -24,15 +24,29 @@
 
 NullTechnique::NullTechnique()
 {   
+    m_instanced = false;
 }
 
 bool NullTechnique::Init()
+{
+    return InitCommon("shaders/null_technique.vs");
+}
+
+
+bool NullTechnique::InitInstanced()
+{
+    m_instanced = true;
+    return InitCommon("shaders/light_volume_instanced.vs");
+}
+
+
+bool NullTechnique::InitCommon(const char* pVSFilename)
 {
     if (!Technique::Init()) {
         return false;
     }
 
-    if (!AddShader(GL_VERTEX_SHADER, "shaders/null_technique.vs")) {
+    if (!AddShader(GL_VERTEX_SHADER, pVSFilename)) {
         return false;
     }
 
@@ -44,7 +58,7 @@ bool NullTechnique::Init()
         return false;
     }
 
-    m_WVPLocation = GetUniformLocation("gWVP");
+    m_WVPLocation = GetUniformLocation(m_instanced ? "gVP" : "gWVP");
 
 	if (m_WVPLocation == INVALID_UNIFORM_LOCATION) {
 		return false;
@@ -59,3 +73,8 @@ void NullTechnique::SetWVP(const Matrix4f& WVP)
     glUniformMatrix4fv(m_WVPLocation, 1, GL_TRUE, (const GLfloat*)WVP.m);    
 }
 
+
+void NullTechnique::SetVP(const Matrix4f& VP)
+{
+    glUniformMatrix4fv(m_WVPLocation, 1, GL_TRUE, (const GLfloat*)VP.m);
+}
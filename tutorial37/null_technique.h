@@ -28,11 +28,20 @@ public:
 
     virtual bool Init();
 
+    // The instanced version draws the light volumes from the PointLightBuffer
+    bool InitInstanced();
+
     void SetWVP(const Matrix4f& WVP);
 
+    // Instanced version only
+    void SetVP(const Matrix4f& VP);
+
 private:
 
-    GLuint m_WVPLocation;
+    bool InitCommon(const char* pVSFilename);
+
+    bool m_instanced;
+    GLuint m_WVPLocation;       // gVP in the instanced version
 };
 
 
@@ -0,0 +1,73 @@
+/*
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <vector>
+
+#include "point_light_buffer.h"
+#include "ogldev_util.h"
+
+using namespace std;
+
+
+PointLightBuffer::PointLightBuffer()
+{
+    m_buffer = 0;
+    m_numLights = 0;
+}
+
+
+PointLightBuffer::~PointLightBuffer()
+{
+    if (m_buffer != 0) {
+        glDeleteBuffers(1, &m_buffer);
+    }
+}
+
+
+bool PointLightBuffer::Init()
+{
+    glGenBuffers(1, &m_buffer);
+
+    // Never leave the binding without storage
+    Update(NULL, NULL, 0);
+
+    return GLCheckError();
+}
+
+
+void PointLightBuffer::Update(const PointLight* pLights, const float* pRadii, unsigned int NumLights)
+{
+    vector<GPUPointLight> Lights(NumLights > 0 ? NumLights : 1);
+
+    for (unsigned int i = 0 ; i < NumLights ; i++) {
+        const PointLight& l = pLights[i];
+        Lights[i].PositionRadius = Vector4f(l.Position, pRadii[i]);
+        Lights[i].ColorDiffuse = Vector4f(l.Color, l.DiffuseIntensity);
+        Lights[i].Atten = Vector4f(l.Attenuation.Constant, l.Attenuation.Linear, l.Attenuation.Exp, l.AmbientIntensity);
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GPUPointLight) * Lights.size(), &Lights[0], GL_DYNAMIC_DRAW);
+
+    m_numLights = NumLights;
+}
+
+
+void PointLightBuffer::Bind(GLuint BindingPoint)
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BindingPoint, m_buffer);
+}
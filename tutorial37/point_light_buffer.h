@@ -0,0 +1,62 @@
+/*
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef POINT_LIGHT_BUFFER_H
+#define	POINT_LIGHT_BUFFER_H
+
+#include <GL/glew.h>
+
+#include "ogldev_math_3d.h"
+#include "ogldev_lights_common.h"
+
+// Binding point of the light buffer in the shaders that read it
+#define POINT_LIGHT_BUFFER_BINDING 0
+
+// Shader storage buffer with the point lights and the radius of their
+// volumes. Used by the tiled light pass and by the instanced light volumes.
+class PointLightBuffer
+{
+public:
+
+    PointLightBuffer();
+
+    ~PointLightBuffer();
+
+    bool Init();
+
+    // pRadii holds the radius of the volume of every light
+    void Update(const PointLight* pLights, const float* pRadii, unsigned int NumLights);
+
+    void Bind(GLuint BindingPoint);
+
+    unsigned int GetNumLights() const { return m_numLights; }
+
+private:
+
+    // std430 layout of a light in the shaders
+    struct GPUPointLight {
+        Vector4f PositionRadius;    // world space
+        Vector4f ColorDiffuse;      // color, diffuse intensity
+        Vector4f Atten;             // constant, linear, exp, ambient intensity
+    };
+
+    GLuint m_buffer;
+    unsigned int m_numLights;
+};
+
+
+#endif
@@ -0,0 +1,28 @@
+#version 430
+
+layout (location = 0) in vec3 Position;
+
+struct PointLight
+{
+    vec4 PositionRadius;
+    vec4 ColorDiffuse;
+    vec4 Atten;             // constant, linear, exp, ambient intensity
+};
+
+// PointLightBuffer
+layout (std430, binding = 0) readonly buffer LightBuffer {
+    PointLight gLights[];
+};
+
+uniform mat4 gVP;
+
+flat out int LightIndex;
+
+// Every instance is the bounding sphere of one light. The sphere mesh has
+// a radius of one so the world transform comes directly from the light.
+void main()
+{
+    vec4 PositionRadius = gLights[gl_InstanceID].PositionRadius;
+    gl_Position = gVP * vec4(PositionRadius.xyz + Position * PositionRadius.w, 1.0);
+    LightIndex = gl_InstanceID;
+}
@@ -34,7 +34,7 @@ struct SpotLight
     float Cutoff;
 };
 
-uniform sampler2D gPositionMap;
+uniform sampler2D gDepthMap;
 uniform sampler2D gColorMap;
 uniform sampler2D gNormalMap;
 uniform DirectionalLight gDirectionalLight;
@@ -45,6 +45,7 @@ uniform float gMatSpecularIntensity;
 uniform float gSpecularPower;
 uniform int gLightType;
 uniform vec2 gScreenSize;
+uniform mat4 gInvViewProj;
 
 vec4 CalcLightInternal(BaseLight Light,
                        vec3 LightDirection,
@@ -104,15 +105,36 @@ vec2 CalcTexCoord()
 }
 
 
+// Inverse of EncodeNormal in geometry_pass.fs
+vec3 DecodeNormal(vec2 f)
+{
+    f = f * 2.0 - 1.0;
+    vec3 n = vec3(f.x, f.y, 1.0 - abs(f.x) - abs(f.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.x += (n.x >= 0.0) ? -t : t;
+    n.y += (n.y >= 0.0) ? -t : t;
+    return normalize(n);
+}
+
+
+// The world position is not stored in the GBuffer. It is recovered by
+// unprojecting the window position of the pixel with its depth.
+vec3 CalcWorldPos(vec2 TexCoord)
+{
+    float Depth = texture(gDepthMap, TexCoord).r;
+    vec4 Pos = gInvViewProj * vec4(TexCoord * 2.0 - 1.0, Depth * 2.0 - 1.0, 1.0);
+    return Pos.xyz / Pos.w;
+}
+
+
 out vec4 FragColor;
 
 void main()
 {
     vec2 TexCoord = CalcTexCoord();
-    vec3 WorldPos = texture(gPositionMap, TexCoord).xyz;
+    vec3 WorldPos = CalcWorldPos(TexCoord);
     vec3 Color = texture(gColorMap, TexCoord).xyz;
-    vec3 Normal = texture(gNormalMap, TexCoord).xyz;
-    Normal = normalize(Normal);
+    vec3 Normal = DecodeNormal(texture(gNormalMap, TexCoord).xy);
 
     FragColor = vec4(Color, 1.0) * CalcPointLight(WorldPos, Normal);
 }
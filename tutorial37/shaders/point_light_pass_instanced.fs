@@ -0,0 +1,116 @@
+#version 430
+
+struct BaseLight
+{
+    vec3 Color;
+    float AmbientIntensity;
+    float DiffuseIntensity;
+};
+
+struct PointLight
+{
+    vec4 PositionRadius;
+    vec4 ColorDiffuse;
+    vec4 Atten;             // constant, linear, exp, ambient intensity
+};
+
+// PointLightBuffer
+layout (std430, binding = 0) readonly buffer LightBuffer {
+    PointLight gLights[];
+};
+
+flat in int LightIndex;
+
+uniform sampler2D gDepthMap;
+uniform sampler2D gColorMap;
+uniform sampler2D gNormalMap;
+uniform vec3 gEyeWorldPos;
+uniform float gMatSpecularIntensity;
+uniform float gSpecularPower;
+uniform vec2 gScreenSize;
+uniform mat4 gInvViewProj;
+
+vec4 CalcLightInternal(BaseLight Light,
+                       vec3 LightDirection,
+                       vec3 WorldPos,
+                       vec3 Normal)
+{
+    vec4 AmbientColor = vec4(Light.Color * Light.AmbientIntensity, 1.0);
+    float DiffuseFactor = dot(Normal, -LightDirection);
+
+    vec4 DiffuseColor  = vec4(0, 0, 0, 0);
+    vec4 SpecularColor = vec4(0, 0, 0, 0);
+
+    if (DiffuseFactor > 0.0) {
+        DiffuseColor = vec4(Light.Color * Light.DiffuseIntensity * DiffuseFactor, 1.0);
+
+        vec3 VertexToEye = normalize(gEyeWorldPos - WorldPos);
+        vec3 LightReflect = normalize(reflect(LightDirection, Normal));
+        float SpecularFactor = dot(VertexToEye, LightReflect);
+        if (SpecularFactor > 0.0) {
+            SpecularFactor = pow(SpecularFactor, gSpecularPower);
+            SpecularColor = vec4(Light.Color * gMatSpecularIntensity * SpecularFactor, 1.0);
+        }
+    }
+
+    return (AmbientColor + DiffuseColor + SpecularColor);
+}
+
+vec2 CalcTexCoord()
+{
+    return gl_FragCoord.xy / gScreenSize;
+}
+
+// Inverse of EncodeNormal in geometry_pass.fs
+vec3 DecodeNormal(vec2 f)
+{
+    f = f * 2.0 - 1.0;
+    vec3 n = vec3(f.x, f.y, 1.0 - abs(f.x) - abs(f.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.x += (n.x >= 0.0) ? -t : t;
+    n.y += (n.y >= 0.0) ? -t : t;
+    return normalize(n);
+}
+
+vec3 CalcWorldPos(vec2 TexCoord)
+{
+    float Depth = texture(gDepthMap, TexCoord).r;
+    vec4 Pos = gInvViewProj * vec4(TexCoord * 2.0 - 1.0, Depth * 2.0 - 1.0, 1.0);
+    return Pos.xyz / Pos.w;
+}
+
+out vec4 FragColor;
+
+void main()
+{
+    vec2 TexCoord = CalcTexCoord();
+    vec3 WorldPos = CalcWorldPos(TexCoord);
+
+    PointLight l = gLights[LightIndex];
+
+    vec3 LightDirection = WorldPos - l.PositionRadius.xyz;
+    float Distance = length(LightDirection);
+
+    // The batched stencil pass only rejects the pixels that are outside of
+    // all the light volumes. The pixels inside another volume but in front
+    // or behind this one are rejected here.
+    if (Distance > l.PositionRadius.w) {
+        discard;
+    }
+
+    LightDirection /= Distance;
+
+    vec3 Color = texture(gColorMap, TexCoord).xyz;
+    vec3 Normal = DecodeNormal(texture(gNormalMap, TexCoord).xy);
+
+    BaseLight Base = BaseLight(l.ColorDiffuse.xyz, l.Atten.w, l.ColorDiffuse.w);
+    vec4 LightColor = CalcLightInternal(Base, LightDirection, WorldPos, Normal);
+
+    float Attenuation = l.Atten.x +
+                        l.Atten.y * Distance +
+                        l.Atten.z * Distance * Distance;
+
+    Attenuation = max(1.0, Attenuation);
+
+    FragColor = vec4(Color, 1.0) * LightColor / Attenuation;
+}
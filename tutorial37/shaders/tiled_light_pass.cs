@@ -0,0 +1,178 @@
+#version 430
+
+// Must match ds_tiled_light_pass_tech.h
+#define TILE_SIZE 16
+#define MAX_LIGHTS_PER_TILE 256
+
+layout (local_size_x = TILE_SIZE, local_size_y = TILE_SIZE) in;
+
+struct BaseLight
+{
+    vec3 Color;
+    float AmbientIntensity;
+    float DiffuseIntensity;
+};
+
+struct TiledLight
+{
+    vec4 PositionRadius;
+    vec4 ColorDiffuse;
+    vec4 Atten;             // constant, linear, exp, ambient intensity
+};
+
+// PointLightBuffer
+layout (std430, binding = 0) readonly buffer LightBuffer {
+    TiledLight gLights[];
+};
+
+layout (rgba8) uniform writeonly image2D gOutput;
+
+uniform sampler2D gColorMap;
+uniform sampler2D gNormalMap;
+uniform sampler2D gDepthMap;
+uniform vec3 gEyeWorldPos;
+uniform float gMatSpecularIntensity;
+uniform float gSpecularPower;
+uniform vec2 gScreenSize;
+uniform vec2 gTanHalfFOV;       // NDC x/y to view space x/y at depth one
+uniform vec2 gProjParams;       // NDC depth is x + y / ViewZ
+uniform mat4 gView;
+uniform mat4 gInvViewProj;
+uniform int gNumLights;
+
+// View space depth range of the tile. Depth is positive so the bits of
+// the floats can be compared as unsigned integers.
+shared uint TileMinZ;
+shared uint TileMaxZ;
+shared uint TileNumLights;
+shared uint TileLights[MAX_LIGHTS_PER_TILE];
+
+vec4 CalcLightInternal(BaseLight Light,
+                       vec3 LightDirection,
+                       vec3 WorldPos,
+                       vec3 Normal)
+{
+    vec4 AmbientColor = vec4(Light.Color * Light.AmbientIntensity, 1.0);
+    float DiffuseFactor = dot(Normal, -LightDirection);
+
+    vec4 DiffuseColor  = vec4(0, 0, 0, 0);
+    vec4 SpecularColor = vec4(0, 0, 0, 0);
+
+    if (DiffuseFactor > 0.0) {
+        DiffuseColor = vec4(Light.Color * Light.DiffuseIntensity * DiffuseFactor, 1.0);
+
+        vec3 VertexToEye = normalize(gEyeWorldPos - WorldPos);
+        vec3 LightReflect = normalize(reflect(LightDirection, Normal));
+        float SpecularFactor = dot(VertexToEye, LightReflect);
+        if (SpecularFactor > 0.0) {
+            SpecularFactor = pow(SpecularFactor, gSpecularPower);
+            SpecularColor = vec4(Light.Color * gMatSpecularIntensity * SpecularFactor, 1.0);
+        }
+    }
+
+    return (AmbientColor + DiffuseColor + SpecularColor);
+}
+
+vec4 CalcPointLight(TiledLight l, vec3 WorldPos, vec3 Normal)
+{
+    vec3 LightDirection = WorldPos - l.PositionRadius.xyz;
+    float Distance = length(LightDirection);
+    LightDirection = normalize(LightDirection);
+
+    BaseLight Base = BaseLight(l.ColorDiffuse.xyz, l.Atten.w, l.ColorDiffuse.w);
+    vec4 Color = CalcLightInternal(Base, LightDirection, WorldPos, Normal);
+
+    float Attenuation = l.Atten.x +
+                        l.Atten.y * Distance +
+                        l.Atten.z * Distance * Distance;
+
+    Attenuation = max(1.0, Attenuation);
+
+    return Color / Attenuation;
+}
+
+// Inverse of EncodeNormal in geometry_pass.fs
+vec3 DecodeNormal(vec2 f)
+{
+    f = f * 2.0 - 1.0;
+    vec3 n = vec3(f.x, f.y, 1.0 - abs(f.x) - abs(f.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.x += (n.x >= 0.0) ? -t : t;
+    n.y += (n.y >= 0.0) ? -t : t;
+    return normalize(n);
+}
+
+void main()
+{
+    ivec2 Pixel = ivec2(gl_GlobalInvocationID.xy);
+    bool Inside = all(lessThan(Pixel, ivec2(gScreenSize)));
+
+    if (gl_LocalInvocationIndex == 0u) {
+        TileMinZ = 0x7F7FFFFFu;      // FLT_MAX
+        TileMaxZ = 0u;
+        TileNumLights = 0u;
+    }
+
+    barrier();
+
+    // Depth 1.0 is the far plane - nothing was rendered there
+    float Depth = Inside ? texelFetch(gDepthMap, Pixel, 0).r : 1.0;
+    bool Background = (Depth >= 1.0);
+
+    if (!Background) {
+        float ViewZ = gProjParams.y / ((Depth * 2.0 - 1.0) - gProjParams.x);
+        atomicMin(TileMinZ, floatBitsToUint(ViewZ));
+        atomicMax(TileMaxZ, floatBitsToUint(ViewZ));
+    }
+
+    barrier();
+
+    // A tile that only contains background pixels has nothing to light
+    if (TileMaxZ > 0u) {
+        float MinZ = uintBitsToFloat(TileMinZ);
+        float MaxZ = uintBitsToFloat(TileMaxZ);
+
+        // View space box of the tile between its min and max depth
+        vec2 NDCMin = vec2(gl_WorkGroupID.xy * uint(TILE_SIZE)) / gScreenSize * 2.0 - 1.0;
+        vec2 NDCMax = vec2((gl_WorkGroupID.xy + 1u) * uint(TILE_SIZE)) / gScreenSize * 2.0 - 1.0;
+        vec2 Min = NDCMin * gTanHalfFOV;
+        vec2 Max = NDCMax * gTanHalfFOV;
+        vec3 BoxMin = vec3(min(Min * MinZ, Min * MaxZ), MinZ);
+        vec3 BoxMax = vec3(max(Max * MinZ, Max * MaxZ), MaxZ);
+
+        // Every thread of the tile tests a different subset of the lights
+        for (uint i = gl_LocalInvocationIndex ; i < uint(gNumLights) ; i += uint(TILE_SIZE * TILE_SIZE)) {
+            vec3 Center = (gView * vec4(gLights[i].PositionRadius.xyz, 1.0)).xyz;
+            float Radius = gLights[i].PositionRadius.w;
+            vec3 d = max(max(BoxMin - Center, Center - BoxMax), 0.0);
+
+            if (dot(d, d) <= Radius * Radius) {
+                uint Slot = atomicAdd(TileNumLights, 1u);
+                if (Slot < uint(MAX_LIGHTS_PER_TILE)) {
+                    TileLights[Slot] = i;
+                }
+            }
+        }
+    }
+
+    barrier();
+
+    if (!Inside || Background) {
+        return;
+    }
+
+    vec2 TexCoord = (vec2(Pixel) + 0.5) / gScreenSize;
+    vec4 Pos = gInvViewProj * vec4(TexCoord * 2.0 - 1.0, Depth * 2.0 - 1.0, 1.0);
+    vec3 WorldPos = Pos.xyz / Pos.w;
+    vec3 Color = texture(gColorMap, TexCoord).xyz;
+    vec3 Normal = DecodeNormal(texture(gNormalMap, TexCoord).xy);
+
+    vec4 TotalLight = vec4(0, 0, 0, 0);
+    uint NumLights = min(TileNumLights, uint(MAX_LIGHTS_PER_TILE));
+
+    for (uint i = 0 ; i < NumLights ; i++) {
+        TotalLight += CalcPointLight(gLights[TileLights[i]], WorldPos, Normal);
+    }
+
+    imageStore(gOutput, Pixel, vec4(Color, 1.0) * TotalLight);
+}
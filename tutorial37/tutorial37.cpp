@@ -35,11 +35,33 @@
 #include "ds_geom_pass_tech.h"
 #include "ds_point_light_pass_tech.h"
 #include "ds_dir_light_pass_tech.h"
+#include "ds_tiled_light_pass_tech.h"
+#include "ds_point_light_batch_tech.h"
+#include "point_light_buffer.h"
 
 
 #define WINDOW_WIDTH  1280
 #define WINDOW_HEIGHT 1024
 
+#define NUM_POINT_LIGHTS 256
+
+// The per light stencil pass keeps the three lights of the original tutorial.
+// The random lights are lit only by the instanced and the tiled passes.
+#define NUM_STENCIL_PASS_POINT_LIGHTS 3
+
+enum LIGHT_PASS_MODE {
+    LIGHT_PASS_STENCIL,         // stencil pass and light volume per light
+    LIGHT_PASS_INSTANCED,       // one instanced stencil pass and one instanced light pass
+    LIGHT_PASS_TILED,           // one compute dispatch
+    NUM_LIGHT_PASS_MODES
+};
+
+static const char* LightPassModeNames[NUM_LIGHT_PASS_MODES] = {
+    "Stencil light pass (3 lights)",
+    "Instanced light pass",
+    "Tiled light pass"
+};
+
 class Tutorial37 : public ICallbacks, public OgldevApp
 {
 public:
@@ -48,6 +70,12 @@ public:
     {
         m_pGameCamera = NULL;
         m_scale = 0.0f;
+        m_lightPassMode = LIGHT_PASS_STENCIL;
+
+        // The stencil pass is always available - Init fails without it
+        m_isModeAvailable[LIGHT_PASS_STENCIL] = true;
+        m_isModeAvailable[LIGHT_PASS_INSTANCED] = false;
+        m_isModeAvailable[LIGHT_PASS_TILED] = false;
 
         m_persProjInfo.FOV = 60.0f;
         m_persProjInfo.Height = WINDOW_HEIGHT;
@@ -88,7 +116,7 @@ public:
 
                 m_DSPointLightPassTech.Enable();
 
-                m_DSPointLightPassTech.SetPositionTextureUnit(GBuffer::GBUFFER_TEXTURE_TYPE_POSITION);
+                m_DSPointLightPassTech.SetDepthTextureUnit(GBuffer::GBUFFER_DEPTH_TEXTURE_UNIT);
                 m_DSPointLightPassTech.SetColorTextureUnit(GBuffer::GBUFFER_TEXTURE_TYPE_DIFFUSE);
                 m_DSPointLightPassTech.SetNormalTextureUnit(GBuffer::GBUFFER_TEXTURE_TYPE_NORMAL);
         m_DSPointLightPassTech.SetScreenSize(WINDOW_WIDTH, WINDOW_HEIGHT);
@@ -100,7 +128,7 @@ public:
 
                 m_DSDirLightPassTech.Enable();
 
-                m_DSDirLightPassTech.SetPositionTextureUnit(GBuffer::GBUFFER_TEXTURE_TYPE_POSITION);
+                m_DSDirLightPassTech.SetDepthTextureUnit(GBuffer::GBUFFER_DEPTH_TEXTURE_UNIT);
                 m_DSDirLightPassTech.SetColorTextureUnit(GBuffer::GBUFFER_TEXTURE_TYPE_DIFFUSE);
                 m_DSDirLightPassTech.SetNormalTextureUnit(GBuffer::GBUFFER_TEXTURE_TYPE_NORMAL);
                 m_DSDirLightPassTech.SetDirectionalLight(m_dirLight);
@@ -109,6 +137,35 @@ public:
         WVP.InitIdentity();
         m_DSDirLightPassTech.SetWVP(WVP);
 
+        // The lights are static so they are uploaded only once. The buffer is
+        // used by both the instanced and the tiled light passes.
+        bool IsLightBufferAvailable = m_pointLightBuffer.Init();
+
+        if (IsLightBufferAvailable) {
+            float Radii[NUM_POINT_LIGHTS];
+
+            for (unsigned int i = 0 ; i < NUM_POINT_LIGHTS ; i++) {
+                Radii[i] = CalcPointLightBSphere(m_pointLight[i]);
+            }
+
+            m_pointLightBuffer.Update(m_pointLight, Radii, NUM_POINT_LIGHTS);
+        }
+        else {
+            printf("Error initializing the point light buffer\n");
+        }
+
+        m_isModeAvailable[LIGHT_PASS_TILED] = IsLightBufferAvailable && InitTiledLightPass();
+
+        if (!m_isModeAvailable[LIGHT_PASS_TILED]) {
+            printf("%s is disabled\n", LightPassModeNames[LIGHT_PASS_TILED]);
+        }
+
+        m_isModeAvailable[LIGHT_PASS_INSTANCED] = IsLightBufferAvailable && InitInstancedLightPass();
+
+        if (!m_isModeAvailable[LIGHT_PASS_INSTANCED]) {
+            printf("%s is disabled\n", LightPassModeNames[LIGHT_PASS_INSTANCED]);
+        }
+
                 if (!m_nullTech.Init()) {
                         return false;
                 }
@@ -133,6 +190,56 @@ public:
         return true;
     }
 
+
+    bool InitTiledLightPass()
+    {
+        if (!m_DSTiledLightPassTech.Init()) {
+            printf("Error initializing DSTiledLightPassTech\n");
+            return false;
+        }
+
+        m_DSTiledLightPassTech.Enable();
+
+        m_DSTiledLightPassTech.SetColorTextureUnit(GBuffer::GBUFFER_TEXTURE_TYPE_DIFFUSE);
+        m_DSTiledLightPassTech.SetNormalTextureUnit(GBuffer::GBUFFER_TEXTURE_TYPE_NORMAL);
+        m_DSTiledLightPassTech.SetDepthTextureUnit(GBuffer::GBUFFER_DEPTH_TEXTURE_UNIT);
+        m_DSTiledLightPassTech.SetOutputImageUnit(GBuffer::GBUFFER_FINAL_IMAGE_UNIT);
+        m_DSTiledLightPassTech.SetMatSpecularIntensity(0.0f);
+        m_DSTiledLightPassTech.SetMatSpecularPower(0.0f);
+        m_DSTiledLightPassTech.SetProjection(m_persProjInfo);
+
+        m_DSTiledLightPassTech.SetNumLights(NUM_POINT_LIGHTS);
+
+        return true;
+    }
+
+
+    bool InitInstancedLightPass()
+    {
+        if (!m_DSPointLightBatchTech.Init()) {
+            printf("Error initializing DSPointLightBatchTech\n");
+            return false;
+        }
+
+        m_DSPointLightBatchTech.Enable();
+
+        m_DSPointLightBatchTech.SetDepthTextureUnit(GBuffer::GBUFFER_DEPTH_TEXTURE_UNIT);
+        m_DSPointLightBatchTech.SetColorTextureUnit(GBuffer::GBUFFER_TEXTURE_TYPE_DIFFUSE);
+        m_DSPointLightBatchTech.SetNormalTextureUnit(GBuffer::GBUFFER_TEXTURE_TYPE_NORMAL);
+        m_DSPointLightBatchTech.SetMatSpecularIntensity(0.0f);
+        m_DSPointLightBatchTech.SetMatSpecularPower(0.0f);
+        m_DSPointLightBatchTech.SetScreenSize(WINDOW_WIDTH, WINDOW_HEIGHT);
+
+        // Without the instanced stencil volumes only this mode is lost - the
+        // per light stencil pass uses m_nullTech
+        if (!m_nullInstancedTech.InitInstanced()) {
+            printf("Error initializing the instanced null technique\n");
+            return false;
+        }
+
+        return true;
+    }
+
     void Run()
     {
         GLUTBackendRun(this);
@@ -147,16 +254,31 @@ public:
 
         m_pGameCamera->OnRender();
 
+        // The light passes reconstruct the world position from the depth buffer
+        Pipeline p;
+        p.SetCamera(m_pGameCamera->GetPos(), m_pGameCamera->GetTarget(), m_pGameCamera->GetUp());
+        p.SetPerspectiveProj(m_persProjInfo);
+        m_viewProj = p.GetVPTrans();
+        m_invViewProj = m_viewProj;
+        m_invViewProj.Inverse();
+
                 m_gbuffer.StartFrame();
 
         DSGeometryPass();
 
+        if (m_lightPassMode == LIGHT_PASS_TILED) {
+            DSTiledLightPass();
+        }
+        else if (m_lightPassMode == LIGHT_PASS_INSTANCED) {
+            DSInstancedPointLightsPass();
+        }
+        else {
                 // We need stencil to be enabled in the stencil pass to get the stencil buffer
                 // updated and we also need it in the light pass because we render the light
                 // only if the stencil passes.
                 glEnable(GL_STENCIL_TEST);
 
-                for (unsigned int i = 0 ; i < ARRAY_SIZE_IN_ELEMENTS(m_pointLight); i++) {
+                for (unsigned int i = 0 ; i < NUM_STENCIL_PASS_POINT_LIGHTS ; i++) {
                         DSStencilPass(i);
                         DSPointLightPass(i);
                 }
@@ -164,6 +286,7 @@ public:
                 // The directional light does not need a stencil test because its volume
                 // is unlimited and the final pass simply copies the texture.
                 glDisable(GL_STENCIL_TEST);
+        }
 
                 DSDirectionalLightPass();
 
@@ -171,6 +294,10 @@ public:
 
         RenderFPS();
 
+#ifndef WIN32
+        m_fontRenderer.RenderText(10, 30, LightPassModeNames[m_lightPassMode]);
+#endif
+
         glutSwapBuffers();
     }
 
@@ -242,6 +369,7 @@ public:
 
         m_DSPointLightPassTech.Enable();
         m_DSPointLightPassTech.SetEyeWorldPos(m_pGameCamera->GetPos());
+        m_DSPointLightPassTech.SetInverseViewProjection(m_invViewProj);
 
                 glStencilFunc(GL_NOTEQUAL, 0, 0xFF);
 
@@ -268,12 +396,90 @@ public:
     }
 
 
+    // All the point lights in a single dispatch. The output is written
+    // directly into the final texture so it must run before the passes that
+    // blend into it.
+    void DSTiledLightPass()
+    {
+        m_gbuffer.BindForTiledLightPass();
+
+        m_DSTiledLightPassTech.Enable();
+        m_DSTiledLightPassTech.SetEyeWorldPos(m_pGameCamera->GetPos());
+        m_DSTiledLightPassTech.SetInverseViewProjection(m_invViewProj);
+
+        Pipeline p;
+        p.SetCamera(m_pGameCamera->GetPos(), m_pGameCamera->GetTarget(), m_pGameCamera->GetUp());
+        m_DSTiledLightPassTech.SetViewMatrix(p.GetViewTrans());
+
+        m_pointLightBuffer.Bind(POINT_LIGHT_BUFFER_BINDING);
+
+        m_DSTiledLightPassTech.Dispatch();
+    }
+
+
+    // Same as DSStencilPass + DSPointLightPass but all the light volumes are
+    // drawn together - two draws for all the lights. The stencil pass
+    // accumulates the volumes of all the lights so after it the stencil is
+    // non zero wherever the pixel is inside at least one volume (as long as
+    // less than 256 volumes overlap). The light pass shader rejects the
+    // pixels which are outside of the volume of the current light.
+    void DSInstancedPointLightsPass()
+    {
+        m_pointLightBuffer.Bind(POINT_LIGHT_BUFFER_BINDING);
+
+        glEnable(GL_STENCIL_TEST);
+
+        m_nullInstancedTech.Enable();
+        m_nullInstancedTech.SetVP(m_viewProj);
+
+        m_gbuffer.BindForStencilPass();
+        glEnable(GL_DEPTH_TEST);
+
+        glDisable(GL_CULL_FACE);
+
+        glClear(GL_STENCIL_BUFFER_BIT);
+
+        glStencilFunc(GL_ALWAYS, 0, 0);
+
+        glStencilOpSeparate(GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP);
+        glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP);
+
+        m_bsphere.Render(NUM_POINT_LIGHTS);
+
+        m_gbuffer.BindForLightPass();
+
+        m_DSPointLightBatchTech.Enable();
+        m_DSPointLightBatchTech.SetEyeWorldPos(m_pGameCamera->GetPos());
+        m_DSPointLightBatchTech.SetInverseViewProjection(m_invViewProj);
+        m_DSPointLightBatchTech.SetVP(m_viewProj);
+
+        glStencilFunc(GL_NOTEQUAL, 0, 0xFF);
+
+        glDisable(GL_DEPTH_TEST);
+        glEnable(GL_BLEND);
+        glBlendEquation(GL_FUNC_ADD);
+        glBlendFunc(GL_ONE, GL_ONE);
+
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_FRONT);
+
+        m_bsphere.Render(NUM_POINT_LIGHTS);
+
+        glCullFace(GL_BACK);
+
+        glDisable(GL_BLEND);
+
+        glDisable(GL_STENCIL_TEST);
+    }
+
+
         void DSDirectionalLightPass()
         {
                 m_gbuffer.BindForLightPass();
 
         m_DSDirLightPassTech.Enable();
         m_DSDirLightPassTech.SetEyeWorldPos(m_pGameCamera->GetPos());
+        m_DSDirLightPassTech.SetInverseViewProjection(m_invViewProj);
 
                 glDisable(GL_DEPTH_TEST);
                 glEnable(GL_BLEND);
@@ -301,6 +507,12 @@ public:
                 case OGLDEV_KEY_q:
                         GLUTBackendLeaveMainLoop();
                         break;
+                case OGLDEV_KEY_t:
+                        // Skip the modes that failed to initialize
+                        do {
+                                m_lightPassMode = (LIGHT_PASS_MODE)((m_lightPassMode + 1) % NUM_LIGHT_PASS_MODES);
+                        } while (!m_isModeAvailable[m_lightPassMode]);
+                        break;
                 default:
                         m_pGameCamera->OnKeyboard(OgldevKey);
                 }
@@ -362,6 +574,18 @@ private:
                 m_pointLight[2].Attenuation.Constant = 0.0f;
         m_pointLight[2].Attenuation.Linear = 0.0f;
         m_pointLight[2].Attenuation.Exp = 0.3f;
+
+        // Small random lights around the boxes
+        for (unsigned int i = 3 ; i < NUM_POINT_LIGHTS ; i++) {
+            m_pointLight[i].DiffuseIntensity = 0.2f;
+            m_pointLight[i].Color = Vector3f(RandomFloat(), RandomFloat(), RandomFloat());
+            m_pointLight[i].Position = Vector3f(RandomFloat() * 16.0f - 8.0f,
+                                                RandomFloat() * 7.0f - 2.0f,
+                                                RandomFloat() * 20.0f + 2.0f);
+            m_pointLight[i].Attenuation.Constant = 0.0f;
+            m_pointLight[i].Attenuation.Linear = 0.0f;
+            m_pointLight[i].Attenuation.Exp = 2.0f;
+        }
     }
 
 
@@ -376,19 +600,27 @@ private:
 
         DSGeomPassTech m_DSGeomPassTech;
         DSPointLightPassTech m_DSPointLightPassTech;
+    DSTiledLightPassTech m_DSTiledLightPassTech;
+    DSPointLightBatchTech m_DSPointLightBatchTech;
     DSDirLightPassTech m_DSDirLightPassTech;
     NullTechnique m_nullTech;
+    NullTechnique m_nullInstancedTech;
+    PointLightBuffer m_pointLightBuffer;
     Camera* m_pGameCamera;
     float m_scale;
     SpotLight m_spotLight;
         DirectionalLight m_dirLight;
-        PointLight m_pointLight[3];
+        PointLight m_pointLight[NUM_POINT_LIGHTS];
     BasicMesh m_box;
     BasicMesh m_bsphere;
     BasicMesh m_quad;
     PersProjInfo m_persProjInfo;
     GBuffer m_gbuffer;
     Vector3f m_boxPositions[5];
+    LIGHT_PASS_MODE m_lightPassMode;
+    bool m_isModeAvailable[NUM_LIGHT_PASS_MODES];
+    Matrix4f m_viewProj;
+    Matrix4f m_invViewProj;
 };
 
 
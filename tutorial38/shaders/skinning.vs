@@ -5,6 +5,8 @@ layout (location = 1) in vec2 TexCoord;
 layout (location = 2) in vec3 Normal;
 layout (location = 3) in ivec4 BoneIDs;
 layout (location = 4) in vec4 Weights;
+layout (location = 14) in ivec4 BoneIDs2;
+layout (location = 15) in vec4 Weights2;
 
 out vec2 TexCoord0;
 out vec3 Normal0;
@@ -15,13 +17,28 @@ const int MAX_BONES = 100;
 uniform mat4 gWVP;
 uniform mat4 gWorld;
 uniform mat4 gBones[MAX_BONES];
+uniform int gNumBoneInfluences;   // 1, 2, 4 or 8 - same for the entire draw
 
 void main()
 {
+    // Influences are sorted by weight so a group only reads the bones it needs
     mat4 BoneTransform = gBones[BoneIDs[0]] * Weights[0];
-    BoneTransform     += gBones[BoneIDs[1]] * Weights[1];
-    BoneTransform     += gBones[BoneIDs[2]] * Weights[2];
-    BoneTransform     += gBones[BoneIDs[3]] * Weights[3];
+
+    if (gNumBoneInfluences > 1) {
+        BoneTransform += gBones[BoneIDs[1]] * Weights[1];
+    }
+
+    if (gNumBoneInfluences > 2) {
+        BoneTransform += gBones[BoneIDs[2]] * Weights[2];
+        BoneTransform += gBones[BoneIDs[3]] * Weights[3];
+    }
+
+    if (gNumBoneInfluences > 4) {
+        BoneTransform += gBones[BoneIDs2[0]] * Weights2[0];
+        BoneTransform += gBones[BoneIDs2[1]] * Weights2[1];
+        BoneTransform += gBones[BoneIDs2[2]] * Weights2[2];
+        BoneTransform += gBones[BoneIDs2[3]] * Weights2[3];
+    }
 
     vec4 PosL    = BoneTransform * vec4(Position, 1.0);
     gl_Position  = gWVP * PosL;
@@ -0,0 +1,45 @@
+#version 330
+
+layout (location = 0) in vec3 Position;
+layout (location = 1) in vec2 TexCoord;
+layout (location = 2) in vec3 Normal;
+layout (location = 3) in ivec4 BoneIDs;
+layout (location = 4) in vec4 Weights;
+layout (location = 5) in mat4 WVP;
+layout (location = 9) in mat4 World;
+layout (location = 13) in vec4 AnimParams;  // first row, num frames, frames per second, time offset
+
+out vec2 TexCoord0;
+out vec3 Normal0;
+out vec3 WorldPos0;
+
+uniform sampler2D gAnimTexture;
+uniform float gTime;
+
+// Each bone takes three texels - the top three rows of its matrix
+mat4 GetBoneTransform(int Frame, int BoneID)
+{
+    int x = BoneID * 3;
+    vec4 Row0 = texelFetch(gAnimTexture, ivec2(x,     Frame), 0);
+    vec4 Row1 = texelFetch(gAnimTexture, ivec2(x + 1, Frame), 0);
+    vec4 Row2 = texelFetch(gAnimTexture, ivec2(x + 2, Frame), 0);
+    return transpose(mat4(Row0, Row1, Row2, vec4(0.0, 0.0, 0.0, 1.0)));
+}
+
+void main()
+{
+    int NumFrames = int(AnimParams.y);
+    int Frame = int(AnimParams.x) + int(mod(floor((gTime + AnimParams.w) * AnimParams.z), float(NumFrames)));
+
+    mat4 BoneTransform = GetBoneTransform(Frame, BoneIDs[0]) * Weights[0];
+    BoneTransform     += GetBoneTransform(Frame, BoneIDs[1]) * Weights[1];
+    BoneTransform     += GetBoneTransform(Frame, BoneIDs[2]) * Weights[2];
+    BoneTransform     += GetBoneTransform(Frame, BoneIDs[3]) * Weights[3];
+
+    vec4 PosL    = BoneTransform * vec4(Position, 1.0);
+    gl_Position  = WVP * PosL;
+    TexCoord0    = TexCoord;
+    vec4 NormalL = BoneTransform * vec4(Normal, 0.0);
+    Normal0      = (World * NormalL).xyz;
+    WorldPos0    = (World * PosL).xyz;
+}
@@ -27,16 +27,71 @@ using namespace std;
 
 SkinningTechnique::SkinningTechnique()
 {
+    m_WVPLocation = INVALID_UNIFORM_LOCATION;
+    m_WorldMatrixLocation = INVALID_UNIFORM_LOCATION;
+    m_numBoneInfluencesLocation = INVALID_UNIFORM_LOCATION;
+    m_animTextureLocation = INVALID_UNIFORM_LOCATION;
+    m_timeLocation = INVALID_UNIFORM_LOCATION;
+
+    for (unsigned int i = 0 ; i < ARRAY_SIZE_IN_ELEMENTS(m_boneLocation) ; i++) {
+        m_boneLocation[i] = INVALID_UNIFORM_LOCATION;
+    }
 }
 
 
 bool SkinningTechnique::Init()
+{
+    if (!InitCommon("shaders/skinning.vs")) {
+        return false;
+    }
+
+    m_WVPLocation = GetUniformLocation("gWVP");
+    m_WorldMatrixLocation = GetUniformLocation("gWorld");
+    m_numBoneInfluencesLocation = GetUniformLocation("gNumBoneInfluences");
+
+    if (m_WVPLocation == INVALID_UNIFORM_LOCATION ||
+        m_WorldMatrixLocation == INVALID_UNIFORM_LOCATION ||
+        m_numBoneInfluencesLocation == INVALID_UNIFORM_LOCATION) {
+        return false;
+    }
+
+    for (unsigned int i = 0 ; i < ARRAY_SIZE_IN_ELEMENTS(m_boneLocation) ; i++) {
+        char Name[128];
+        memset(Name, 0, sizeof(Name));
+        SNPRINTF(Name, sizeof(Name), "gBones[%d]", i);
+        m_boneLocation[i] = GetUniformLocation(Name);
+    }
+
+    return true;
+}
+
+
+// skinning_instanced.vs has no bone or matrix uniforms so those locations stay invalid
+bool SkinningTechnique::InitInstanced()
+{
+    if (!InitCommon("shaders/skinning_instanced.vs")) {
+        return false;
+    }
+
+    m_animTextureLocation = GetUniformLocation("gAnimTexture");
+    m_timeLocation = GetUniformLocation("gTime");
+
+    if (m_animTextureLocation == INVALID_UNIFORM_LOCATION ||
+        m_timeLocation == INVALID_UNIFORM_LOCATION) {
+        return false;
+    }
+
+    return true;
+}
+
+
+bool SkinningTechnique::InitCommon(const char* pVSFilename)
 {
     if (!Technique::Init()) {
         return false;
     }
 
-    if (!AddShader(GL_VERTEX_SHADER, "shaders/skinning.vs")) {
+    if (!AddShader(GL_VERTEX_SHADER, pVSFilename)) {
         return false;
     }
 
@@ -48,8 +103,6 @@ bool SkinningTechnique::Init()
         return false;
     }
 
-    m_WVPLocation = GetUniformLocation("gWVP");
-    m_WorldMatrixLocation = GetUniformLocation("gWorld");
     m_colorTextureLocation = GetUniformLocation("gColorMap");
     m_eyeWorldPosLocation = GetUniformLocation("gEyeWorldPos");
     m_dirLightLocation.Color = GetUniformLocation("gDirectionalLight.Base.Color");
@@ -60,10 +113,7 @@ bool SkinningTechnique::Init()
     m_matSpecularPowerLocation = GetUniformLocation("gSpecularPower");
     m_numPointLightsLocation = GetUniformLocation("gNumPointLights");
     m_numSpotLightsLocation = GetUniformLocation("gNumSpotLights");
-
     if (m_dirLightLocation.AmbientIntensity == INVALID_UNIFORM_LOCATION ||
-        m_WVPLocation == INVALID_UNIFORM_LOCATION ||
-        m_WorldMatrixLocation == INVALID_UNIFORM_LOCATION ||
         m_colorTextureLocation == INVALID_UNIFORM_LOCATION ||
         m_eyeWorldPosLocation == INVALID_UNIFORM_LOCATION ||
         m_dirLightLocation.Color == INVALID_UNIFORM_LOCATION ||
@@ -154,13 +204,6 @@ bool SkinningTechnique::Init()
         }
     }
 
-    for (unsigned int i = 0 ; i < ARRAY_SIZE_IN_ELEMENTS(m_boneLocation) ; i++) {
-        char Name[128];
-        memset(Name, 0, sizeof(Name));
-        SNPRINTF(Name, sizeof(Name), "gBones[%d]", i);
-        m_boneLocation[i] = GetUniformLocation(Name);
-    }
-
     return true;
 }
 
@@ -255,3 +298,21 @@ void SkinningTechnique::SetBoneTransform(uint Index, const Matrix4f& Transform)
     //Transform.Print();
     glUniformMatrix4fv(m_boneLocation[Index], 1, GL_TRUE, (const GLfloat*)Transform);
 }
+
+
+void SkinningTechnique::SetAnimTextureUnit(uint TextureUnit)
+{
+    glUniform1i(m_animTextureLocation, TextureUnit);
+}
+
+
+void SkinningTechnique::SetTime(float Time)
+{
+    glUniform1f(m_timeLocation, Time);
+}
+
+
+void SkinningTechnique::SetNumBoneInfluences(uint NumInfluences)
+{
+    glUniform1i(m_numBoneInfluencesLocation, NumInfluences);
+}
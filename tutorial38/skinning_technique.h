@@ -88,6 +88,10 @@ public:
 
     virtual bool Init();
 
+    // Instanced variant - bones come from an AnimationTexture and the
+    // WVP/world matrices are per instance vertex attributes
+    bool InitInstanced();
+
     void SetWVP(const Matrix4f& WVP);
     void SetWorldMatrix(const Matrix4f& WVP);
     void SetColorTextureUnit(uint TextureUnit);
@@ -98,9 +102,18 @@ public:
     void SetMatSpecularIntensity(float Intensity);
     void SetMatSpecularPower(float Power);
     void SetBoneTransform(uint Index, const Matrix4f& Transform);
+    void SetAnimTextureUnit(uint TextureUnit);
+    void SetTime(float Time);
+    void SetNumBoneInfluences(uint NumInfluences);
 
 private:
-    
+
+    bool InitCommon(const char* pVSFilename);
+
+    GLuint m_animTextureLocation;
+    GLuint m_timeLocation;
+    GLuint m_numBoneInfluencesLocation;
+
     GLuint m_WVPLocation;
     GLuint m_WorldMatrixLocation;
     GLuint m_colorTextureLocation;
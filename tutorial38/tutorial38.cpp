@@ -38,12 +38,19 @@
 #include "skinning_technique.h"
 #include "ogldev_glut_backend.h"
 #include "ogldev_skinned_mesh.h"
+#include "ogldev_anim_texture.h"
 
 using namespace std;
 
 #define WINDOW_WIDTH  1280
 #define WINDOW_HEIGHT 1024
 
+#define CROWD_ROWS    32
+#define CROWD_COLUMNS 32
+#define NUM_INSTANCES (CROWD_ROWS * CROWD_COLUMNS)
+
+#define CHARACTER_HEIGHT 6.0f   // world units after scaling
+
 class Tutorial38 : public ICallbacks, public OgldevApp
 {
 public:
@@ -52,6 +59,9 @@ public:
     {
         m_pGameCamera = NULL;
         m_pEffect = NULL;
+        m_pInstancedEffect = NULL;
+        m_crowdMode = false;
+        m_animLOD = true;
         m_directionalLight.Color = Vector3f(1.0f, 1.0f, 1.0f);
         m_directionalLight.AmbientIntensity = 0.55f;
         m_directionalLight.DiffuseIntensity = 0.9f;
@@ -69,6 +79,7 @@ public:
     ~Tutorial38()
     {
         SAFE_DELETE(m_pEffect);
+        SAFE_DELETE(m_pInstancedEffect);
         SAFE_DELETE(m_pGameCamera);
     }
 
@@ -99,6 +110,37 @@ public:
             return false;
         }
 
+        // 1/1000 of a unit, 0.05 degrees and 0.1% of the scale
+        if (!m_mesh.CompressAnimation(30.0f, 0.001f, ToRadian(0.05f), 0.001f)) {
+            printf("Animation compression failed\n");
+            return false;
+        }
+
+        m_pInstancedEffect = new SkinningTechnique();
+
+        if (!m_pInstancedEffect->InitInstanced()) {
+            printf("Error initializing the instanced skinning technique\n");
+            return false;
+        }
+
+        m_pInstancedEffect->Enable();
+
+        m_pInstancedEffect->SetColorTextureUnit(COLOR_TEXTURE_UNIT_INDEX);
+        m_pInstancedEffect->SetAnimTextureUnit(ANIMATION_TEXTURE_UNIT_INDEX);
+        m_pInstancedEffect->SetDirectionalLight(m_directionalLight);
+        m_pInstancedEffect->SetMatSpecularIntensity(0.0f);
+        m_pInstancedEffect->SetMatSpecularPower(0);
+
+        if (!m_animTexture.AddClip(m_mesh, 30.0f) || !m_animTexture.Finalize()) {
+            printf("Error baking the animation texture\n");
+            return false;
+        }
+
+        // Desynchronize the crowd
+        for (uint i = 0 ; i < NUM_INSTANCES ; i++) {
+            m_animParams[i] = m_animTexture.GetInstanceParams(0, RandomFloat() * m_mesh.GetAnimationDuration());
+        }
+
 #ifndef WIN32
         if (!m_fontRenderer.InitFontRenderer()) {
             return false;
@@ -121,13 +163,46 @@ public:
 
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+        if (m_crowdMode) {
+            RenderCrowd();
+        }
+        else {
+            RenderSingle();
+        }
+
+        RenderFPS();
+
+        if (!m_crowdMode) {
+            char text[64];
+            ZERO_MEM(text);
+            SNPRINTF(text, sizeof(text), "Bones evaluated: %d%s", m_animLODState.BonesEvaluated, m_animLOD ? " (LOD)" : "");
+#ifndef WIN32
+            m_fontRenderer.RenderText(10, 30, text);
+#endif
+        }
+
+        glutSwapBuffers();
+    }
+
+
+    void RenderSingle()
+    {
         m_pEffect->Enable();
 
         vector<Matrix4f> Transforms;
 
         float RunningTime = GetRunningTime();
 
-        m_mesh.BoneTransform(RunningTime, Transforms);
+        if (m_animLOD) {
+            // Fraction of the viewport height covered by the character
+            float Distance = (m_position - m_pGameCamera->GetPos()).Length();
+            float ScreenSize = CHARACTER_HEIGHT / (2.0f * Distance * tanf(ToRadian(m_persProjInfo.FOV / 2.0f)));
+            m_mesh.BoneTransform(RunningTime, Transforms, m_animLODConfig, ScreenSize, m_animLODState);
+        }
+        else {
+            m_mesh.BoneTransform(RunningTime, Transforms);
+            m_animLODState.BonesEvaluated = m_mesh.NumBones();
+        }
 
         for (uint i = 0 ; i < Transforms.size() ; i++) {
             m_pEffect->SetBoneTransform(i, Transforms[i]);
@@ -146,11 +221,39 @@ public:
         m_pEffect->SetWVP(p.GetWVPTrans());
         m_pEffect->SetWorldMatrix(p.GetWorldTrans());
 
-        m_mesh.Render();
+        // Rigid triangles first, then the groups that need more bones
+        for (uint i = 0 ; i < SkinnedMesh::NUM_INFLUENCE_GROUPS ; i++) {
+            m_pEffect->SetNumBoneInfluences(SkinnedMesh::GetInfluenceGroupSize(i));
+            m_mesh.RenderInfluenceGroup(i);
+        }
+    }
 
-        RenderFPS();
 
-        glutSwapBuffers();
+    // All the characters are drawn by a single instanced draw. The bones of
+    // every instance are fetched from the animation texture in the VS.
+    void RenderCrowd()
+    {
+        m_pInstancedEffect->Enable();
+        m_pInstancedEffect->SetEyeWorldPos(m_pGameCamera->GetPos());
+        m_pInstancedEffect->SetTime(GetRunningTime());
+
+        m_animTexture.Bind(ANIMATION_TEXTURE_UNIT);
+
+        Pipeline p;
+        p.SetCamera(m_pGameCamera->GetPos(), m_pGameCamera->GetTarget(), m_pGameCamera->GetUp());
+        p.SetPerspectiveProj(m_persProjInfo);
+        p.Scale(0.1f, 0.1f, 0.1f);
+        p.Rotate(270.0f, 180.0f, 0.0f);
+
+        for (uint i = 0 ; i < NUM_INSTANCES ; i++) {
+            float x = ((float)(i % CROWD_COLUMNS) - CROWD_COLUMNS / 2) * 3.0f;
+            float z = (float)(i / CROWD_COLUMNS) * 3.0f;
+            p.WorldPos(m_position.x + x, m_position.y, m_position.z + z);
+            m_WVPMatrices[i] = p.GetWVPTrans().Transpose();
+            m_worldMatrices[i] = p.GetWorldTrans().Transpose();
+        }
+
+        m_mesh.Render(NUM_INSTANCES, m_WVPMatrices, m_worldMatrices, m_animParams);
     }
 
 
@@ -161,6 +264,12 @@ public:
                 case OGLDEV_KEY_q:
                         GLUTBackendLeaveMainLoop();
                         break;
+                case OGLDEV_KEY_c:
+                        m_crowdMode = !m_crowdMode;
+                        break;
+                case OGLDEV_KEY_l:
+                        m_animLOD = !m_animLOD;
+                        break;
                 default:
                         m_pGameCamera->OnKeyboard(OgldevKey);
                 }
@@ -176,11 +285,20 @@ public:
 private:
 
     SkinningTechnique* m_pEffect;
+    SkinningTechnique* m_pInstancedEffect;
     Camera* m_pGameCamera;
     DirectionalLight m_directionalLight;
     SkinnedMesh m_mesh;
     Vector3f m_position;
     PersProjInfo m_persProjInfo;
+    AnimationTexture m_animTexture;
+    bool m_crowdMode;
+    bool m_animLOD;
+    AnimationLODConfig m_animLODConfig;
+    AnimationLODState m_animLODState;
+    Matrix4f m_WVPMatrices[NUM_INSTANCES];
+    Matrix4f m_worldMatrices[NUM_INSTANCES];
+    Vector4f m_animParams[NUM_INSTANCES];
 };
 
 
@@ -151,6 +151,10 @@ bool Mesh::InitFromScene(const aiScene* pScene, const string& Filename)
         InitMesh(i, paiMesh, Positions, Normals, TexCoords, Bones, Indices);
     }
 
+    if (m_withAdjacencies) {
+        BuildAdjacencies(pScene, Positions, Indices);
+    }
+
     if (!InitMaterials(pScene, Filename)) {
         return false;
     }
@@ -185,76 +189,27 @@ bool Mesh::InitFromScene(const aiScene* pScene, const string& Filename)
 }
 
 
-static uint GetOppositeIndex(const aiFace& Face, const Edge& e)
+// The submeshes are processed in parallel. Their indices stay relative to
+// their base vertex.
+void Mesh::BuildAdjacencies(const aiScene* pScene, const vector<Vector3f>& Positions, vector<uint>& Indices)
 {
-    for (uint i = 0 ; i < 3 ; i++) {
-        uint Index = Face.mIndices[i];
-
-        if (Index != e.a && Index != e.b) {
-            return Index;
-        }
-    }
-       
-    assert(0);      
-
-    return 0;
-}
+    vector<uint> AdjIndices(Indices.size() * 2);
+    vector<AdjacencyJob> Jobs(m_Entries.size());
+    uint FirstIndex = 0;
 
+    for (uint i = 0 ; i < m_Entries.size() ; i++) {
+        Jobs[i].pPositions   = Positions.data() + m_Entries[i].BaseVertex;
+        Jobs[i].NumVertices  = pScene->mMeshes[i]->mNumVertices;
+        Jobs[i].pIndices     = Indices.data() + FirstIndex;
+        Jobs[i].NumTriangles = pScene->mMeshes[i]->mNumFaces;
+        Jobs[i].pAdjIndices  = AdjIndices.data() + m_Entries[i].BaseIndex;
 
-void Mesh::FindAdjacencies(const aiMesh* paiMesh, vector<unsigned int>& Indices)
-{       
-    // Step 1 - find the two triangles that share every edge
-    for (uint i = 0 ; i < paiMesh->mNumFaces ; i++) {
-        const aiFace& face = paiMesh->mFaces[i];
+        FirstIndex += Jobs[i].NumTriangles * 3;
+    }
 
-        Face Unique;
-        
-        // If a position vector is duplicated in the VB we fetch the 
-        // index of the first occurrence.
-        for (uint j = 0 ; j < 3 ; j++) {            
-            uint Index = face.mIndices[j];
-            aiVector3D& v = paiMesh->mVertices[Index];
-            
-            if (m_posMap.find(v) == m_posMap.end()) {
-                m_posMap[v] = Index;
-            }
-            else {
-                Index = m_posMap[v];
-            }           
-            
-            Unique.Indices[j] = Index;
-        }
-        
-        m_uniqueFaces.push_back(Unique);
-        
-        Edge e1(Unique.Indices[0], Unique.Indices[1]);
-        Edge e2(Unique.Indices[1], Unique.Indices[2]);
-        Edge e3(Unique.Indices[2], Unique.Indices[0]);
-        
-        m_indexMap[e1].AddNeigbor(i);
-        m_indexMap[e2].AddNeigbor(i);
-        m_indexMap[e3].AddNeigbor(i);
-    }   
-
-    // Step 2 - build the index buffer with the adjacency info
-    for (uint i = 0 ; i < paiMesh->mNumFaces ; i++) {        
-        const Face& face = m_uniqueFaces[i];
-        
-        for (uint j = 0 ; j < 3 ; j++) {            
-            Edge e(face.Indices[j], face.Indices[(j + 1) % 3]);
-            assert(m_indexMap.find(e) != m_indexMap.end());
-            Neighbors n = m_indexMap[e];
-            uint OtherTri = n.GetOther(i);
-            
-            assert(OtherTri != -1);
+    BuildAdjacency(Jobs);
 
-            const Face& OtherFace = m_uniqueFaces[OtherTri];
-            uint OppositeIndex = OtherFace.GetOppositeIndex(e);
-         
-            Indices.push_back(face.Indices[j]);
-            Indices.push_back(OppositeIndex);             
-        }
-    }    
+    Indices.swap(AdjIndices);
 }
 
 
@@ -281,19 +236,15 @@ void Mesh::InitMesh(uint MeshIndex,
     
     LoadBones(MeshIndex, paiMesh, Bones);
 
-	if (m_withAdjacencies) {
-    	FindAdjacencies(paiMesh, Indices);
-	}
-	else {
-	    // Populate the index buffer
-	    for (uint i = 0 ; i < paiMesh->mNumFaces ; i++) {
-	        const aiFace& Face = paiMesh->mFaces[i];
-	        assert(Face.mNumIndices == 3);
-	        Indices.push_back(Face.mIndices[0]);
-	        Indices.push_back(Face.mIndices[1]);
-	        Indices.push_back(Face.mIndices[2]);
-	    }	
-	}
+    // Populate the index buffer. InitFromScene converts it to adjacency
+    // triangles if required.
+    for (uint i = 0 ; i < paiMesh->mNumFaces ; i++) {
+        const aiFace& Face = paiMesh->mFaces[i];
+        assert(Face.mNumIndices == 3);
+        Indices.push_back(Face.mIndices[0]);
+        Indices.push_back(Face.mIndices[1]);
+        Indices.push_back(Face.mIndices[2]);
+    }
 }
 
 
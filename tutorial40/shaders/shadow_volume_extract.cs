@@ -0,0 +1,120 @@
+#version 430
+
+// Must match shadow_volume_technique.h
+#define MAX_SHADOW_LIGHTS 4
+
+layout (local_size_x = 64) in;
+
+layout (std430, binding = 0) readonly buffer PositionBuffer {
+    float gPositions[];         // 3 per vertex, like the vertex buffer of the mesh
+};
+
+layout (std430, binding = 1) readonly buffer IndexBuffer {
+    uint gIndices[];            // 6 per triangle (GL_TRIANGLES_ADJACENCY)
+};
+
+layout (std430, binding = 2) writeonly buffer VolumeBuffer {
+    vec4 gVertices[];           // gMaxVertices per light
+};
+
+// DrawArraysIndirectCommand
+struct DrawCommand {
+    uint Count;
+    uint InstanceCount;
+    uint First;
+    uint BaseInstance;
+};
+
+layout (std430, binding = 3) buffer CommandBuffer {
+    DrawCommand gCommands[];    // one per light
+};
+
+uniform uint gNumTriangles;
+uniform uint gBaseIndex;
+uniform uint gBaseVertex;
+uniform uint gMaxVertices;
+uniform vec3 gLightPos[MAX_SHADOW_LIGHTS];
+
+const float EPSILON = 0.0001;
+
+vec3 GetPosition(uint i)
+{
+    uint Index = (gBaseVertex + gIndices[gBaseIndex + i]) * 3u;
+    return vec3(gPositions[Index], gPositions[Index + 1u], gPositions[Index + 2u]);
+}
+
+// Just a tiny bit behind the original vertex
+vec4 NearVertex(vec3 Pos, vec3 LightPos)
+{
+    return vec4(Pos + normalize(Pos - LightPos) * EPSILON, 1.0);
+}
+
+// Projected to infinity
+vec4 FarVertex(vec3 Pos, vec3 LightPos)
+{
+    return vec4(Pos - LightPos, 0.0);
+}
+
+// Same classification as shadow_volume.gs. Every silhouette edge is
+// extruded by the light facing triangle only so it is written once.
+void main()
+{
+    uint Triangle = gl_GlobalInvocationID.x;
+    uint Light = gl_GlobalInvocationID.y;
+
+    if (Triangle >= gNumTriangles) {
+        return;
+    }
+
+    vec3 LightPos = gLightPos[Light];
+    vec3 P[6];
+
+    for (uint i = 0u ; i < 6u ; i++) {
+        P[i] = GetPosition(Triangle * 6u + i);
+    }
+
+    if (dot(cross(P[2] - P[0], P[4] - P[0]), LightPos - P[0]) <= 0.0) {
+        return;
+    }
+
+    bool Silhouette[3];
+    Silhouette[0] = dot(cross(P[1] - P[0], P[2] - P[0]), LightPos - P[0]) <= 0.0;
+    Silhouette[1] = dot(cross(P[3] - P[2], P[4] - P[2]), LightPos - P[2]) <= 0.0;
+    Silhouette[2] = dot(cross(P[4] - P[0], P[5] - P[0]), LightPos - P[4]) <= 0.0;
+
+    uint NumVertices = 6u;
+
+    for (uint i = 0u ; i < 3u ; i++) {
+        if (Silhouette[i]) {
+            NumVertices += 6u;
+        }
+    }
+
+    uint Offset = Light * gMaxVertices + atomicAdd(gCommands[Light].Count, NumVertices);
+
+    // Front and back caps
+    gVertices[Offset]      = NearVertex(P[0], LightPos);
+    gVertices[Offset + 1u] = NearVertex(P[2], LightPos);
+    gVertices[Offset + 2u] = NearVertex(P[4], LightPos);
+    gVertices[Offset + 3u] = FarVertex(P[0], LightPos);
+    gVertices[Offset + 4u] = FarVertex(P[4], LightPos);
+    gVertices[Offset + 5u] = FarVertex(P[2], LightPos);
+    Offset += 6u;
+
+    // The quads of the silhouette edges as two triangles each. Edge i goes
+    // from vertex 2 * i to vertex 2 * i + 2 of the adjacency triangle.
+    for (uint i = 0u ; i < 3u ; i++) {
+        if (Silhouette[i]) {
+            vec3 Start = P[i * 2u];
+            vec3 End = P[(i * 2u + 2u) % 6u];
+
+            gVertices[Offset]      = NearVertex(Start, LightPos);
+            gVertices[Offset + 1u] = FarVertex(Start, LightPos);
+            gVertices[Offset + 2u] = NearVertex(End, LightPos);
+            gVertices[Offset + 3u] = NearVertex(End, LightPos);
+            gVertices[Offset + 4u] = FarVertex(Start, LightPos);
+            gVertices[Offset + 5u] = FarVertex(End, LightPos);
+            Offset += 6u;
+        }
+    }
+}
@@ -0,0 +1,10 @@
+#version 330
+
+layout (location = 0) in vec4 Position;    // w is 0 for the vertices at infinity
+
+uniform mat4 gWVP;
+
+void main()
+{
+    gl_Position = gWVP * Position;
+}
@@ -0,0 +1,168 @@
+/*
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <vector>
+
+#include "ogldev_util.h"
+#include "shadow_volume_buffer.h"
+
+using namespace std;
+
+// A light facing triangle writes its two caps and up to three quads
+#define MAX_VOLUME_VERTICES_PER_TRIANGLE 24
+
+
+ShadowVolumeBuffer::ShadowVolumeBuffer()
+{
+    m_maxLights = 0;
+    m_maxVertices = 0;
+    m_VAO = 0;
+
+    ZERO_MEM(m_buffers);
+}
+
+
+ShadowVolumeBuffer::~ShadowVolumeBuffer()
+{
+    if (m_buffers[0] != 0) {
+        glDeleteBuffers(ARRAY_SIZE_IN_ELEMENTS(m_buffers), m_buffers);
+    }
+
+    if (m_VAO != 0) {
+        glDeleteVertexArrays(1, &m_VAO);
+    }
+}
+
+
+bool ShadowVolumeBuffer::Init(const Mesh& Mesh, uint MaxLights)
+{
+    if (!Mesh.HasAdjacencies()) {
+        printf("The shadow volume buffer requires a mesh with adjacencies\n");
+        return false;
+    }
+
+    if (MaxLights == 0 || MaxLights > MAX_SHADOW_LIGHTS) {
+        printf("Invalid number of shadow casting lights %d\n", MaxLights);
+        return false;
+    }
+
+    uint NumTriangles = 0;
+
+    for (uint i = 0 ; i < Mesh.GetNumEntries() ; i++) {
+        uint BaseIndex, BaseVertex, NumIndices;
+        Mesh.GetEntry(i, BaseIndex, BaseVertex, NumIndices);
+        NumTriangles += NumIndices / 6;
+    }
+
+    m_maxLights = MaxLights;
+    m_maxVertices = NumTriangles * MAX_VOLUME_VERTICES_PER_TRIANGLE;
+
+    glGenBuffers(ARRAY_SIZE_IN_ELEMENTS(m_buffers), m_buffers);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[VOLUME_BUFFER]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(Vector4f) * m_maxVertices * MaxLights, NULL, GL_DYNAMIC_COPY);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[COMMAND_BUFFER]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(DrawArraysIndirectCommand) * MaxLights, NULL, GL_DYNAMIC_COPY);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glGenVertexArrays(1, &m_VAO);
+    glBindVertexArray(m_VAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffers[VOLUME_BUFFER]);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, 0);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (!m_extractTech.Init()) {
+        printf("Error initializing the shadow volume extraction technique\n");
+        return false;
+    }
+
+    m_extractTech.Enable();
+    m_extractTech.SetMaxVertices(m_maxVertices);
+
+    return GLCheckError();
+}
+
+
+void ShadowVolumeBuffer::Extract(const Mesh& Mesh, const Vector3f* pLightPositions, uint NumLights)
+{
+    assert(NumLights <= m_maxLights);
+
+    // Every light starts with an empty range
+    vector<DrawArraysIndirectCommand> Commands(m_maxLights);
+
+    for (uint i = 0 ; i < m_maxLights ; i++) {
+        Commands[i].Count = 0;
+        Commands[i].InstanceCount = 1;
+        Commands[i].First = i * m_maxVertices;
+        Commands[i].BaseInstance = 0;
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[COMMAND_BUFFER]);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(Commands[0]) * Commands.size(), &Commands[0]);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    if (NumLights == 0) {
+        return;
+    }
+
+    m_extractTech.Enable();
+    m_extractTech.SetLightPositions(pLightPositions, NumLights);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SV_POSITION_BINDING, Mesh.GetPositionBuffer());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SV_INDEX_BINDING, Mesh.GetIndexBuffer());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SV_VOLUME_BINDING, m_buffers[VOLUME_BUFFER]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SV_COMMAND_BINDING, m_buffers[COMMAND_BUFFER]);
+
+    for (uint i = 0 ; i < Mesh.GetNumEntries() ; i++) {
+        uint BaseIndex, BaseVertex, NumIndices;
+        Mesh.GetEntry(i, BaseIndex, BaseVertex, NumIndices);
+
+        uint NumTriangles = NumIndices / 6;
+
+        if (NumTriangles == 0) {
+            continue;
+        }
+
+        m_extractTech.SetMeshRange(BaseIndex, BaseVertex, NumTriangles);
+
+        uint NumGroups = (NumTriangles + SHADOW_VOLUME_EXTRACT_GROUP_SIZE - 1) / SHADOW_VOLUME_EXTRACT_GROUP_SIZE;
+        glDispatchCompute(NumGroups, NumLights, 1);
+    }
+
+    // The volumes are read as vertices and the counts as draw commands
+    glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+}
+
+
+void ShadowVolumeBuffer::Render(uint Light)
+{
+    assert(Light < m_maxLights);
+
+    glBindVertexArray(m_VAO);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_buffers[COMMAND_BUFFER]);
+
+    glDrawArraysIndirect(GL_TRIANGLES, (const void*)(sizeof(DrawArraysIndirectCommand) * Light));
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindVertexArray(0);
+}
@@ -0,0 +1,73 @@
+/*
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SHADOW_VOLUME_BUFFER_H
+#define SHADOW_VOLUME_BUFFER_H
+
+#include <GL/glew.h>
+
+#include "ogldev_types.h"
+#include "ogldev_math_3d.h"
+#include "shadow_volume_technique.h"
+#include "mesh.h"
+
+// Shadow volumes of a mesh with adjacencies built by a compute pass instead
+// of the geometry shader. Extract classifies the triangles against all the
+// lights at once and appends the caps and the silhouette quads of every
+// light to its own range of a vertex buffer. The vertex count of a light is
+// the count of an indirect draw command so Render never waits for the CPU.
+class ShadowVolumeBuffer
+{
+public:
+
+    ShadowVolumeBuffer();
+
+    ~ShadowVolumeBuffer();
+
+    bool Init(const Mesh& Mesh, uint MaxLights);
+
+    // The light positions are in the object space of the mesh
+    void Extract(const Mesh& Mesh, const Vector3f* pLightPositions, uint NumLights);
+
+    // Draws the volume of one light with the currently enabled technique
+    // (ShadowVolumeTechnique::InitIndirect)
+    void Render(uint Light);
+
+private:
+
+    // Must match DrawCommand in shadow_volume_extract.cs
+    struct DrawArraysIndirectCommand {
+        uint Count;
+        uint InstanceCount;
+        uint First;
+        uint BaseInstance;
+    };
+
+    enum BUFFER_TYPE {
+        VOLUME_BUFFER  = 0,
+        COMMAND_BUFFER = 1,
+        NUM_BUFFERS    = 2
+    };
+
+    uint m_maxLights;
+    uint m_maxVertices;     // per light
+    GLuint m_buffers[NUM_BUFFERS];
+    GLuint m_VAO;
+    ShadowVolumeExtractTechnique m_extractTech;
+};
+
+#endif  /* SHADOW_VOLUME_BUFFER_H */
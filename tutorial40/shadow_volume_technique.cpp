@@ -63,6 +63,35 @@ bool ShadowVolumeTechnique::Init()
 }
 
 
+bool ShadowVolumeTechnique::InitIndirect()
+{
+    if (!Technique::Init()) {
+        return false;
+    }
+
+    if (!AddShader(GL_VERTEX_SHADER, "shaders/shadow_volume_indirect.vs")) {
+        return false;
+    }
+
+    if (!AddShader(GL_FRAGMENT_SHADER, "shaders/shadow_volume.fs")) {
+        return false;
+    }
+
+    if (!Finalize()) {
+        return false;
+    }
+
+    m_WVPLocation = GetUniformLocation("gWVP");
+    m_lightPosLocation = INVALID_UNIFORM_LOCATION;
+
+    if (m_WVPLocation == INVALID_UNIFORM_LOCATION) {
+        return false;
+    }
+
+    return true;
+}
+
+
 void ShadowVolumeTechnique::SetWVP(const Matrix4f& WVP)
 {
     glUniformMatrix4fv(m_WVPLocation, 1, GL_TRUE, (const GLfloat*)WVP.m);    
@@ -72,4 +101,62 @@ void ShadowVolumeTechnique::SetWVP(const Matrix4f& WVP)
 void ShadowVolumeTechnique::SetLightPos(const Vector3f& Pos)
 {
     glUniform3f(m_lightPosLocation, Pos.x, Pos.y, Pos.z);
-}
\ No newline at end of file
+}
+
+
+ShadowVolumeExtractTechnique::ShadowVolumeExtractTechnique()
+{
+}
+
+
+bool ShadowVolumeExtractTechnique::Init()
+{
+    if (!Technique::Init()) {
+        return false;
+    }
+
+    if (!AddShader(GL_COMPUTE_SHADER, "shaders/shadow_volume_extract.cs")) {
+        return false;
+    }
+
+    if (!Finalize()) {
+        return false;
+    }
+
+    m_lightPosLocation = GetUniformLocation("gLightPos[0]");
+    m_baseIndexLocation = GetUniformLocation("gBaseIndex");
+    m_baseVertexLocation = GetUniformLocation("gBaseVertex");
+    m_numTrianglesLocation = GetUniformLocation("gNumTriangles");
+    m_maxVerticesLocation = GetUniformLocation("gMaxVertices");
+
+    if (m_lightPosLocation == INVALID_UNIFORM_LOCATION ||
+        m_baseIndexLocation == INVALID_UNIFORM_LOCATION ||
+        m_baseVertexLocation == INVALID_UNIFORM_LOCATION ||
+        m_numTrianglesLocation == INVALID_UNIFORM_LOCATION ||
+        m_maxVerticesLocation == INVALID_UNIFORM_LOCATION) {
+        return false;
+    }
+
+    return GLCheckError();
+}
+
+
+void ShadowVolumeExtractTechnique::SetLightPositions(const Vector3f* pPositions, uint NumLights)
+{
+    assert(NumLights <= MAX_SHADOW_LIGHTS);
+    glUniform3fv(m_lightPosLocation, NumLights, (const GLfloat*)pPositions);
+}
+
+
+void ShadowVolumeExtractTechnique::SetMeshRange(uint BaseIndex, uint BaseVertex, uint NumTriangles)
+{
+    glUniform1ui(m_baseIndexLocation, BaseIndex);
+    glUniform1ui(m_baseVertexLocation, BaseVertex);
+    glUniform1ui(m_numTrianglesLocation, NumTriangles);
+}
+
+
+void ShadowVolumeExtractTechnique::SetMaxVertices(uint MaxVertices)
+{
+    glUniform1ui(m_maxVerticesLocation, MaxVertices);
+}
@@ -21,6 +21,16 @@
 #include "technique.h"
 #include "ogldev_math_3d.h"
 
+// Must match shadow_volume_extract.cs
+#define MAX_SHADOW_LIGHTS 4
+#define SHADOW_VOLUME_EXTRACT_GROUP_SIZE 64
+
+// Shader storage binding points of shadow_volume_extract.cs
+#define SV_POSITION_BINDING 0
+#define SV_INDEX_BINDING    1
+#define SV_VOLUME_BINDING   2
+#define SV_COMMAND_BINDING  3
+
 class ShadowVolumeTechnique : public Technique {
 public:
 
@@ -28,6 +38,10 @@ public:
 
     virtual bool Init();
 
+    // Draws the volumes written by ShadowVolumeExtractTechnique instead of
+    // extruding them in the GS. Only SetWVP is used.
+    bool InitIndirect();
+
     void SetWVP(const Matrix4f& WVP);
     void SetLightPos(const Vector3f& Pos);
     
@@ -38,4 +52,32 @@ private:
 };
 
 
+// Classifies the triangles of a mesh with adjacency against up to
+// MAX_SHADOW_LIGHTS lights in one dispatch and writes the caps and the
+// silhouette quads of every light as a triangle list
+class ShadowVolumeExtractTechnique : public Technique {
+public:
+
+    ShadowVolumeExtractTechnique();
+
+    virtual bool Init();
+
+    // Object space positions
+    void SetLightPositions(const Vector3f* pPositions, uint NumLights);
+
+    // Range of a submesh in the adjacency index buffer and the vertex buffer
+    void SetMeshRange(uint BaseIndex, uint BaseVertex, uint NumTriangles);
+
+    void SetMaxVertices(uint MaxVertices);
+
+private:
+
+    GLuint m_lightPosLocation;
+    GLuint m_baseIndexLocation;
+    GLuint m_baseVertexLocation;
+    GLuint m_numTrianglesLocation;
+    GLuint m_maxVerticesLocation;
+};
+
+
 #endif	/* SHADOW_VOLUME_TECHNIQUE_H */
@@ -35,6 +35,7 @@
 #include "ogldev_camera.h"
 #include "ogldev_texture.h"
 #include "shadow_volume_technique.h"
+#include "shadow_volume_buffer.h"
 #include "ogldev_basic_lighting.h"
 #include "ogldev_glut_backend.h"
 #include "mesh.h"
@@ -69,6 +70,8 @@ public:
         m_quadOrientation.m_rotation = Vector3f(90.0f, 0.0f, 0.0f);
 
         m_isWireframe = false;
+        m_computeVolumes = true;
+        m_isComputeAvailable = false;
     }
 
     ~Tutorial40()
@@ -94,6 +97,9 @@ public:
             return false;
         }
 
+        // The compute shader path is optional - the geometry shader is used without it
+        m_isComputeAvailable = m_ShadowVolIndirectTech.InitIndirect();
+
         if (!m_LightingTech.Init()) {
             printf("Error initializing the lighting technique\n");
             return false;
@@ -111,6 +117,15 @@ public:
             return false;
         }
 
+        if (m_isComputeAvailable) {
+            m_isComputeAvailable = m_boxVolume.Init(m_box, 1);
+        }
+
+        if (!m_isComputeAvailable) {
+            printf("Error initializing the compute shader shadow volumes - using the geometry shader\n");
+            m_computeVolumes = false;
+        }
+
 #ifndef WIN32
         if (!m_fontRenderer.InitFontRenderer()) {
             return false;
@@ -180,6 +195,12 @@ public:
             else {
                 glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
             }
+            break;
+        case OGLDEV_KEY_c:
+            if (m_isComputeAvailable) {
+                m_computeVolumes = !m_computeVolumes;
+                printf("Shadow volumes extruded by the %s\n", m_computeVolumes ? "compute shader" : "geometry shader");
+            }
             break;
                 default:
                         m_pGameCamera->OnKeyboard(OgldevKey);
@@ -228,18 +249,31 @@ private:
         glStencilOpSeparate(GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP);
         glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP);
 
-        m_ShadowVolTech.Enable();
-
-        m_ShadowVolTech.SetLightPos(m_pointLight.Position);
-
-        // Render the occluder
         Pipeline p;
         p.SetCamera(m_pGameCamera->GetPos(), m_pGameCamera->GetTarget(), m_pGameCamera->GetUp());
         p.SetPerspectiveProj(m_persProjInfo);
         m_boxOrientation.m_rotation = Vector3f(0, m_scale, 0);
         p.Orient(m_boxOrientation);
-        m_ShadowVolTech.SetWVP(p.GetWVPTrans());
-        m_box.Render();
+
+        // The volumes are built from the object space positions of the occluder
+        Matrix4f InvWorld = p.GetWorldTrans();
+        InvWorld.Inverse();
+        Vector3f LightPosL = Vector3f(InvWorld * Vector4f(m_pointLight.Position, 1.0f));
+
+        // Render the occluder
+        if (m_computeVolumes) {
+            m_boxVolume.Extract(m_box, &LightPosL, 1);
+
+            m_ShadowVolIndirectTech.Enable();
+            m_ShadowVolIndirectTech.SetWVP(p.GetWVPTrans());
+            m_boxVolume.Render(0);
+        }
+        else {
+            m_ShadowVolTech.Enable();
+            m_ShadowVolTech.SetLightPos(LightPosL);
+            m_ShadowVolTech.SetWVP(p.GetWVPTrans());
+            m_box.Render();
+        }
 
         // Restore local stuff
         glDisable(GL_DEPTH_CLAMP);
@@ -314,6 +348,8 @@ private:
     }
 
     ShadowVolumeTechnique m_ShadowVolTech;
+    ShadowVolumeTechnique m_ShadowVolIndirectTech;
+    ShadowVolumeBuffer m_boxVolume;
     BasicLightingTechnique m_LightingTech;
     NullTechnique m_nullTech;
     Camera* m_pGameCamera;
@@ -326,6 +362,8 @@ private:
     Texture* m_pGroundTex;
     PersProjInfo m_persProjInfo;
     bool m_isWireframe;
+    bool m_computeVolumes;
+    bool m_isComputeAvailable;
 };
 
 
@@ -0,0 +1,27 @@
+#version 330
+
+layout (location = 0) in vec3 Position;         // already skinned
+layout (location = 1) in vec2 TexCoord;
+layout (location = 2) in vec3 Normal;           // already skinned
+layout (location = 3) in vec3 PrevPosition;     // skinned position from the previous frame
+
+out vec2 TexCoord0;
+out vec3 Normal0;
+out vec3 WorldPos0;
+out vec4 ClipSpacePos0;
+out vec4 PrevClipSpacePos0;
+
+uniform mat4 gWVP;
+uniform mat4 gWorld;
+
+void main()
+{
+    vec4 ClipSpacePos = gWVP * vec4(Position, 1.0);
+    gl_Position       = ClipSpacePos;
+    TexCoord0         = TexCoord;
+    Normal0           = (gWorld * vec4(Normal, 0.0)).xyz;
+    WorldPos0         = (gWorld * vec4(Position, 1.0)).xyz;
+
+    ClipSpacePos0     = ClipSpacePos;
+    PrevClipSpacePos0 = gWVP * vec4(PrevPosition, 1.0);
+}
@@ -5,6 +5,8 @@ layout (location = 1) in vec2 TexCoord;
 layout (location = 2) in vec3 Normal;                                               
 layout (location = 3) in ivec4 BoneIDs;
 layout (location = 4) in vec4 Weights;
+layout (location = 14) in ivec4 BoneIDs2;     // the mesh is loaded with 8 bones per vertex
+layout (location = 15) in vec4 Weights2;
 
 out vec2 TexCoord0;
 out vec3 Normal0;                                                                   
@@ -26,6 +28,10 @@ void main()
     BoneTransform     += gBones[BoneIDs[1]] * Weights[1];
     BoneTransform     += gBones[BoneIDs[2]] * Weights[2];
     BoneTransform     += gBones[BoneIDs[3]] * Weights[3];
+    BoneTransform     += gBones[BoneIDs2[0]] * Weights2[0];
+    BoneTransform     += gBones[BoneIDs2[1]] * Weights2[1];
+    BoneTransform     += gBones[BoneIDs2[2]] * Weights2[2];
+    BoneTransform     += gBones[BoneIDs2[3]] * Weights2[3];
 
     vec4 PosL         = BoneTransform * vec4(Position, 1.0);
     vec4 ClipSpacePos = gWVP * PosL;
@@ -39,6 +45,10 @@ void main()
     PrevBoneTransform += gPrevBones[BoneIDs[1]] * Weights[1];
     PrevBoneTransform += gPrevBones[BoneIDs[2]] * Weights[2];
     PrevBoneTransform += gPrevBones[BoneIDs[3]] * Weights[3];
+    PrevBoneTransform += gPrevBones[BoneIDs2[0]] * Weights2[0];
+    PrevBoneTransform += gPrevBones[BoneIDs2[1]] * Weights2[1];
+    PrevBoneTransform += gPrevBones[BoneIDs2[2]] * Weights2[2];
+    PrevBoneTransform += gPrevBones[BoneIDs2[3]] * Weights2[3];
 
     ClipSpacePos0 = ClipSpacePos;
     vec4 PrevPosL = PrevBoneTransform * vec4(Position, 1.0);
@@ -27,16 +27,46 @@ using namespace std;
 
 SkinningTechnique::SkinningTechnique()
 {   
+    for (unsigned int i = 0 ; i < ARRAY_SIZE_IN_ELEMENTS(m_boneLocation) ; i++) {
+        m_boneLocation[i] = INVALID_UNIFORM_LOCATION;
+        m_prevBoneLocation[i] = INVALID_UNIFORM_LOCATION;
+    }
 }
 
 
 bool SkinningTechnique::Init()
+{
+    if (!InitCommon("shaders/skinning.vs")) {
+        return false;
+    }
+
+    for (unsigned int i = 0 ; i < ARRAY_SIZE_IN_ELEMENTS(m_boneLocation) ; i++) {
+        char Name[128];
+        memset(Name, 0, sizeof(Name));
+        SNPRINTF(Name, sizeof(Name), "gBones[%d]", i);
+        m_boneLocation[i] = GetUniformLocation(Name);
+        SNPRINTF(Name, sizeof(Name), "gPrevBones[%d]", i);
+        m_prevBoneLocation[i] = GetUniformLocation(Name);
+    }
+
+    return true;
+}
+
+
+// pre_skinned.vs has no bone uniforms so the bone locations stay invalid
+bool SkinningTechnique::InitPreSkinned()
+{
+    return InitCommon("shaders/pre_skinned.vs");
+}
+
+
+bool SkinningTechnique::InitCommon(const char* pVSFilename)
 {
     if (!Technique::Init()) {
         return false;
     }
 
-    if (!AddShader(GL_VERTEX_SHADER, "shaders/skinning.vs")) {
+    if (!AddShader(GL_VERTEX_SHADER, pVSFilename)) {
         return false;
     }
 
@@ -154,15 +184,6 @@ bool SkinningTechnique::Init()
         }
     }
 
-    for (unsigned int i = 0 ; i < ARRAY_SIZE_IN_ELEMENTS(m_boneLocation) ; i++) {
-        char Name[128];
-        memset(Name, 0, sizeof(Name));
-        SNPRINTF(Name, sizeof(Name), "gBones[%d]", i);
-        m_boneLocation[i] = GetUniformLocation(Name);
-        SNPRINTF(Name, sizeof(Name), "gPrevBones[%d]", i);
-        m_prevBoneLocation[i] = GetUniformLocation(Name);
-    }
-
     return true;
 }
 
@@ -88,6 +88,10 @@ public:
 
     virtual bool Init();
 
+    // Variant for meshes that were already skinned into a vertex buffer
+    // (see SkinnedMesh::InitPreSkinning). No bones are needed.
+    bool InitPreSkinned();
+
     void SetWVP(const Matrix4f& WVP);
     void SetPrevWVP(const Matrix4f& PrevWVP);
     void SetWorldMatrix(const Matrix4f& WVP);
@@ -100,9 +104,11 @@ public:
     void SetMatSpecularPower(float Power);
     void SetBoneTransform(uint Index, const Matrix4f& Transform);
     void SetPrevBoneTransform(uint Index, const Matrix4f& Transform);
-    
+
 private:
-    
+
+    bool InitCommon(const char* pVSFilename);
+
     GLuint m_WVPLocation;
     GLuint m_WorldMatrixLocation;
     GLuint m_colorTextureLocation;
@@ -38,12 +38,23 @@
 #include "ogldev_glut_backend.h"
 #include "ogldev_skinned_mesh.h"
 #include "intermediate_buffer.h"
+#include "ogldev_skinning_stream_out.h"
 
 using namespace std;
 
 #define WINDOW_WIDTH  1280
 #define WINDOW_HEIGHT 1024
 
+#define NUM_BENCHMARK_ITERATIONS 1000
+
+// Where the vertices are skinned
+enum SKINNING_MODE {
+    SKINNING_MODE_VS,       // in the VS of every pass (the original method)
+    SKINNING_MODE_CPU,      // once per frame on the CPU into a pre-skinned buffer
+    SKINNING_MODE_GPU,      // once per frame using transform feedback into a pre-skinned buffer
+    SKINNING_MODE_COUNT
+};
+
 class Tutorial41 : public ICallbacks, public OgldevApp
 {
 public:
@@ -52,7 +63,10 @@ public:
     {
         m_pGameCamera = NULL;
         m_pSkinningTech = NULL;
+        m_pPreSkinnedTech = NULL;
+        m_pStreamOutTech = NULL;
         m_pMotionBlurTech = NULL;
+        m_skinningMode = SKINNING_MODE_VS;
         m_directionalLight.Color = Vector3f(1.0f, 1.0f, 1.0f);
         m_directionalLight.AmbientIntensity = 0.66f;
         m_directionalLight.DiffuseIntensity = 1.0f;
@@ -70,6 +84,8 @@ public:
     ~Tutorial41()
     {
         SAFE_DELETE(m_pSkinningTech);
+        SAFE_DELETE(m_pPreSkinnedTech);
+        SAFE_DELETE(m_pStreamOutTech);
         SAFE_DELETE(m_pMotionBlurTech);
         SAFE_DELETE(m_pGameCamera);
     }
@@ -101,6 +117,27 @@ public:
         m_pSkinningTech->SetMatSpecularIntensity(0.0f);
         m_pSkinningTech->SetMatSpecularPower(0);
 
+        m_pPreSkinnedTech = new SkinningTechnique();
+
+        if (!m_pPreSkinnedTech->InitPreSkinned()) {
+            printf("Error initializing the pre-skinned technique\n");
+            return false;
+        }
+
+        m_pPreSkinnedTech->Enable();
+
+        m_pPreSkinnedTech->SetColorTextureUnit(COLOR_TEXTURE_UNIT_INDEX);
+        m_pPreSkinnedTech->SetDirectionalLight(m_directionalLight);
+        m_pPreSkinnedTech->SetMatSpecularIntensity(0.0f);
+        m_pPreSkinnedTech->SetMatSpecularPower(0);
+
+        m_pStreamOutTech = new SkinningStreamOutTechnique();
+
+        if (!m_pStreamOutTech->Init()) {
+            printf("Error initializing the skinning stream out technique\n");
+            return false;
+        }
+
         m_pMotionBlurTech = new MotionBlurTechnique();
 
         if (!m_pMotionBlurTech->Init()) {
@@ -112,13 +149,20 @@ public:
         m_pMotionBlurTech->SetColorTextureUnit(COLOR_TEXTURE_UNIT_INDEX);
         m_pMotionBlurTech->SetMotionTextureUnit(MOTION_TEXTURE_UNIT_INDEX);
 
-        if (!m_mesh.LoadMesh("../Content/boblampclean.md5mesh")) {
+        // Up to 8 influences so the second bone attributes are exercised by
+        // all the skinning paths
+        if (!m_mesh.LoadMesh("../Content/boblampclean.md5mesh", MAX_BONES_PER_VERTEX)) {
             printf("Mesh load failed\n");
             return false;
         }
 
         m_mesh.BoneTransform(0.0f, m_prevTransforms);
 
+        if (!m_mesh.InitPreSkinning()) {
+            printf("Error initializing pre-skinning\n");
+            return false;
+        }
+
         if (!m_quad.LoadMesh("../Content/quad_r.obj")) {
             printf("Quad mesh load failed\n");
             return false;
@@ -159,21 +203,12 @@ public:
 
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        m_pSkinningTech->Enable();
-
         vector<Matrix4f> Transforms;
 
         float RunningTime = GetRunningTime();
 
         m_mesh.BoneTransform(RunningTime, Transforms);
 
-        for (uint i = 0 ; i < Transforms.size() ; i++) {
-            m_pSkinningTech->SetBoneTransform(i, Transforms[i]);
-            m_pSkinningTech->SetPrevBoneTransform(i, m_prevTransforms[i]);
-        }
-
-        m_pSkinningTech->SetEyeWorldPos(m_pGameCamera->GetPos());
-
         m_pipeline.SetCamera(m_pGameCamera->GetPos(), m_pGameCamera->GetTarget(), m_pGameCamera->GetUp());
         m_pipeline.SetPerspectiveProj(m_persProjInfo);
         m_pipeline.Scale(0.1f, 0.1f, 0.1f);
@@ -181,15 +216,122 @@ public:
         Vector3f Pos(m_position);
         m_pipeline.WorldPos(Pos);
         m_pipeline.Rotate(270.0f, 180.0f, 0.0f);
-        m_pSkinningTech->SetWVP(m_pipeline.GetWVPTrans());
-        m_pSkinningTech->SetWorldMatrix(m_pipeline.GetWorldTrans());
 
-        m_mesh.Render();
+        if (m_skinningMode == SKINNING_MODE_VS) {
+            m_pSkinningTech->Enable();
+
+            for (uint i = 0 ; i < Transforms.size() ; i++) {
+                m_pSkinningTech->SetBoneTransform(i, Transforms[i]);
+                m_pSkinningTech->SetPrevBoneTransform(i, m_prevTransforms[i]);
+            }
+
+            m_pSkinningTech->SetEyeWorldPos(m_pGameCamera->GetPos());
+            m_pSkinningTech->SetWVP(m_pipeline.GetWVPTrans());
+            m_pSkinningTech->SetWorldMatrix(m_pipeline.GetWorldTrans());
+
+            m_mesh.Render();
+        }
+        else {
+            SkinVertices(Transforms);
+
+            // Any number of passes can read the pre-skinned buffer from here on
+            m_pPreSkinnedTech->Enable();
+            m_pPreSkinnedTech->SetEyeWorldPos(m_pGameCamera->GetPos());
+            m_pPreSkinnedTech->SetWVP(m_pipeline.GetWVPTrans());
+            m_pPreSkinnedTech->SetWorldMatrix(m_pipeline.GetWorldTrans());
+
+            m_mesh.RenderPreSkinned();
+        }
 
         m_prevTransforms = Transforms;
     }
 
 
+    void SkinVertices(const vector<Matrix4f>& Transforms)
+    {
+        if (m_skinningMode == SKINNING_MODE_CPU) {
+            m_mesh.SkinVerticesCPU(Transforms);
+        }
+        else {
+            m_pStreamOutTech->Enable();
+
+            for (uint i = 0 ; i < Transforms.size() ; i++) {
+                m_pStreamOutTech->SetBoneTransform(i, Transforms[i]);
+            }
+
+            m_mesh.SkinVerticesGPU();
+        }
+    }
+
+
+    // Compares the skinned vertex throughput of the CPU kernel (including
+    // the upload) and the transform feedback pass
+    void RunSkinningBenchmark()
+    {
+        vector<Matrix4f> Transforms;
+        m_mesh.BoneTransform(GetRunningTime(), Transforms);
+
+        glFinish();
+
+        long long StartTime = GetCurrentTimeMillis();
+
+        for (uint i = 0 ; i < NUM_BENCHMARK_ITERATIONS ; i++) {
+            m_mesh.SkinVerticesCPU(Transforms);
+        }
+
+        glFinish();
+
+        long long CPUTimeMillis = MAX(GetCurrentTimeMillis() - StartTime, 1);
+
+        m_pStreamOutTech->Enable();
+
+        for (uint i = 0 ; i < Transforms.size() ; i++) {
+            m_pStreamOutTech->SetBoneTransform(i, Transforms[i]);
+        }
+
+        GLuint Query;
+        glGenQueries(1, &Query);
+        glBeginQuery(GL_TIME_ELAPSED, Query);
+
+        for (uint i = 0 ; i < NUM_BENCHMARK_ITERATIONS ; i++) {
+            m_mesh.SkinVerticesGPU();
+        }
+
+        glEndQuery(GL_TIME_ELAPSED);
+
+        GLuint64 GPUTimeNanos = 0;
+        glGetQueryObjectui64v(Query, GL_QUERY_RESULT, &GPUTimeNanos);
+        glDeleteQueries(1, &Query);
+
+        double NumVertices = (double)m_mesh.NumVertices() * NUM_BENCHMARK_ITERATIONS;
+
+        printf("Skinning benchmark (%d vertices x %d iterations)\n", m_mesh.NumVertices(), NUM_BENCHMARK_ITERATIONS);
+        printf("    CPU: %lld ms, %.2f million vertices per second\n", CPUTimeMillis, NumVertices / ((double)CPUTimeMillis * 1000.0));
+        printf("    GPU: %.2f ms, %.2f million vertices per second\n", (double)GPUTimeNanos / 1000000.0,
+               NumVertices / MAX((double)GPUTimeNanos / 1000.0, 1.0));
+    }
+
+
+    // The transform feedback pass must produce the same vertices as the CPU kernel
+    void VerifySkinning()
+    {
+        vector<Matrix4f> Transforms;
+        m_mesh.BoneTransform(GetRunningTime(), Transforms);
+
+        m_pStreamOutTech->Enable();
+
+        for (uint i = 0 ; i < Transforms.size() ; i++) {
+            m_pStreamOutTech->SetBoneTransform(i, Transforms[i]);
+        }
+
+        uint NumMultiBoneVertices = 0;
+        float MaxError = m_mesh.CompareSkinning(Transforms, NumMultiBoneVertices);
+
+        printf("CPU vs GPU skinning: max position error %f (%d vertices with more than 4 bones)%s\n",
+               MaxError, NumMultiBoneVertices, (MaxError > 0.001f) ? " - MISMATCH" : "");
+    }
+
+
     void MotionBlurPass()
     {
         m_intermediateBuffer.BindForReading();
@@ -209,6 +351,15 @@ public:
         case OGLDEV_KEY_q:
                 GLUTBackendLeaveMainLoop();
                 break;
+        case OGLDEV_KEY_s:
+                m_skinningMode = (SKINNING_MODE)((m_skinningMode + 1) % SKINNING_MODE_COUNT);
+                break;
+        case OGLDEV_KEY_b:
+                RunSkinningBenchmark();
+                break;
+        case OGLDEV_KEY_v:
+                VerifySkinning();
+                break;
         default:
                 m_pGameCamera->OnKeyboard(OgldevKey);
         }
@@ -224,6 +375,9 @@ public:
 private:
 
     SkinningTechnique* m_pSkinningTech;
+    SkinningTechnique* m_pPreSkinnedTech;
+    SkinningStreamOutTechnique* m_pStreamOutTech;
+    SKINNING_MODE m_skinningMode;
     MotionBlurTechnique* m_pMotionBlurTech;
     Camera* m_pGameCamera;
     DirectionalLight m_directionalLight;
@@ -63,6 +63,11 @@ bool LightingTechnique::Init()
     m_numPointLightsLocation = GetUniformLocation("gNumPointLights");
     m_numSpotLightsLocation = GetUniformLocation("gNumSpotLights");
     m_shadowMapSizeLocation = GetUniformLocation("gMapSize");
+    m_shadowDepthMapLocation = GetUniformLocation("gShadowDepthMap");
+    m_shadowFilterLocation = GetUniformLocation("gShadowFilter");
+    m_filterRadiusLocation = GetUniformLocation("gFilterRadius");
+    m_lightSizeLocation = GetUniformLocation("gLightSize");
+    m_lightNearFarLocation = GetUniformLocation("gLightNearFar");
 
     if (m_dirLightLocation.AmbientIntensity == INVALID_UNIFORM_LOCATION ||
         m_WVPLocation == INVALID_UNIFORM_LOCATION ||
@@ -78,7 +83,12 @@ bool LightingTechnique::Init()
         m_matSpecularPowerLocation == INVALID_UNIFORM_LOCATION ||
         m_numPointLightsLocation == INVALID_UNIFORM_LOCATION ||
         m_numSpotLightsLocation == INVALID_UNIFORM_LOCATION ||
-        m_shadowMapSizeLocation == INVALID_UNIFORM_LOCATION) {
+        m_shadowMapSizeLocation == INVALID_UNIFORM_LOCATION ||
+        m_shadowDepthMapLocation == INVALID_UNIFORM_LOCATION ||
+        m_shadowFilterLocation == INVALID_UNIFORM_LOCATION ||
+        m_filterRadiusLocation == INVALID_UNIFORM_LOCATION ||
+        m_lightSizeLocation == INVALID_UNIFORM_LOCATION ||
+        m_lightNearFarLocation == INVALID_UNIFORM_LOCATION) {
         return false;
     }
 
@@ -260,4 +270,34 @@ void LightingTechnique::SetSpotLights(unsigned int NumLights, const SpotLight* p
 void LightingTechnique::SetShadowMapSize(float Width, float Height)
 {
     glUniform2f(m_shadowMapSizeLocation, Width, Height);
-}
\ No newline at end of file
+}
+
+
+void LightingTechnique::SetShadowDepthMapTextureUnit(unsigned int TextureUnit)
+{
+    glUniform1i(m_shadowDepthMapLocation, TextureUnit);
+}
+
+
+void LightingTechnique::SetShadowFilter(SHADOW_FILTER Filter)
+{
+    glUniform1i(m_shadowFilterLocation, Filter);
+}
+
+
+void LightingTechnique::SetFilterRadius(float Radius)
+{
+    glUniform1f(m_filterRadiusLocation, Radius);
+}
+
+
+void LightingTechnique::SetLightSize(float Size)
+{
+    glUniform1f(m_lightSizeLocation, Size);
+}
+
+
+void LightingTechnique::SetLightNearFar(float zNear, float zFar)
+{
+    glUniform2f(m_lightNearFarLocation, zNear, zFar);
+}
@@ -77,6 +77,15 @@ struct SpotLight : public PointLight
     }
 };
 
+// Must match lighting.fs
+enum SHADOW_FILTER {
+    SHADOW_FILTER_GRID_3X3,     // 9 taps
+    SHADOW_FILTER_ROTATED_GRID, // 4 taps
+    SHADOW_FILTER_POISSON,      // 8 taps on a randomly rotated disk
+    SHADOW_FILTER_PCSS,         // 8 blocker search taps + 8 PCF taps
+    SHADOW_FILTER_NUM
+};
+
 class LightingTechnique : public Technique {
 public:
 
@@ -99,6 +108,11 @@ public:
     void SetMatSpecularIntensity(float Intensity);
     void SetMatSpecularPower(float Power);
     void SetShadowMapSize(float Width, float Height);
+    void SetShadowDepthMapTextureUnit(unsigned int TextureUnit);
+    void SetShadowFilter(SHADOW_FILTER Filter);
+    void SetFilterRadius(float Radius);
+    void SetLightSize(float Size);
+    void SetLightNearFar(float zNear, float zFar);
 
 private:
     
@@ -113,6 +127,11 @@ private:
     GLuint m_numPointLightsLocation;
     GLuint m_numSpotLightsLocation;
     GLuint m_shadowMapSizeLocation;
+    GLuint m_shadowDepthMapLocation;
+    GLuint m_shadowFilterLocation;
+    GLuint m_filterRadiusLocation;
+    GLuint m_lightSizeLocation;
+    GLuint m_lightNearFarLocation;
 
     struct {
         GLuint Color;
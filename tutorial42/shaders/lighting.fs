@@ -62,31 +62,143 @@ uniform float gSpecularPower;
 uniform vec2 gMapSize;
 
 uniform sampler2DShadow gShadowMap;
+uniform sampler2D gShadowDepthMap;      // the same texture without the comparison
+uniform int gShadowFilter;
+uniform float gFilterRadius;            // in texels
+uniform float gLightSize;               // in texels, for PCSS
+uniform vec2 gLightNearFar;
+
+// Must match SHADOW_FILTER in lighting_technique.h
+#define SHADOW_FILTER_GRID_3X3      0
+#define SHADOW_FILTER_ROTATED_GRID  1
+#define SHADOW_FILTER_POISSON       2
+#define SHADOW_FILTER_PCSS          3
 
 #define EPSILON 0.00001
 
-float CalcShadowFactor(vec4 LightSpacePos)
-{
-    vec3 ProjCoords = LightSpacePos.xyz / LightSpacePos.w;
-    vec2 UVCoords;
-    UVCoords.x = 0.5 * ProjCoords.x + 0.5;
-    UVCoords.y = 0.5 * ProjCoords.y + 0.5;
-    float z = 0.5 * ProjCoords.z + 0.5;
-  
-    float xOffset = 1.0/gMapSize.x;
-    float yOffset = 1.0/gMapSize.y;
+#define NUM_POISSON_TAPS 8
+
+const vec2 PoissonDisk[NUM_POISSON_TAPS] = vec2[](
+    vec2(-0.326, -0.406), vec2(-0.840, -0.074), vec2(-0.696,  0.457), vec2(-0.203,  0.621),
+    vec2( 0.962, -0.195), vec2( 0.473, -0.480), vec2( 0.519,  0.767), vec2( 0.185, -0.893)
+);
+
+// Every tap of gShadowMap is a 2x2 bilinear PCF done by the hardware
 
+// 9 taps - the original kernel
+float PCFGrid3x3(vec3 UVZ, vec2 TexelSize)
+{
     float Factor = 0.0;
 
     for (int y = -1 ; y <= 1 ; y++) {
         for (int x = -1 ; x <= 1 ; x++) {
-            vec2 Offsets = vec2(x * xOffset, y * yOffset);
-            vec3 UVC = vec3(UVCoords + Offsets, z + EPSILON);
-            Factor += texture(gShadowMap, UVC);
+            vec2 Offsets = vec2(x, y) * TexelSize;
+            Factor += texture(gShadowMap, vec3(UVZ.xy + Offsets, UVZ.z));
         }
     }
-    
-    return (0.5 + (Factor / 18.0));
+
+    return Factor / 9.0;
+}
+
+// 4 taps on a 2x2 grid rotated by atan(1/2). With the 2x2 footprint of
+// every tap this covers the same 4x4 texels as the 3x3 grid.
+float PCFRotatedGrid(vec3 UVZ, vec2 TexelSize)
+{
+    const vec2 Offsets[4] = vec2[](vec2(-0.25, -0.75), vec2(0.75, -0.25), vec2(0.25, 0.75), vec2(-0.75, 0.25));
+
+    float Factor = 0.0;
+
+    for (int i = 0 ; i < 4 ; i++) {
+        vec2 Offset = Offsets[i] * gFilterRadius * TexelSize;
+        Factor += texture(gShadowMap, vec3(UVZ.xy + Offset, UVZ.z));
+    }
+
+    return Factor / 4.0;
+}
+
+// The disk is rotated per pixel which turns banding into noise
+mat2 CalcDiskRotation()
+{
+    float Angle = 6.2831853 * fract(sin(dot(gl_FragCoord.xy, vec2(12.9898, 78.233))) * 43758.5453);
+    float s = sin(Angle);
+    float c = cos(Angle);
+    return mat2(c, s, -s, c);
+}
+
+float PCFPoisson(vec3 UVZ, vec2 TexelSize, float Radius, mat2 Rotation)
+{
+    float Factor = 0.0;
+
+    for (int i = 0 ; i < NUM_POISSON_TAPS ; i++) {
+        vec2 Offset = Rotation * PoissonDisk[i] * Radius * TexelSize;
+        Factor += texture(gShadowMap, vec3(UVZ.xy + Offset, UVZ.z));
+    }
+
+    return Factor / float(NUM_POISSON_TAPS);
+}
+
+float LinearizeDepth(float Depth)
+{
+    float n = gLightNearFar.x;
+    float f = gLightNearFar.y;
+    float z = Depth * 2.0 - 1.0;
+    return (2.0 * n * f) / (f + n - z * (f - n));
+}
+
+// Percentage closer soft shadows: the average depth of the blockers around
+// the pixel sets the size of the penumbra and the PCF kernel follows it
+float PCSS(vec3 UVZ, vec2 TexelSize)
+{
+    mat2 Rotation = CalcDiskRotation();
+
+    float BlockerSum = 0.0;
+    int NumBlockers = 0;
+
+    for (int i = 0 ; i < NUM_POISSON_TAPS ; i++) {
+        vec2 Offset = Rotation * PoissonDisk[i] * gLightSize * TexelSize;
+        float Depth = texture(gShadowDepthMap, UVZ.xy + Offset).x;
+
+        if (Depth < UVZ.z) {
+            BlockerSum += Depth;
+            NumBlockers++;
+        }
+    }
+
+    if (NumBlockers == 0) {
+        return 1.0;
+    }
+
+    float Blocker = LinearizeDepth(BlockerSum / float(NumBlockers));
+    float Receiver = LinearizeDepth(UVZ.z);
+    float Penumbra = clamp(gLightSize * (Receiver - Blocker) / Blocker, 1.0, gLightSize);
+
+    return PCFPoisson(UVZ, TexelSize, Penumbra, Rotation);
+}
+
+float CalcShadowFactor(vec4 LightSpacePos)
+{
+    vec3 ProjCoords = LightSpacePos.xyz / LightSpacePos.w;
+    vec3 UVZ = 0.5 * ProjCoords + 0.5;
+    UVZ.z += EPSILON;
+
+    vec2 TexelSize = 1.0 / gMapSize;
+
+    float Factor;
+
+    if (gShadowFilter == SHADOW_FILTER_GRID_3X3) {
+        Factor = PCFGrid3x3(UVZ, TexelSize);
+    }
+    else if (gShadowFilter == SHADOW_FILTER_ROTATED_GRID) {
+        Factor = PCFRotatedGrid(UVZ, TexelSize);
+    }
+    else if (gShadowFilter == SHADOW_FILTER_POISSON) {
+        Factor = PCFPoisson(UVZ, TexelSize, gFilterRadius, CalcDiskRotation());
+    }
+    else {
+        Factor = PCSS(UVZ, TexelSize);
+    }
+
+    return (0.5 + 0.5 * Factor);
 }
 
 vec4 CalcLightInternal(BaseLight Light, vec3 LightDirection, VSOutput In, float ShadowFactor)           
@@ -23,6 +23,8 @@ ShadowMapFBO::ShadowMapFBO()
 {
     m_fbo = 0;
     m_shadowMap = 0;
+    m_pcfSampler = 0;
+    m_depthSampler = 0;
 }
 
 ShadowMapFBO::~ShadowMapFBO()
@@ -34,6 +36,14 @@ ShadowMapFBO::~ShadowMapFBO()
     if (m_shadowMap != 0) {
         glDeleteTextures(1, &m_shadowMap);
     }
+
+    if (m_pcfSampler != 0) {
+        glDeleteSamplers(1, &m_pcfSampler);
+    }
+
+    if (m_depthSampler != 0) {
+        glDeleteSamplers(1, &m_depthSampler);
+    }
 }
 
 bool ShadowMapFBO::Init(unsigned int WindowWidth, unsigned int WindowHeight)
@@ -47,10 +57,23 @@ bool ShadowMapFBO::Init(unsigned int WindowWidth, unsigned int WindowHeight)
     glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32, WindowWidth, WindowHeight, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    // The filtering state comes from the samplers so the same texture can be
+    // read both with and without the depth comparison
+    glGenSamplers(1, &m_pcfSampler);
+    glSamplerParameteri(m_pcfSampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glSamplerParameteri(m_pcfSampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glSamplerParameteri(m_pcfSampler, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glSamplerParameteri(m_pcfSampler, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glSamplerParameteri(m_pcfSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glSamplerParameteri(m_pcfSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glGenSamplers(1, &m_depthSampler);
+    glSamplerParameteri(m_depthSampler, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glSamplerParameteri(m_depthSampler, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glSamplerParameteri(m_depthSampler, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+    glSamplerParameteri(m_depthSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glSamplerParameteri(m_depthSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
     glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_shadowMap, 0);
@@ -82,4 +105,13 @@ void ShadowMapFBO::BindForReading(GLenum TextureUnit)
 {
     glActiveTexture(TextureUnit);
     glBindTexture(GL_TEXTURE_2D, m_shadowMap);
+    glBindSampler(TextureUnit - GL_TEXTURE0, m_pcfSampler);
+}
+
+
+void ShadowMapFBO::BindDepthForReading(GLenum TextureUnit)
+{
+    glActiveTexture(TextureUnit);
+    glBindTexture(GL_TEXTURE_2D, m_shadowMap);
+    glBindSampler(TextureUnit - GL_TEXTURE0, m_depthSampler);
 }
\ No newline at end of file
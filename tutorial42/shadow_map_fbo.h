@@ -31,11 +31,18 @@ public:
 
     void BindForWriting();
 
+    // Binds the shadow map with a comparison sampler (sampler2DShadow). Every
+    // lookup returns the bilinear weighted result of 4 depth comparisons.
     void BindForReading(GLenum TextureUnit);
 
+    // Binds the same texture with a plain sampler that returns the raw depth
+    void BindDepthForReading(GLenum TextureUnit);
+
 private:
     GLuint m_fbo;
     GLuint m_shadowMap;
+    GLuint m_pcfSampler;
+    GLuint m_depthSampler;
 };
 
 #endif	/* SHADOWMAPFBO_H */
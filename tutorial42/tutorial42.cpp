@@ -41,6 +41,16 @@ using namespace std;
 #define WINDOW_WIDTH  1000
 #define WINDOW_HEIGHT 1000
 
+#define SHADOW_FILTER_RADIUS 2.0f   // texels
+#define SHADOW_LIGHT_SIZE    8.0f   // texels
+
+static const char* ShadowFilterNames[SHADOW_FILTER_NUM] = {
+    "3x3 grid (9 taps)",
+    "Rotated grid (4 taps)",
+    "Poisson disk (8 taps)",
+    "PCSS (16 taps)"
+};
+
 
 class Tutorial42 : public ICallbacks, public OgldevApp
 {
@@ -52,6 +62,7 @@ public:
         m_pLightingEffect = NULL;
         m_pShadowMapEffect = NULL;
         m_scale = 0.0f;
+        m_shadowFilter = SHADOW_FILTER_ROTATED_GRID;
         m_spotLight.AmbientIntensity = 0.1f;
         m_spotLight.DiffuseIntensity = 0.9f;
         m_spotLight.Color = Vector3f(1.0f, 1.0f, 1.0f);
@@ -99,6 +110,11 @@ public:
         m_pLightingEffect->SetShadowMapTextureUnit(SHADOW_TEXTURE_UNIT_INDEX);
         m_pLightingEffect->SetSpotLights(1, &m_spotLight);
         m_pLightingEffect->SetShadowMapSize((float)WINDOW_WIDTH, (float)WINDOW_HEIGHT);
+        m_pLightingEffect->SetShadowDepthMapTextureUnit(SHADOW_DEPTH_TEXTURE_UNIT_INDEX);
+        m_pLightingEffect->SetShadowFilter(m_shadowFilter);
+        m_pLightingEffect->SetFilterRadius(SHADOW_FILTER_RADIUS);
+        m_pLightingEffect->SetLightSize(SHADOW_LIGHT_SIZE);
+        m_pLightingEffect->SetLightNearFar(m_persProjInfo.zNear, m_persProjInfo.zFar);
 
         m_pShadowMapEffect = new ShadowMapTechnique();
 
@@ -149,6 +165,10 @@ public:
 
         RenderFPS();
 
+#ifndef WIN32
+        m_fontRenderer.RenderText(10, 30, ShadowFilterNames[m_shadowFilter]);
+#endif
+
         glutSwapBuffers();
     }
 
@@ -169,7 +189,7 @@ public:
         p.SetCamera(m_spotLight.Position, m_spotLight.Direction, Vector3f(0.0f, 1.0f, 0.0f));
         p.SetPerspectiveProj(m_persProjInfo);
         m_pShadowMapEffect->SetWVP(p.GetWVPTrans());
-        m_mesh.Render();
+        m_mesh.RenderDepth();
 
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
     }
@@ -182,7 +202,11 @@ public:
 
         m_pLightingEffect->Enable();
 
-        m_shadowMapFBO.BindForReading(GL_TEXTURE1);
+        m_shadowMapFBO.BindForReading(SHADOW_TEXTURE_UNIT);
+
+        if (m_shadowFilter == SHADOW_FILTER_PCSS) {
+            m_shadowMapFBO.BindDepthForReading(SHADOW_DEPTH_TEXTURE_UNIT);
+        }
 
         Pipeline p;
         p.SetPerspectiveProj(m_persProjInfo);
@@ -219,6 +243,11 @@ public:
                 case OGLDEV_KEY_q:
                         OgldevBackendLeaveMainLoop();
                         break;
+                case OGLDEV_KEY_f:
+                        m_shadowFilter = (SHADOW_FILTER)((m_shadowFilter + 1) % SHADOW_FILTER_NUM);
+                        m_pLightingEffect->Enable();
+                        m_pLightingEffect->SetShadowFilter(m_shadowFilter);
+                        break;
                 default:
                         m_pGameCamera->OnKeyboard(OgldevKey);
                 }
@@ -238,6 +267,7 @@ private:
     Camera* m_pGameCamera;
     float m_scale;
     SpotLight m_spotLight;
+    SHADOW_FILTER m_shadowFilter;
     BasicMesh m_mesh;
     BasicMesh m_quad;
     PersProjInfo m_persProjInfo;
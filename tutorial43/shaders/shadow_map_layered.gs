@@ -0,0 +1,48 @@
+#version 330
+
+layout (triangles) in;
+layout (triangle_strip, max_vertices = 18) out;
+
+uniform mat4 gLightVP[6];       // indexed by cube face
+uniform int gFaces[6];          // the faces the mesh touches
+uniform int gNumFaces;
+
+in vec3 WorldPos0[];
+
+out vec3 WorldPos;
+
+// True if all the vertices are on the outer side of the same clip plane
+bool IsOutside(vec4 v0, vec4 v1, vec4 v2)
+{
+    return (v0.x < -v0.w && v1.x < -v1.w && v2.x < -v2.w) ||
+           (v0.x >  v0.w && v1.x >  v1.w && v2.x >  v2.w) ||
+           (v0.y < -v0.w && v1.y < -v1.w && v2.y < -v2.w) ||
+           (v0.y >  v0.w && v1.y >  v1.w && v2.y >  v2.w) ||
+           (v0.z >  v0.w && v1.z >  v1.w && v2.z >  v2.w);
+}
+
+void main()
+{
+    for (int i = 0 ; i < gNumFaces ; i++) {
+        int Face = gFaces[i];
+
+        vec4 Clip[3];
+
+        for (int j = 0 ; j < 3 ; j++) {
+            Clip[j] = gLightVP[Face] * vec4(WorldPos0[j], 1.0);
+        }
+
+        if (IsOutside(Clip[0], Clip[1], Clip[2])) {
+            continue;
+        }
+
+        for (int j = 0 ; j < 3 ; j++) {
+            gl_Layer = Face;
+            gl_Position = Clip[j];
+            WorldPos = WorldPos0[j];
+            EmitVertex();
+        }
+
+        EndPrimitive();
+    }
+}
@@ -0,0 +1,20 @@
+#version 330
+
+#extension GL_ARB_shader_viewport_layer_array : require
+
+layout (location = 0) in vec3 Position;
+
+uniform mat4 gWorld;
+uniform mat4 gLightVP[6];       // indexed by cube face
+uniform int gFaces[6];          // the faces the mesh touches - one per instance
+
+out vec3 WorldPos;
+
+void main()
+{
+    int Face = gFaces[gl_InstanceID];
+    vec4 Pos4 = gWorld * vec4(Position, 1.0);
+    gl_Position = gLightVP[Face] * Pos4;
+    gl_Layer = Face;
+    WorldPos = Pos4.xyz;
+}
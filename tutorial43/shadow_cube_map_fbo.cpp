@@ -26,6 +26,8 @@ ShadowCubeMapFBO::ShadowCubeMapFBO()
     m_fbo = 0;
     m_shadowMap = 0;	
     m_depth = 0;
+    m_layeredFbo = 0;
+    m_depthCubeMap = 0;
 }
 
 ShadowCubeMapFBO::~ShadowCubeMapFBO()
@@ -41,6 +43,14 @@ ShadowCubeMapFBO::~ShadowCubeMapFBO()
     if (m_depth != 0) {
         glDeleteTextures(1, &m_depth);
     }	
+
+    if (m_layeredFbo != 0) {
+        glDeleteFramebuffers(1, &m_layeredFbo);
+    }
+
+    if (m_depthCubeMap != 0) {
+        glDeleteTextures(1, &m_depthCubeMap);
+    }
 }
 
 bool ShadowCubeMapFBO::Init(unsigned int WindowWidth, unsigned int WindowHeight)
@@ -87,6 +97,29 @@ bool ShadowCubeMapFBO::Init(unsigned int WindowWidth, unsigned int WindowHeight)
         return false;
     }
     
+    glGenTextures(1, &m_depthCubeMap);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, m_depthCubeMap);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    for (uint i = 0 ; i < 6 ; i++) {
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT32, WindowWidth, WindowHeight, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    }
+
+    glGenFramebuffers(1, &m_layeredFbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_layeredFbo);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depthCubeMap, 0);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_shadowMap, 0);
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
+    glReadBuffer(GL_NONE);
+
+    Status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+
+    if (Status != GL_FRAMEBUFFER_COMPLETE) {
+        printf("Layered FB error, status: 0x%x\n", Status);
+        return false;
+    }
+
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
     return GLCheckError();
@@ -101,6 +134,12 @@ void ShadowCubeMapFBO::BindForWriting(GLenum CubeFace)
 }
 
 
+void ShadowCubeMapFBO::BindForWritingLayered()
+{
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_layeredFbo);
+}
+
+
 void ShadowCubeMapFBO::BindForReading(GLenum TextureUnit)
 {
     glActiveTexture(TextureUnit);
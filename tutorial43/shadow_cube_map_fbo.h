@@ -31,12 +31,17 @@ public:
 
     void BindForWriting(GLenum CubeFace);
 
+    // All the faces are attached as layers - gl_Layer selects the face
+    void BindForWritingLayered();
+
     void BindForReading(GLenum TextureUnit);
     
 private:
     GLuint m_fbo;
     GLuint m_shadowMap;
     GLuint m_depth;
+    GLuint m_layeredFbo;
+    GLuint m_depthCubeMap;     // a layered FBO needs layered depth as well
 };
 
 #endif	/* SHADOW_CUBE_MAP_FBO_H */
@@ -16,21 +16,49 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <string.h>
+
 #include "shadow_map_technique.h"
 #include "ogldev_pipeline.h"
+#include "ogldev_util.h"
 
 
 ShadowMapTechnique::ShadowMapTechnique()
 {
+    m_layered = false;
+    m_vertexShaderLayer = false;
 }
 
 bool ShadowMapTechnique::Init()
+{
+    return InitCommon("shaders/shadow_map.vs", NULL);
+}
+
+
+bool ShadowMapTechnique::InitLayered()
+{
+    m_layered = true;
+
+    if (GLEW_ARB_shader_viewport_layer_array) {
+        m_vertexShaderLayer = true;
+        return InitCommon("shaders/shadow_map_vs_layer.vs", NULL);
+    }
+
+    return InitCommon("shaders/shadow_map_layered.vs", "shaders/shadow_map_layered.gs");
+}
+
+
+bool ShadowMapTechnique::InitCommon(const char* pVSFilename, const char* pGSFilename)
 {
     if (!Technique::Init()) {
         return false;
     }
 
-    if (!AddShader(GL_VERTEX_SHADER, "shaders/shadow_map.vs")) {
+    if (!AddShader(GL_VERTEX_SHADER, pVSFilename)) {
+        return false;
+    }
+
+    if (pGSFilename && !AddShader(GL_GEOMETRY_SHADER, pGSFilename)) {
         return false;
     }
 
@@ -42,16 +70,42 @@ bool ShadowMapTechnique::Init()
         return false;
     }
 
-    m_WVPLocation = GetUniformLocation("gWVP");
     m_WorldMatrixLocation = GetUniformLocation("gWorld");
     m_lightWorldPosLoc = GetUniformLocation("gLightWorldPos");
 
-    if (m_WVPLocation == INVALID_UNIFORM_LOCATION ||
-	m_WorldMatrixLocation == INVALID_UNIFORM_LOCATION ||
+    if (m_WorldMatrixLocation == INVALID_UNIFORM_LOCATION ||
         m_lightWorldPosLoc == INVALID_UNIFORM_LOCATION) {
         return false;
     }
 
+    if (!m_layered) {
+        m_WVPLocation = GetUniformLocation("gWVP");
+        return (m_WVPLocation != INVALID_UNIFORM_LOCATION);
+    }
+
+    for (uint i = 0 ; i < NUM_OF_LAYERS ; i++) {
+        char Name[128];
+        memset(Name, 0, sizeof(Name));
+        SNPRINTF(Name, sizeof(Name), "gLightVP[%d]", i);
+        m_lightVPLocation[i] = GetUniformLocation(Name);
+        SNPRINTF(Name, sizeof(Name), "gFaces[%d]", i);
+        m_facesLocation[i] = GetUniformLocation(Name);
+
+        if (m_lightVPLocation[i] == INVALID_UNIFORM_LOCATION ||
+            m_facesLocation[i] == INVALID_UNIFORM_LOCATION) {
+            return false;
+        }
+    }
+
+    // The vertex shader version gets the number of faces from the number of instances
+    if (!m_vertexShaderLayer) {
+        m_numFacesLocation = GetUniformLocation("gNumFaces");
+
+        if (m_numFacesLocation == INVALID_UNIFORM_LOCATION) {
+            return false;
+        }
+    }
+
     return true;
 }
 
@@ -70,4 +124,24 @@ void ShadowMapTechnique::SetWorld(const Matrix4f& World)
 void ShadowMapTechnique::SetLightWorldPos(const Vector3f& Pos)
 {
     glUniform3f(m_lightWorldPosLoc, Pos.x, Pos.y, Pos.z);    
-}
\ No newline at end of file
+}
+
+
+void ShadowMapTechnique::SetLightVPs(const Matrix4f* pVPs)
+{
+    for (uint i = 0 ; i < NUM_OF_LAYERS ; i++) {
+        glUniformMatrix4fv(m_lightVPLocation[i], 1, GL_TRUE, (const GLfloat*)pVPs[i].m);
+    }
+}
+
+
+void ShadowMapTechnique::SetFaces(const uint* pFaces, uint NumFaces)
+{
+    for (uint i = 0 ; i < NumFaces ; i++) {
+        glUniform1i(m_facesLocation[i], pFaces[i]);
+    }
+
+    if (!m_vertexShaderLayer) {
+        glUniform1i(m_numFacesLocation, NumFaces);
+    }
+}
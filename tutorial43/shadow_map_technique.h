@@ -31,17 +31,38 @@ public:
 
     ShadowMapTechnique();
 
+    // Renders one cube face per pass
     virtual bool Init();
 
+    // Renders all the cube faces in a single pass into a layered FBO. When
+    // the vertex shader can write gl_Layer (ARB_shader_viewport_layer_array)
+    // every face is an instance of the draw. Otherwise a geometry shader
+    // routes each triangle to the faces it touches.
+    bool InitLayered();
+
+    // Layered version only - if true draw the meshes with one instance per face
+    bool IsVertexShaderLayer() const { return m_vertexShaderLayer; }
+
     void SetWVP(const Matrix4f& WVP);
     void SetWorld(const Matrix4f& World);
     void SetLightWorldPos(const Vector3f& Pos);
 
+    // Layered version only
+    void SetLightVPs(const Matrix4f* pVPs);     // one per cube face
+    void SetFaces(const uint* pFaces, uint NumFaces);
+
 private:
 
+    bool InitCommon(const char* pVSFilename, const char* pGSFilename);
+
+    bool m_layered;
+    bool m_vertexShaderLayer;
     GLint m_WVPLocation;
     GLint m_WorldMatrixLocation;
     GLint m_lightWorldPosLoc;
+    GLint m_lightVPLocation[NUM_OF_LAYERS];
+    GLint m_facesLocation[NUM_OF_LAYERS];
+    GLint m_numFacesLocation;
 };
 
 
@@ -41,6 +41,8 @@ using namespace std;
 #define WINDOW_WIDTH  1000
 #define WINDOW_HEIGHT 1000
 
+#define MESH_RADIUS 1.0f    // sphere.obj
+
 struct CameraDirection
 {
     GLenum CubemapFace;
@@ -67,6 +69,7 @@ public:
     {
         m_pGameCamera = NULL;
         m_scale = 0.0f;
+        m_layeredShadows = true;
         m_pointLight.AmbientIntensity = 0.1f;
         m_pointLight.DiffuseIntensity = 0.9f;
         m_pointLight.Color = Vector3f(1.0f, 1.0f, 1.0f);
@@ -119,6 +122,14 @@ public:
         m_shadowMapEffect.Enable();
         m_shadowMapEffect.SetLightWorldPos(m_pointLight.Position);
 
+        if (!m_shadowMapLayeredEffect.InitLayered()) {
+            printf("Error initializing the layered shadow map technique\n");
+            return false;
+        }
+
+        m_shadowMapLayeredEffect.Enable();
+        m_shadowMapLayeredEffect.SetLightWorldPos(m_pointLight.Position);
+
                 if (!m_quad.LoadMesh("../Content/quad.obj")) {
             return false;
         }
@@ -168,11 +179,27 @@ public:
 
         m_pGameCamera->OnRender();
 
-        ShadowMapPass();
+        if (m_layeredShadows) {
+            ShadowMapPassLayered();
+        }
+        else {
+            ShadowMapPass();
+        }
+
         RenderPass();
 
         RenderFPS();
 
+#ifndef WIN32
+        const char* pMode = "Shadow pass per face";
+
+        if (m_layeredShadows) {
+            pMode = m_shadowMapLayeredEffect.IsVertexShaderLayer() ? "Layered shadow pass (VS)" : "Layered shadow pass (GS)";
+        }
+
+        m_fontRenderer.RenderText(10, 30, pMode);
+#endif
+
         glutSwapBuffers();
     }
 
@@ -201,19 +228,112 @@ public:
 
             p.SetCamera(m_pointLight.Position, gCameraDirections[i].Target, gCameraDirections[i].Up);
 
-            p.Orient(m_mesh1Orientation);
-            m_shadowMapEffect.SetWorld(p.GetWorldTrans());
-            m_shadowMapEffect.SetWVP(p.GetWVPTrans());
-            m_mesh.Render();
+            if (IsInCubeFace(m_mesh1Orientation, i)) {
+                p.Orient(m_mesh1Orientation);
+                m_shadowMapEffect.SetWorld(p.GetWorldTrans());
+                m_shadowMapEffect.SetWVP(p.GetWVPTrans());
+                m_mesh.RenderDepth();
+            }
+
+            if (IsInCubeFace(m_mesh2Orientation, i)) {
+                p.Orient(m_mesh2Orientation);
+                m_shadowMapEffect.SetWorld(p.GetWorldTrans());
+                m_shadowMapEffect.SetWVP(p.GetWVPTrans());
+                m_mesh.RenderDepth();
+            }
+        }
+    }
 
-            p.Orient(m_mesh2Orientation);
-            m_shadowMapEffect.SetWorld(p.GetWorldTrans());
-            m_shadowMapEffect.SetWVP(p.GetWVPTrans());
-            m_mesh.Render();
+
+    // Same as ShadowMapPass but the scene is submitted only once. Every mesh
+    // is sent only to the faces its bounding sphere touches.
+    void ShadowMapPassLayered()
+    {
+        glCullFace(GL_FRONT);
+
+        m_shadowMapLayeredEffect.Enable();
+
+        Pipeline p;
+        p.SetPerspectiveProj(m_persProjInfo);
+
+        Matrix4f LightVPs[NUM_OF_LAYERS];
+
+        for (uint i = 0 ; i < NUM_OF_LAYERS ; i++) {
+            p.SetCamera(m_pointLight.Position, gCameraDirections[i].Target, gCameraDirections[i].Up);
+            LightVPs[i] = p.GetVPTrans();
+        }
+
+        m_shadowMapLayeredEffect.SetLightVPs(LightVPs);
+
+        glClearColor(FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX);
+
+        m_shadowMapFBO.BindForWritingLayered();
+        glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+
+        RenderShadowCasterLayered(m_mesh, m_mesh1Orientation);
+        RenderShadowCasterLayered(m_mesh, m_mesh2Orientation);
+    }
+
+
+    void RenderShadowCasterLayered(BasicMesh& Mesh, const Orientation& o)
+    {
+        uint Faces[NUM_OF_LAYERS];
+        uint NumFaces = 0;
+
+        for (uint i = 0 ; i < NUM_OF_LAYERS ; i++) {
+            if (IsInCubeFace(o, i)) {
+                Faces[NumFaces++] = i;
+            }
+        }
+
+        if (NumFaces == 0) {
+            return;
+        }
+
+        Pipeline p;
+        p.Orient(o);
+        m_shadowMapLayeredEffect.SetWorld(p.GetWorldTrans());
+        m_shadowMapLayeredEffect.SetFaces(Faces, NumFaces);
+
+        if (m_shadowMapLayeredEffect.IsVertexShaderLayer()) {
+            Mesh.RenderDepth(NumFaces);
+        }
+        else {
+            Mesh.RenderDepth();
         }
     }
 
 
+    // Tests the bounding sphere of a mesh against the 90 degree frustum of
+    // one cube face. Inside the frustum Dot(v, Dir) >= |Dot(v, Axis)| for the
+    // two axes of the face.
+    bool IsInCubeFace(const Orientation& o, uint Face)
+    {
+        float Radius = MESH_RADIUS * MAX(MAX(o.m_scale.x, o.m_scale.y), o.m_scale.z);
+        Vector3f v = o.m_pos - m_pointLight.Position;
+
+        const Vector3f& Dir = gCameraDirections[Face].Target;
+        Vector3f Axes[2] = { gCameraDirections[Face].Up, Dir.Cross(gCameraDirections[Face].Up) };
+
+        float Depth = v.x * Dir.x + v.y * Dir.y + v.z * Dir.z;
+
+        if ((Depth < m_persProjInfo.zNear - Radius) || (Depth > m_persProjInfo.zFar + Radius)) {
+            return false;
+        }
+
+        // The side planes have normals (Dir +- Axis) / sqrt(2)
+        for (uint i = 0 ; i < 2 ; i++) {
+            float d = v.x * Axes[i].x + v.y * Axes[i].y + v.z * Axes[i].z;
+
+            if ((Depth - d < -Radius * sqrtf(2.0f)) || (Depth + d < -Radius * sqrtf(2.0f))) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+
     void RenderPass()
     {
         glCullFace(GL_BACK);
@@ -262,6 +382,9 @@ public:
             case OGLDEV_KEY_q:
                 glutLeaveMainLoop();
                 break;
+            case OGLDEV_KEY_l:
+                m_layeredShadows = !m_layeredShadows;
+                break;
             default:
                 m_pGameCamera->OnKeyboard(OgldevKey);
         }
@@ -278,6 +401,7 @@ private:
 
     LightingTechnique m_lightingEffect;
     ShadowMapTechnique m_shadowMapEffect;
+    ShadowMapTechnique m_shadowMapLayeredEffect;
     Camera* m_pGameCamera;
     float m_scale;
     PointLight m_pointLight;
@@ -290,6 +414,7 @@ private:
     PersProjInfo m_persProjInfo;
     Texture* m_pGroundTex;
     ShadowCubeMapFBO m_shadowMapFBO;
+    bool m_layeredShadows;
 };
 
 
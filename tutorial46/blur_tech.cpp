@@ -24,13 +24,31 @@
 
 #define INPUT_TEXTURE_UNIT                 GL_TEXTURE0
 #define INPUT_TEXTURE_UNIT_INDEX           0
+#define DEPTH_TEXTURE_UNIT                 GL_TEXTURE1
+#define DEPTH_TEXTURE_UNIT_INDEX           1
 
 
 BlurTech::BlurTech()
 {   
+    m_bilateral = false;
 }
 
+
 bool BlurTech::Init()
+{
+    return InitCommon("shaders/blur.fs");
+}
+
+
+bool BlurTech::InitBilateral()
+{
+    m_bilateral = true;
+
+    return InitCommon("shaders/bilateral_blur.fs");
+}
+
+
+bool BlurTech::InitCommon(const char* pFSFilename)
 {
     if (!Technique::Init()) {
         return false;
@@ -41,7 +59,7 @@ bool BlurTech::Init()
     }
 
 
-    if (!AddShader(GL_FRAGMENT_SHADER, "shaders/blur.fs")) {
+    if (!AddShader(GL_FRAGMENT_SHADER, pFSFilename)) {
         return false;
     }
 
@@ -54,11 +72,25 @@ bool BlurTech::Init()
 	if (m_inputTextureUnitLocation == INVALID_UNIFORM_LOCATION) {
 		return false;
 	}
+
+    if (m_bilateral) {
+        m_depthTextureUnitLocation = GetUniformLocation("gLinearDepthMap");
+        m_directionLocation = GetUniformLocation("gDirection");
+
+        if (m_depthTextureUnitLocation == INVALID_UNIFORM_LOCATION ||
+            m_directionLocation == INVALID_UNIFORM_LOCATION) {
+            return false;
+        }
+    }
     
     Enable();
     
     glUniform1i(m_inputTextureUnitLocation, INPUT_TEXTURE_UNIT_INDEX);
 
+    if (m_bilateral) {
+        glUniform1i(m_depthTextureUnitLocation, DEPTH_TEXTURE_UNIT_INDEX);
+    }
+
 	return true;
 }
 
@@ -68,3 +100,15 @@ void BlurTech::BindInputBuffer(IOBuffer& inputBuf)
     inputBuf.BindForReading(INPUT_TEXTURE_UNIT);
 }
 
+
+void BlurTech::BindLinearDepthBuffer(IOBuffer& linearDepthBuf)
+{
+    linearDepthBuf.BindForReading(DEPTH_TEXTURE_UNIT);
+}
+
+
+void BlurTech::SetDirection(int x, int y)
+{
+    glUniform2i(m_directionLocation, x, y);
+}
+
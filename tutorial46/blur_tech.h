@@ -27,13 +27,26 @@ public:
 
     BlurTech();
 
+    // 4x4 box blur
     virtual bool Init();
 
+    // One pass of a separable depth aware blur
+    bool InitBilateral();
+
     void BindInputBuffer(IOBuffer& inputBuf);
 
+    void BindLinearDepthBuffer(IOBuffer& linearDepthBuf);
+
+    void SetDirection(int x, int y);
+
 private:
 
+    bool InitCommon(const char* pFSFilename);
+
+    bool m_bilateral;
     GLuint m_inputTextureUnitLocation;
+    GLuint m_depthTextureUnitLocation;
+    GLuint m_directionLocation;
 };
 
 
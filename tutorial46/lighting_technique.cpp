@@ -26,6 +26,8 @@
 
 #define AO_TEXTURE_UNIT               GL_TEXTURE3
 #define AO_TEXTURE_UNIT_INDEX         3
+#define AO_DEPTH_TEXTURE_UNIT         GL_TEXTURE4
+#define AO_DEPTH_TEXTURE_UNIT_INDEX   4
 
 LightingTechnique::LightingTechnique()
 {   
@@ -55,6 +57,8 @@ bool LightingTechnique::Init()
     m_WorldMatrixLocation = GetUniformLocation("gWorld");
     m_colorTextureLocation = GetUniformLocation("gColorMap");
     m_aoTextureLocation = GetUniformLocation("gAOMap");
+    m_aoDepthTextureLocation = GetUniformLocation("gAODepthMap");
+    m_aoDownsampleLocation = GetUniformLocation("gAODownsample");
     m_eyeWorldPosLocation = GetUniformLocation("gEyeWorldPos");
     m_dirLightLocation.Color = GetUniformLocation("gDirectionalLight.Base.Color");
     m_dirLightLocation.AmbientIntensity = GetUniformLocation("gDirectionalLight.Base.AmbientIntensity");
@@ -72,6 +76,8 @@ bool LightingTechnique::Init()
         m_WorldMatrixLocation == INVALID_UNIFORM_LOCATION ||
         m_colorTextureLocation == INVALID_UNIFORM_LOCATION ||
         m_aoTextureLocation == INVALID_UNIFORM_LOCATION ||
+        m_aoDepthTextureLocation == INVALID_UNIFORM_LOCATION ||
+        m_aoDownsampleLocation == INVALID_UNIFORM_LOCATION ||
         m_eyeWorldPosLocation == INVALID_UNIFORM_LOCATION ||
         m_dirLightLocation.Color == INVALID_UNIFORM_LOCATION ||
         m_dirLightLocation.DiffuseIntensity == INVALID_UNIFORM_LOCATION ||
@@ -165,6 +171,8 @@ bool LightingTechnique::Init()
     Enable();
     
     glUniform1i(m_aoTextureLocation, AO_TEXTURE_UNIT_INDEX);
+    glUniform1i(m_aoDepthTextureLocation, AO_DEPTH_TEXTURE_UNIT_INDEX);
+    glUniform1i(m_aoDownsampleLocation, 1);
     glUniform1i(m_colorTextureLocation, COLOR_TEXTURE_UNIT_INDEX);
 
     return true;
@@ -195,6 +203,18 @@ void LightingTechnique::BindAOBuffer(IOBuffer& aoBuffer)
 }
 
 
+void LightingTechnique::BindAODepthBuffer(IOBuffer& aoDepthBuffer)
+{
+    aoDepthBuffer.BindForReading(AO_DEPTH_TEXTURE_UNIT);
+}
+
+
+void LightingTechnique::SetAODownsample(int Downsample)
+{
+    glUniform1i(m_aoDownsampleLocation, Downsample);
+}
+
+
 void LightingTechnique::SetDirectionalLight(const DirectionalLight& Light)
 {
     glUniform3f(m_dirLightLocation.Color, Light.Color.x, Light.Color.y, Light.Color.z);
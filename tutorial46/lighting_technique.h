@@ -37,6 +37,9 @@ public:
     void SetWVP(const Matrix4f& WVP);
     void SetWorldMatrix(const Matrix4f& WVP);
     void BindAOBuffer(IOBuffer& aoBuffer);
+    // Linear depth that matches a low resolution AO buffer
+    void BindAODepthBuffer(IOBuffer& aoDepthBuffer);
+    void SetAODownsample(int Downsample);
     void SetDirectionalLight(const DirectionalLight& Light);
     void SetPointLights(uint NumLights, const PointLight* pLights);
     void SetSpotLights(uint NumLights, const SpotLight* pLights);
@@ -52,6 +55,8 @@ private:
     GLuint m_WorldMatrixLocation;
     GLuint m_colorTextureLocation;
     GLuint m_aoTextureLocation;
+    GLuint m_aoDepthTextureLocation;
+    GLuint m_aoDownsampleLocation;
     GLuint m_eyeWorldPosLocation;
     GLuint m_matSpecularIntensityLocation;
     GLuint m_matSpecularPowerLocation;
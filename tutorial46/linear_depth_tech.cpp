@@ -0,0 +1,85 @@
+/*
+
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <limits.h>
+#include <string.h>
+
+#include "linear_depth_tech.h"
+#include "ogldev_util.h"
+
+#define DEPTH_TEXTURE_UNIT                 GL_TEXTURE1
+#define DEPTH_TEXTURE_UNIT_INDEX           1
+
+
+LinearDepthTech::LinearDepthTech()
+{
+}
+
+
+bool LinearDepthTech::Init()
+{
+    if (!Technique::Init()) {
+        return false;
+    }
+
+    if (!AddShader(GL_VERTEX_SHADER, "shaders/blur.vs")) {
+        return false;
+    }
+
+    if (!AddShader(GL_FRAGMENT_SHADER, "shaders/linear_depth.fs")) {
+        return false;
+    }
+
+    if (!Finalize()) {
+        return false;
+    }
+
+    m_depthTextureUnitLocation = GetUniformLocation("gDepthMap");
+    m_projMatrixLocation = GetUniformLocation("gProj");
+    m_downsampleLocation = GetUniformLocation("gDownsample");
+
+    if (m_depthTextureUnitLocation == INVALID_UNIFORM_LOCATION ||
+        m_projMatrixLocation == INVALID_UNIFORM_LOCATION ||
+        m_downsampleLocation == INVALID_UNIFORM_LOCATION) {
+        return false;
+    }
+
+    Enable();
+
+    glUniform1i(m_depthTextureUnitLocation, DEPTH_TEXTURE_UNIT_INDEX);
+
+    return true;
+}
+
+
+void LinearDepthTech::BindDepthBuffer(IOBuffer& depthBuf)
+{
+    depthBuf.BindForReading(DEPTH_TEXTURE_UNIT);
+}
+
+
+void LinearDepthTech::SetProjMatrix(const Matrix4f& m)
+{
+    glUniformMatrix4fv(m_projMatrixLocation, 1, GL_TRUE, (const GLfloat*)m.m);
+}
+
+
+void LinearDepthTech::SetDownsample(int Downsample)
+{
+    glUniform1i(m_downsampleLocation, Downsample);
+}
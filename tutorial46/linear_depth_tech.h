@@ -0,0 +1,49 @@
+/*
+        Copyright 2021 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef LINEAR_DEPTH_TECH_H
+#define	LINEAR_DEPTH_TECH_H
+
+#include "technique.h"
+#include "ogldev_math_3d.h"
+#include "ogldev_io_buffer.h"
+
+// Converts the depth buffer into view space Z at 1/Downsample of its
+// resolution. Low resolution AO reads it instead of the depth buffer.
+class LinearDepthTech : public Technique {
+public:
+
+    LinearDepthTech();
+
+    virtual bool Init();
+
+    void BindDepthBuffer(IOBuffer& depthBuf);
+
+    void SetProjMatrix(const Matrix4f& m);
+
+    void SetDownsample(int Downsample);
+
+private:
+
+    GLuint m_depthTextureUnitLocation;
+    GLuint m_projMatrixLocation;
+    GLuint m_downsampleLocation;
+};
+
+
+#endif
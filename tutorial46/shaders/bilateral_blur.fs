@@ -0,0 +1,37 @@
+#version 330
+
+out vec4 FragColor;
+
+uniform sampler2D gColorMap;
+uniform sampler2D gLinearDepthMap;
+uniform ivec2 gDirection;           // (1, 0) for the horizontal pass, (0, 1) for the vertical
+
+const int BLUR_RADIUS = 4;
+const float DEPTH_SHARPNESS = 32.0;
+
+float Gaussian[BLUR_RADIUS + 1] = float[]( 0.2301, 0.1954, 0.1197, 0.0529, 0.0169 );
+
+
+// One dimension of a separable gaussian. Samples from a different surface
+// (large relative depth difference) are faded out so AO stays on its side of
+// the depth edges.
+void main()
+{
+    ivec2 Coord = ivec2(gl_FragCoord.xy);
+    ivec2 MaxCoord = textureSize(gColorMap, 0) - ivec2(1);
+
+    float CenterZ = texelFetch(gLinearDepthMap, Coord, 0).x;
+
+    float AO = 0.0;
+    float TotalWeight = 0.0;
+
+    for (int i = -BLUR_RADIUS ; i <= BLUR_RADIUS ; i++) {
+        ivec2 c = clamp(Coord + gDirection * i, ivec2(0), MaxCoord);
+        float SampleZ = texelFetch(gLinearDepthMap, c, 0).x;
+        float Weight = Gaussian[abs(i)] * exp(-abs(SampleZ - CenterZ) / CenterZ * DEPTH_SHARPNESS);
+        AO += texelFetch(gColorMap, c, 0).x * Weight;
+        TotalWeight += Weight;
+    }
+
+    FragColor = vec4(AO / TotalWeight);
+}
@@ -55,6 +55,8 @@ uniform PointLight gPointLights[MAX_POINT_LIGHTS];
 uniform SpotLight gSpotLights[MAX_SPOT_LIGHTS];                                             
 uniform sampler2D gColorMap;
 uniform sampler2D gAOMap;
+uniform sampler2D gAODepthMap;      // linear depth of a low resolution AO map
+uniform int gAODownsample;          // 1 when the AO map is full resolution
 uniform vec3 gEyeWorldPos;
 uniform float gMatSpecularIntensity;                                                        
 uniform float gSpecularPower; 
@@ -65,6 +67,39 @@ vec2 CalcScreenTexCoord()
 {
     return gl_FragCoord.xy / gScreenSize;
 }
+
+
+// Bilateral upsample: the bilinear weights of the four nearest low resolution
+// texels are scaled down by their depth difference from the current pixel so
+// AO does not leak across depth discontinuities.
+float CalcAO()
+{
+    if (gAODownsample == 1) {
+        return texture(gAOMap, CalcScreenTexCoord()).r;
+    }
+
+    float ViewZ = 1.0 / gl_FragCoord.w;
+    vec2 Coord = gl_FragCoord.xy / float(gAODownsample) - vec2(0.5);
+    ivec2 Base = ivec2(floor(Coord));
+    vec2 f = fract(Coord);
+    ivec2 MaxCoord = textureSize(gAOMap, 0) - ivec2(1);
+
+    vec4 Bilinear = vec4((1.0 - f.x) * (1.0 - f.y), f.x * (1.0 - f.y), (1.0 - f.x) * f.y, f.x * f.y);
+    ivec2 Offsets[4] = ivec2[](ivec2(0, 0), ivec2(1, 0), ivec2(0, 1), ivec2(1, 1));
+
+    float AO = 0.0;
+    float TotalWeight = 0.0;
+
+    for (int i = 0 ; i < 4 ; i++) {
+        ivec2 c = clamp(Base + Offsets[i], ivec2(0), MaxCoord);
+        float SampleZ = texelFetch(gAODepthMap, c, 0).x;
+        float Weight = Bilinear[i] / (0.001 + abs(SampleZ - ViewZ) / ViewZ);
+        AO += texelFetch(gAOMap, c, 0).x * Weight;
+        TotalWeight += Weight;
+    }
+
+    return AO / TotalWeight;
+}
                                                               
                                                                                             
 vec4 CalcLightInternal(BaseLight Light, vec3 LightDirection, vec3 Normal)                   
@@ -72,7 +107,7 @@ vec4 CalcLightInternal(BaseLight Light, vec3 LightDirection, vec3 Normal)
     vec4 AmbientColor = vec4(Light.Color * Light.AmbientIntensity, 1.0f);
 
     if (gShaderType == SHADER_TYPE_SSAO) {
-         AmbientColor *= texture(gAOMap, CalcScreenTexCoord()).r;
+         AmbientColor *= CalcAO();
     }
 
     float DiffuseFactor = dot(Normal, -LightDirection);                                     
@@ -142,7 +177,7 @@ void main()
     }                                                                                       
            
     if (gShaderType == SHADER_TYPE_ONLY_AO) {
-        FragColor = vec4(texture(gAOMap, CalcScreenTexCoord()).x);
+        FragColor = vec4(CalcAO());
     }
     else {
         FragColor = texture(gColorMap, TexCoord0.xy) * TotalLight;
@@ -0,0 +1,26 @@
+#version 330
+
+out vec4 FragColor;
+
+uniform sampler2D gDepthMap;
+uniform mat4 gProj;
+uniform int gDownsample;
+
+
+// Every output texel covers gDownsample x gDownsample depth texels. The
+// closest one is kept so thin foreground objects are not lost.
+void main()
+{
+    ivec2 Base = ivec2(gl_FragCoord.xy) * gDownsample;
+    float Depth = 1.0;
+
+    for (int y = 0 ; y < gDownsample ; y++) {
+        for (int x = 0 ; x < gDownsample ; x++) {
+            Depth = min(Depth, texelFetch(gDepthMap, Base + ivec2(x, y), 0).x);
+        }
+    }
+
+    float ViewZ = gProj[3][2] / (2 * Depth - 1 - gProj[2][2]);
+
+    FragColor = vec4(ViewZ);
+}
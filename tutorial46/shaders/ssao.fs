@@ -11,6 +11,8 @@ uniform mat4 gProj;
 
 const int MAX_KERNEL_SIZE = 64;
 uniform vec3 gKernel[MAX_KERNEL_SIZE];
+uniform int gFirstSample;       // with temporal accumulation every frame
+uniform int gSampleStep;        // takes a different subset of the kernel
 
 
 float CalcViewZ(vec2 Coords)
@@ -32,7 +34,7 @@ void main()
 
     float AO = 0.0;
 
-    for (int i = 0 ; i < MAX_KERNEL_SIZE ; i++) {
+    for (int i = gFirstSample ; i < MAX_KERNEL_SIZE ; i += gSampleStep) {
         vec3 samplePos = Pos + gKernel[i];
         vec4 offset = vec4(samplePos, 1.0);
         offset = gProj * offset;
@@ -46,7 +48,7 @@ void main()
         }
     }
 
-    AO = 1.0 - AO/64.0;
+    AO = 1.0 - AO * float(gSampleStep) / float(MAX_KERNEL_SIZE);
  
     FragColor = vec4(pow(AO, 2.0));
 }
\ No newline at end of file
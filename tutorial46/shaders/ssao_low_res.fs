@@ -0,0 +1,59 @@
+#version 330
+
+in vec2 TexCoord;
+in vec2 ViewRay;
+
+out vec4 FragColor;
+
+uniform sampler2D gLinearDepthMap;
+uniform sampler2D gNoiseMap;
+uniform float gSampleRad;
+uniform mat4 gProj;
+
+const int KERNEL_SIZE = 16;
+uniform vec3 gKernel[KERNEL_SIZE];
+uniform int gFirstSample;       // with temporal accumulation every frame
+uniform int gSampleStep;        // takes a different subset of the kernel
+
+
+float GetViewZ(vec2 Coords)
+{
+    ivec2 MaxCoord = textureSize(gLinearDepthMap, 0) - ivec2(1);
+    ivec2 c = clamp(ivec2(Coords * textureSize(gLinearDepthMap, 0)), ivec2(0), MaxCoord);
+    return texelFetch(gLinearDepthMap, c, 0).x;
+}
+
+
+void main()
+{
+    float ViewZ = texelFetch(gLinearDepthMap, ivec2(gl_FragCoord.xy), 0).x;
+
+    vec3 Pos = vec3(ViewRay * ViewZ, ViewZ);
+
+    // Rotate the kernel around the view axis. Neighbouring pixels use different
+    // rotations so the small kernel turns into noise which the blur removes.
+    vec2 Rotation = texelFetch(gNoiseMap, ivec2(gl_FragCoord.xy) & ivec2(3), 0).xy;
+    mat2 RotationMat = mat2(Rotation.x, Rotation.y, -Rotation.y, Rotation.x);
+
+    float AO = 0.0;
+
+    for (int i = gFirstSample ; i < KERNEL_SIZE ; i += gSampleStep) {
+        vec3 samplePos = gKernel[i];
+        samplePos.xy = RotationMat * samplePos.xy;
+        samplePos += Pos;
+
+        vec4 offset = gProj * vec4(samplePos, 1.0);
+        offset.xy /= offset.w;
+        offset.xy = offset.xy * 0.5 + vec2(0.5);
+
+        float sampleDepth = GetViewZ(offset.xy);
+
+        if (abs(Pos.z - sampleDepth) < gSampleRad) {
+            AO += step(sampleDepth, samplePos.z);
+        }
+    }
+
+    AO = 1.0 - AO * float(gSampleStep) / float(KERNEL_SIZE);
+
+    FragColor = vec4(pow(AO, 2.0));
+}
@@ -25,14 +25,40 @@
 
 #define DEPTH_TEXTURE_UNIT           GL_TEXTURE1
 #define DEPTH_TEXTURE_UNIT_INDEX     1
+#define NOISE_TEXTURE_UNIT           GL_TEXTURE2
+#define NOISE_TEXTURE_UNIT_INDEX     2
 
 
 SSAOTechnique::SSAOTechnique()
 {   
+    m_lowRes = false;
+    m_noiseTexture = 0;
+}
+
+
+SSAOTechnique::~SSAOTechnique()
+{
+    if (m_noiseTexture != 0) {
+        glDeleteTextures(1, &m_noiseTexture);
+    }
 }
 
 
 bool SSAOTechnique::Init()
+{
+    return InitCommon("shaders/ssao.fs", "gDepthMap");
+}
+
+
+bool SSAOTechnique::InitLowRes()
+{
+    m_lowRes = true;
+
+    return InitCommon("shaders/ssao_low_res.fs", "gLinearDepthMap");
+}
+
+
+bool SSAOTechnique::InitCommon(const char* pFSFilename, const char* pDepthMapName)
 {
     if (!Technique::Init()) {
         return false;
@@ -42,7 +68,7 @@ bool SSAOTechnique::Init()
         return false;
     }
 
-    if (!AddShader(GL_FRAGMENT_SHADER, "shaders/ssao.fs")) {
+    if (!AddShader(GL_FRAGMENT_SHADER, pFSFilename)) {
         return false;
     }
 
@@ -50,29 +76,48 @@ bool SSAOTechnique::Init()
         return false;
     }
 
-	m_depthTextureUnitLocation = GetUniformLocation("gDepthMap");
+	m_depthTextureUnitLocation = GetUniformLocation(pDepthMapName);
     m_sampleRadLocation = GetUniformLocation("gSampleRad");
     m_projMatrixLocation = GetUniformLocation("gProj");	
     m_kernelLocation = GetUniformLocation("gKernel");
     m_aspectRatioLocation = GetUniformLocation("gAspectRatio");
     m_tanHalfFOVLocation = GetUniformLocation("gTanHalfFOV");
+    m_firstSampleLocation = GetUniformLocation("gFirstSample");
+    m_sampleStepLocation = GetUniformLocation("gSampleStep");
             
     if (m_depthTextureUnitLocation  == INVALID_UNIFORM_LOCATION ||
         m_sampleRadLocation         == INVALID_UNIFORM_LOCATION ||
         m_projMatrixLocation        == INVALID_UNIFORM_LOCATION ||		
         m_kernelLocation            == INVALID_UNIFORM_LOCATION ||
         m_aspectRatioLocation       == INVALID_UNIFORM_LOCATION ||
-        m_tanHalfFOVLocation        == INVALID_UNIFORM_LOCATION) {
+        m_tanHalfFOVLocation        == INVALID_UNIFORM_LOCATION ||
+        m_firstSampleLocation       == INVALID_UNIFORM_LOCATION ||
+        m_sampleStepLocation        == INVALID_UNIFORM_LOCATION) {
         return false;
     }
+
+    if (m_lowRes) {
+        m_noiseTextureUnitLocation = GetUniformLocation("gNoiseMap");
+
+        if (m_noiseTextureUnitLocation == INVALID_UNIFORM_LOCATION) {
+            return false;
+        }
+    }
    
     Enable();
     
     GLExitIfError;
     
-    GenKernel();
+    GenKernel(m_lowRes ? LOW_RES_KERNEL_SIZE : KERNEL_SIZE);
     
     glUniform1i(m_depthTextureUnitLocation, DEPTH_TEXTURE_UNIT_INDEX);
+
+    SetSampleSubset(0, 1);
+
+    if (m_lowRes) {
+        GenNoiseTexture();
+        glUniform1i(m_noiseTextureUnitLocation, NOISE_TEXTURE_UNIT_INDEX);
+    }
     
     GLExitIfError;
     
@@ -80,12 +125,12 @@ bool SSAOTechnique::Init()
 }
 
 
-void SSAOTechnique::GenKernel()
+void SSAOTechnique::GenKernel(uint KernelSize)
 {
     Vector3f kernel[KERNEL_SIZE];
     
-    for (uint i = 0 ; i < KERNEL_SIZE ; i++ ) {
-        float scale = (float)i / (float)(KERNEL_SIZE);        
+    for (uint i = 0 ; i < KernelSize ; i++ ) {
+        float scale = (float)i / (float)(KernelSize);        
         Vector3f v;
         v.x = 2.0f * (float)rand()/RAND_MAX - 1.0f;
         v.y = 2.0f * (float)rand()/RAND_MAX - 1.0f;
@@ -97,7 +142,29 @@ void SSAOTechnique::GenKernel()
         kernel[i] = v;
     }
        
-    glUniform3fv(m_kernelLocation, KERNEL_SIZE, (const GLfloat*)&kernel[0]);    
+    glUniform3fv(m_kernelLocation, KernelSize, (const GLfloat*)&kernel[0]);    
+}
+
+
+// Random rotations around the view axis stored as (cos, sin). The texture
+// repeats every NOISE_SIZE pixels and the bilateral blur removes the pattern.
+void SSAOTechnique::GenNoiseTexture()
+{
+    float Noise[NOISE_SIZE * NOISE_SIZE * 2];
+
+    for (uint i = 0 ; i < NOISE_SIZE * NOISE_SIZE ; i++) {
+        float Angle = 2.0f * (float)M_PI * (float)rand()/RAND_MAX;
+        Noise[i * 2]     = cosf(Angle);
+        Noise[i * 2 + 1] = sinf(Angle);
+    }
+
+    glGenTextures(1, &m_noiseTexture);
+    glBindTexture(GL_TEXTURE_2D, m_noiseTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, NOISE_SIZE, NOISE_SIZE, 0, GL_RG, GL_FLOAT, Noise);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 }
 
 
@@ -107,6 +174,15 @@ void SSAOTechnique::BindDepthBuffer(IOBuffer& depthBuf)
 }
 
 
+void SSAOTechnique::BindLinearDepthBuffer(IOBuffer& linearDepthBuf)
+{
+    linearDepthBuf.BindForReading(DEPTH_TEXTURE_UNIT);
+
+    glActiveTexture(NOISE_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, m_noiseTexture);
+}
+
+
 void SSAOTechnique::SetSampleRadius(float sr)
 {
     glUniform1f(m_sampleRadLocation, sr);
@@ -129,3 +205,10 @@ void SSAOTechnique::SetTanHalfFOV(float tanHalfFOV)
 {
     glUniform1f(m_tanHalfFOVLocation, tanHalfFOV);
 }
+
+
+void SSAOTechnique::SetSampleSubset(int FirstSample, int Step)
+{
+    glUniform1i(m_firstSampleLocation, FirstSample);
+    glUniform1i(m_sampleStepLocation, Step);
+}
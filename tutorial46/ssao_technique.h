@@ -28,26 +28,48 @@ public:
 
     SSAOTechnique();
 
+    ~SSAOTechnique();
+
+    // Full resolution, 64 samples, view Z is reconstructed from the depth buffer
     virtual bool Init();
 
+    // For low resolution AO: 16 samples rotated per pixel by a 4x4 noise
+    // texture, view Z is read from a linear depth buffer
+    bool InitLowRes();
+
     void BindDepthBuffer(IOBuffer& depthBuf);	
+    void BindLinearDepthBuffer(IOBuffer& linearDepthBuf);
     void SetSampleRadius(float sr);    
     void SetProjMatrix(const Matrix4f& m);
     void SetAspectRatio(float aspectRatio);
     void SetTanHalfFOV(float tanHalfFOV);
+    // Only samples FirstSample, FirstSample + Step, ... are taken
+    void SetSampleSubset(int FirstSample, int Step);
     
 private:
     
-    void GenKernel();
+    bool InitCommon(const char* pFSFilename, const char* pDepthMapName);
+
+    void GenKernel(uint KernelSize);
+
+    void GenNoiseTexture();
     
     const static uint KERNEL_SIZE = 64;
+    const static uint LOW_RES_KERNEL_SIZE = 16;
+    const static uint NOISE_SIZE = 4;
+
+    bool m_lowRes;
+    GLuint m_noiseTexture;
 
     GLuint m_depthTextureUnitLocation;
+    GLuint m_noiseTextureUnitLocation;
     GLuint m_sampleRadLocation;    
     GLuint m_kernelLocation;
     GLuint m_projMatrixLocation;
     GLuint m_aspectRatioLocation;
     GLuint m_tanHalfFOVLocation;
+    GLuint m_firstSampleLocation;
+    GLuint m_sampleStepLocation;
 };
 
 
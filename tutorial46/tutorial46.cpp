@@ -34,15 +34,21 @@
 #include "ssao_technique.h"
 #include "geom_pass_tech.h"
 #include "blur_tech.h"
+#include "linear_depth_tech.h"
 #include "lighting_technique.h"
 #include "ogldev_backend.h"
 #include "ogldev_camera.h"
 #include "mesh.h"
 #include "ogldev_io_buffer.h"
+#include "ogldev_temporal_accumulation.h"
 
 #define WINDOW_WIDTH  1280
 #define WINDOW_HEIGHT 1024
 
+// AO resolution divisors. 1 is the original full resolution path.
+static const int AODownsample[] = { 1, 2, 4 };
+#define NUM_AO_LEVELS ARRAY_SIZE_IN_ELEMENTS(AODownsample)
+
 class Tutorial46 : public ICallbacks, public OgldevApp
 {
 public:
@@ -65,6 +71,8 @@ public:
         m_directionalLight.Direction = Vector3f(1.0f, 0.0, 0.0);
 
         m_shaderType = 0;
+        m_aoLevel = 1;
+        m_temporal = false;
     }
 
     ~Tutorial46()
@@ -103,6 +111,25 @@ public:
         float TanHalfFOV = tanf(ToRadian(m_persProjInfo.FOV / 2.0f));
         m_SSAOTech.SetTanHalfFOV(TanHalfFOV);
 
+        if (!m_SSAOLowResTech.InitLowRes()) {
+            OGLDEV_ERROR0("Error initializing the low resolution SSAO technique\n");
+            return false;
+        }
+
+        m_SSAOLowResTech.Enable();
+        m_SSAOLowResTech.SetSampleRadius(1.5f);
+        m_SSAOLowResTech.SetProjMatrix(PersProjTrans);
+        m_SSAOLowResTech.SetAspectRatio(AspectRatio);
+        m_SSAOLowResTech.SetTanHalfFOV(TanHalfFOV);
+
+        if (!m_linearDepthTech.Init()) {
+            OGLDEV_ERROR0("Error initializing the linear depth technique\n");
+            return false;
+        }
+
+        m_linearDepthTech.Enable();
+        m_linearDepthTech.SetProjMatrix(PersProjTrans);
+
         if (!m_lightingTech.Init()) {
             OGLDEV_ERROR0("Error initializing the lighting technique\n");
             return false;
@@ -118,6 +145,11 @@ public:
             return false;
         }
 
+        if (!m_bilateralBlurTech.InitBilateral()) {
+            OGLDEV_ERROR0("Error initializing the bilateral blur technique\n");
+            return false;
+        }
+
         //if (!m_mesh.LoadMesh("../Content/crytek_sponza/sponza.obj")) {
         if (!m_mesh.LoadMesh("../Content/jeep.obj")) {
             return false;
@@ -143,6 +175,24 @@ public:
             return false;
         }
 
+        for (uint i = 0 ; i < NUM_AO_LEVELS ; i++) {
+            if (!m_temporalAccum[i].Init(WINDOW_WIDTH / AODownsample[i], WINDOW_HEIGHT / AODownsample[i])) {
+                OGLDEV_ERROR0("Error initializing the temporal accumulation\n");
+                return false;
+            }
+        }
+
+        for (uint i = 1 ; i < NUM_AO_LEVELS ; i++) {
+            uint Width = WINDOW_WIDTH / AODownsample[i];
+            uint Height = WINDOW_HEIGHT / AODownsample[i];
+
+            if (!m_lowResBuffers[i].LinearDepth.Init(Width, Height, false, GL_R32F) ||
+                !m_lowResBuffers[i].AO.Init(Width, Height, false, GL_R32F) ||
+                !m_lowResBuffers[i].BlurTemp.Init(Width, Height, false, GL_R32F)) {
+                return false;
+            }
+        }
+
 #ifndef WIN32
         if (!m_fontRenderer.InitFontRenderer()) {
             return false;
@@ -165,14 +215,26 @@ public:
 
         GeometryPass();
 
-        SSAOPass();
+        if (AODownsample[m_aoLevel] == 1) {
+            SSAOPass();
 
-        BlurPass();
+            BlurPass();
+        }
+        else {
+            LowResSSAOPass();
+        }
 
         LightingPass();
 
         RenderFPS();
 
+        char text[64];
+        ZERO_MEM(text);
+        SNPRINTF(text, sizeof(text), "AO resolution: 1/%d, temporal: %s", AODownsample[m_aoLevel], m_temporal ? "on" : "off");
+#ifndef WIN32
+        m_fontRenderer.RenderText(10, 30, text);
+#endif
+
         CalcFPS();
 
         OgldevBackendSwapBuffers();
@@ -196,12 +258,30 @@ public:
     {
         m_SSAOTech.Enable();
         m_SSAOTech.BindDepthBuffer(m_depthBuffer);
+        SetSampleSubset(m_SSAOTech);
 
         m_aoBuffer.BindForWriting();
 
         glClear(GL_COLOR_BUFFER_BIT);
 
         m_quad.Render();
+
+        if (m_temporal) {
+            m_temporalAccum[0].Accumulate(m_aoBuffer, m_depthBuffer, m_pipeline.GetVPTrans());
+        }
+    }
+
+
+    // With temporal accumulation every frame takes a quarter of the kernel
+    // and the history fills in the rest
+    void SetSampleSubset(SSAOTechnique& Tech)
+    {
+        if (m_temporal) {
+            Tech.SetSampleSubset(m_temporalAccum[m_aoLevel].GetFrameIndex(), TemporalAccumulation::NUM_FRAMES);
+        }
+        else {
+            Tech.SetSampleSubset(0, 1);
+        }
     }
 
 
@@ -209,7 +289,7 @@ public:
     {
         m_blurTech.Enable();
 
-        m_blurTech.BindInputBuffer(m_aoBuffer);
+        m_blurTech.BindInputBuffer(m_temporal ? m_temporalAccum[0].GetOutput() : m_aoBuffer);
 
         m_blurBuffer.BindForWriting();
 
@@ -219,11 +299,67 @@ public:
     }
 
 
+    // Linearize and downsample the depth, compute AO with the small kernel
+    // and blur it horizontally and then vertically. The result ends up in
+    // the AO buffer and the lighting pass upsamples it.
+    void LowResSSAOPass()
+    {
+        LowResBuffers& Buffers = m_lowResBuffers[m_aoLevel];
+        int Downsample = AODownsample[m_aoLevel];
+
+        glViewport(0, 0, WINDOW_WIDTH / Downsample, WINDOW_HEIGHT / Downsample);
+
+        m_linearDepthTech.Enable();
+        m_linearDepthTech.SetDownsample(Downsample);
+        m_linearDepthTech.BindDepthBuffer(m_depthBuffer);
+        Buffers.LinearDepth.BindForWriting();
+        m_quad.Render();
+
+        m_SSAOLowResTech.Enable();
+        m_SSAOLowResTech.BindLinearDepthBuffer(Buffers.LinearDepth);
+        SetSampleSubset(m_SSAOLowResTech);
+        Buffers.AO.BindForWriting();
+        m_quad.Render();
+
+        IOBuffer* pAO = &Buffers.AO;
+
+        if (m_temporal) {
+            m_temporalAccum[m_aoLevel].Accumulate(Buffers.AO, m_depthBuffer, m_pipeline.GetVPTrans());
+            pAO = &m_temporalAccum[m_aoLevel].GetOutput();
+        }
+
+        m_bilateralBlurTech.Enable();
+        m_bilateralBlurTech.BindLinearDepthBuffer(Buffers.LinearDepth);
+
+        m_bilateralBlurTech.SetDirection(1, 0);
+        m_bilateralBlurTech.BindInputBuffer(*pAO);
+        Buffers.BlurTemp.BindForWriting();
+        m_quad.Render();
+
+        m_bilateralBlurTech.SetDirection(0, 1);
+        m_bilateralBlurTech.BindInputBuffer(Buffers.BlurTemp);
+        Buffers.AO.BindForWriting();
+        m_quad.Render();
+
+        glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+    }
+
+
     void LightingPass()
     {
         m_lightingTech.Enable();
         m_lightingTech.SetShaderType(m_shaderType);
-        m_lightingTech.BindAOBuffer(m_blurBuffer);
+
+        int Downsample = AODownsample[m_aoLevel];
+        m_lightingTech.SetAODownsample(Downsample);
+
+        if (Downsample == 1) {
+            m_lightingTech.BindAOBuffer(m_blurBuffer);
+        }
+        else {
+            m_lightingTech.BindAOBuffer(m_lowResBuffers[m_aoLevel].AO);
+            m_lightingTech.BindAODepthBuffer(m_lowResBuffers[m_aoLevel].LinearDepth);
+        }
 
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
@@ -247,6 +383,14 @@ public:
                 m_shaderType++;
                 m_shaderType = m_shaderType % 3;
                 break;
+            case OGLDEV_KEY_r:
+                m_aoLevel = (m_aoLevel + 1) % NUM_AO_LEVELS;
+                m_temporalAccum[m_aoLevel].Reset();
+                break;
+            case OGLDEV_KEY_t:
+                m_temporal = !m_temporal;
+                m_temporalAccum[m_aoLevel].Reset();
+                break;
             default:
                 m_pGameCamera->OnKeyboard(OgldevKey);
         }
@@ -262,6 +406,9 @@ public:
 private:
 
     SSAOTechnique m_SSAOTech;
+    SSAOTechnique m_SSAOLowResTech;
+    LinearDepthTech m_linearDepthTech;
+    BlurTech m_bilateralBlurTech;
     GeomPassTech m_geomPassTech;
     LightingTechnique m_lightingTech;
     BlurTech m_blurTech;
@@ -275,6 +422,17 @@ private:
     IOBuffer m_blurBuffer;
     DirectionalLight m_directionalLight;
     int m_shaderType;
+    uint m_aoLevel;
+    bool m_temporal;
+    TemporalAccumulation m_temporalAccum[NUM_AO_LEVELS];
+
+    struct LowResBuffers {
+        IOBuffer LinearDepth;
+        IOBuffer AO;
+        IOBuffer BlurTemp;
+    };
+
+    LowResBuffers m_lowResBuffers[NUM_AO_LEVELS];     // entry 0 is not used
 };
 
 
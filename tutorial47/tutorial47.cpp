@@ -52,6 +52,7 @@ public:
     {
         m_pGameCamera = NULL;
         m_pGroundTex  = NULL;
+        m_shadowCache = true;
 
         m_dirLight.AmbientIntensity = 0.5f;
         m_dirLight.DiffuseIntensity = 0.9f;
@@ -78,6 +79,7 @@ public:
         for (int i = 0; i < NUM_MESHES ; i++) {
             m_meshOrientation[i].m_scale    = Vector3f(1.0f, 1.0f, 1.0f);
             m_meshOrientation[i].m_pos      = Vector3f(0.0f, 0.0f, 3.0f + i * 30.0f);
+            m_meshIsStatic[i] = (i % 2 == 0);
         }
     }
 
@@ -89,7 +91,7 @@ public:
 
     bool Init()
     {
-        if (!m_shadowMapFBO.Init(WINDOW_WIDTH, WINDOW_HEIGHT)) {
+        if (!m_shadowMapFBO.Init(WINDOW_WIDTH, WINDOW_HEIGHT, true)) {
             return false;
         }
 
@@ -112,7 +114,8 @@ public:
         m_LightingTech.SetMatSpecularIntensity(0.0f);
         m_LightingTech.SetMatSpecularPower(0);
 
-        if (!m_mesh.LoadMesh("../Content/dragon.obj")) {
+        // The shadow map bias hides the precision loss of the half float positions
+        if (!m_mesh.LoadMesh("../Content/dragon.obj", true)) {
             return false;
         }
 
@@ -149,8 +152,11 @@ public:
 
     virtual void RenderSceneCB()
     {
+        // Moving a static mesh requires m_shadowMapFBO.InvalidateStatic()
         for (int i = 0; i < NUM_MESHES ; i++) {
-            m_meshOrientation[i].m_rotation.y += 0.01f;
+            if (!m_meshIsStatic[i]) {
+                m_meshOrientation[i].m_rotation.y += 0.01f;
+            }
         }
 
         m_pGameCamera->OnRender();
@@ -162,24 +168,48 @@ public:
     }
 
 
+    // The static meshes are rendered only when the static shadow map is
+    // invalid so the cost of a regular frame depends only on the dynamic meshes
     void ShadowMapPass()
     {
-        m_shadowMapFBO.BindForWriting();
-        glClear(GL_DEPTH_BUFFER_BIT);
-
         m_ShadowMapEffect.Enable();
 
         Pipeline p;
         p.SetCamera(Vector3f(0.0f, 0.0f, 0.0f), m_dirLight.Direction, Vector3f(0.0f, 1.0f, 0.0f));
         p.SetOrthographicProj(m_shadowOrthoProjInfo);
 
+        if (m_shadowCache) {
+            if (!m_shadowMapFBO.IsStaticValid()) {
+                m_shadowMapFBO.BindForWritingStatic();
+                glClear(GL_DEPTH_BUFFER_BIT);
+                RenderShadowCasters(p, true);
+            }
+
+            m_shadowMapFBO.BindForWritingDynamic();
+            RenderShadowCasters(p, false);
+        }
+        else {
+            m_shadowMapFBO.BindForWriting();
+            glClear(GL_DEPTH_BUFFER_BIT);
+            RenderShadowCasters(p, true);
+            RenderShadowCasters(p, false);
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+
+    void RenderShadowCasters(Pipeline& p, bool Static)
+    {
         for (int i = 0; i < NUM_MESHES ; i++) {
+            if (m_meshIsStatic[i] != Static) {
+                continue;
+            }
+
             p.Orient(m_meshOrientation[i]);
             m_ShadowMapEffect.SetWVP(p.GetWVOrthoPTrans());
-            m_mesh.Render();
+            m_mesh.RenderDepth();
         }
-
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
     }
 
 
@@ -221,6 +251,10 @@ public:
             case OGLDEV_KEY_q:
                 OgldevBackendLeaveMainLoop();
                 break;
+            case OGLDEV_KEY_c:
+                m_shadowCache = !m_shadowCache;
+                m_shadowMapFBO.InvalidateStatic();
+                break;
             default:
                 m_pGameCamera->OnKeyboard(OgldevKey);
         }
@@ -241,11 +275,13 @@ private:
     DirectionalLight m_dirLight;
     BasicMesh m_mesh;
     Orientation m_meshOrientation[NUM_MESHES];
+    bool m_meshIsStatic[NUM_MESHES];
     BasicMesh m_quad;
     Texture* m_pGroundTex;
     ShadowMapFBO m_shadowMapFBO;
     PersProjInfo m_persProjInfo;
     OrthoProjInfo m_shadowOrthoProjInfo;
+    bool m_shadowCache;
 };
 
 
@@ -0,0 +1,49 @@
+#version 330
+
+const int NUM_CASCADES = 3;
+
+layout (triangles) in;
+layout (triangle_strip, max_vertices = 9) out;
+
+uniform mat4 gLightVP[NUM_CASCADES];    // indexed by cascade
+uniform int gCascades[NUM_CASCADES];    // the cascades the mesh touches
+uniform int gNumCascades;
+
+in vec3 WorldPos0[];
+
+// True if all the vertices are on the outer side of the same side plane.
+// The near plane is not tested because depth clamping keeps the casters
+// which are in front of the cascade.
+bool IsOutside(vec4 v0, vec4 v1, vec4 v2)
+{
+    return (v0.x < -1.0 && v1.x < -1.0 && v2.x < -1.0) ||
+           (v0.x >  1.0 && v1.x >  1.0 && v2.x >  1.0) ||
+           (v0.y < -1.0 && v1.y < -1.0 && v2.y < -1.0) ||
+           (v0.y >  1.0 && v1.y >  1.0 && v2.y >  1.0) ||
+           (v0.z >  1.0 && v1.z >  1.0 && v2.z >  1.0);
+}
+
+void main()
+{
+    for (int i = 0 ; i < gNumCascades ; i++) {
+        int Cascade = gCascades[i];
+
+        vec4 Clip[3];
+
+        for (int j = 0 ; j < 3 ; j++) {
+            Clip[j] = gLightVP[Cascade] * vec4(WorldPos0[j], 1.0);
+        }
+
+        if (IsOutside(Clip[0], Clip[1], Clip[2])) {
+            continue;
+        }
+
+        for (int j = 0 ; j < 3 ; j++) {
+            gl_Layer = Cascade;
+            gl_Position = Clip[j];
+            EmitVertex();
+        }
+
+        EndPrimitive();
+    }
+}
@@ -0,0 +1,13 @@
+#version 330
+
+layout (location = 0) in vec3 Position;
+
+uniform mat4 gWorld;
+
+out vec3 WorldPos0;
+
+// The projection into the cascades is done in the geometry shader
+void main()
+{
+    WorldPos0 = (gWorld * vec4(Position, 1.0)).xyz;
+}
@@ -0,0 +1,18 @@
+#version 330
+
+#extension GL_ARB_shader_viewport_layer_array : require
+
+const int NUM_CASCADES = 3;
+
+layout (location = 0) in vec3 Position;
+
+uniform mat4 gWorld;
+uniform mat4 gLightVP[NUM_CASCADES];    // indexed by cascade
+uniform int gCascades[NUM_CASCADES];    // the cascades the mesh touches - one per instance
+
+void main()
+{
+    int Cascade = gCascades[gl_InstanceID];
+    gl_Position = gLightVP[Cascade] * gWorld * vec4(Position, 1.0);
+    gl_Layer = Cascade;
+}
@@ -52,7 +52,7 @@ uniform DirectionalLight gDirectionalLight;
 uniform PointLight gPointLights[MAX_POINT_LIGHTS];                                          
 uniform SpotLight gSpotLights[MAX_SPOT_LIGHTS];                                             
 uniform sampler2D gSampler;                                                                 
-uniform sampler2D gShadowMap[NUM_CASCADES];
+uniform sampler2DArray gShadowMap;       // one layer per cascade
 uniform vec3 gEyeWorldPos;                                                                  
 uniform float gMatSpecularIntensity;                                                        
 uniform float gSpecularPower;
@@ -65,7 +65,7 @@ float CalcShadowFactor(int CascadeIndex, vec4 LightSpacePos)
     UVCoords.x = 0.5 * ProjCoords.x + 0.5;                                                  
     UVCoords.y = 0.5 * ProjCoords.y + 0.5;                                                  
     float z = 0.5 * ProjCoords.z + 0.5;                                                     
-    float Depth = texture(gShadowMap[CascadeIndex], UVCoords).x;                                          
+    float Depth = texture(gShadowMap, vec3(UVCoords, CascadeIndex)).x;                                          
     if (Depth < z + 0.00001)                                                                 
         return 0.5;                                                                         
     else                                                                                    
@@ -23,15 +23,40 @@
 
 CSMTechnique::CSMTechnique()
 {
+    m_layered = false;
+    m_vertexShaderLayer = false;
 }
 
 bool CSMTechnique::Init()
+{
+    return InitCommon("Shaders/csm.vs", NULL);
+}
+
+
+bool CSMTechnique::InitLayered()
+{
+    m_layered = true;
+
+    if (GLEW_ARB_shader_viewport_layer_array) {
+        m_vertexShaderLayer = true;
+        return InitCommon("Shaders/csm_vs_layer.vs", NULL);
+    }
+
+    return InitCommon("Shaders/csm_layered.vs", "Shaders/csm_layered.gs");
+}
+
+
+bool CSMTechnique::InitCommon(const char* pVSFilename, const char* pGSFilename)
 {
     if (!Technique::Init()) {
         return false;
     }
 
-    if (!AddShader(GL_VERTEX_SHADER, "Shaders/csm.vs")) {
+    if (!AddShader(GL_VERTEX_SHADER, pVSFilename)) {
+        return false;
+    }
+
+    if (pGSFilename && !AddShader(GL_GEOMETRY_SHADER, pGSFilename)) {
         return false;
     }
 
@@ -43,17 +68,70 @@ bool CSMTechnique::Init()
         return false;
     }
 
-    m_WVPLocation = GetUniformLocation("gWVP");
+    if (!m_layered) {
+        m_WVPLocation = GetUniformLocation("gWVP");
+        return (m_WVPLocation != INVALID_UNIFORM_LOCATION);
+    }
 
-    if (m_WVPLocation == INVALID_UNIFORM_LOCATION) {        
+    m_WorldMatrixLocation = GetUniformLocation("gWorld");
+
+    if (m_WorldMatrixLocation == INVALID_UNIFORM_LOCATION) {
         return false;
     }
 
+    for (uint i = 0 ; i < NUM_CASCADES ; i++) {
+        char Name[128] = { 0 };
+        SNPRINTF(Name, sizeof(Name), "gLightVP[%d]", i);
+        m_lightVPLocation[i] = GetUniformLocation(Name);
+        SNPRINTF(Name, sizeof(Name), "gCascades[%d]", i);
+        m_cascadesLocation[i] = GetUniformLocation(Name);
+
+        if (m_lightVPLocation[i] == INVALID_UNIFORM_LOCATION ||
+            m_cascadesLocation[i] == INVALID_UNIFORM_LOCATION) {
+            return false;
+        }
+    }
+
+    // The vertex shader version gets the number of cascades from the number of instances
+    if (!m_vertexShaderLayer) {
+        m_numCascadesLocation = GetUniformLocation("gNumCascades");
+
+        if (m_numCascadesLocation == INVALID_UNIFORM_LOCATION) {
+            return false;
+        }
+    }
+
     return true;
 }
 
+
 void CSMTechnique::SetWVP(const Matrix4f& WVP)
 {
     glUniformMatrix4fv(m_WVPLocation, 1, GL_TRUE, (const GLfloat*)WVP.m);
 }
 
+
+void CSMTechnique::SetWorld(const Matrix4f& World)
+{
+    glUniformMatrix4fv(m_WorldMatrixLocation, 1, GL_TRUE, (const GLfloat*)World.m);
+}
+
+
+void CSMTechnique::SetLightVPs(const Matrix4f* pVPs)
+{
+    for (uint i = 0 ; i < NUM_CASCADES ; i++) {
+        glUniformMatrix4fv(m_lightVPLocation[i], 1, GL_TRUE, (const GLfloat*)pVPs[i].m);
+    }
+}
+
+
+void CSMTechnique::SetCascades(const uint* pCascades, uint NumCascades)
+{
+    for (uint i = 0 ; i < NumCascades ; i++) {
+        glUniform1i(m_cascadesLocation[i], pCascades[i]);
+    }
+
+    if (!m_vertexShaderLayer) {
+        glUniform1i(m_numCascadesLocation, NumCascades);
+    }
+}
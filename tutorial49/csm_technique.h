@@ -21,18 +21,46 @@
 #include "technique.h"
 #include "ogldev_math_3d.h"
 
+#define NUM_CASCADES 3      // must match lighting_technique.h
+
 class CSMTechnique : public Technique {
 
 public:
 
     CSMTechnique();
 
+    // Renders one cascade per pass
     virtual bool Init();
 
+    // Renders all the cascades in a single pass into the layers of the
+    // shadow map array. When the vertex shader can write gl_Layer
+    // (ARB_shader_viewport_layer_array) every cascade is an instance of the
+    // draw. Otherwise a geometry shader replicates the triangles.
+    bool InitLayered();
+
+    bool IsVertexShaderLayer() const { return m_vertexShaderLayer; }
+
     void SetWVP(const Matrix4f& WVP);
+
+    void SetWorld(const Matrix4f& World);
+
+    void SetLightVPs(const Matrix4f* pVPs);
+
+    // The cascades that the next draw goes into
+    void SetCascades(const uint* pCascades, uint NumCascades);
+
 private:
 
+    bool InitCommon(const char* pVSFilename, const char* pGSFilename);
+
+    bool m_layered;
+    bool m_vertexShaderLayer;
+
     GLuint m_WVPLocation;
+    GLuint m_WorldMatrixLocation;
+    GLuint m_lightVPLocation[NUM_CASCADES];
+    GLuint m_cascadesLocation[NUM_CASCADES];
+    GLuint m_numCascadesLocation;
 };
 
 
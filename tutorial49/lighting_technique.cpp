@@ -76,14 +76,10 @@ bool LightingTechnique::Init()
         return false;
     }
     
-    for (uint i = 0 ; i < ARRAY_SIZE_IN_ELEMENTS(m_shadowMapLocation) ; i++) {
-        char Name[128] = { 0 };
-        SNPRINTF(Name, sizeof(Name), "gShadowMap[%d]", i);
-        m_shadowMapLocation[i] = GetUniformLocation(Name);
-        
-        if (m_shadowMapLocation[i] == INVALID_UNIFORM_LOCATION) {
-            return false;
-        }
+    m_shadowMapLocation = GetUniformLocation("gShadowMap");
+
+    if (m_shadowMapLocation == INVALID_UNIFORM_LOCATION) {
+        return false;
     }
 
     for (uint i = 0 ; i < ARRAY_SIZE_IN_ELEMENTS(m_lightWVPLocation) ; i++) {
@@ -218,11 +214,7 @@ void LightingTechnique::SetColorTextureUnit(uint TextureUnit)
 
 void LightingTechnique::SetShadowMapTextureUnit()
 {   
-    glUniform1i(m_shadowMapLocation[0], CASCACDE_SHADOW_TEXTURE_UNIT0_INDEX);
-    GLExitIfError
-    glUniform1i(m_shadowMapLocation[1], CASCACDE_SHADOW_TEXTURE_UNIT1_INDEX);
-    GLExitIfError
-    glUniform1i(m_shadowMapLocation[2], CASCACDE_SHADOW_TEXTURE_UNIT2_INDEX);
+    glUniform1i(m_shadowMapLocation, CASCACDE_SHADOW_TEXTURE_UNIT0_INDEX);
     GLExitIfError
 }
 
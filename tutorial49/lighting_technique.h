@@ -23,7 +23,7 @@
 #include "ogldev_lights_common.h"
 #include "csm_technique.h"
 
-#define NUM_CASCADES 3
+#define NUM_CASCADES 3      // must match csm_technique.h
 
 class LightingTechnique : public Technique {
 public:
@@ -55,7 +55,7 @@ private:
     GLuint m_cascadeEndClipSpace[NUM_CASCADES];
     GLuint m_worldMatrixLocation;
     GLuint m_samplerLocation;
-    GLuint m_shadowMapLocation[NUM_CASCADES];
+    GLuint m_shadowMapLocation;
     GLuint m_eyeWorldPosLocation;
     GLuint m_matSpecularIntensityLocation;
     GLuint m_matSpecularPowerLocation;
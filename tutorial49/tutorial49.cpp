@@ -48,6 +48,7 @@
 
 #define NUM_MESHES 5
 #define NUM_FRUSTUM_CORNERS 8
+#define SHADOW_MAP_SIZE 1024    // must be square for the stable cascades
 
 Quaternion g_Rotation = Quaternion(0.707f, 0.0f, 0.0f, 0.707f);
 
@@ -63,6 +64,15 @@ public:
     {
         m_pGameCamera = NULL;
         m_pGroundTex = NULL;
+        m_animate = true;
+        m_csmCache = true;
+        m_movedMeshes = 0;
+        m_numCascadesRendered = 0;
+
+        for (uint i = 0 ; i < NUM_CASCADES ; i++) {
+            m_cascadeValid[i] = false;
+            m_cachedCasters[i] = 0;
+        }
 
         m_dirLight.Name = "DirLight1";
         m_dirLight.Color = Vector3f(1.0f, 1.0f, 1.0f);
@@ -106,7 +116,7 @@ public:
             return false;
         }
 
-        if (!m_csmFBO.Init(WINDOW_WIDTH, WINDOW_HEIGHT)) {
+        if (!m_csmFBO.Init(SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, NUM_CASCADES)) {
             return false;
         }
 
@@ -144,7 +154,7 @@ public:
             return false;
         }
 
-        if (!m_ShadowMapEffect.Init()) {
+        if (!m_ShadowMapEffect.InitLayered()) {
             printf("Error initializing the shadow map technique\n");
             return false;
         }
@@ -178,6 +188,10 @@ public:
 
         m_dirLight.AddToATB(bar);
 
+        TwAddSeparator(bar, "", NULL);
+
+        TwAddVarRO(bar, "Cascades redrawn", TW_TYPE_INT32, &m_numCascadesRendered, " label='Cascades redrawn' ");
+
         float refresh = 0.1f;
         TwSetParam(bar, NULL, "refresh", TW_PARAM_FLOAT, 1, &refresh);
 
@@ -196,8 +210,11 @@ public:
 
     virtual void RenderSceneCB()
     {
-        for (int i = 0; i < NUM_MESHES ; i++) {
-            m_meshOrientation[i].m_rotation.y += 0.5f;
+        if (m_animate) {
+            for (int i = 0; i < NUM_MESHES ; i++) {
+                m_meshOrientation[i].m_rotation.y += 0.5f;
+                m_movedMeshes |= (1 << i);
+            }
         }
 
         m_pGameCamera->OnRender();
@@ -208,27 +225,92 @@ public:
     }
 
 
+    // All the cascades that need to be redrawn are rendered by a single pass
+    // into the layers of the shadow map array. Each mesh only goes into the
+    // cascades that its bounding sphere overlaps. A cascade whose projection
+    // and casters haven't changed since the previous frame keeps its contents.
     void ShadowMapPass()
     {
         CalcOrthoProjs();
 
-        m_ShadowMapEffect.Enable();
+        uint Casters[NUM_CASCADES] = { 0 };
 
-        Pipeline p;
+        for (int i = 0; i < NUM_MESHES ; i++) {
+            Pipeline p;
+            p.Orient(m_meshOrientation[i]);
+            m_meshWorld[i] = p.GetWorldTrans();
 
-        p.SetCamera(Vector3f(0.0f, 0.0f, 0.0f), m_dirLight.Direction, Vector3f(0.0f, 1.0f, 0.0f));
+            const Vector3f& Scale = m_meshOrientation[i].m_scale;
+            float Radius = m_mesh.GetBoundingSphereRadius() * MAX(Scale.x, MAX(Scale.y, Scale.z));
+            Vector4f Center = m_lightView * m_meshWorld[i] * Vector4f(m_mesh.GetBoundingSphereCenter(), 1.0f);
+
+            for (uint j = 0 ; j < NUM_CASCADES ; j++) {
+                if (IsInCascade(m_shadowOrthoProjInfo[j], Center, Radius)) {
+                    Casters[j] |= (1 << i);
+                }
+            }
+        }
+
+        uint DirtyCascades[NUM_CASCADES];
+        uint NumDirtyCascades = 0;
 
         for (uint i = 0 ; i < NUM_CASCADES ; i++) {
-            m_csmFBO.BindForWriting(i);
-            glClear(GL_DEPTH_BUFFER_BIT);
+            bool Dirty = !m_csmCache ||
+                         !m_cascadeValid[i] ||
+                         !IsSameMatrix(m_cachedLightVP[i], m_lightVP[i]) ||
+                         (m_cachedCasters[i] != Casters[i]) ||
+                         (Casters[i] & m_movedMeshes);
+
+            if (Dirty) {
+                m_csmFBO.BindForWriting(i);
+                glClear(GL_DEPTH_BUFFER_BIT);
+
+                m_cascadeValid[i] = true;
+                m_cachedLightVP[i] = m_lightVP[i];
+                m_cachedCasters[i] = Casters[i];
+                DirtyCascades[NumDirtyCascades++] = i;
+            }
+        }
 
-            p.SetOrthographicProj(m_shadowOrthoProjInfo[i]);
+        m_numCascadesRendered = NumDirtyCascades;
+        m_movedMeshes = 0;
+
+        if (NumDirtyCascades > 0) {
+            m_ShadowMapEffect.Enable();
+            m_ShadowMapEffect.SetLightVPs(m_lightVP);
+
+            m_csmFBO.BindForWritingLayered();
+
+            // Casters between the light and the near plane of a cascade are
+            // flattened onto the near plane instead of being clipped
+            glEnable(GL_DEPTH_CLAMP);
 
             for (int i = 0; i < NUM_MESHES ; i++) {
-                p.Orient(m_meshOrientation[i]);
-                m_ShadowMapEffect.SetWVP(p.GetWVOrthoPTrans());
-                m_mesh.Render();
+                uint MeshCascades[NUM_CASCADES];
+                uint NumMeshCascades = 0;
+
+                for (uint j = 0 ; j < NumDirtyCascades ; j++) {
+                    if (Casters[DirtyCascades[j]] & (1 << i)) {
+                        MeshCascades[NumMeshCascades++] = DirtyCascades[j];
+                    }
+                }
+
+                if (NumMeshCascades == 0) {
+                    continue;
+                }
+
+                m_ShadowMapEffect.SetWorld(m_meshWorld[i]);
+                m_ShadowMapEffect.SetCascades(MeshCascades, NumMeshCascades);
+
+                if (m_ShadowMapEffect.IsVertexShaderLayer()) {
+                    m_mesh.RenderDepth(NumMeshCascades);
+                }
+                else {
+                    m_mesh.RenderDepth();
+                }
             }
+
+            glDisable(GL_DEPTH_CLAMP);
         }
 
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -247,15 +329,13 @@ public:
 
         Pipeline p;
         p.Orient(m_quad.GetOrientation());
+        p.SetCamera(m_pGameCamera->GetPos(), m_pGameCamera->GetTarget(), m_pGameCamera->GetUp());
+        p.SetPerspectiveProj(m_persProjInfo);
 
-        p.SetCamera(Vector3f(0.0f, 0.0f, 0.0f), m_dirLight.Direction, Vector3f(0.0f, 1.0f, 0.0f));
         for (uint i = 0 ; i < NUM_CASCADES ; i++) {
-            p.SetOrthographicProj(m_shadowOrthoProjInfo[i]);
-            m_LightingTech.SetLightWVP(i, p.GetWVOrthoPTrans());
+            m_LightingTech.SetLightWVP(i, m_lightVP[i] * p.GetWorldTrans());
         }
 
-        p.SetCamera(m_pGameCamera->GetPos(), m_pGameCamera->GetTarget(), m_pGameCamera->GetUp());
-        p.SetPerspectiveProj(m_persProjInfo);
         m_LightingTech.SetWVP(p.GetWVPTrans());
         m_LightingTech.SetWorldMatrix(p.GetWorldTrans());
         m_pGroundTex->Bind(COLOR_TEXTURE_UNIT);
@@ -264,6 +344,11 @@ public:
 
         for (int i = 0; i < NUM_MESHES ; i++) {
             p.Orient(m_meshOrientation[i]);
+
+            for (uint j = 0 ; j < NUM_CASCADES ; j++) {
+                m_LightingTech.SetLightWVP(j, m_lightVP[j] * p.GetWorldTrans());
+            }
+
             m_LightingTech.SetWVP(p.GetWVPTrans());
             m_LightingTech.SetWorldMatrix(p.GetWorldTrans());
             m_mesh.Render();
@@ -293,6 +378,12 @@ public:
             case OGLDEV_KEY_q:
                 OgldevBackendLeaveMainLoop();
                 break;
+            case OGLDEV_KEY_p:
+                m_animate = !m_animate;
+                break;
+            case OGLDEV_KEY_c:
+                m_csmCache = !m_csmCache;
+                break;
             default:
                 m_pGameCamera->OnKeyboard(OgldevKey);
         }
@@ -314,6 +405,12 @@ public:
 
 private:
 
+    // Every cascade is an ortho box around the bounding sphere of its slice
+    // of the view frustum. The size of the sphere doesn't depend on the
+    // orientation of the camera and its center is snapped to whole shadow map
+    // texels. This removes the shimmering of the shadow edges when the camera
+    // moves and keeps the projection of a cascade exactly the same across
+    // frames as long as the camera stays inside the same texel.
     void CalcOrthoProjs()
     {
         Pipeline p;
@@ -323,23 +420,18 @@ private:
         Matrix4f CamInv = Cam.Inverse();
 
         p.SetCamera(Vector3f(0.0f, 0.0f, 0.0f), m_dirLight.Direction, Vector3f(0.0f, 1.0f, 0.0f));
-        Matrix4f LightM = p.GetViewTrans();
+        m_lightView = p.GetViewTrans();
 
         float ar = m_persProjInfo.Height / m_persProjInfo.Width;
         float tanHalfHFOV = tanf(ToRadian(m_persProjInfo.FOV / 2.0f));
         float tanHalfVFOV = tanf(ToRadian((m_persProjInfo.FOV * ar) / 2.0f));
 
-        printf("ar %f tanHalfHFOV %f tanHalfVFOV %f\n", ar, tanHalfHFOV, tanHalfVFOV);
-
         for (uint i = 0 ; i < NUM_CASCADES ; i++) {
             float xn = m_cascadeEnd[i]     * tanHalfHFOV;
             float xf = m_cascadeEnd[i + 1] * tanHalfHFOV;
             float yn = m_cascadeEnd[i]     * tanHalfVFOV;
             float yf = m_cascadeEnd[i + 1] * tanHalfVFOV;
 
-            printf("xn %f xf %f\n", xn, xf);
-            printf("yn %f yf %f\n", yn, yf);
-
             Vector4f frustumCorners[NUM_FRUSTUM_CORNERS] = {
                 // near face
                 Vector4f(xn,   yn, m_cascadeEnd[i], 1.0),
@@ -354,43 +446,71 @@ private:
                 Vector4f(-xf, -yf, m_cascadeEnd[i + 1], 1.0)
             };
 
-            Vector4f frustumCornersL[NUM_FRUSTUM_CORNERS];
+            Vector3f frustumCornersW[NUM_FRUSTUM_CORNERS];
+            Vector3f Center(0.0f, 0.0f, 0.0f);
+
+            for (uint j = 0 ; j < NUM_FRUSTUM_CORNERS ; j++) {
+                frustumCornersW[j] = Vector3f(CamInv * frustumCorners[j]);
+                Center += frustumCornersW[j];
+            }
+
+            Center = Center * (1.0f / NUM_FRUSTUM_CORNERS);
 
-            float minX = std::numeric_limits<float>::max();
-            float maxX = std::numeric_limits<float>::min();
-            float minY = std::numeric_limits<float>::max();
-            float maxY = std::numeric_limits<float>::min();
-            float minZ = std::numeric_limits<float>::max();
-            float maxZ = std::numeric_limits<float>::min();
+            float Radius = 0.0f;
 
             for (uint j = 0 ; j < NUM_FRUSTUM_CORNERS ; j++) {
-                printf("Frustum: ");
-                Vector4f vW = CamInv * frustumCorners[j];
-                vW.Print();
-                printf("Light space: ");
-                frustumCornersL[j] = LightM * vW;
-                frustumCornersL[j].Print();
-                printf("\n");
-
-                minX = min(minX, frustumCornersL[j].x);
-                maxX = max(maxX, frustumCornersL[j].x);
-                minY = min(minY, frustumCornersL[j].y);
-                maxY = max(maxY, frustumCornersL[j].y);
-                minZ = min(minZ, frustumCornersL[j].z);
-                maxZ = max(maxZ, frustumCornersL[j].z);
+                Radius = MAX(Radius, (frustumCornersW[j] - Center).Length());
             }
 
-            printf("BB: %f %f %f %f %f %f\n", minX, maxX, minY, maxY, minZ, maxZ);
+            // Round up to get rid of floating point noise in the size of the cascade
+            Radius = ceilf(Radius * 16.0f) / 16.0f;
 
-            m_shadowOrthoProjInfo[i].r = maxX;
-            m_shadowOrthoProjInfo[i].l = minX;
-            m_shadowOrthoProjInfo[i].b = minY;
-            m_shadowOrthoProjInfo[i].t = maxY;
-            m_shadowOrthoProjInfo[i].f = maxZ;
-            m_shadowOrthoProjInfo[i].n = minZ;
+            float TexelSize = 2.0f * Radius / SHADOW_MAP_SIZE;
+
+            Vector4f CenterL = m_lightView * Vector4f(Center, 1.0f);
+            CenterL.x = floorf(CenterL.x / TexelSize) * TexelSize;
+            CenterL.y = floorf(CenterL.y / TexelSize) * TexelSize;
+            CenterL.z = floorf(CenterL.z / TexelSize) * TexelSize;
+
+            m_shadowOrthoProjInfo[i].r = CenterL.x + Radius;
+            m_shadowOrthoProjInfo[i].l = CenterL.x - Radius;
+            m_shadowOrthoProjInfo[i].b = CenterL.y - Radius;
+            m_shadowOrthoProjInfo[i].t = CenterL.y + Radius;
+            m_shadowOrthoProjInfo[i].f = CenterL.z + Radius;
+            m_shadowOrthoProjInfo[i].n = CenterL.z - Radius;
+
+            Matrix4f Ortho;
+            Ortho.InitOrthoProjTransform(m_shadowOrthoProjInfo[i]);
+            m_lightVP[i] = Ortho * m_lightView;
+        }
+    }
+
+
+    // Center is in light space. A caster that is closer to the light than the
+    // near plane still shadows the cascade so only the far plane is tested.
+    static bool IsInCascade(const OrthoProjInfo& Proj, const Vector4f& Center, float Radius)
+    {
+        return (Center.x + Radius >= Proj.l) && (Center.x - Radius <= Proj.r) &&
+               (Center.y + Radius >= Proj.b) && (Center.y - Radius <= Proj.t) &&
+               (Center.z - Radius <= Proj.f);
+    }
+
+
+    // The light VP of a cascade covers both its projection and the light
+    // direction so the cached contents are dropped when either changes
+    static bool IsSameMatrix(const Matrix4f& l, const Matrix4f& r)
+    {
+        for (uint i = 0 ; i < 4 ; i++) {
+            for (uint j = 0 ; j < 4 ; j++) {
+                if (l.m[i][j] != r.m[i][j]) {
+                    return false;
                 }
+            }
         }
 
+        return true;
+    }
+
     LightingTechnique m_LightingTech;
     CSMTechnique m_ShadowMapEffect;
     Camera* m_pGameCamera;
@@ -402,6 +522,18 @@ private:
     CascadedShadowMapFBO m_csmFBO;
     PersProjInfo m_persProjInfo;
     OrthoProjInfo m_shadowOrthoProjInfo[NUM_CASCADES];
+    Matrix4f m_lightView;
+    Matrix4f m_lightVP[NUM_CASCADES];
+    Matrix4f m_meshWorld[NUM_MESHES];
+
+    // Shadow map cache
+    bool m_csmCache;
+    bool m_cascadeValid[NUM_CASCADES];
+    Matrix4f m_cachedLightVP[NUM_CASCADES];
+    uint m_cachedCasters[NUM_CASCADES];     // bit per mesh
+    uint m_movedMeshes;                     // bit per mesh
+    int m_numCascadesRendered;
+    bool m_animate;
     float m_cascadeEnd[NUM_CASCADES + 1];
     ATB m_atb;
     TwBar *bar;